@@ -30,9 +30,10 @@ class FcnArgs: public kArgs {
         FcnArgs(unsigned int p_Aoffset, unsigned int p_Boffset,
                 unsigned int p_Coffset, unsigned int p_Xoffset, unsigned int p_M, unsigned int p_K,
                 unsigned int p_N, unsigned int p_Lda, unsigned int p_Ldb,
-                unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift, short prelu_scale, short prelu_alpha) :              
+                unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift, short prelu_scale, short prelu_alpha,
+                bool p_TransA = false, bool p_TransB = false, bool p_TransC = false) :              
                 m_fcn_args( { OpFcn, p_Aoffset, p_Boffset, p_Coffset, p_Xoffset, p_M, p_K,
-                    p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, 0, 0, 0 }) {
+                    p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, 0, p_TransA, p_TransB, p_TransC, {0, 0, 0}, {0} }) {
                 m_fcn_args.m_postScaleVal = (post_scale << 8) | (post_shift & 0x000000ff);
                 m_fcn_args.m_PReLUVal = (prelu_scale << 6) | (prelu_alpha & 0x003f);
             }
@@ -42,6 +43,9 @@ class FcnArgs: public kArgs {
         char *asByteArray() {
             return reinterpret_cast<char*>(&m_fcn_args);
         }
+        unsigned int numPageOffsets() {
+            return 4;
+        }
 
     protected:
         struct {
@@ -49,8 +53,9 @@ class FcnArgs: public kArgs {
             unsigned int m_Aoffset, m_Boffset, m_Coffset, m_Xoffset, m_M, m_K, m_N, m_Lda, m_Ldb, m_Ldc, m_Ldx;
             int m_postScaleVal;
             short m_PReLUVal;
-            short s_dummy;
-            int dummy[2];
+            bool m_TransA, m_TransB, m_TransC;
+            char c_dummy[3];
+            int dummy[1];
         } m_fcn_args;
 };
 template<typename HType>
@@ -67,8 +72,15 @@ template<typename HType>
             return AddFCNOp (A, B, C, bias, m, k, n, k, n, n, n, postScale, postShift, 1, 0);
         }
 
-        virtual bool AddGEMMOp(const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
-            return AddFCNOp (A, B, C, bias, m, k, n, k, n, n, n, postScale, postShift, 1, 0);
+        virtual bool AddGEMMOp(const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
+            return AddFCNOp (A, B, C, bias, m, k, n, lda, ldb, ldc, ldx, postScale, postShift, 1, 0, transA, transB, transC);
+        }
+
+        virtual bool AddGEMMOpAt(unsigned long long A_off, unsigned long long B_off, unsigned long long C_off, unsigned long long X_off, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
+            FcnArgs args(A_off, B_off, C_off, X_off, m,
+                    k, n, lda, ldb, ldc, ldx, postScale, postShift, 1, 0, transA, transB, transC);
+            this->AddInstr ( &args);
+            return true;
         }
 
         virtual bool AddFCNOp ( const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift, short PReLUScale, short PReLUAlpha)
@@ -76,56 +88,24 @@ template<typename HType>
             return AddFCNOp ( A, B, C, bias, m, k, n, k, n, n, n,postScale, postShift, PReLUScale, PReLUAlpha);
         }
 
-        virtual bool AddFCNOp ( const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha)
+        // Transposed operands as for GEMMHost::AddGEMMOp
+        virtual bool AddFCNOp ( const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha, bool transA = false, bool transB = false, bool transC = false)
         {
             XTimer t;
-            if (this->_hostMat.find(A) == this->_hostMat.end()
-                    || this->_hostMat.find(B) == this->_hostMat.end()
-                    || this->_hostMat.find(C) == this->_hostMat.end()
-                    || this->_hostMat.find(bias) == this->_hostMat.end()) {
+            unsigned int l_ids[4];
+            if (!this->FindMats({A, B, C, bias}, false, l_ids)) {
                 cerr << "Matrix not found!" << endl;
                 return false;
             }
 
             unsigned long long A_off = 0, B_off = 0, C_off = 0, X_off = 0;
-
-            xclGetMemObjDeviceAddress(this->_devHandle[A](),
-                    (this->_fpga_stream->getDevice())(),
-                    sizeof(unsigned long long), &A_off);
-            xclGetMemObjDeviceAddress(this->_devHandle[B](),
-                    (this->_fpga_stream->getDevice())(),
-                    sizeof(unsigned long long), &B_off);
-            xclGetMemObjDeviceAddress(this->_devHandle[C](),
-                    (this->_fpga_stream->getDevice())(),
-                    sizeof(unsigned long long), &C_off);
-
-            if ( this->_devHandle.find(bias) != this->_devHandle.end()){
-                xclGetMemObjDeviceAddress(this->_devHandle[bias](),
-                        (this->_fpga_stream->getDevice())(),
-                        sizeof(unsigned long long), &X_off);
-                assert(X_off > this->_ddrDeviceBaseAddr);
-                X_off -= this->_ddrDeviceBaseAddr;
-            }
-
-            assert(A_off > this->_ddrDeviceBaseAddr);
-            assert(B_off > this->_ddrDeviceBaseAddr);
-            assert(C_off > this->_ddrDeviceBaseAddr);
-            A_off -= this->_ddrDeviceBaseAddr;
-            B_off -= this->_ddrDeviceBaseAddr;
-            C_off -= this->_ddrDeviceBaseAddr;
-
-            assert(A_off % this->PAGE_SIZE == 0);
-            assert(B_off % this->PAGE_SIZE == 0);
-            assert(C_off % this->PAGE_SIZE == 0);
-            assert(X_off % this->PAGE_SIZE == 0);
-
-            A_off /= this->PAGE_SIZE;
-            B_off /= this->PAGE_SIZE;
-            C_off /= this->PAGE_SIZE;
-            X_off /= this->PAGE_SIZE;
+            A_off = this->GetIdPageOffset(l_ids[0]);
+            B_off = this->GetIdPageOffset(l_ids[1]);
+            C_off = this->GetIdPageOffset(l_ids[2]);
+            X_off = this->GetIdPageOffset(l_ids[3]);
 
             FcnArgs args(A_off, B_off, C_off, X_off, m,
-                    k, n, lda, ldb, ldc, ldx, postScale, postShift,  PReLUScale, PReLUAlpha);
+                    k, n, lda, ldb, ldc, ldx, postScale, postShift,  PReLUScale, PReLUAlpha, transA, transB, transC);
             this->AddInstr ( &args);
             #ifdef GEMX_PERF_DBG
             cout << "AddFCNOp: " << t.elapsed() << endl;
@@ -141,19 +121,17 @@ template<typename HType>
         virtual bool AddFCNDevOp ( const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha)
         {
             XTimer t;
-            if (this->_hostMatPageOffset.find(A) == this->_hostMatPageOffset.end()
-                    || this->_hostMatPageOffset.find(B) == this->_hostMatPageOffset.end()
-                    || this->_hostMatPageOffset.find(C) == this->_hostMatPageOffset.end()
-                    || this->_hostMatPageOffset.find(bias) == this->_hostMatPageOffset.end()) {
+            unsigned int l_ids[4];
+            if (!this->FindMats({A, B, C, bias}, true, l_ids)) {
                 cerr << "Matrix not found!" << endl;
                 return false;
             }
 
             unsigned long long A_off = 0, B_off = 0, C_off = 0, X_off = 0;
-            A_off = this->GetMatOffset(A);
-            B_off = this->GetMatOffset(B);
-            C_off = this->GetMatOffset(C);
-            X_off = this->GetMatOffset(bias);
+            A_off = this->GetIdPageOffset(l_ids[0]);
+            B_off = this->GetIdPageOffset(l_ids[1]);
+            C_off = this->GetIdPageOffset(l_ids[2]);
+            X_off = this->GetIdPageOffset(l_ids[3]);
 
             FcnArgs args(A_off, B_off, C_off, X_off, m,
                     k, n, lda, ldb, ldc, ldx, postScale, postShift,  PReLUScale, PReLUAlpha);
@@ -0,0 +1,298 @@
+/**********
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+* **********/
+#ifndef _GEMM_AUTO_H_
+#define _GEMM_AUTO_H_
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "gemm_host.h"
+#include "xcpu.h"
+
+using namespace std;
+namespace gemx {
+
+// One deque per worker. A worker pops from the front of its own deque and
+// steals from the back of the others once it runs dry.
+class WorkStealingQueue {
+public:
+    WorkStealingQueue(unsigned int p_workers) : m_Queues(p_workers), m_Mutex(p_workers) {
+    }
+
+    void push(unsigned int p_worker, unsigned int p_item) {
+        lock_guard<mutex> l_lock(m_Mutex[p_worker]);
+        m_Queues[p_worker].push_back(p_item);
+    }
+
+    bool pop(unsigned int p_worker, unsigned int & p_item) {
+        {
+            lock_guard<mutex> l_lock(m_Mutex[p_worker]);
+            if (!m_Queues[p_worker].empty()) {
+                p_item = m_Queues[p_worker].front();
+                m_Queues[p_worker].pop_front();
+                return true;
+            }
+        }
+        for (unsigned int i = 1; i < m_Queues.size(); ++i) {
+            unsigned int l_victim = (p_worker + i) % m_Queues.size();
+            lock_guard<mutex> l_lock(m_Mutex[l_victim]);
+            if (!m_Queues[l_victim].empty()) {
+                p_item = m_Queues[l_victim].back();
+                m_Queues[l_victim].pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    vector<deque<unsigned int> > m_Queues;
+    vector<mutex> m_Mutex;
+};
+
+// Runs one C = A * B + X on all PEs. M is cut into row tiles that are sent
+// and read back as sub-buffers of the caller's matrices. When M is too small
+// to give every PE a tile, column strips of B, X and C are packed into
+// scratch matrices instead. Each PE keeps one tile in flight while it sends
+// the next one.
+class GemmAuto {
+public:
+    static const unsigned int TILES_PER_PE = 4;
+
+    GemmAuto(const vector<shared_ptr<GEMMHost<void*> > > & p_hosts, const CpuConfig & p_cfg) :
+        m_Hosts(p_hosts),
+        m_mMin(p_cfg.gemmMBlocks() * p_cfg.ddrWidth()),
+        m_kMin(p_cfg.gemmKBlocks() * p_cfg.ddrWidth()),
+        m_nMin(p_cfg.gemmNBlocks() * p_cfg.ddrWidth()) {
+    }
+
+    template<typename T, typename TX>
+    bool Run(T * A, T * B, T * C, TX * X, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift) {
+        XTimer t;
+        if (m_Hosts.empty()) {
+            cerr << "ERROR: no GEMM host created" << endl;
+            return false;
+        }
+        if (m == 0 || k == 0 || n == 0 || m % m_mMin != 0 || k % m_kMin != 0 || n % m_nMin != 0) {
+            cerr << "ERROR: GEMM " << m << "x" << k << "x" << n << " must be multiple of "
+                 << m_mMin << "x" << m_kMin << "x" << m_nMin << endl;
+            return false;
+        }
+        unsigned int l_pes = m_Hosts.size();
+        vector<Tile> l_tiles = Plan(m, k, n, sizeof(T), sizeof(TX), l_pes);
+
+        WorkStealingQueue l_queue(l_pes);
+        for (unsigned int i = 0; i < l_tiles.size(); ++i) {
+            l_queue.push((unsigned long long)i * l_pes / l_tiles.size(), i);
+        }
+
+        atomic<bool> l_ok(true);
+        vector<thread> l_workers;
+        for (unsigned int p = 0; p < l_pes; ++p) {
+            l_workers.push_back(thread([&, p]() {
+                if (!RunTiles(p, l_queue, l_tiles, A, B, C, X, m, k, n, postScale, postShift)) {
+                    l_ok = false;
+                }
+            }));
+        }
+        for (auto & l_worker : l_workers) {
+            l_worker.join();
+        }
+        #ifdef GEMX_PERF_DBG
+        cout << "GemmAuto: " << l_tiles.size() << " tiles on " << l_pes << " PEs " << t.elapsed() << endl;
+        #endif
+        return l_ok;
+    }
+
+private:
+    static const unsigned int PAGE_SIZE = 4096;
+
+    struct Tile {
+        unsigned int m_Row, m_Rows, m_Col, m_Cols;
+    };
+
+    struct InFlight {
+        unsigned int m_Tile;
+        unsigned int m_Slot;
+        XBuf m_C;
+        void * m_Scratch[3];
+    };
+
+    vector<Tile> Plan(unsigned int m, unsigned int k, unsigned int n, size_t p_szT, size_t p_szX, unsigned int p_pes) {
+        vector<Tile> l_tiles;
+        unsigned int l_target = p_pes * TILES_PER_PE;
+        unsigned int l_mBlocks = m / m_mMin, l_nBlocks = n / m_nMin;
+        // row tiles are sub-buffers, so every tile must start on a page
+        bool l_rowsAligned = ((unsigned long long)m_mMin * k * p_szT % PAGE_SIZE == 0)
+                          && ((unsigned long long)m_mMin * n * p_szT % PAGE_SIZE == 0)
+                          && ((unsigned long long)m_mMin * n * p_szX % PAGE_SIZE == 0);
+        if (l_rowsAligned && (l_mBlocks >= p_pes || l_nBlocks == 1)) {
+            unsigned int l_per = max(1u, (l_mBlocks + l_target - 1) / l_target);
+            for (unsigned int b = 0; b < l_mBlocks; b += l_per) {
+                Tile l_tile = { b * m_mMin, min(l_per, l_mBlocks - b) * m_mMin, 0, n };
+                l_tiles.push_back(l_tile);
+            }
+        } else {
+            unsigned int l_per = max(1u, (l_nBlocks + l_target - 1) / l_target);
+            for (unsigned int b = 0; b < l_nBlocks; b += l_per) {
+                Tile l_tile = { 0, m, b * m_nMin, min(l_per, l_nBlocks - b) * m_nMin };
+                l_tiles.push_back(l_tile);
+            }
+        }
+        return l_tiles;
+    }
+
+    template<typename T>
+    static T * AllocScratch(unsigned long long p_elems) {
+        unsigned long long l_sz = (p_elems * sizeof(T) + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        return (T*)aligned_alloc(PAGE_SIZE, l_sz);
+    }
+
+    template<typename T, typename TX>
+    bool RunTiles(unsigned int p_pe, WorkStealingQueue & p_queue, const vector<Tile> & p_tiles,
+            T * A, T * B, T * C, TX * X, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift) {
+        GEMMHost<void*> & l_host = *m_Hosts[p_pe];
+        bool l_ok = true;
+        // matrices this call registers are dropped again at the end
+        vector<void*> l_added;
+        auto l_addMat = [&](void * p_mat, unsigned long long p_sz) {
+            if (l_host.GetMat(p_mat) == nullptr) {
+                l_added.push_back(p_mat);
+            }
+            l_host.AddMat(p_mat, p_mat, p_sz);
+        };
+        bool l_bSent = false;
+        XBuf l_bBuf;
+        InFlight l_prev;
+        bool l_hasPrev = false;
+
+        auto l_finish = [&](InFlight & p_fl) {
+            const Tile & l_tile = p_tiles[p_fl.m_Tile];
+            l_host.GetRegion(p_fl.m_C, true, p_fl.m_Slot);
+            if (p_fl.m_Scratch[0] != nullptr) {
+                T * l_c = (T*)p_fl.m_Scratch[2];
+                for (unsigned int i = 0; i < m; ++i) {
+                    memcpy(C + (size_t)i * n + l_tile.m_Col, l_c + (size_t)i * l_tile.m_Cols, l_tile.m_Cols * sizeof(T));
+                }
+                for (unsigned int i = 0; i < 3; ++i) {
+                    l_host.RemoveMat(p_fl.m_Scratch[i]);
+                    free(p_fl.m_Scratch[i]);
+                }
+            }
+        };
+
+        unsigned int l_idx;
+        while (l_ok && p_queue.pop(p_pe, l_idx)) {
+            const Tile & l_tile = p_tiles[l_idx];
+            InFlight l_fl = { l_idx, 0, XBuf(), { nullptr, nullptr, nullptr } };
+            XBuf l_a, l_b, l_x;
+            unsigned int l_rows = l_tile.m_Rows, l_cols = l_tile.m_Cols;
+            if (l_cols == n) {
+                if (!l_bSent) {
+                    l_addMat(B, (unsigned long long)k * n * sizeof(T));
+                    l_ok = l_host.GetMatRegion(B, 0, (unsigned long long)k * n * sizeof(T), l_bBuf);
+                    l_host.SendRegion(l_bBuf);
+                    l_addMat(A, (unsigned long long)m * k * sizeof(T));
+                    l_addMat(C, (unsigned long long)m * n * sizeof(T));
+                    l_addMat(X, (unsigned long long)m * n * sizeof(TX));
+                    l_bSent = true;
+                }
+                l_b = l_bBuf;
+                l_ok = l_ok
+                    && l_host.GetMatRegion(A, (unsigned long long)l_tile.m_Row * k * sizeof(T), (unsigned long long)l_rows * k * sizeof(T), l_a)
+                    && l_host.GetMatRegion(C, (unsigned long long)l_tile.m_Row * n * sizeof(T), (unsigned long long)l_rows * n * sizeof(T), l_fl.m_C)
+                    && l_host.GetMatRegion(X, (unsigned long long)l_tile.m_Row * n * sizeof(TX), (unsigned long long)l_rows * n * sizeof(TX), l_x);
+            } else {
+                if (!l_bSent) {
+                    l_addMat(A, (unsigned long long)m * k * sizeof(T));
+                    l_ok = l_host.GetMatRegion(A, 0, (unsigned long long)m * k * sizeof(T), l_a);
+                    l_host.SendRegion(l_a);
+                    l_bSent = true;
+                } else {
+                    l_ok = l_host.GetMatRegion(A, 0, (unsigned long long)m * k * sizeof(T), l_a);
+                }
+                T * l_bS = AllocScratch<T>((unsigned long long)k * l_cols);
+                TX * l_xS = AllocScratch<TX>((unsigned long long)m * l_cols);
+                T * l_cS = AllocScratch<T>((unsigned long long)m * l_cols);
+                if (l_bS == nullptr || l_xS == nullptr || l_cS == nullptr) {
+                    cerr << "ERROR: GemmAuto failed to allocate the scratch matrices of a " << m << " x " << l_cols << " tile" << endl;
+                    free(l_bS);
+                    free(l_xS);
+                    free(l_cS);
+                    l_ok = false;
+                } else {
+                    for (unsigned int i = 0; i < k; ++i) {
+                        memcpy(l_bS + (size_t)i * l_cols, B + (size_t)i * n + l_tile.m_Col, l_cols * sizeof(T));
+                    }
+                    for (unsigned int i = 0; i < m; ++i) {
+                        memcpy(l_xS + (size_t)i * l_cols, X + (size_t)i * n + l_tile.m_Col, l_cols * sizeof(TX));
+                    }
+                    l_fl.m_Scratch[0] = l_bS;
+                    l_fl.m_Scratch[1] = l_xS;
+                    l_fl.m_Scratch[2] = l_cS;
+                    l_host.AddMat(l_bS, l_bS, (unsigned long long)k * l_cols * sizeof(T));
+                    l_host.AddMat(l_xS, l_xS, (unsigned long long)m * l_cols * sizeof(TX));
+                    l_host.AddMat(l_cS, l_cS, (unsigned long long)m * l_cols * sizeof(T));
+                    l_ok = l_ok
+                        && l_host.GetMatRegion(l_bS, 0, (unsigned long long)k * l_cols * sizeof(T), l_b)
+                        && l_host.GetMatRegion(l_xS, 0, (unsigned long long)m * l_cols * sizeof(TX), l_x)
+                        && l_host.GetMatRegion(l_cS, 0, (unsigned long long)m * l_cols * sizeof(T), l_fl.m_C);
+                    l_host.SendRegion(l_b);
+                }
+            }
+            if (l_ok) {
+                if (l_cols == n) {
+                    l_host.SendRegion(l_a);
+                }
+                l_host.SendRegion(l_x);
+                l_host.ClearInstrBuf();
+                l_ok = l_host.AddGEMMOpAt(l_host.GetDevPageOffset(l_a), l_host.GetDevPageOffset(l_b),
+                        l_host.GetDevPageOffset(l_fl.m_C), l_host.GetDevPageOffset(l_x),
+                        l_rows, k, l_cols, k, l_cols, l_cols, l_cols, postScale, postShift);
+            }
+            if (l_ok) {
+                l_host.Execute(false);
+                l_fl.m_Slot = l_host.GetLastSlot();
+                if (l_hasPrev) {
+                    l_finish(l_prev);
+                }
+                l_prev = l_fl;
+                l_hasPrev = true;
+            } else if (l_fl.m_Scratch[0] != nullptr) {
+                for (unsigned int i = 0; i < 3; ++i) {
+                    l_host.RemoveMat(l_fl.m_Scratch[i]);
+                    free(l_fl.m_Scratch[i]);
+                }
+            }
+        }
+        if (l_hasPrev) {
+            l_finish(l_prev);
+        }
+        l_host.ClearInstrBuf();
+        for (auto l_mat : l_added) {
+            l_host.RemoveMat(l_mat);
+        }
+        return l_ok;
+    }
+
+    vector<shared_ptr<GEMMHost<void*> > > m_Hosts;
+    unsigned int m_mMin, m_kMin, m_nMin;
+};
+
+}
+#endif
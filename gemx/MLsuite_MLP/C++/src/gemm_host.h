@@ -30,9 +30,10 @@ public:
     GemmArgs(unsigned int p_Aoffset, unsigned int p_Boffset,
             unsigned int p_Coffset, unsigned int p_Xoffset, unsigned int p_M, unsigned int p_K,
             unsigned int p_N, unsigned int p_Lda, unsigned int p_Ldb,
-            unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift) :
+            unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift,
+            bool p_TransA = false, bool p_TransB = false, bool p_TransC = false) :
                 m_gemm_args( { int(OpGemm),  p_Aoffset, p_Boffset, p_Coffset, p_Xoffset, p_M, p_K,
-        p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, 0, 0, 0 }) {
+        p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, p_TransA, p_TransB, p_TransC, 0, {0, 0} }) {
         m_gemm_args.m_postScaleVal = (post_scale << 8) | (post_shift & 0x000000ff);
     }
     size_t sizeInBytes() {
@@ -41,6 +42,9 @@ public:
     char *asByteArray() {
         return reinterpret_cast<char*>(&m_gemm_args);
     }
+    unsigned int numPageOffsets() {
+        return 4;
+    }
 
 protected:
     struct {
@@ -48,7 +52,10 @@ protected:
         unsigned int m_Aoffset, m_Boffset, m_Coffset, m_Xoffset, m_M, m_K, m_N,
         m_Lda, m_Ldb, m_Ldc, m_Ldx;
     int m_postScaleVal;
-        int dummy[3];
+        // A stored K x M, B stored N x K, X and C stored N x M
+        bool m_TransA, m_TransB, m_TransC;
+        char c_dummy;
+        int dummy[2];
     } m_gemm_args;
 };
 
@@ -75,46 +82,33 @@ public:
         return AddGEMMOp (A, B, C, bias, m, k, n, k, n, n, n, postScale, postShift);
     }
 
-    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
+    // Transposed operands are stored as K x M (A), N x K (B) and N x M (C and bias),
+    // with the leading dimensions of the stored matrices
+    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
         XTimer t;
-        if (this->_hostMat.find(A) == this->_hostMat.end()
-                || this->_hostMat.find(B) == this->_hostMat.end()
-                || this->_hostMat.find(C) == this->_hostMat.end()
-                || this->_hostMat.find(bias) == this->_hostMat.end()) {
+        unsigned int l_ids[4];
+        if (!this->FindMats({A, B, C, bias}, false, l_ids)) {
             cerr << "Matrix not found!" << endl;
             return false;
         }
         unsigned long long A_off = 0, B_off = 0, C_off = 0, X_off = 0;
-        xclGetMemObjDeviceAddress(this->_devHandle[A].get(),XHost<HType>::_fpga_stream->m_Device.get(),sizeof(unsigned long long), &A_off);
-        xclGetMemObjDeviceAddress(this->_devHandle[B].get(),XHost<HType>::_fpga_stream->m_Device.get(),sizeof(unsigned long long), &B_off);
-        xclGetMemObjDeviceAddress(this->_devHandle[C].get(),XHost<HType>::_fpga_stream->m_Device.get(),sizeof(unsigned long long), &C_off);
-
-        if ( this->_devHandle.find(bias) != this->_devHandle.end()){
-            xclGetMemObjDeviceAddress(this->_devHandle[bias].get(),XHost<HType>::_fpga_stream->m_Device.get(),sizeof(unsigned long long), &X_off);
-            assert(X_off > this->_ddrDeviceBaseAddr);
-            X_off -= this->_ddrDeviceBaseAddr;
-        }
-
-       // cout << "A_dev_addr: " << A_off << " B_dev_addr: " << B_off << " C_dev_addr: " << C_off << " X_dev_addr: " << X_off << endl;
-        assert(A_off > this->_ddrDeviceBaseAddr);
-        assert(B_off > this->_ddrDeviceBaseAddr);
-        assert(C_off > this->_ddrDeviceBaseAddr);
-        A_off -= this->_ddrDeviceBaseAddr;
-        B_off -= this->_ddrDeviceBaseAddr;
-        C_off -= this->_ddrDeviceBaseAddr;
-
-        assert(A_off % this->PAGE_SIZE == 0);
-        assert(B_off % this->PAGE_SIZE == 0);
-        assert(C_off % this->PAGE_SIZE == 0);
-        assert(X_off % this->PAGE_SIZE == 0);
+        A_off = this->GetIdPageOffset(l_ids[0]);
+        B_off = this->GetIdPageOffset(l_ids[1]);
+        C_off = this->GetIdPageOffset(l_ids[2]);
+        X_off = this->GetIdPageOffset(l_ids[3]);
+        return AddGEMMOpAt(A_off, B_off, C_off, X_off, m, k, n, lda, ldb, ldc, ldx, postScale, postShift, transA, transB, transC);
+    }
 
-        A_off /= this->PAGE_SIZE;
-        B_off /= this->PAGE_SIZE;
-        C_off /= this->PAGE_SIZE;
-        X_off /= this->PAGE_SIZE;
+    // Encodes the op for matrices registered with RegisterMat, skipping the handle lookups
+    bool AddGEMMOpById(unsigned int A, unsigned int B, unsigned int C, unsigned int bias, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift) {
+        return AddGEMMOpAt(this->GetIdPageOffset(A), this->GetIdPageOffset(B), this->GetIdPageOffset(C), this->GetIdPageOffset(bias),
+                m, k, n, k, n, n, n, postScale, postShift);
+    }
 
+    // Encodes the op for operands given as device page offsets
+    virtual bool AddGEMMOpAt(unsigned long long A_off, unsigned long long B_off, unsigned long long C_off, unsigned long long X_off, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
         GemmArgs gargs(A_off, B_off, C_off, X_off, m,
-                k, n, lda, ldb, ldc, ldx, postScale, postShift);
+                k, n, lda, ldb, ldc, ldx, postScale, postShift, transA, transB, transC);
         this->AddInstr ( &gargs);
         return true;
     }
@@ -125,28 +119,22 @@ public:
 
   virtual bool AddGEMMDevOp(const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
     XTimer t;
-    if (this->_hostMatPageOffset.find(A) == this->_hostMatPageOffset.end()
-        || this->_hostMatPageOffset.find(B) == this->_hostMatPageOffset.end()
-        || this->_hostMatPageOffset.find(C) == this->_hostMatPageOffset.end()
-        || this->_hostMatPageOffset.find(bias) == this->_hostMatPageOffset.end()) {
+    unsigned int l_ids[4];
+    if (!this->FindMats({A, B, C, bias}, true, l_ids)) {
       cerr << "Matrix not found!" << endl;
       return false;
     }
     unsigned long long A_off = 0, B_off = 0, C_off = 0, X_off = 0;
-        A_off = this->GetMatOffset(A);
-        B_off = this->GetMatOffset(B);
-        C_off = this->GetMatOffset(C);
-        X_off = this->GetMatOffset(bias);
-    GemmArgs gargs(A_off, B_off, C_off, X_off, m,
-       k, n, lda, ldb, ldc, ldx, postScale, postShift);
-    this->AddInstr ( &gargs);
-    return true;
+        A_off = this->GetIdPageOffset(l_ids[0]);
+        B_off = this->GetIdPageOffset(l_ids[1]);
+        C_off = this->GetIdPageOffset(l_ids[2]);
+        X_off = this->GetIdPageOffset(l_ids[3]);
+    return AddGEMMOpAt(A_off, B_off, C_off, X_off, m, k, n, lda, ldb, ldc, ldx, postScale, postShift);
   }
   
   virtual void Execute( bool sync_exec = true) {
       XTimer t;
-      this->_fpga_stream->copyToFpga(this->_cl_instr_buf, false);
-      this->_fpga_stream->execKernel(this->_cl_instr_buf, sync_exec);
+      this->Launch(sync_exec, false);
       #ifdef GEMX_PERF_DBG
       cout << "Execute: " << t.elapsed() << endl;
       #endif
@@ -154,10 +142,7 @@ public:
 
   virtual void ExecuteDev( bool sync_exec = true) {
       XTimer t;
-      this->_fpga_stream->copyToFpga(this->_cl_instr_buf, true);
-      this->_fpga_stream->copyToFpga(this->_cl_stats_buf, true);
-      this->_fpga_stream->execKernel(this->_cl_instr_buf, sync_exec);
-      this->_fpga_stream->copyFromFpga(this->_cl_stats_buf, true);
+      this->Launch(sync_exec, true);
       #ifdef GEMX_PERF_DBG
       cout << "Execute: " << t.elapsed() << endl;
       #endif
@@ -20,8 +20,10 @@
 #include "fcn_host.h"
 #include "spmv_host.h"
 #include "uspmv_host.h"
+#include "gemm_auto.h"
 #include "xhost.h"
 #include "gemx_util.h"
+#include "gemx_perfmodel.h"
 #include "gemx_host_c_api.h"
 
 //#define GEMX_PERF_DBG
@@ -46,6 +48,7 @@ template<typename HType>
 class GEMXHostHandle {
     public:
         vector<shared_ptr<GEMMHost<HType>>> gh_ptr;
+        CpuConfig gh_cfg;
         static GEMXHostHandle& Instance() {
             static GEMXHostHandle theInstance;
             return theInstance;
@@ -76,6 +79,7 @@ static void print(char *name,T * A, int m, int n)
 
 void MakeFCNHost(char *xclbin, unsigned int nPE)
 {
+    GEMXHostHandle<void*>::Instance().gh_cfg = CpuConfig(xclbin);
     for (unsigned i = 0; i < nPE; i++)
     {
         string kName = GEMMHost<short*>::getKernelName(i);
@@ -85,6 +89,7 @@ void MakeFCNHost(char *xclbin, unsigned int nPE)
 
 void MakeGEMMHost(char *xclbin, unsigned int nPE)
 {
+    GEMXHostHandle<void*>::Instance().gh_cfg = CpuConfig(xclbin);
     for (unsigned i = 0; i < nPE; i++)
     {
         string kName = GEMMHost<short*>::getKernelName(i);
@@ -93,6 +98,7 @@ void MakeGEMMHost(char *xclbin, unsigned int nPE)
 }
 
 void MakeUSPMVHost(char *xclbin, unsigned int nPE) { 
+    GEMXHostHandle<void*>::Instance().gh_cfg = CpuConfig(xclbin);
     for (unsigned i = 0; i < nPE; i++)
     {
         string kName = GEMMHost<void*>::getKernelName(i);
@@ -101,6 +107,7 @@ void MakeUSPMVHost(char *xclbin, unsigned int nPE) {
 }
 
 void MakeSPMVHost(char *xclbin, unsigned int nPE) {  
+    GEMXHostHandle<void*>::Instance().gh_cfg = CpuConfig(xclbin);
     for (unsigned i = 0; i < nPE; i++)
     {
         string kName = GEMMHost<void*>::getKernelName(i);
@@ -108,6 +115,16 @@ void MakeSPMVHost(char *xclbin, unsigned int nPE) {
     }
 }
 
+void* AllocHostMat(unsigned long long buf_sz, unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->AllocHostMat(buf_sz);
+}
+
+bool FreeHostMat(void * A, unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->FreeHostMat(A);
+}
+
 void SendToFPGAShrt(short *A, unsigned long long num_elem, unsigned PE, bool sync_send)
 {
     gemx::XTimer t;
@@ -140,6 +157,72 @@ void SendToFPGAFloat(float *A, unsigned long long num_elem, unsigned PE,bool syn
 
 }
 
+void SendCachedMat(void *A, unsigned long long buf_sz, unsigned PE, bool sync_send)
+{
+    gemx::XTimer t;
+    GEMXHostHandle<void*>::Instance().gh_ptr[PE]->SendToFPGA(A, A, buf_sz, sync_send, true);
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["SendCachedMat"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["SendCachedMat"]++;
+#endif
+}
+
+void* SendStridedMat(void *A, unsigned int rows, unsigned int cols, unsigned int ld, bool trans, unsigned int elem_bytes, void *dst, unsigned int dst_rows, unsigned int dst_ld, bool cached, unsigned PE, bool sync_send)
+{
+    gemx::XTimer t;
+    void * ret = nullptr;
+    auto & l_host = GEMXHostHandle<void*>::Instance().gh_ptr[PE];
+    if (elem_bytes == sizeof(uint16_t)) {
+        ret = l_host->SendStridedMat((const uint16_t*)A, rows, cols, ld, trans, (uint16_t*)dst, dst_rows, dst_ld, sync_send, cached);
+    } else if (elem_bytes == sizeof(uint32_t)) {
+        ret = l_host->SendStridedMat((const uint32_t*)A, rows, cols, ld, trans, (uint32_t*)dst, dst_rows, dst_ld, sync_send, cached);
+    } else {
+        cerr << "ERROR: unsupported element size " << elem_bytes << endl;
+    }
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["SendStridedMat"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["SendStridedMat"]++;
+#endif
+    return ret;
+}
+
+bool GetStridedMat(void *A, unsigned int rows, unsigned int cols, unsigned int ld, bool trans, unsigned int elem_bytes, void *dst, unsigned int dst_ld, unsigned PE)
+{
+    gemx::XTimer t;
+    bool ret = false;
+    auto & l_host = GEMXHostHandle<void*>::Instance().gh_ptr[PE];
+    if (elem_bytes == sizeof(uint16_t)) {
+        ret = l_host->GetStridedMat(A, rows, cols, ld, trans, (uint16_t*)dst, dst_ld);
+    } else if (elem_bytes == sizeof(uint32_t)) {
+        ret = l_host->GetStridedMat(A, rows, cols, ld, trans, (uint32_t*)dst, dst_ld);
+    } else {
+        cerr << "ERROR: unsupported element size " << elem_bytes << endl;
+    }
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["GetStridedMat"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["GetStridedMat"]++;
+#endif
+    return ret;
+}
+
+void ReleaseMat(void *A, unsigned PE)
+{
+    GEMXHostHandle<void*>::Instance().gh_ptr[PE]->RemoveMat(A);
+}
+
+void SetMatCacheSize(unsigned long long buf_sz, unsigned PE)
+{
+    GEMXHostHandle<void*>::Instance().gh_ptr[PE]->SetMatCacheSize(buf_sz);
+}
+
+void GetMatCacheStats(unsigned long long *hits, unsigned long long *misses, unsigned long long *bytes, unsigned PE)
+{
+    const gemx::XMatCache & l_cache = GEMXHostHandle<void*>::Instance().gh_ptr[PE]->GetMatCache();
+    *hits = l_cache.hits();
+    *misses = l_cache.misses();
+    *bytes = l_cache.bytes();
+}
+
 void* SendUSpMat(uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages, unsigned PE){
     gemx::XTimer t;
     gemx::USPMVHost<void*>* spmv_ptr = static_cast< gemx::USPMVHost<void*> *> (GEMXHostHandle<void*>::Instance().gh_ptr[PE].get());
@@ -163,6 +246,40 @@ void* SendSpToFpgaInt(int *row, int *col, float *data, unsigned int m, unsigned
     return ret;
 }
 
+bool WriteSpImage(const char *fileName, int *row, int *col, float *data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, bool is_int){
+    return gemx::SPMVHost<void*>::WriteSpImage(fileName,row,col,data,m,k,nnz,ddr_width,spmv_width,num_cblocks,capacity_Cblocks,capacity_Bblocks,is_int);
+}
+
+void* SendSpImage(const char *fileName, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, bool is_int, unsigned int *dims, unsigned PE){
+    gemx::XTimer t;
+    gemx::SPMVHost<void*>* spmv_ptr = static_cast< gemx::SPMVHost<void*> *> (GEMXHostHandle<void*>::Instance().gh_ptr[PE].get());
+    void* ret = spmv_ptr->SendSpImage(fileName,ddr_width,spmv_width,num_cblocks,capacity_Cblocks,capacity_Bblocks,is_int,dims);
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["SendSpImage"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["SendSpImage"]++;
+#endif
+    return ret;
+}
+
+bool WriteUSpImage(const char *fileName, uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages){
+    return gemx::USPMVHost<void*>::WriteUSpImage(fileName,row,col,data,row_size,col_size,nnz_size,p_pRelu,t_DdrWidth,t_Stages);
+}
+
+void* SendUSpImage(const char *fileName, unsigned int t_DdrWidth, unsigned int t_Stages, unsigned PE){
+    gemx::XTimer t;
+    gemx::USPMVHost<void*>* spmv_ptr = static_cast< gemx::USPMVHost<void*> *> (GEMXHostHandle<void*>::Instance().gh_ptr[PE].get());
+    void* ret = spmv_ptr->SendUSpImage(fileName,t_DdrWidth,t_Stages);
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["SendUSpImage"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["SendUSpImage"]++;
+#endif
+    return ret;
+}
+
+bool FreeSpImage(void *A, unsigned PE){
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->FreeImage(A);
+}
+
 void* GetFromFPGA(short *A, unsigned PE, bool sync_get)
 {
     gemx::XTimer t;
@@ -215,6 +332,61 @@ bool AddGEMMOp(void * A, void * B, void *C, void * bias, unsigned int m, unsigne
     return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->AddGEMMOp(A, B, C, bias, m,k,n, postScale, postShift);
 }
 
+bool AddFCNOpLd(void * A, void * B, void *C, void * bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha, unsigned PE)
+{
+    gemx::FCNHost<void*>* fcn_ptr = static_cast< gemx::FCNHost<void*> *> (GEMXHostHandle<void*>::Instance().gh_ptr[PE].get());
+    return fcn_ptr->AddFCNOp(A, B, C, bias, m,k,n, lda,ldb,ldc,ldx, postScale, postShift, PReLUScale, PReLUAlpha);
+}
+
+bool AddGEMMOpLd(void * A, void * B, void *C, void * bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->AddGEMMOp(A, B, C, bias, m,k,n, lda,ldb,ldc,ldx, postScale, postShift);
+}
+
+bool AddFCNOpTrans(void * A, void * B, void *C, void * bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha, bool transA, bool transB, bool transC, unsigned PE)
+{
+    gemx::FCNHost<void*>* fcn_ptr = static_cast< gemx::FCNHost<void*> *> (GEMXHostHandle<void*>::Instance().gh_ptr[PE].get());
+    return fcn_ptr->AddFCNOp(A, B, C, bias, m,k,n, lda,ldb,ldc,ldx, postScale, postShift, PReLUScale, PReLUAlpha, transA, transB, transC);
+}
+
+bool AddGEMMOpTrans(void * A, void * B, void *C, void * bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA, bool transB, bool transC, unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->AddGEMMOp(A, B, C, bias, m,k,n, lda,ldb,ldc,ldx, postScale, postShift, transA, transB, transC);
+}
+
+template<typename T, typename TX>
+static bool RunGemmAuto(T * A, T * B, T * C, TX * X, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift)
+{
+    gemx::XTimer t;
+    gemx::GemmAuto l_auto(GEMXHostHandle<void*>::Instance().gh_ptr, GEMXHostHandle<void*>::Instance().gh_cfg);
+    bool ret = l_auto.Run(A, B, C, X, m, k, n, postScale, postShift);
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["GemmAuto"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["GemmAuto"]++;
+#endif
+    return ret;
+}
+
+bool GemmAutoShrt(short * A, short * B, short * C, int * X, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift)
+{
+    return RunGemmAuto(A, B, C, X, m, k, n, postScale, postShift);
+}
+
+bool GemmAutoFloat(float * A, float * B, float * C, float * X, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift)
+{
+    return RunGemmAuto(A, B, C, X, m, k, n, postScale, postShift);
+}
+
+int RegisterMat(void * A, unsigned long long buf_sz, unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->RegisterMat(A, A, buf_sz);
+}
+
+bool AddGEMMOpById(unsigned int A, unsigned int B, unsigned int C, unsigned int bias, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift, unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->AddGEMMOpById(A, B, C, bias, m,k,n, postScale, postShift);
+}
+
 bool AddSPMVOp(void *A, void * B, void *C, unsigned int m, unsigned int k, unsigned int nnz, bool l_pRelu, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, unsigned PE)
 {
     gemx::XTimer t;
@@ -230,6 +402,98 @@ bool AddUSPMVOp(void *A, void * B, void *C, unsigned int numRuns, unsigned PE)
     return ret;
 }
 
+static bool SetEstimate(const gemx::perfmodel::Estimate & est, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops)
+{
+    *cycles = est.m_Cycles;
+    *ddr_bytes = est.getDdrBytes();
+    *gops = est.getGops();
+    return true;
+}
+
+// Model configuration of the loaded kernel
+static bool GetPerfConfig(const char *op, double clock_mhz, gemx::perfmodel::Config & cfg)
+{
+    if (GEMXHostHandle<void*>::Instance().gh_ptr.empty()) {
+        cerr << "ERROR: " << op << " needs a kernel loaded by a Make*Host call" << endl;
+        return false;
+    }
+    const CpuConfig & l_cfg = GEMXHostHandle<void*>::Instance().gh_cfg;
+    cfg.m_ElemBytes = (l_cfg.dataType() == "short") ? sizeof(short) : sizeof(float);
+    cfg.m_DdrWidth = l_cfg.ddrWidth();
+    cfg.m_XddrWidth = l_cfg.xddrWidth();
+    cfg.m_GemmMBlocks = l_cfg.gemmMBlocks();
+    cfg.m_GemmKBlocks = l_cfg.gemmKBlocks();
+    cfg.m_GemmNBlocks = l_cfg.gemmNBlocks();
+    cfg.m_TranspBlocks = l_cfg.transpBlocks();
+    cfg.m_SpmvWidth = l_cfg.spmvWidth();
+    cfg.m_SpmvMacGroups = l_cfg.spmvMacGroups();
+    cfg.m_SpmvmVectorBlocks = l_cfg.spmvRowsInCblock() / (l_cfg.spmvWidth() * l_cfg.spmvMacGroups() * l_cfg.ddrWidth());
+    cfg.m_SpmvkVectorBlocks = l_cfg.spmvkVectorBlocks();
+    cfg.m_SpmvFloatPerDesc = l_cfg.spmvFloatPerDesc();
+    cfg.m_ClockMHz = clock_mhz;
+    return true;
+}
+
+bool EstimateGEMMOp(unsigned int m, unsigned int k, unsigned int n, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops)
+{
+    gemx::perfmodel::Config l_cfg;
+    if (!GetPerfConfig("EstimateGEMMOp", clock_mhz, l_cfg)) {
+        return false;
+    }
+    return SetEstimate(gemx::perfmodel::PerfModel(l_cfg).gemm(m, k, n), cycles, ddr_bytes, gops);
+}
+
+bool EstimateFCNOp(unsigned int m, unsigned int k, unsigned int n, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops)
+{
+    gemx::perfmodel::Config l_cfg;
+    if (!GetPerfConfig("EstimateFCNOp", clock_mhz, l_cfg)) {
+        return false;
+    }
+    return SetEstimate(gemx::perfmodel::PerfModel(l_cfg).fcn(m, k, n), cycles, ddr_bytes, gops);
+}
+
+bool EstimateGEMVOp(unsigned int m, unsigned int k, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops)
+{
+    gemx::perfmodel::Config l_cfg;
+    if (!GetPerfConfig("EstimateGEMVOp", clock_mhz, l_cfg)) {
+        return false;
+    }
+    return SetEstimate(gemx::perfmodel::PerfModel(l_cfg).gemv(m, k), cycles, ddr_bytes, gops);
+}
+
+bool EstimateTRANSPOp(unsigned int rows, unsigned int cols, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops)
+{
+    gemx::perfmodel::Config l_cfg;
+    if (!GetPerfConfig("EstimateTRANSPOp", clock_mhz, l_cfg)) {
+        return false;
+    }
+    return SetEstimate(gemx::perfmodel::PerfModel(l_cfg).transp(rows, cols), cycles, ddr_bytes, gops);
+}
+
+bool EstimateSPMVOp(int *row, int *col, unsigned int m, unsigned int k, unsigned int nnz, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops)
+{
+    gemx::perfmodel::Config l_cfg;
+    if (!GetPerfConfig("EstimateSPMVOp", clock_mhz, l_cfg)) {
+        return false;
+    }
+    gemx::perfmodel::PerfModel l_model(l_cfg);
+    unsigned int l_Cblocks = (m + l_cfg.getSpmvRowsInCblock() - 1) / l_cfg.getSpmvRowsInCblock();
+    unsigned int l_Bblocks = (k + l_cfg.getSpmvColsInBblock() - 1) / l_cfg.getSpmvColsInBblock();
+    vector<unsigned int> l_descNnz = l_model.spmvDescNnz(row, col, nnz, l_Bblocks, l_Cblocks);
+    return SetEstimate(l_model.spmv(m, k, nnz, l_Bblocks, l_Cblocks, l_descNnz), cycles, ddr_bytes, gops);
+}
+
+bool EstimateUSPMVOp(int* row_size, int* col_size, int* nnz_size, unsigned int numRuns, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops)
+{
+    gemx::perfmodel::Config l_cfg;
+    if (!GetPerfConfig("EstimateUSPMVOp", clock_mhz, l_cfg)) {
+        return false;
+    }
+    unsigned int l_stages = GEMXHostHandle<void*>::Instance().gh_cfg.uspmvStages();
+    vector<unsigned int> l_rows(row_size, row_size + l_stages), l_cols(col_size, col_size + l_stages), l_nnzs(nnz_size, nnz_size + l_stages);
+    return SetEstimate(gemx::perfmodel::PerfModel(l_cfg).uspmv(numRuns, l_rows, l_cols, l_nnzs), cycles, ddr_bytes, gops);
+}
+
 void Execute (bool sync_exec, unsigned PE)
 {
     gemx::XTimer t;
@@ -241,6 +505,54 @@ void Execute (bool sync_exec, unsigned PE)
 
 }
 
+bool ExecuteCpuImage(char *image, unsigned long long buf_sz)
+{
+    if (GEMXHostHandle<void*>::Instance().gh_ptr.empty()) {
+        cerr << "ERROR: ExecuteCpuImage needs a kernel loaded by a Make*Host call" << endl;
+        return false;
+    }
+    const unsigned long long l_pageSz = CpuKernel::PAGE_SIZE;
+    if (buf_sz < l_pageSz) {
+        cerr << "ERROR: device image of " << buf_sz << " bytes has no code page" << endl;
+        return false;
+    }
+    CpuKernel l_kernel(GEMXHostHandle<void*>::Instance().gh_cfg);
+    return l_kernel.run(image, [image, buf_sz, l_pageSz](unsigned int p_page) {
+        unsigned long long l_off = (unsigned long long)p_page * l_pageSz;
+        return (l_off < buf_sz) ? image + l_off : nullptr;
+    });
+}
+
+void BeginCapture(unsigned PE)
+{
+    GEMXHostHandle<void*>::Instance().gh_ptr[PE]->BeginCapture();
+}
+
+int EndCapture(unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->EndCapture();
+}
+
+bool Replay(int graph, void ** from, void ** to, unsigned int num_binds, bool sync_exec, unsigned PE)
+{
+    gemx::XTimer t;
+    vector<pair<void*, void*> > l_binds;
+    for (unsigned int i = 0; i < num_binds; i++) {
+        l_binds.push_back(make_pair(from[i], to[i]));
+    }
+    bool ret = GEMXHostHandle<void*>::Instance().gh_ptr[PE]->Replay(graph, l_binds, sync_exec);
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["Replay"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["Replay"]++;
+#endif
+    return ret;
+}
+
+bool FreeGraph(int graph, unsigned PE)
+{
+    return GEMXHostHandle<void*>::Instance().gh_ptr[PE]->FreeGraph(graph);
+}
+
 void Wait (unsigned PE)
 {
     gemx::XTimer t;
@@ -390,6 +702,22 @@ void SendDevBuf(char* A, unsigned PE, bool sync_send)
 #endif
 }
 
+bool FreeDevBuf(char* A, unsigned PE)
+{
+    return GEMXHostHandle<char*>::Instance().gh_ptr[PE]->FreeDevBuf(A);
+}
+
+bool CompactDevBuf(unsigned PE)
+{
+    gemx::XTimer t;
+    bool ret = GEMXHostHandle<char*>::Instance().gh_ptr[PE]->CompactDevBuf();
+#ifdef GEMX_PERF_DBG
+    GEMXHostProfiler::Instance().func_time["CompactDevBuf"] += t.elapsed();
+    GEMXHostProfiler::Instance().func_calls["CompactDevBuf"]++;
+#endif
+    return ret;
+}
+
 void* GetDevBuf(char* A, unsigned PE, bool sync_get)
 {
     gemx::XTimer t;
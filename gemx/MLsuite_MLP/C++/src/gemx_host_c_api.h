@@ -22,13 +22,33 @@ void MakeGEMMHost(char *xclbin, unsigned int nPE);
 void MakeUSPMVHost(char *xclbin, unsigned int nPE);
 void MakeSPMVHost(char *xclbin, unsigned int nPE);
 
+// Page aligned matrices from the pinned host pool of PE, reused after ClearBuf once freed
+void* AllocHostMat(unsigned long long buf_sz, unsigned PE);
+bool FreeHostMat(void * A, unsigned PE);
 void SendToFPGAShrt(short *A,  unsigned long long num_elem, unsigned PE, bool sync_send);
 void SendToFPGAInt(int *A,  unsigned long long num_elem, unsigned PE, bool sync_send);
 void SendToFPGAFloat(float *A,  unsigned long long num_elem, unsigned PE, bool sync_send);
+// Sends a constant matrix through the content keyed device cache of PE; identical
+// bytes sent before are not transferred again. ReleaseMat drops the reference.
+void SendCachedMat(void *A, unsigned long long buf_sz, unsigned PE, bool sync_send);
+// Packs a strided view (row stride ld elements, transposed if trans) of 2 or 4 byte
+// elements into the zero padded dst_rows x dst_ld matrix dst and sends it in one
+// pass; dst null allocates it from the pinned pool. Returns dst, the handle for ops.
+void* SendStridedMat(void *A, unsigned int rows, unsigned int cols, unsigned int ld, bool trans, unsigned int elem_bytes, void *dst, unsigned int dst_rows, unsigned int dst_ld, bool cached, unsigned PE, bool sync_send);
+// Reads back A and copies its top left rows x cols corner, transposed if trans, to dst
+bool GetStridedMat(void *A, unsigned int rows, unsigned int cols, unsigned int ld, bool trans, unsigned int elem_bytes, void *dst, unsigned int dst_ld, unsigned PE);
+void ReleaseMat(void *A, unsigned PE);
+void SetMatCacheSize(unsigned long long buf_sz, unsigned PE);
+void GetMatCacheStats(unsigned long long *hits, unsigned long long *misses, unsigned long long *bytes, unsigned PE);
 void* SendUSpMat(uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages, unsigned PE);
 void* SendSpToFpgaFloat(int *row, int *col, float *data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, unsigned PE);
 void* SendSpToFpgaInt(int *row, int *col, float *data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, unsigned PE);
 
+bool WriteSpImage(const char *fileName, int *row, int *col, float *data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, bool is_int);
+void* SendSpImage(const char *fileName, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, bool is_int, unsigned int *dims, unsigned PE);
+bool WriteUSpImage(const char *fileName, uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages);
+void* SendUSpImage(const char *fileName, unsigned int t_DdrWidth, unsigned int t_Stages, unsigned PE);
+bool FreeSpImage(void *A, unsigned PE);
 void* GetFromFPGA( short *A, unsigned PE, bool sync_get);
 void* GetFromFPGAInt( int *A, unsigned PE, bool sync_get);
 void* GetFromFPGAFloat( float *A, unsigned PE, bool sync_get);
@@ -38,10 +58,40 @@ void ClearBuf (unsigned PE);
 void PrintStats();
 bool AddFCNOp( void * A, void * B, void *C, void * bias,  unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift, short PReLUScale, short PReLUAlpha, unsigned PE);
 bool AddGEMMOp( void * A, void * B, void *C, void * bias,  unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift, unsigned PE);
+// Ops on sub-matrices of padded buffers, with leading dimensions in elements
+bool AddFCNOpLd( void * A, void * B, void *C, void * bias,  unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha, unsigned PE);
+bool AddGEMMOpLd( void * A, void * B, void *C, void * bias,  unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, unsigned PE);
+// As the Ld ops with operands stored transposed: A as k x m, B as n x k, C and bias as n x m
+bool AddFCNOpTrans( void * A, void * B, void *C, void * bias,  unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha, bool transA, bool transB, bool transC, unsigned PE);
+bool AddGEMMOpTrans( void * A, void * B, void *C, void * bias,  unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA, bool transB, bool transC, unsigned PE);
+// IDs from RegisterMat encode ops without looking up the matrix pointers
+int RegisterMat(void * A, unsigned long long buf_sz, unsigned PE);
+bool AddGEMMOpById(unsigned int A, unsigned int B, unsigned int C, unsigned int bias, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift, unsigned PE);
 bool AddUSPMVOp(void *A, void * B, void *C, unsigned int numRuns, unsigned PE);
 bool AddSPMVOp(void *A, void * B, void *C, unsigned int m, unsigned int k, unsigned int nnz, bool l_pRelu, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, unsigned PE);
+// Predicted cycles, DDR bytes and GOPS of one op from the analytic model, for the
+// configuration of the kernel loaded by the last Make*Host call
+bool EstimateGEMMOp(unsigned int m, unsigned int k, unsigned int n, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops);
+bool EstimateFCNOp(unsigned int m, unsigned int k, unsigned int n, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops);
+bool EstimateGEMVOp(unsigned int m, unsigned int k, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops);
+bool EstimateTRANSPOp(unsigned int rows, unsigned int cols, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops);
+bool EstimateSPMVOp(int *row, int *col, unsigned int m, unsigned int k, unsigned int nnz, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops);
+bool EstimateUSPMVOp(int* row_size, int* col_size, int* nnz_size, unsigned int numRuns, double clock_mhz, unsigned long long *cycles, unsigned long long *ddr_bytes, double *gops);
 
 void Execute (bool sync_exec, unsigned PE);
+// Runs a device image in the gen_bin app.bin layout (code page 0, page offsets from
+// the image start, chained code pages) on the CPU kernels of the configuration
+// loaded by the last Make*Host call; the results are written in place
+bool ExecuteCpuImage(char *image, unsigned long long buf_sz);
+// Records the ops added until EndCapture into a graph that runs with a single launch
+void BeginCapture(unsigned PE);
+int EndCapture(unsigned PE);
+// from[i] is replaced by to[i] for this run; both must have been sent with SendToFPGA*
+bool Replay(int graph, void ** from, void ** to, unsigned int num_binds, bool sync_exec, unsigned PE);
+bool FreeGraph(int graph, unsigned PE);
+// Splits one GEMM over all PEs created by MakeGEMMHost/MakeFCNHost
+bool GemmAutoShrt(short * A, short * B, short * C, int * X, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift);
+bool GemmAutoFloat(float * A, float * B, float * C, float * X, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift);
 
 void int16_gemm(short * A, short * B, short * X, short *C, unsigned int M, unsigned int K, unsigned int N );
 
@@ -57,6 +107,9 @@ void* AddSpDevBuf(int * row, int * col, float * data, char* A, unsigned int m, u
 void* AddUSpDevBuf(uint16_t* row, uint16_t* col, float* data, char* A, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages, unsigned PE);
 void SendDevBuf(char* A, unsigned PE, bool sync_send);
 void* GetDevBuf(char* A, unsigned PE, bool sync_get);
+bool FreeDevBuf(char* A, unsigned PE);
+// Moves live device buffers to the front of the program buffer, GetDevBuf returns their new address
+bool CompactDevBuf(unsigned PE);
 bool AddGEMMDevOp(char* A, char* B, char*C, char* bias, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift, unsigned PE);
 bool AddFCNDevOp(char* A, char* B, char*C, char* bias, unsigned int m, unsigned int k, unsigned int n, int postScale, int postShift, short PReLUScale, short PReLUAlpha, unsigned PE);
 bool AddSPMVDevOp(char* A, char* B, char*C, unsigned int m, unsigned int k, unsigned int nnz, bool l_pRelu, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, unsigned PE);
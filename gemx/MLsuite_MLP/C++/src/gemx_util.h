@@ -22,10 +22,16 @@
 #include <sstream>
 #include <thread>
 #include <queue>
+#include <array>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
+#include "gemx_mtx_reader.h"
 
 using namespace std;
 
@@ -256,6 +262,47 @@ namespace gemx{
 
         };
 
+    // Copies the p_rows x p_cols matrix at p_src with leading dimension p_ld, or its
+    // transpose, to the top left corner of the p_dstRows x p_dstCols region at p_dst
+    // and zeroes the rest of the region, writing each destination element once.
+    // p_ld 0 repeats the first row, e.g. for a broadcast bias.
+    template<typename T>
+        void CopyStrided(const T * p_src, unsigned int p_rows, unsigned int p_cols, unsigned int p_ld, bool p_trans,
+                T * p_dst, unsigned int p_dstRows, unsigned int p_dstCols, unsigned int p_dstLd)
+        {
+            const unsigned int l_tile = 32;
+            unsigned int l_rows = p_trans ? p_cols : p_rows;
+            unsigned int l_cols = p_trans ? p_rows : p_cols;
+            assert(l_rows <= p_dstRows && l_cols <= p_dstCols && p_dstCols <= p_dstLd);
+            if (!p_trans) {
+                for (unsigned int r = 0; r < l_rows; r++) {
+                    T * l_dst = p_dst + (unsigned long long)r * p_dstLd;
+                    memcpy(l_dst, p_src + (unsigned long long)r * p_ld, sizeof(T) * l_cols);
+                    memset(l_dst + l_cols, 0, sizeof(T) * (p_dstCols - l_cols));
+                }
+            } else {
+                // Square tiles keep both the source columns and destination rows in cache
+                for (unsigned int r0 = 0; r0 < l_rows; r0 += l_tile) {
+                    unsigned int r1 = min(l_rows, r0 + l_tile);
+                    for (unsigned int c0 = 0; c0 < l_cols; c0 += l_tile) {
+                        unsigned int c1 = min(l_cols, c0 + l_tile);
+                        for (unsigned int r = r0; r < r1; r++) {
+                            T * l_dst = p_dst + (unsigned long long)r * p_dstLd;
+                            for (unsigned int c = c0; c < c1; c++) {
+                                l_dst[c] = p_src[(unsigned long long)c * p_ld + r];
+                            }
+                        }
+                    }
+                    for (unsigned int r = r0; r < r1; r++) {
+                        memset(p_dst + (unsigned long long)r * p_dstLd + l_cols, 0, sizeof(T) * (p_dstCols - l_cols));
+                    }
+                }
+            }
+            for (unsigned int r = l_rows; r < p_dstRows; r++) {
+                memset(p_dst + (unsigned long long)r * p_dstLd, 0, sizeof(T) * p_dstCols);
+            }
+        }
+
 
     class MtxRow {
         private:
@@ -307,6 +354,7 @@ namespace gemx{
             string m_FileName;
             bool m_Good;
             unsigned int m_M, m_K, m_Nnz;
+            MtxCoo m_Coo;
             vector<MtxRow> m_Rows;
         private:
             void align( unsigned int &dst, unsigned int width) {dst = width * ((dst + width - 1) / width);}
@@ -324,37 +372,13 @@ namespace gemx{
         {
             if (m_FileName != "none") {
                 cout << "INFO: loading Mtx file  " << m_FileName << "\n";
-                ifstream l_fs(m_FileName.c_str(), ios_base::in | ios_base::binary);
-
-                boost::iostreams::filtering_istream l_bs;
-                string l_ext = m_FileName.substr(m_FileName.find_last_of(".") + 1);
-                transform(l_ext.begin(), l_ext.end(), l_ext.begin(), ::tolower);
-
-                if (l_ext == "gz") {
-                    l_bs.push(boost::iostreams::gzip_decompressor());
-                } else if (l_ext == "mtx") {
-                    // noop
-                } else{
-                    cerr << "ERROR: MtxFile failed due to unknown extension \"" << l_ext << "\", file  "
-                        << m_FileName << "\n";
-                    assert(0);
-                }
-                l_bs.push(l_fs);          
-                m_Good = l_bs.good();
+                MtxReader l_reader;
+                m_Good = l_reader.read(m_FileName, m_M, m_K, m_Nnz, m_Coo);
                 if (m_Good) {
-                    while (l_bs.peek() == '%') l_bs.ignore(2048, '\n');
-                    l_bs >>  m_M >> m_K >> m_Nnz;
-                    for (unsigned int i = 0; i < nnz(); ++i) {
-                        MtxRow l_row;
-                        l_row.scan(l_bs);
-                        m_Rows.push_back(l_row);
-                    }
-                    boost::iostreams::close(l_bs);
 #if GEMX_runSpmv==1
                     while (m_Nnz % GEMX_spmvWidth != 0) {
                         cout << "INFO: Added padding row to the mtx data\n";
-                        MtxRow l_row;
-                        m_Rows.push_back(l_row);
+                        m_Coo.push(0, 0, 0);
                         m_Nnz++;
                     }
                     // Adjust dimensions - needs to be aligned to both GEMX_spmvWidth and GEMX_ddrWidth
@@ -369,8 +393,7 @@ namespace gemx{
 #elif GEMX_runUspmv==1
                     while (m_Nnz % GEMX_ddrWidth != 0) {
                         cout << "INFO: Added padding row to the mtx data\n";
-                        MtxRow l_row;
-                        m_Rows.push_back(l_row);
+                        m_Coo.push(0, 0, 0);
                         m_Nnz++;
                     }
                     // Adjust dimensions - needs to be aligned to both GEMX_spmvWidth and GEMX_ddrWidth
@@ -387,7 +410,21 @@ namespace gemx{
                 }
             }
         }
-            vector<MtxRow> &getRows() {return(m_Rows);}
+            // Valid until the first getRows
+            MtxCoo &getCoo() {return(m_Coo);}
+            // Row objects for the fillFromVector consumers, built on first use from the
+            // coordinate arrays, which are then released
+            vector<MtxRow> &getRows() {
+                if (m_Coo.size() != 0) {
+                    m_Rows.clear();
+                    m_Rows.reserve(m_Coo.size());
+                    for (size_t i = 0; i < m_Coo.size(); ++i) {
+                        m_Rows.push_back(MtxRow(m_Coo.m_Val[i], m_Coo.m_Row[i], m_Coo.m_Col[i]));
+                    }
+                    m_Coo = MtxCoo();
+                }
+                return(m_Rows);
+            }
             void setIndex(unsigned int p_m, unsigned int p_k, unsigned int p_nnz){
                 m_M=p_m;
                 m_K=p_k;
@@ -687,7 +724,118 @@ namespace gemx{
 
         };
 
+    // Packed sparse matrix device image (SpMat or UspMat layout) stored in a file
+    // together with the kernel configuration it was packed for. The image starts
+    // on a page boundary so a mapping of the file can be given to the device as is.
+    class SpImage
+    {
+        public:
+            static const uint32_t t_Version = 1;
+            static const size_t t_DataOffset = 4096;
+            enum Kind {Spmv = 1, Uspmv = 2};
+            enum DataType {Float = 1, Int32 = 2};
+            struct Header {
+                char m_Magic[8];
+                uint32_t m_Version, m_Kind, m_DataType;
+                uint32_t m_DdrWidth, m_SpmvWidth, m_NumCblocks, m_CapacityCblocks, m_CapacityBblocks;
+                uint32_t m_Stages;
+                uint32_t m_M, m_K, m_Nnz;
+                unsigned long long m_Bytes;
+            };
+        private:
+            Header m_Header;
+            char *m_Map;
+            size_t m_MapSz;
+        public:
+            SpImage() : m_Map(nullptr), m_MapSz(0) {}
+            SpImage(const SpImage &) = delete;
+            SpImage & operator=(const SpImage &) = delete;
+            ~SpImage() {
+                if (m_Map != nullptr) {
+                    munmap(m_Map, m_MapSz);
+                }
+            }
+
+            // Header with the identity fields set, the rest zero
+            static Header makeHeader(Kind p_Kind, DataType p_DataType) {
+                Header l_hdr;
+                memset(&l_hdr, 0, sizeof(l_hdr));
+                memcpy(l_hdr.m_Magic, "GEMXSPI", 8);
+                l_hdr.m_Version = t_Version;
+                l_hdr.m_Kind = p_Kind;
+                l_hdr.m_DataType = p_DataType;
+                return l_hdr;
+            }
+
+            static bool write(const string & p_FileName, const Header & p_Header, const void *p_Data) {
+                ofstream l_of(p_FileName.c_str(), ios::binary);
+                vector<char> l_page(t_DataOffset, 0);
+                memcpy(l_page.data(), &p_Header, sizeof(p_Header));
+                l_of.write(l_page.data(), l_page.size());
+                l_of.write((const char*)p_Data, p_Header.m_Bytes);
+                if (!l_of.good()) {
+                    cerr << "ERROR: failed to write sparse image " << p_FileName << endl;
+                    return false;
+                }
+                return true;
+            }
+
+            bool map(const string & p_FileName) {
+                int l_fd = open(p_FileName.c_str(), O_RDONLY);
+                struct stat l_st;
+                if (l_fd < 0 || fstat(l_fd, &l_st) != 0 || (size_t)l_st.st_size < t_DataOffset) {
+                    cerr << "ERROR: failed to open sparse image " << p_FileName << endl;
+                    if (l_fd >= 0) close(l_fd);
+                    return false;
+                }
+                // Private writable mapping, pages stay shared with the page cache
+                // unless written
+                m_MapSz = l_st.st_size;
+                void *l_map = mmap(nullptr, m_MapSz, PROT_READ | PROT_WRITE, MAP_PRIVATE, l_fd, 0);
+                close(l_fd);
+                if (l_map == MAP_FAILED) {
+                    cerr << "ERROR: failed to map sparse image " << p_FileName << endl;
+                    return false;
+                }
+                m_Map = (char*)l_map;
+                memcpy(&m_Header, m_Map, sizeof(m_Header));
+                if (memcmp(m_Header.m_Magic, "GEMXSPI", 8) != 0 || m_Header.m_Version != t_Version) {
+                    cerr << "ERROR: " << p_FileName << " is not a version " << t_Version << " sparse image" << endl;
+                    return false;
+                }
+                if (m_Header.m_Bytes > m_MapSz - t_DataOffset) {
+                    cerr << "ERROR: sparse image " << p_FileName << " is truncated" << endl;
+                    return false;
+                }
+                madvise(m_Map + t_DataOffset, m_Header.m_Bytes, MADV_WILLNEED);
+                return true;
+            }
+
+            // Compares the configuration fields with the ones the caller runs with
+            bool matches(const Header & p_Expected) const {
+                bool l_ok = true;
+                auto l_check = [&](const char *p_Name, uint32_t p_Got, uint32_t p_Exp) {
+                    if (p_Got != p_Exp) {
+                        cerr << "ERROR: sparse image built for " << p_Name << " " << p_Got
+                             << ", kernel uses " << p_Exp << endl;
+                        l_ok = false;
+                    }
+                };
+                l_check("kind", m_Header.m_Kind, p_Expected.m_Kind);
+                l_check("data type", m_Header.m_DataType, p_Expected.m_DataType);
+                l_check("GEMX_ddrWidth", m_Header.m_DdrWidth, p_Expected.m_DdrWidth);
+                l_check("GEMX_spmvWidth", m_Header.m_SpmvWidth, p_Expected.m_SpmvWidth);
+                l_check("GEMX_spmvNumCblocks", m_Header.m_NumCblocks, p_Expected.m_NumCblocks);
+                l_check("C block capacity", m_Header.m_CapacityCblocks, p_Expected.m_CapacityCblocks);
+                l_check("B block capacity", m_Header.m_CapacityBblocks, p_Expected.m_CapacityBblocks);
+                l_check("GEMX_uspmvStages", m_Header.m_Stages, p_Expected.m_Stages);
+                return l_ok;
+            }
 
+            const Header & header() const {return m_Header;}
+            void * data() const {return m_Map + t_DataOffset;}
+            unsigned long long sizeBytes() const {return m_Header.m_Bytes;}
+    };
 
 }
 
@@ -39,6 +39,9 @@ public:
     char *asByteArray() {
         return reinterpret_cast<char*>(&m_spmv_args);
     }
+    unsigned int numPageOffsets() {
+        return 3;
+    }
 protected:
     struct {
         int m_optype;
@@ -66,78 +69,108 @@ public:
         return false;
     }
 
-    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
+    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
+        cerr << "GEMM operation not supported" << endl;
+        return false;
+    }
+
+    virtual bool AddGEMMOpAt(unsigned long long A_off, unsigned long long B_off, unsigned long long C_off, unsigned long long X_off, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
         cerr << "GEMM operation not supported" << endl;
         return false;
     } 
     
-    virtual void* SendSpToFpgaFloat(int * row, int * col, float * data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks){
+    // Packs the COO arrays into the SpMat device layout, the buffer comes from new[]
+    template<typename T>
+    static T* PackSpMat(int * row, int * col, float * data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, unsigned long long & p_bytes){
         vector<MtxRow> l_rows;     
         for(unsigned int i = 0; i<nnz; ++i){
           MtxRow l_m(data[i], row[i], col[i]);
           l_rows.push_back(l_m);
         }
-        typedef SpmvAd<float> SpmvAdType; 
+        typedef SpmvAd<T> SpmvAdType; 
         unsigned int l_Cblocks = (m + capacity_Cblocks - 1) / capacity_Cblocks;
         unsigned int l_Bblocks = (k + capacity_Bblocks - 1) / capacity_Bblocks;
         unsigned int l_numDescPages = (num_cblocks + SpmvAdesc::t_per4k - 1) / SpmvAdesc::t_per4k; 
-        unsigned int l_numDescDdrWords = l_numDescPages * 4096 / sizeof(float) / ddr_width;
-        unsigned int l_numPaddingDdrWords = num_cblocks * 4096 / sizeof(float) / ddr_width;
-        float *A = new float[l_numDescDdrWords * ddr_width + nnz * ddr_width / spmv_width + l_numPaddingDdrWords * ddr_width];
-        SpMat<float,SpmvAdType> MatA(m,k,nnz,l_Bblocks,l_Cblocks,A);
+        unsigned int l_numDescDdrWords = l_numDescPages * 4096 / sizeof(T) / ddr_width;
+        unsigned int l_numPaddingDdrWords = num_cblocks * 4096 / sizeof(T) / ddr_width;
+        unsigned long long l_elems = l_numDescDdrWords * ddr_width + nnz * ddr_width / spmv_width + l_numPaddingDdrWords * ddr_width;
+        T *A = new T[l_elems];
+        SpMat<T,SpmvAdType> MatA(m,k,nnz,l_Bblocks,l_Cblocks,A);
         MatA.fillFromVector(l_rows, capacity_Cblocks, capacity_Bblocks, spmv_width);
-        this->SendToFPGA(A, A, (unsigned long long)((l_numDescDdrWords * ddr_width + nnz * ddr_width / spmv_width + l_numPaddingDdrWords * ddr_width)*sizeof(float)));
+        p_bytes = l_elems * sizeof(T);
+        return A;
+    }
+
+    virtual void* SendSpToFpgaFloat(int * row, int * col, float * data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks){
+        unsigned long long l_bytes;
+        float *A = PackSpMat<float>(row, col, data, m, k, nnz, ddr_width, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, l_bytes);
+        this->SendToFPGA(A, A, l_bytes);
         return A;
     }
     
     virtual void* SendSpToFpgaInt(int * row, int * col, float * data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks){
-        vector<MtxRow> l_rows;     
-        for(unsigned int i = 0; i<nnz; ++i){
-          MtxRow l_m(data[i], row[i], col[i]);
-          l_rows.push_back(l_m);
-        }
-        typedef SpmvAd<int> SpmvAdType; 
-        unsigned int l_Cblocks = (m + capacity_Cblocks - 1) / capacity_Cblocks;
-        unsigned int l_Bblocks = (k + capacity_Bblocks - 1) / capacity_Bblocks;
-        unsigned int l_numDescPages = (num_cblocks + SpmvAdesc::t_per4k - 1) / SpmvAdesc::t_per4k; 
-        unsigned int l_numDescDdrWords = l_numDescPages * 4096 / sizeof(int) / ddr_width;
-        unsigned int l_numPaddingDdrWords = num_cblocks * 4096 / sizeof(int) / ddr_width;
-        int *A = new int[l_numDescDdrWords * ddr_width + nnz * ddr_width / spmv_width + l_numPaddingDdrWords * ddr_width];
-        SpMat<int,SpmvAdType> MatA(m,k,nnz,l_Bblocks,l_Cblocks,A);
-        MatA.fillFromVector(l_rows, capacity_Cblocks, capacity_Bblocks, spmv_width);
-        this->SendToFPGA(A, A, (unsigned long long)((l_numDescDdrWords * ddr_width + nnz * ddr_width / spmv_width + l_numPaddingDdrWords * ddr_width)*sizeof(int)));
+        unsigned long long l_bytes;
+        int *A = PackSpMat<int>(row, col, data, m, k, nnz, ddr_width, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, l_bytes);
+        this->SendToFPGA(A, A, l_bytes);
         return A;
     }
+
+    static SpImage::Header SpImageConfig(bool is_int, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks){
+        SpImage::Header l_hdr = SpImage::makeHeader(SpImage::Spmv, is_int ? SpImage::Int32 : SpImage::Float);
+        l_hdr.m_DdrWidth = ddr_width;
+        l_hdr.m_SpmvWidth = spmv_width;
+        l_hdr.m_NumCblocks = num_cblocks;
+        l_hdr.m_CapacityCblocks = capacity_Cblocks;
+        l_hdr.m_CapacityBblocks = capacity_Bblocks;
+        return l_hdr;
+    }
+
+    // Packs the matrix once and stores the device image for SendSpImage
+    static bool WriteSpImage(const string & fileName, int * row, int * col, float * data, unsigned int m, unsigned int k, unsigned int nnz, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, bool is_int){
+        SpImage::Header l_hdr = SpImageConfig(is_int, ddr_width, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks);
+        l_hdr.m_M = m;
+        l_hdr.m_K = k;
+        l_hdr.m_Nnz = nnz;
+        void *A;
+        if (is_int) {
+            A = PackSpMat<int>(row, col, data, m, k, nnz, ddr_width, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, l_hdr.m_Bytes);
+        } else {
+            A = PackSpMat<float>(row, col, data, m, k, nnz, ddr_width, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, l_hdr.m_Bytes);
+        }
+        bool l_res = SpImage::write(fileName, l_hdr, A);
+        if (is_int) {
+            delete [] (int*)A;
+        } else {
+            delete [] (float*)A;
+        }
+        return l_res;
+    }
+
+    // Maps an image from WriteSpImage and sends it without repacking. p_dims
+    // receives m, k and nnz for AddSPMVOp.
+    void* SendSpImage(const string & fileName, unsigned int ddr_width, unsigned int spmv_width, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks, bool is_int, unsigned int * p_dims){
+        unique_ptr<SpImage> l_image(new SpImage());
+        if (!l_image->map(fileName) ||
+            !l_image->matches(SpImageConfig(is_int, ddr_width, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks))) {
+            return nullptr;
+        }
+        p_dims[0] = l_image->header().m_M;
+        p_dims[1] = l_image->header().m_K;
+        p_dims[2] = l_image->header().m_Nnz;
+        return this->SendImage(std::move(l_image));
+    }
       
     virtual bool AddSPMVOp(const HType & A, const HType & B, const HType & C, unsigned int m, unsigned int k, unsigned int nnz, bool l_pRelu, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks){     
-        if (this->_hostMat.find(A) == this->_hostMat.end()
-                || this->_hostMat.find(B) == this->_hostMat.end()
-                || this->_hostMat.find(C) == this->_hostMat.end()) {
+        unsigned int l_ids[3];
+        if (!this->FindMats({A, B, C}, false, l_ids)) {
             cerr << "Matrix not found!" << endl;
             return false;
         }
        
         unsigned long long A_off = 0, B_off = 0, C_off = 0;
-        xclGetMemObjDeviceAddress(this->_devHandle[A](), (this->_fpga_stream->getDevice())(), sizeof(unsigned long long), &A_off);
-        xclGetMemObjDeviceAddress(this->_devHandle[B](), (this->_fpga_stream->getDevice())(), sizeof(unsigned long long), &B_off);
-        xclGetMemObjDeviceAddress(this->_devHandle[C](), (this->_fpga_stream->getDevice())(), sizeof(unsigned long long), &C_off);
-        //cout << "A_dev_addr: " << A_off << " B_dev_addr: " << B_off << " C_dev_addr: " << C_off << endl;
-       
-        assert(A_off > this->_ddrDeviceBaseAddr);
-        assert(B_off > this->_ddrDeviceBaseAddr);
-        assert(C_off > this->_ddrDeviceBaseAddr);
-        
-        A_off -= this->_ddrDeviceBaseAddr;
-        B_off -= this->_ddrDeviceBaseAddr;
-        C_off -= this->_ddrDeviceBaseAddr;
-
-        assert(A_off % this->PAGE_SIZE == 0);  
-        assert(B_off % this->PAGE_SIZE == 0);
-        assert(C_off % this->PAGE_SIZE == 0);
-
-        A_off /= this->PAGE_SIZE;
-        B_off /= this->PAGE_SIZE;
-        C_off /= this->PAGE_SIZE;
+        A_off = this->GetIdPageOffset(l_ids[0]);
+        B_off = this->GetIdPageOffset(l_ids[1]);
+        C_off = this->GetIdPageOffset(l_ids[2]);
         unsigned int l_numDescPages = (num_cblocks + SpmvAdesc::t_per4k - 1) / SpmvAdesc::t_per4k; 
         unsigned int l_Cblocks = (m + capacity_Cblocks - 1) / capacity_Cblocks;
         unsigned int l_Bblocks = (k + capacity_Bblocks - 1) / capacity_Bblocks;
@@ -167,7 +200,12 @@ public:
         return false;
     }
 
-    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
+    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
+        cerr << "GEMM operation not supported" << endl;
+        return false;
+    }
+
+    virtual bool AddGEMMOpAt(unsigned long long A_off, unsigned long long B_off, unsigned long long C_off, unsigned long long X_off, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
         cerr << "GEMM operation not supported" << endl;
         return false;
     } 
@@ -186,23 +224,25 @@ public:
         unsigned int l_numPaddingDdrWords = num_cblocks * 4096 / sizeof(float) / ddr_width;       
         unsigned int l_aSize = (l_numDescDdrWords * ddr_width + nnz * ddr_width / spmv_width + l_numPaddingDdrWords * ddr_width) * sizeof(float);
         float *A = (float*) this->AddDevBuf(A_str, l_aSize);
+        if (A == nullptr) {
+            return nullptr;
+        }
         SpMat<float,SpmvAdType> MatA(m,k,nnz,l_Bblocks,l_Cblocks,A);
         MatA.fillFromVector(l_rows, capacity_Cblocks, capacity_Bblocks, spmv_width);
         return A;
     }
     
     virtual bool AddSPMVDevOp(const HType & A, const HType & B, const HType & C, unsigned int m, unsigned int k, unsigned int nnz, bool l_pRelu, unsigned int num_cblocks, unsigned int capacity_Cblocks, unsigned int capacity_Bblocks){     
-        if (this->_hostMatPageOffset.find(A) == this->_hostMatPageOffset.end()
-                || this->_hostMatPageOffset.find(B) == this->_hostMatPageOffset.end()
-                || this->_hostMatPageOffset.find(C) == this->_hostMatPageOffset.end()) {
+        unsigned int l_ids[3];
+        if (!this->FindMats({A, B, C}, true, l_ids)) {
             cerr << "Matrix not found!" << endl;
             return false;
         }
        
         unsigned long long A_off = 0, B_off = 0, C_off = 0;
-        A_off = this->GetMatOffset(A);
-        B_off = this->GetMatOffset(B);
-        C_off = this->GetMatOffset(C);
+        A_off = this->GetIdPageOffset(l_ids[0]);
+        B_off = this->GetIdPageOffset(l_ids[1]);
+        C_off = this->GetIdPageOffset(l_ids[2]);
         unsigned int l_numDescPages = (num_cblocks + SpmvAdesc::t_per4k - 1) / SpmvAdesc::t_per4k; 
         unsigned int l_Cblocks = (m + capacity_Cblocks - 1) / capacity_Cblocks;
         unsigned int l_Bblocks = (k + capacity_Bblocks - 1) / capacity_Bblocks;
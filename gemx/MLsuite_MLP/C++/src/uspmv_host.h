@@ -38,6 +38,9 @@ public:
     char *asByteArray() {
         return reinterpret_cast<char*>(&m_uspmv_args);
     }
+    unsigned int numPageOffsets() {
+        return 3;
+    }
 protected:
     struct {
         int m_optype;
@@ -65,12 +68,18 @@ public:
         return false;
     }
 
-    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
+    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
+        cerr << "GEMM operation not supported" << endl;
+        return false;
+    }
+
+    virtual bool AddGEMMOpAt(unsigned long long A_off, unsigned long long B_off, unsigned long long C_off, unsigned long long X_off, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
         cerr << "GEMM operation not supported" << endl;
         return false;
     } 
        
-    virtual void* SendUSpMat(uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages){
+    // Packs all stages into the UspMat device layout, the buffer comes from new[]
+    static float* PackUSpMat(uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages, unsigned long long & p_bytes){
       unsigned int t_DoubleDdrWidth = t_DdrWidth*2;
       unsigned int t_StageBlocks = (t_Stages + t_DoubleDdrWidth -1) / t_DoubleDdrWidth;
       unsigned int l_aSize = ((t_StageBlocks * t_DoubleDdrWidth * 3)+1)/2;
@@ -80,38 +89,58 @@ public:
       float *A = new float[l_aSize];
       UspMat<float,uint16_t> MatA(A, t_DdrWidth, t_Stages);
       MatA.fillFromVector(row, col, data, row_size, col_size, nnz_size, p_pRelu);
-      this->SendToFPGA((float*)A, A,(unsigned long long)l_aSize * sizeof(float));
+      p_bytes = (unsigned long long)l_aSize * sizeof(float);
+      return A;
+    }
+
+    virtual void* SendUSpMat(uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages){
+      unsigned long long l_bytes;
+      float *A = PackUSpMat(row, col, data, row_size, col_size, nnz_size, p_pRelu, t_DdrWidth, t_Stages, l_bytes);
+      this->SendToFPGA((float*)A, A, l_bytes);
       return A;
     }
+
+    static SpImage::Header USpImageConfig(unsigned int t_DdrWidth, unsigned int t_Stages){
+      SpImage::Header l_hdr = SpImage::makeHeader(SpImage::Uspmv, SpImage::Float);
+      l_hdr.m_DdrWidth = t_DdrWidth;
+      l_hdr.m_Stages = t_Stages;
+      return l_hdr;
+    }
+
+    // Packs the stages once and stores the device image for SendUSpImage
+    static bool WriteUSpImage(const string & fileName, uint16_t* row, uint16_t* col, float* data, int* row_size, int* col_size, int* nnz_size, float* p_pRelu, unsigned int t_DdrWidth, unsigned int t_Stages){
+      SpImage::Header l_hdr = USpImageConfig(t_DdrWidth, t_Stages);
+      l_hdr.m_M = row_size[0];
+      l_hdr.m_K = col_size[0];
+      for (unsigned int i=0; i<t_Stages; ++i) {
+        l_hdr.m_Nnz += nnz_size[i];
+      }
+      float *A = PackUSpMat(row, col, data, row_size, col_size, nnz_size, p_pRelu, t_DdrWidth, t_Stages, l_hdr.m_Bytes);
+      bool l_res = SpImage::write(fileName, l_hdr, A);
+      delete [] A;
+      return l_res;
+    }
+
+    // Maps an image from WriteUSpImage and sends it without repacking
+    void* SendUSpImage(const string & fileName, unsigned int t_DdrWidth, unsigned int t_Stages){
+      unique_ptr<SpImage> l_image(new SpImage());
+      if (!l_image->map(fileName) || !l_image->matches(USpImageConfig(t_DdrWidth, t_Stages))) {
+        return nullptr;
+      }
+      return this->SendImage(std::move(l_image));
+    }
     
     virtual bool AddUSPMVOp(const HType & A, const HType & B, const HType & C, unsigned int numRuns){     
-      if (this->_hostMat.find(A) == this->_hostMat.end()
-                || this->_hostMat.find(B) == this->_hostMat.end()
-                || this->_hostMat.find(C) == this->_hostMat.end()) {
+      unsigned int l_ids[3];
+      if (!this->FindMats({A, B, C}, false, l_ids)) {
             cerr << "Matrix not found!" << endl;
             return false;
       }
        
      unsigned long long A_off = 0, B_off = 0, C_off = 0;
-     xclGetMemObjDeviceAddress(this->_devHandle[A](), (this->_fpga_stream->getDevice())(), sizeof(unsigned long long), &A_off);
-     xclGetMemObjDeviceAddress(this->_devHandle[B](), (this->_fpga_stream->getDevice())(), sizeof(unsigned long long), &B_off);
-     xclGetMemObjDeviceAddress(this->_devHandle[C](), (this->_fpga_stream->getDevice())(), sizeof(unsigned long long), &C_off);
-       
-     assert(A_off > this->_ddrDeviceBaseAddr);
-     assert(B_off > this->_ddrDeviceBaseAddr);
-     assert(C_off > this->_ddrDeviceBaseAddr);
-       
-     A_off -= this->_ddrDeviceBaseAddr;
-     B_off -= this->_ddrDeviceBaseAddr;
-     C_off -= this->_ddrDeviceBaseAddr;
-
-     assert(A_off % this->PAGE_SIZE == 0);  
-     assert(B_off % this->PAGE_SIZE == 0);
-     assert(C_off % this->PAGE_SIZE == 0);
-
-     A_off /= this->PAGE_SIZE;
-     B_off /= this->PAGE_SIZE;
-     C_off /= this->PAGE_SIZE;
+     A_off = this->GetIdPageOffset(l_ids[0]);
+     B_off = this->GetIdPageOffset(l_ids[1]);
+     C_off = this->GetIdPageOffset(l_ids[2]);
               
      USpmvArgs args(A_off, B_off, C_off, numRuns);
      this->AddInstr (&args);  
@@ -119,16 +148,15 @@ public:
    }
     
     virtual bool AddUSPMVDevOp(const HType & A, const HType & B, const HType & C, unsigned int numRuns){     
-       if (this->_hostMatPageOffset.find(A) == this->_hostMatPageOffset.end()
-          || this->_hostMatPageOffset.find(B) == this->_hostMatPageOffset.end()
-          || this->_hostMatPageOffset.find(C) == this->_hostMatPageOffset.end()) {
+       unsigned int l_ids[3];
+       if (!this->FindMats({A, B, C}, true, l_ids)) {
           cerr << "Matrix not found!" << endl;
           return false;
        }
        unsigned long long A_off = 0, B_off = 0, C_off = 0;
-       A_off = this->GetMatOffset(A);
-       B_off = this->GetMatOffset(B);
-       C_off = this->GetMatOffset(C);
+       A_off = this->GetIdPageOffset(l_ids[0]);
+       B_off = this->GetIdPageOffset(l_ids[1]);
+       C_off = this->GetIdPageOffset(l_ids[2]);
        USpmvArgs args(A_off, B_off, C_off, numRuns);
        this->AddInstr (&args);  
        return true;
@@ -154,7 +182,12 @@ public:
         return false;
     }
 
-    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
+    virtual bool AddGEMMOp(const HType & A, const HType & B, const HType & C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
+        cerr << "GEMM operation not supported" << endl;
+        return false;
+    }
+
+    virtual bool AddGEMMOpAt(unsigned long long A_off, unsigned long long B_off, unsigned long long C_off, unsigned long long X_off, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
         cerr << "GEMM operation not supported" << endl;
         return false;
     } 
@@ -167,6 +200,9 @@ public:
         l_aSize += nnz_size[i] * 2;
       }
       float *A = (float*) this->AddDevBuf(A_str, l_aSize* sizeof(float));
+      if (A == nullptr) {
+        return nullptr;
+      }
       UspMat<float,uint16_t> MatA(A, t_DdrWidth, t_Stages);
       MatA.fillFromVector(row, col, data, row_size, col_size, nnz_size, p_pRelu);
       
@@ -174,16 +210,15 @@ public:
     }  
     
     virtual bool AddUSPMVDevOp(const HType & A, const HType & B, const HType & C, unsigned int numRuns){     
-       if (this->_hostMatPageOffset.find(A) == this->_hostMatPageOffset.end()
-          || this->_hostMatPageOffset.find(B) == this->_hostMatPageOffset.end()
-          || this->_hostMatPageOffset.find(C) == this->_hostMatPageOffset.end()) {
+       unsigned int l_ids[3];
+       if (!this->FindMats({A, B, C}, true, l_ids)) {
           cerr << "Matrix not found!" << endl;
           return false;
        }
        unsigned long long A_off = 0, B_off = 0, C_off = 0;
-       A_off = this->GetMatOffset(A);
-       B_off = this->GetMatOffset(B);
-       C_off = this->GetMatOffset(C);
+       A_off = this->GetIdPageOffset(l_ids[0]);
+       B_off = this->GetIdPageOffset(l_ids[1]);
+       C_off = this->GetIdPageOffset(l_ids[2]);
        USpmvArgs args(A_off, B_off, C_off, numRuns);
        this->AddInstr (&args);  
        return true;
@@ -0,0 +1,551 @@
+/**********
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+* **********/
+/**
+ *  @brief Native CPU implementation of the GEMX engines, used by the CPU
+ *         backend of XStream. It decodes the instruction page written by
+ *         XHost::AddInstr and runs each instruction on the page-offset memory
+ *         layout the FPGA kernel uses.
+ */
+#ifndef _XCPU_H_
+#define _XCPU_H_
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <type_traits>
+#include <unordered_map>
+
+using namespace std;
+namespace gemx
+{
+    // Compile-time GEMX_* configuration of the kernel, read from the
+    // config_info.dat written next to gemx.xclbin by the hardware build
+    class CpuConfig
+    {
+        public:
+            CpuConfig() : m_Good(false) {}
+            CpuConfig(const string &p_xclbin) : m_Good(false)
+            {
+                string l_cfgFile = getConfigFile(p_xclbin);
+                ifstream l_fs(l_cfgFile.c_str());
+                if (!l_fs.is_open()) {
+                    cerr << "WARNING: cannot open " << l_cfgFile << ", using default GEMX configuration" << endl;
+                    return;
+                }
+                m_Good = true;
+                string l_line;
+                while (getline(l_fs, l_line)) {
+                    size_t l_pos = l_line.find('=');
+                    if (l_pos != string::npos) {
+                        m_Opts[l_line.substr(0, l_pos)] = l_line.substr(l_pos + 1);
+                    }
+                }
+                cout << "INFO: GEMX configuration read from " << l_cfgFile << endl;
+            }
+
+            static string getConfigFile(const string &p_xclbin)
+            {
+                const string l_cfgName = "config_info.dat";
+                if (p_xclbin.size() >= 4 && p_xclbin.compare(p_xclbin.size() - 4, 4, ".dat") == 0) {
+                    return p_xclbin;
+                }
+                size_t l_pos = p_xclbin.find_last_of('/');
+                return (l_pos == string::npos) ? l_cfgName : p_xclbin.substr(0, l_pos + 1) + l_cfgName;
+            }
+
+            // True when the configuration was read from config_info.dat
+            bool good() const { return m_Good; }
+
+            string getStr(const string &p_key, const string &p_default) const
+            {
+                auto l_it = m_Opts.find(p_key);
+                return (l_it == m_Opts.end()) ? p_default : l_it->second;
+            }
+
+            unsigned int getInt(const string &p_key, unsigned int p_default) const
+            {
+                auto l_it = m_Opts.find(p_key);
+                return (l_it == m_Opts.end()) ? p_default : (unsigned int)strtoul(l_it->second.c_str(), nullptr, 10);
+            }
+
+            // Defaults match common.mk
+            string dataType() const { return getStr("GEMX_dataType", "short"); }
+            string xDataType() const { return getStr("GEMX_XdataType", "int32_t"); }
+            unsigned int ddrWidth() const { return getInt("GEMX_ddrWidth", 32); }
+            unsigned int xddrWidth() const { return getInt("GEMX_XddrWidth", 16); }
+            unsigned int numInstr() const { return getInt("GEMX_numInstr", 16); }
+            bool keepMacBits() const { return getInt("GEMX_keepMacBits", 0) != 0; }
+            unsigned int macBits() const { return getInt("GEMX_macBits", 48); }
+            unsigned int gemmMBlocks() const { return getInt("GEMX_gemmMBlocks", 4); }
+            unsigned int gemmKBlocks() const { return getInt("GEMX_gemmKBlocks", 4); }
+            unsigned int gemmNBlocks() const { return getInt("GEMX_gemmNBlocks", 4); }
+            unsigned int spmvWidth() const { return getInt("GEMX_spmvWidth", 8); }
+            unsigned int spmvMacGroups() const { return getInt("GEMX_spmvMacGroups", 12); }
+            unsigned int spmvColAddIdxBits() const { return getInt("GEMX_spmvColAddIdxBits", 2); }
+            unsigned int spmvkVectorBlocks() const { return getInt("GEMX_spmvkVectorBlocks", 2048); }
+            unsigned int spmvFloatPerDesc() const { return getInt("GEMX_spmvFloatPerDesc", 2); }
+            unsigned int uspmvStages() const { return getInt("GEMX_uspmvStages", 1); }
+            unsigned int transpBlocks() const { return getInt("GEMX_transpBlocks", 1); }
+
+            unsigned int spmvRowsInCblock() const
+            {
+                unsigned int l_group = spmvWidth() * spmvMacGroups() * ddrWidth();
+                unsigned int l_mVectorBlocks = (1 << (16 - spmvColAddIdxBits())) / l_group;
+                return l_group * l_mVectorBlocks;
+            }
+            unsigned int spmvColsInBblock() const
+            {
+                return spmvWidth() * spmvkVectorBlocks() * ddrWidth();
+            }
+
+        private:
+            bool m_Good;
+            unordered_map<string, string> m_Opts;
+    };
+
+    // Instruction layouts, identical to the kArgs structs in the *_host.h files.
+    // CpuGemmInstr is the FcnArgs layout; GemmArgs has no PReLU value and keeps
+    // the transpose flags where FcnArgs keeps m_PReLUVal
+    struct CpuGemmInstr
+    {
+        int m_optype;
+        unsigned int m_Aoffset, m_Boffset, m_Coffset, m_Xoffset, m_M, m_K, m_N,
+                     m_Lda, m_Ldb, m_Ldc, m_Ldx;
+        int m_postScaleVal;
+        short m_PReLUVal;
+        // A stored K x M, B stored N x K, X and C stored N x M
+        bool m_TransA, m_TransB, m_TransC;
+        char c_dummy[3];
+        int dummy[1];
+    };
+
+    // ControlArgs as serialized by KargsType::setControlArgs: the fields are packed
+    // without padding, so m_NextCodePage starts at byte 6
+    struct CpuControlInstr
+    {
+        static const unsigned int IS_LAST_OP_OFFSET = 4;
+        static const unsigned int NEXT_CODE_PAGE_OFFSET = 6;
+    };
+
+    struct CpuSpmvInstr
+    {
+        int m_optype;
+        unsigned int m_Aoffset, m_Boffset, m_Coffset, m_M, m_K, m_Nnz, m_Bblocks, m_Cblocks, m_DescPages;
+        bool m_Prelu;
+        unsigned int dummy[5];
+    };
+
+    struct CpuUspmvInstr
+    {
+        int m_optype;
+        unsigned int m_Aoffset, m_Boffset, m_Coffset, m_numRuns;
+        unsigned int dummy[11];
+    };
+
+    class CpuKernel
+    {
+        public:
+            // Resolves a page offset of the instruction to a host pointer
+            typedef function<char*(unsigned int)> PageResolver;
+
+            static const unsigned int PAGE_SIZE = 4096;
+            static const unsigned int INSTR_SIZE = 64;
+
+            CpuKernel() = delete;
+            CpuKernel(const CpuConfig &p_config) : m_Config(p_config)
+            {
+                const char *l_threads = getenv("GEMX_CPU_THREADS");
+                m_NumThreads = (l_threads != nullptr) ? (unsigned int)atoi(l_threads) : thread::hardware_concurrency();
+                if (m_NumThreads == 0) {
+                    m_NumThreads = 1;
+                }
+            }
+
+            const CpuConfig & getConfig() const { return m_Config; }
+            unsigned int getNumThreads() const { return m_NumThreads; }
+
+            // Runs the code page at p_code and, like kernelOpLow, continues at the
+            // code page named by a control op in the last slot of each page
+            bool run(const char *p_code, const PageResolver &p_page)
+            {
+                bool l_res = true;
+                unsigned int l_numInstr = m_Config.numInstr();
+                if (l_numInstr > PAGE_SIZE / INSTR_SIZE) {
+                    l_numInstr = PAGE_SIZE / INSTR_SIZE;
+                }
+                const char *l_code = p_code;
+                while (l_res && l_code != nullptr) {
+                    unsigned int l_nextCodePage = 0;
+                    l_res = runPage(l_code, l_numInstr, l_nextCodePage, p_page);
+                    l_code = nullptr;
+                    if (l_res && l_nextCodePage != 0) {
+                        l_code = p_page(l_nextCodePage);
+                        if (l_code == nullptr) {
+                            cerr << "ERROR: next code page " << l_nextCodePage << " outside of device memory" << endl;
+                            l_res = false;
+                        }
+                    }
+                }
+                return l_res;
+            }
+
+        private:
+            bool runPage(const char *p_code, unsigned int p_numInstr, unsigned int &p_nextCodePage, const PageResolver &p_page)
+            {
+                bool l_res = true;
+                for (unsigned int l_pc = 0; l_res && l_pc < p_numInstr; ++l_pc) {
+                    const char *l_instr = p_code + l_pc * INSTR_SIZE;
+                    int l_op;
+                    memcpy(&l_op, l_instr, sizeof(l_op));
+                    switch (l_op) {
+                        case 0: { // OpControl
+                            bool l_isLastOp;
+                            unsigned int l_nextCodePage;
+                            memcpy(&l_isLastOp, l_instr + CpuControlInstr::IS_LAST_OP_OFFSET, sizeof(l_isLastOp));
+                            memcpy(&l_nextCodePage, l_instr + CpuControlInstr::NEXT_CODE_PAGE_OFFSET, sizeof(l_nextCodePage));
+                            if ((l_isLastOp || l_nextCodePage != 0) && l_pc != p_numInstr - 1) {
+                                cerr << "ERROR: control op at instruction " << l_pc << " ends the code page early" << endl;
+                                l_res = false;
+                            } else if (!l_isLastOp) {
+                                p_nextCodePage = l_nextCodePage;
+                            }
+                            break;
+                        }
+                        case 2: // OpGemm
+                        case 8: { // OpFcn
+                            CpuGemmInstr l_args;
+                            memcpy(&l_args, l_instr, sizeof(l_args));
+                            if (l_op == 2) {
+                                memcpy(&l_args.m_TransA, l_instr + offsetof(CpuGemmInstr, m_PReLUVal), 3 * sizeof(bool));
+                                l_args.m_PReLUVal = 0;
+                            }
+                            l_res = runGemm(l_args, l_op == 8, p_page);
+                            break;
+                        }
+                        case 4: { // OpSpmv
+                            CpuSpmvInstr l_args;
+                            memcpy(&l_args, l_instr, sizeof(l_args));
+                            l_res = runSpmv(l_args, p_page);
+                            break;
+                        }
+                        case 5: { // OpUspmv
+                            CpuUspmvInstr l_args;
+                            memcpy(&l_args, l_instr, sizeof(l_args));
+                            l_res = runUspmv(l_args, p_page);
+                            break;
+                        }
+                        default:
+                            cerr << "ERROR: CPU backend does not support op " << l_op << " at instruction " << l_pc << endl;
+                            l_res = false;
+                    }
+                }
+                return l_res;
+            }
+
+            // Split [0, p_n) into contiguous ranges, one per worker thread
+            void parallelFor(unsigned int p_n, const function<void(unsigned int, unsigned int)> &p_fn)
+            {
+                unsigned int l_threads = (p_n < m_NumThreads) ? p_n : m_NumThreads;
+                if (l_threads <= 1) {
+                    if (p_n > 0) {
+                        p_fn(0, p_n);
+                    }
+                    return;
+                }
+                vector<thread> l_workers;
+                unsigned int l_chunk = (p_n + l_threads - 1) / l_threads;
+                for (unsigned int l_begin = 0; l_begin < p_n; l_begin += l_chunk) {
+                    unsigned int l_end = (l_begin + l_chunk < p_n) ? l_begin + l_chunk : p_n;
+                    l_workers.push_back(thread(p_fn, l_begin, l_end));
+                }
+                for (auto &l_worker : l_workers) {
+                    l_worker.join();
+                }
+            }
+
+            static int64_t wrapBits(int64_t p_val, unsigned int p_bits)
+            {
+                if (p_bits >= 64) {
+                    return p_val;
+                }
+                unsigned int l_shift = 64 - p_bits;
+                return (int64_t)((uint64_t)p_val << l_shift) >> l_shift;
+            }
+
+            // GemmAddX and FcnScalePRelu with GEMX_keepMacBits: the accumulator
+            // wraps to t_MacBits, post scale is ap_uint<16> value, 8 bit shift
+            template<typename t_DataType, typename t_XType>
+            t_DataType postProcess(int64_t p_ab, t_XType p_x, int32_t p_postScale, bool p_isFcn, int16_t p_PReluVal, std::true_type)
+            {
+                unsigned int l_macBits = m_Config.macBits();
+                int64_t l_abx = wrapBits(wrapBits(p_ab, l_macBits) + (int64_t)p_x, l_macBits);
+                int64_t l_scaleVal = ((uint32_t)p_postScale >> 8) & 0xffff;
+                unsigned int l_shift = p_postScale & 0xff;
+                int64_t l_ps = wrapBits(l_abx * l_scaleVal, l_macBits);
+                l_ps = (l_shift >= l_macBits) ? ((l_ps < 0) ? -1 : 0) : (l_ps >> l_shift);
+                t_DataType l_c = (t_DataType)l_ps;
+                if (p_isFcn && l_c < 0) {
+                    int l_scale = p_PReluVal >> 6;
+                    int l_alpha = p_PReluVal & 0x3f;
+                    l_alpha = (l_alpha > 31) ? 31 : l_alpha;
+                    l_c = (t_DataType)((l_c * l_scale) >> l_alpha);
+                }
+                return l_c;
+            }
+
+            template<typename t_DataType, typename t_XType, typename t_AccType>
+            t_DataType postProcess(t_AccType p_ab, t_XType p_x, int32_t p_postScale, bool p_isFcn, int16_t p_PReluVal, std::false_type)
+            {
+                t_DataType l_c = (t_DataType)((t_DataType)p_ab + p_x);
+                if (p_isFcn && l_c < 0) {
+                    l_c = 0;
+                }
+                return l_c;
+            }
+
+            template<typename t_DataType, typename t_XType>
+            void gemm(const CpuGemmInstr &p_args, bool p_isFcn, t_DataType *p_a, t_DataType *p_b, t_DataType *p_c, t_XType *p_x)
+            {
+                typedef typename conditional<is_floating_point<t_DataType>::value, t_DataType, int64_t>::type AccType;
+                const bool l_keepMacBits = m_Config.keepMacBits() && !is_floating_point<t_DataType>::value;
+                // A transposed B is copied once to K x N so the inner loop stays unit stride
+                vector<t_DataType> l_bT;
+                const t_DataType *l_b = p_b;
+                size_t l_ldb = p_args.m_Ldb;
+                if (p_args.m_TransB) {
+                    l_bT.resize((size_t)p_args.m_K * p_args.m_N);
+                    for (unsigned int k = 0; k < p_args.m_K; ++k) {
+                        for (unsigned int j = 0; j < p_args.m_N; ++j) {
+                            l_bT[(size_t)k * p_args.m_N + j] = p_b[(size_t)j * p_args.m_Ldb + k];
+                        }
+                    }
+                    l_b = l_bT.data();
+                    l_ldb = p_args.m_N;
+                }
+                // Element strides of C and X along a row and down a column
+                const size_t l_cCol = p_args.m_TransC ? p_args.m_Ldc : 1, l_cRow = p_args.m_TransC ? 1 : p_args.m_Ldc;
+                const size_t l_xCol = p_args.m_TransC ? p_args.m_Ldx : 1, l_xRow = p_args.m_TransC ? 1 : p_args.m_Ldx;
+                parallelFor(p_args.m_M, [&](unsigned int p_begin, unsigned int p_end) {
+                    vector<AccType> l_acc(p_args.m_N);
+                    vector<t_DataType> l_aCol(p_args.m_TransA ? p_args.m_K : 0);
+                    for (unsigned int i = p_begin; i < p_end; ++i) {
+                        fill(l_acc.begin(), l_acc.end(), AccType(0));
+                        const t_DataType *l_aRow = p_a + (size_t)i * p_args.m_Lda;
+                        if (p_args.m_TransA) {
+                            for (unsigned int k = 0; k < p_args.m_K; ++k) {
+                                l_aCol[k] = p_a[(size_t)k * p_args.m_Lda + i];
+                            }
+                            l_aRow = l_aCol.data();
+                        }
+                        for (unsigned int k = 0; k < p_args.m_K; ++k) {
+                            const AccType l_aVal = l_aRow[k];
+                            const t_DataType *l_bRow = l_b + (size_t)k * l_ldb;
+                            for (unsigned int j = 0; j < p_args.m_N; ++j) {
+                                l_acc[j] += l_aVal * (AccType)l_bRow[j];
+                            }
+                        }
+                        t_DataType *l_c = p_c + i * l_cRow;
+                        const t_XType *l_x = p_x + i * l_xRow;
+                        for (unsigned int j = 0; j < p_args.m_N; ++j) {
+                            if (l_keepMacBits) {
+                                l_c[j * l_cCol] = postProcess<t_DataType, t_XType>((int64_t)l_acc[j], l_x[j * l_xCol],
+                                        p_args.m_postScaleVal, p_isFcn, p_args.m_PReLUVal,
+                                        integral_constant<bool, !is_floating_point<t_DataType>::value>());
+                            } else {
+                                l_c[j * l_cCol] = postProcess<t_DataType, t_XType, AccType>(l_acc[j], l_x[j * l_xCol],
+                                        p_args.m_postScaleVal, p_isFcn, p_args.m_PReLUVal, std::false_type());
+                            }
+                        }
+                    }
+                });
+            }
+
+            template<typename t_DataType>
+            bool runGemmX(const CpuGemmInstr &p_args, bool p_isFcn, const PageResolver &p_page)
+            {
+                t_DataType *l_a = (t_DataType*)p_page(p_args.m_Aoffset);
+                t_DataType *l_b = (t_DataType*)p_page(p_args.m_Boffset);
+                t_DataType *l_c = (t_DataType*)p_page(p_args.m_Coffset);
+                char *l_x = p_page(p_args.m_Xoffset);
+                if (l_a == nullptr || l_b == nullptr || l_c == nullptr || l_x == nullptr) {
+                    cerr << "ERROR: GEMM operand outside of device memory" << endl;
+                    return false;
+                }
+                string l_xType = m_Config.xDataType();
+                if (l_xType == "float") {
+                    gemm(p_args, p_isFcn, l_a, l_b, l_c, (float*)l_x);
+                } else if (l_xType == "short" || l_xType == "int16_t") {
+                    gemm(p_args, p_isFcn, l_a, l_b, l_c, (int16_t*)l_x);
+                } else {
+                    gemm(p_args, p_isFcn, l_a, l_b, l_c, (int32_t*)l_x);
+                }
+                return true;
+            }
+
+            bool runGemm(const CpuGemmInstr &p_args, bool p_isFcn, const PageResolver &p_page)
+            {
+                string l_type = m_Config.dataType();
+                if (l_type == "float") {
+                    return runGemmX<float>(p_args, p_isFcn, p_page);
+                } else if (l_type == "int" || l_type == "int32_t") {
+                    return runGemmX<int32_t>(p_args, p_isFcn, p_page);
+                }
+                return runGemmX<int16_t>(p_args, p_isFcn, p_page);
+            }
+
+            // A is laid out by SpMat::fillFromVector: block descriptors followed by
+            // 4k aligned runs of {value, col, row} entries per (Bblock, Cblock)
+            template<typename t_DataType>
+            bool spmv(const CpuSpmvInstr &p_args, const PageResolver &p_page)
+            {
+                const unsigned int *l_desc = (const unsigned int*)p_page(p_args.m_Aoffset);
+                t_DataType *l_b = (t_DataType*)p_page(p_args.m_Boffset);
+                t_DataType *l_c = (t_DataType*)p_page(p_args.m_Coffset);
+                if (l_desc == nullptr || l_b == nullptr || l_c == nullptr) {
+                    cerr << "ERROR: SPMV operand outside of device memory" << endl;
+                    return false;
+                }
+                const unsigned int l_rowsInCblock = m_Config.spmvRowsInCblock();
+                const unsigned int l_colsInBblock = m_Config.spmvColsInBblock();
+                const unsigned int l_rowBits = 16 - m_Config.spmvColAddIdxBits();
+                const unsigned int l_rowMask = (1 << l_rowBits) - 1;
+                atomic<bool> l_res(true);
+                for (unsigned int l_Bblock = 0; l_res && l_Bblock < p_args.m_Bblocks; ++l_Bblock) {
+                    parallelFor(p_args.m_Cblocks, [&](unsigned int p_begin, unsigned int p_end) {
+                        for (unsigned int l_Cblock = p_begin; l_Cblock < p_end; ++l_Cblock) {
+                            unsigned int l_blockId = l_Bblock * p_args.m_Cblocks + l_Cblock;
+                            unsigned int l_nnz = l_desc[l_blockId * 2];
+                            unsigned int l_offset = l_desc[l_blockId * 2 + 1];
+                            const char *l_ad = p_page(p_args.m_Aoffset + p_args.m_DescPages + l_offset);
+                            if (l_ad == nullptr) {
+                                l_res = false;
+                                continue;
+                            }
+                            unsigned int l_rowBase = l_Cblock * l_rowsInCblock;
+                            unsigned int l_colBase = l_Bblock * l_colsInBblock;
+                            for (unsigned int i = 0; i < l_nnz; ++i) {
+                                t_DataType l_val;
+                                uint16_t l_col, l_row;
+                                memcpy(&l_val, l_ad + i * 8, 4);
+                                memcpy(&l_col, l_ad + i * 8 + 4, 2);
+                                memcpy(&l_row, l_ad + i * 8 + 6, 2);
+                                unsigned int l_colIdx = l_colBase + (l_col | ((l_row >> l_rowBits) << 16));
+                                unsigned int l_rowIdx = l_rowBase + (l_row & l_rowMask);
+                                if (l_val != 0 && l_rowIdx < p_args.m_M && l_colIdx < p_args.m_K) {
+                                    l_c[l_rowIdx] += l_val * l_b[l_colIdx];
+                                }
+                            }
+                            if (p_args.m_Prelu) {
+                                unsigned int l_rowEnd = l_rowBase + l_rowsInCblock;
+                                for (unsigned int r = l_rowBase; r < l_rowEnd && r < p_args.m_M; ++r) {
+                                    if (l_c[r] < 0) {
+                                        l_c[r] = 0;
+                                    }
+                                }
+                            }
+                        }
+                    });
+                }
+                if (!l_res) {
+                    cerr << "ERROR: SPMV block outside of device memory" << endl;
+                }
+                return l_res;
+            }
+
+            bool runSpmv(const CpuSpmvInstr &p_args, const PageResolver &p_page)
+            {
+                string l_type = m_Config.dataType();
+                if (l_type == "float") {
+                    return spmv<float>(p_args, p_page);
+                }
+                return spmv<int32_t>(p_args, p_page);
+            }
+
+            // A is laid out by UspMat::fillFromVector: per stage nnz, rows, prelu,
+            // then {col,row} index pairs followed by values for every stage
+            bool runUspmv(const CpuUspmvInstr &p_args, const PageResolver &p_page)
+            {
+                float *l_aDat = (float*)p_page(p_args.m_Aoffset);
+                float *l_b = (float*)p_page(p_args.m_Boffset);
+                float *l_c = (float*)p_page(p_args.m_Coffset);
+                if (l_aDat == nullptr || l_b == nullptr || l_c == nullptr) {
+                    cerr << "ERROR: USPMV operand outside of device memory" << endl;
+                    return false;
+                }
+                const unsigned int l_ddrWidth = m_Config.ddrWidth();
+                const unsigned int l_stages = m_Config.uspmvStages();
+                const unsigned int l_doubleDdrWidth = l_ddrWidth * 2;
+                const unsigned int l_stageBlocks = (l_stages + l_doubleDdrWidth - 1) / l_doubleDdrWidth;
+                const unsigned int l_descSize = ((l_stageBlocks * l_doubleDdrWidth * 3) + 1) / 2;
+                const unsigned int *l_nnzs = (const unsigned int*)l_aDat;
+                const uint16_t *l_idx = (const uint16_t*)l_aDat;
+                const uint16_t *l_rows = l_idx + l_stageBlocks * l_doubleDdrWidth;
+                const float *l_prelu = l_aDat + l_stageBlocks * l_ddrWidth * 2;
+
+                vector<unsigned int> l_dim(l_stages + 1), l_idxBase(l_stages), l_datBase(l_stages);
+                l_dim[0] = (l_rows[l_stages] / l_ddrWidth) * l_ddrWidth;
+                unsigned int l_maxDim = l_dim[0];
+                unsigned int l_offset = 0;
+                for (unsigned int s = 0; s < l_stages; ++s) {
+                    l_dim[s + 1] = (l_rows[s] / l_ddrWidth) * l_ddrWidth;
+                    l_maxDim = (l_dim[s + 1] > l_maxDim) ? l_dim[s + 1] : l_maxDim;
+                    l_idxBase[s] = l_descSize * 2 + l_offset * 2;
+                    l_datBase[s] = l_descSize + l_offset + l_nnzs[s];
+                    l_offset += l_nnzs[s] * 2;
+                }
+
+                parallelFor(p_args.m_numRuns, [&](unsigned int p_begin, unsigned int p_end) {
+                    vector<float> l_in(l_maxDim), l_out(l_maxDim);
+                    for (unsigned int r = p_begin; r < p_end; ++r) {
+                        copy(l_b + (size_t)r * l_dim[0], l_b + (size_t)(r + 1) * l_dim[0], l_in.begin());
+                        for (unsigned int s = 0; s < l_stages; ++s) {
+                            fill(l_out.begin(), l_out.begin() + l_dim[s + 1], 0.0f);
+                            const uint16_t *l_pairs = l_idx + l_idxBase[s];
+                            const float *l_vals = l_aDat + l_datBase[s];
+                            for (unsigned int j = 0; j < l_nnzs[s]; ++j) {
+                                unsigned int l_col = l_pairs[j * 2];
+                                unsigned int l_row = l_pairs[j * 2 + 1];
+                                if (l_row < l_dim[s + 1] && l_col < l_dim[s]) {
+                                    l_out[l_row] += l_vals[j] * l_in[l_col];
+                                }
+                            }
+                            for (unsigned int i = 0; i < l_dim[s + 1]; ++i) {
+                                l_in[i] = (l_out[i] < 0) ? l_out[i] * l_prelu[s] : l_out[i];
+                            }
+                        }
+                        copy(l_in.begin(), l_in.begin() + l_dim[l_stages], l_c + (size_t)r * l_dim[l_stages]);
+                    }
+                });
+                return true;
+            }
+
+        private:
+            CpuConfig m_Config;
+            unsigned int m_NumThreads;
+    };
+
+}
+
+#endif
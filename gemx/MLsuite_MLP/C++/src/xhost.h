@@ -21,10 +21,52 @@
 #include <string>
 #include <fstream>
 #include <unordered_map>
+#include <unordered_set>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <algorithm>
+#include <initializer_list>
 #include "gemx_util.h"
+#include "xcpu.h"
+
+// Build with the XRT device backend; 0 builds the CPU backend alone, without XRT
+#ifndef GEMX_useXrt
+#define GEMX_useXrt 1
+#endif
+#if GEMX_useXrt
 #include "xcl2/xcl2.hpp"
+#endif
 
 //#define GEMX_PERF_DBG
+
+// Number of instruction pages XHost rotates through, i.e. programs in flight
+#ifndef GEMX_hostInstrSlots
+#define GEMX_hostInstrSlots 2
+#endif
+
+// Instruction pages reserved for programs recorded with BeginCapture/EndCapture
+#ifndef GEMX_hostGraphSlots
+#define GEMX_hostGraphSlots 4
+#endif
+
+// Size of the pinned host regions AllocHostMat carves matrices from
+#ifndef GEMX_hostPoolChunkSize
+#define GEMX_hostPoolChunkSize (64ULL << 20)
+#endif
+
+// Bytes of constant matrices XHost keeps on the device for SendToFPGA(..., cached)
+#ifndef GEMX_hostMatCacheSize
+#define GEMX_hostMatCacheSize (1ULL << 30)
+#endif
+
+// GEMX_numInstr of an xclbin without a config_info.dat next to it
+#ifndef GEMX_hostNumInstr
+#define GEMX_hostNumInstr 16
+#endif
+
 using namespace std;
 namespace gemx
 {
@@ -40,25 +82,83 @@ namespace gemx
             }
             virtual size_t sizeInBytes() = 0;
             virtual char* asByteArray() = 0;
+            // Number of page offset words following the op type word
+            virtual unsigned int numPageOffsets() { return 0; }
+    };
+
+    // Device buffer handle shared by all XStream backends
+    class XBuf
+    {
+        public:
+            XBuf() : m_HostPtr(nullptr), m_Sz(0), m_DevAddr(0) {}
+
+#if GEMX_useXrt
+            cl::Buffer m_ClBuf;
+#endif
+            char* m_HostPtr;
+            unsigned long long m_Sz;
+            unsigned long long m_DevAddr;
     };
 
     //Base address will be the instruction memory region
-    class XStream 
+    //Kernel runs are tagged with the instruction slot they were launched from, so
+    //a readback only waits for the run that produced its data
+    class XStream
+    {
+        public:
+            static const unsigned int LAST_SLOT = ~0u;
+
+            virtual ~XStream() {}
+
+            // GEMX_BACKEND=cpu runs the kernel on the host instead of the first Xilinx device,
+            // which is the only backend when built with GEMX_useXrt=0
+            static shared_ptr<XStream> create(const string &xclbin, const string & kernelName);
+
+            virtual XBuf createBuf(void *ptr, size_t sz_bytes) = 0;
+            virtual bool createSubBuf(const XBuf & buf, size_t origin, size_t sz_bytes, XBuf & sub_buf) = 0;
+            virtual unsigned long long getDevAddr(const XBuf & buf) = 0;
+            virtual bool copyToFpga(const XBuf & buf, bool sync_send) = 0;
+            virtual void copyFromFpga(const XBuf & buf, bool sync_exec = true, unsigned int slot = LAST_SLOT) = 0;
+            virtual void execKernel(const XBuf & instr_buf, bool sync_exec = true, unsigned int slot = 0) = 0;
+            virtual void waitSlot(unsigned int slot) = 0;
+            virtual void wait () = 0;
+            // Instructions the kernel executes per run (GEMX_numInstr)
+            virtual unsigned int getNumInstr() const = 0;
+
+            XBuf copyToFpga(void * buf, size_t sz_bytes,
+                    bool sync_send = false)
+            {
+                XBuf l_buf = createBuf(buf, sz_bytes);
+                copyToFpga(l_buf, sync_send);
+                return l_buf;
+            }
+    };
+
+#if GEMX_useXrt
+    class XFpgaStream : public XStream
     {
         private:
             cl::Kernel m_Kernel;
 
 
             vector<cl::Event>   _waitInput;//m_Mem2FpgaEvents;
-            vector<cl::Event>   _waitOutput;//m_ExeKernelEvents;
+            vector<cl::Event>   _waitOutput;//m_Fpga2MemEvents;
+            vector<cl::Event>   _slotExec;//last kernel run of each slot
+            cl::Event           _lastExec;
+            unsigned int        _numInstr;
         public:
             cl::Context m_Context;
             cl::CommandQueue m_CommandQueue;
             cl::Device m_Device;
 
-            XStream() = delete;
-            XStream(const string &xclbin, const string & kernelName)
+            XFpgaStream() = delete;
+            XFpgaStream(const string &xclbin, const string & kernelName)
+                : _numInstr(GEMX_hostNumInstr)
             {
+                CpuConfig l_cfg(xclbin);
+                if (l_cfg.good()) {
+                    _numInstr = l_cfg.numInstr();
+                }
                 const char* l_kernelName = kernelName.c_str();
 
                 vector<cl::Device> l_devices = xcl::get_xil_devices();
@@ -85,24 +185,53 @@ namespace gemx
                 m_Kernel = move(cl::Kernel(l_program, l_kernelName));
             }
 
-            ~XStream() 
+            ~XFpgaStream() 
+            {
+            }
+
+            unsigned int getNumInstr() const
             {
+                return _numInstr;
             }
 
             cl::Device getDevice() {
                 return m_Device;
             }
 
-            cl::Buffer createBuf(void *ptr, size_t sz_bytes)
+            XBuf createBuf(void *ptr, size_t sz_bytes)
+            {
+                XBuf l_buf;
+                l_buf.m_ClBuf = cl::Buffer(m_Context,CL_MEM_USE_HOST_PTR | CL_MEM_READ_WRITE,sz_bytes,ptr);
+                l_buf.m_HostPtr = (char*)ptr;
+                l_buf.m_Sz = sz_bytes;
+                return l_buf;
+            }
+
+            bool createSubBuf(const XBuf & buf, size_t origin, size_t sz_bytes, XBuf & sub_buf)
+            {
+                cl_buffer_region l_region;
+                l_region.origin = origin;
+                l_region.size = sz_bytes;
+
+                cl_int l_err;
+                sub_buf.m_ClBuf = buf.m_ClBuf.createSubBuffer(CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &l_region, &l_err);
+                sub_buf.m_HostPtr = buf.m_HostPtr + origin;
+                sub_buf.m_Sz = sz_bytes;
+                return (l_err == CL_SUCCESS);
+            }
+
+            unsigned long long getDevAddr(const XBuf & buf)
             {
-                return cl::Buffer(m_Context,CL_MEM_USE_HOST_PTR | CL_MEM_READ_WRITE,sz_bytes,ptr);
+                unsigned long long l_addr = 0;
+                xclGetMemObjDeviceAddress(buf.m_ClBuf.get(), m_Device.get(), sizeof(unsigned long long), &l_addr);
+                return l_addr;
             }
 
-            bool copyToFpga(const cl::Buffer & buf, bool sync_send)
+            bool copyToFpga(const XBuf & buf, bool sync_send)
             {
                 cl::Event l_event;
                 vector<cl::Memory> l_buff;
-                l_buff.push_back(buf);
+                l_buff.push_back(buf.m_ClBuf);
                 // Send the input data to the accelerator
                 m_CommandQueue.enqueueMigrateMemObjects(l_buff,0,NULL,&l_event);
                 if (sync_send)
@@ -115,24 +244,20 @@ namespace gemx
                 return true;
             }
 
-            cl::Buffer copyToFpga(void * buf, size_t sz_bytes,
-                    bool sync_send = false)
-            {
-                cl::Buffer cl_buf = createBuf(buf, sz_bytes);
-                copyToFpga(cl_buf, sync_send);
-                return cl_buf;
-            }
-
-            void copyFromFpga(const cl::Buffer & buf, bool sync_exec = true)
+            void copyFromFpga(const XBuf & buf, bool sync_exec = true, unsigned int slot = LAST_SLOT)
             {
                 //cout << "copyFromFPGA" << endl;
                 XTimer t;
                 cl::Event l_readEvents;
+                vector<cl::Event> l_deps;
+                cl::Event l_exec = (slot < _slotExec.size()) ? _slotExec[slot] : _lastExec;
+                if (l_exec() != nullptr) {
+                    l_deps.push_back(l_exec);
+                }
 
-                m_CommandQueue.enqueueMigrateMemObjects({buf},CL_MIGRATE_MEM_OBJECT_HOST,&_waitOutput,&l_readEvents);
+                m_CommandQueue.enqueueMigrateMemObjects({buf.m_ClBuf},CL_MIGRATE_MEM_OBJECT_HOST,&l_deps,&l_readEvents);
                 if ( sync_exec ){
                     l_readEvents.wait();
-                    _waitOutput.clear();
                 } else{
                     _waitOutput.push_back(l_readEvents);
                 }
@@ -140,28 +265,42 @@ namespace gemx
                 cout << "copyFromFpga: " << t.elapsed() << endl;
 #endif
             }
-            void execKernel(const cl::Buffer & instr_buf, bool sync_exec = true )
+            void execKernel(const XBuf & instr_buf, bool sync_exec = true, unsigned int slot = 0)
             {
                 // Launch kernels
-                m_Kernel.setArg(0,instr_buf);
-                m_Kernel.setArg(1,instr_buf);
+                m_Kernel.setArg(0,instr_buf.m_ClBuf);
+                m_Kernel.setArg(1,instr_buf.m_ClBuf);
 
                 XTimer t;
                 cl::Event l_event;
+                // keep runs in order, a program may consume the results of the previous one
+                if (_lastExec() != nullptr) {
+                    _waitInput.push_back(_lastExec);
+                }
                 m_CommandQueue.enqueueTask(m_Kernel, &(_waitInput),&l_event);
+                _waitInput.clear();
 
+                if (slot >= _slotExec.size()) {
+                    _slotExec.resize(slot + 1);
+                }
+                _slotExec[slot] = l_event;
+                _lastExec = l_event;
                 if ( sync_exec ) {
                     l_event.wait();
-                } else{
-                    _waitOutput.push_back(l_event);
                 }
-                _waitInput.clear();
 #ifdef GEMX_PERF_DBG
                 cout << "execKernel: " << t.elapsed() << endl;
 #endif
 
             }
 
+            void waitSlot(unsigned int slot)
+            {
+                if (slot < _slotExec.size() && _slotExec[slot]() != nullptr) {
+                    _slotExec[slot].wait();
+                }
+            }
+
             void wait ()
             {
                 m_CommandQueue.finish();
@@ -169,6 +308,437 @@ namespace gemx
                 _waitOutput.clear();
             }
     };
+#endif
+
+    // Runs the instruction page with the native kernels in xcpu.h. Buffers alias
+    // host memory (like CL_MEM_USE_HOST_PTR), so transfers are no-ops, and device
+    // addresses are emulated in a page aligned address space to keep the page
+    // offsets encoded by the *Host classes valid.
+    class XCpuStream : public XStream
+    {
+        private:
+            static const unsigned int PAGE_SIZE = 4096;
+
+            CpuKernel m_Kernel;
+            mutex m_Mutex;
+            map<unsigned long long, XBuf> m_Regions;
+            unsigned long long m_NextAddr;
+            shared_future<bool> m_LastRun;
+            vector<shared_future<bool> > m_SlotRun;
+        public:
+            XCpuStream() = delete;
+            XCpuStream(const string &xclbin, const string & kernelName)
+                : m_Kernel(CpuConfig(xclbin)), m_NextAddr(PAGE_SIZE)
+            {
+                cout << "INFO: CPU backend for " << kernelName << " with " << m_Kernel.getNumThreads() << " threads" << endl;
+            }
+
+            ~XCpuStream()
+            {
+                wait();
+            }
+
+            unsigned int getNumInstr() const
+            {
+                return m_Kernel.getConfig().numInstr();
+            }
+
+            XBuf createBuf(void *ptr, size_t sz_bytes)
+            {
+                XBuf l_buf;
+                l_buf.m_HostPtr = (char*)ptr;
+                l_buf.m_Sz = sz_bytes;
+                lock_guard<mutex> l_lock(m_Mutex);
+                l_buf.m_DevAddr = m_NextAddr;
+                // one unmapped guard page between buffers
+                m_NextAddr += ((sz_bytes + PAGE_SIZE - 1) / PAGE_SIZE + 1) * PAGE_SIZE;
+                m_Regions[l_buf.m_DevAddr] = l_buf;
+                return l_buf;
+            }
+
+            bool createSubBuf(const XBuf & buf, size_t origin, size_t sz_bytes, XBuf & sub_buf)
+            {
+                if (origin + sz_bytes > buf.m_Sz) {
+                    return false;
+                }
+                sub_buf.m_HostPtr = buf.m_HostPtr + origin;
+                sub_buf.m_Sz = sz_bytes;
+                sub_buf.m_DevAddr = buf.m_DevAddr + origin;
+                return true;
+            }
+
+            unsigned long long getDevAddr(const XBuf & buf)
+            {
+                return buf.m_DevAddr;
+            }
+
+            bool copyToFpga(const XBuf & buf, bool sync_send)
+            {
+                return true;
+            }
+
+            void copyFromFpga(const XBuf & buf, bool sync_exec = true, unsigned int slot = LAST_SLOT)
+            {
+                if (sync_exec) {
+                    if (slot < m_SlotRun.size()) {
+                        waitSlot(slot);
+                    } else {
+                        wait();
+                    }
+                }
+            }
+
+            void execKernel(const XBuf & instr_buf, bool sync_exec = true, unsigned int slot = 0)
+            {
+                XTimer t;
+                // XHost does not touch the slot's code page again before waitSlot
+                const char* l_code = instr_buf.m_HostPtr;
+                unsigned long long l_base = instr_buf.m_DevAddr;
+                shared_future<bool> l_prev = m_LastRun;
+                m_LastRun = async(launch::async, [this, l_code, l_base, l_prev]() {
+                    if (l_prev.valid()) {
+                        l_prev.wait();
+                    }
+                    bool l_res = m_Kernel.run(l_code, [this, l_base](unsigned int p_page) {
+                        return resolve(l_base + (unsigned long long)p_page * PAGE_SIZE);
+                    });
+                    if (!l_res) {
+                        cerr << "ERROR: CPU backend failed to execute the instructions" << endl;
+                    }
+                    return l_res;
+                }).share();
+                if (slot >= m_SlotRun.size()) {
+                    m_SlotRun.resize(slot + 1);
+                }
+                m_SlotRun[slot] = m_LastRun;
+                if (sync_exec) {
+                    m_LastRun.wait();
+                }
+#ifdef GEMX_PERF_DBG
+                cout << "execKernel: " << t.elapsed() << endl;
+#endif
+            }
+
+            void waitSlot(unsigned int slot)
+            {
+                if (slot < m_SlotRun.size() && m_SlotRun[slot].valid()) {
+                    m_SlotRun[slot].wait();
+                }
+            }
+
+            void wait ()
+            {
+                if (m_LastRun.valid()) {
+                    m_LastRun.wait();
+                }
+            }
+
+        private:
+            char* resolve(unsigned long long p_addr)
+            {
+                lock_guard<mutex> l_lock(m_Mutex);
+                auto l_it = m_Regions.upper_bound(p_addr);
+                if (l_it == m_Regions.begin()) {
+                    return nullptr;
+                }
+                --l_it;
+                unsigned long long l_off = p_addr - l_it->first;
+                return (l_off < l_it->second.m_Sz) ? l_it->second.m_HostPtr + l_off : nullptr;
+            }
+    };
+
+    inline shared_ptr<XStream> XStream::create(const string &xclbin, const string & kernelName)
+    {
+#if GEMX_useXrt
+        const char* l_backend = getenv("GEMX_BACKEND");
+        if (l_backend != nullptr && string(l_backend) == "cpu") {
+            return shared_ptr<XStream>(new XCpuStream(xclbin, kernelName));
+        }
+        return shared_ptr<XStream>(new XFpgaStream(xclbin, kernelName));
+#else
+        return shared_ptr<XStream>(new XCpuStream(xclbin, kernelName));
+#endif
+    }
+
+    // Page aligned host memory carved from large chunks. Each chunk is created as
+    // one device buffer and every block keeps its sub buffer, so matrices from
+    // the pool need no buffer creation in SendToFPGA. Blocks are rounded up to a
+    // power of two number of pages and recycled through per size class free lists.
+    class XHostPool
+    {
+        public:
+            XHostPool(const shared_ptr<XStream> & p_stream, unsigned long long p_chunkSz = GEMX_hostPoolChunkSize)
+                : m_Stream(p_stream), m_ChunkSz(p_chunkSz), m_ChunkUsed(0), m_FreeLists(64)
+            {
+            }
+
+            ~XHostPool()
+            {
+                for (auto & l_chunk : m_Chunks) {
+                    free(l_chunk.m_HostPtr);
+                }
+            }
+
+            void* alloc(unsigned long long p_sz)
+            {
+                unsigned int l_class = sizeClass(p_sz);
+                vector<Block> & l_freeList = m_FreeLists[l_class];
+                Block l_block;
+                if (!l_freeList.empty()) {
+                    l_block = l_freeList.back();
+                    l_freeList.pop_back();
+                } else if (!carve(l_class, l_block)) {
+                    return nullptr;
+                }
+                m_Used[l_block.m_Buf.m_HostPtr] = l_block;
+                return l_block.m_Buf.m_HostPtr;
+            }
+
+            // The block may still be in use by the kernel, it is only recycled on the next recycle()
+            bool release(void * p_ptr)
+            {
+                auto l_it = m_Used.find((char*)p_ptr);
+                if (l_it == m_Used.end()) {
+                    return false;
+                }
+                m_Released.push_back(l_it->second);
+                m_Used.erase(l_it);
+                return true;
+            }
+
+            bool hasReleased() const
+            {
+                return !m_Released.empty();
+            }
+
+            void recycle()
+            {
+                for (auto & l_block : m_Released) {
+                    m_FreeLists[l_block.m_Class].push_back(l_block);
+                }
+                m_Released.clear();
+            }
+
+            // Device buffer of the pool block starting at p_ptr, if it holds p_sz bytes
+            bool find(const void * p_ptr, unsigned long long p_sz, XBuf & p_buf) const
+            {
+                auto l_it = m_Used.find((char*)p_ptr);
+                if (l_it == m_Used.end() || l_it->second.m_Buf.m_Sz < p_sz) {
+                    return false;
+                }
+                p_buf = l_it->second.m_Buf;
+                return true;
+            }
+
+        private:
+            static const unsigned int PAGE_SIZE = 4096;
+
+            struct Block {
+                XBuf m_Buf;
+                unsigned int m_Class;
+            };
+
+            static unsigned int sizeClass(unsigned long long p_sz)
+            {
+                unsigned long long l_pages = (p_sz + PAGE_SIZE - 1) / PAGE_SIZE;
+                unsigned int l_class = 0;
+                while ((1ULL << l_class) < l_pages) {
+                    ++l_class;
+                }
+                return l_class;
+            }
+
+            bool carve(unsigned int p_class, Block & p_block)
+            {
+                unsigned long long l_sz = (1ULL << p_class) * PAGE_SIZE;
+                if (m_Chunks.empty() || m_ChunkUsed + l_sz > m_Chunks.back().m_Sz) {
+                    if (!m_Chunks.empty()) {
+                        spill();
+                    }
+                    unsigned long long l_chunkSz = max(m_ChunkSz, l_sz);
+                    void * l_mem = nullptr;
+                    if (posix_memalign(&l_mem, PAGE_SIZE, l_chunkSz) != 0) {
+                        cerr << "ERROR: failed to allocate " << l_chunkSz << " bytes of host memory" << endl;
+                        return false;
+                    }
+                    m_Chunks.push_back(m_Stream->createBuf(l_mem, l_chunkSz));
+                    m_ChunkUsed = 0;
+                }
+                p_block.m_Class = p_class;
+                if (!m_Stream->createSubBuf(m_Chunks.back(), m_ChunkUsed, l_sz, p_block.m_Buf)) {
+                    cerr << "ERROR: failed to create pool buffer" << endl;
+                    return false;
+                }
+                m_ChunkUsed += l_sz;
+                return true;
+            }
+
+            // hands the unused tail of the current chunk to the free lists
+            void spill()
+            {
+                unsigned long long l_pages = (m_Chunks.back().m_Sz - m_ChunkUsed) / PAGE_SIZE;
+                while (l_pages > 0) {
+                    unsigned int l_class = 63 - __builtin_clzll(l_pages);
+                    Block l_block;
+                    l_block.m_Class = l_class;
+                    if (!m_Stream->createSubBuf(m_Chunks.back(), m_ChunkUsed, (1ULL << l_class) * PAGE_SIZE, l_block.m_Buf)) {
+                        break;
+                    }
+                    m_FreeLists[l_class].push_back(l_block);
+                    m_ChunkUsed += (1ULL << l_class) * PAGE_SIZE;
+                    l_pages -= (1ULL << l_class);
+                }
+            }
+
+            shared_ptr<XStream> m_Stream;
+            unsigned long long m_ChunkSz;
+            unsigned long long m_ChunkUsed;
+            vector<XBuf> m_Chunks;
+            vector<vector<Block> > m_FreeLists;
+            unordered_map<char*, Block> m_Used;
+            vector<Block> m_Released;
+    };
+
+    // Device copies of constant matrices such as weights, keyed by content. Sends of
+    // identical bytes share one pool block that was transferred once, so reloading a
+    // model or loading models with common layers skips the PCIe copy. Copies nobody
+    // references stay resident and are evicted least recently used first once the
+    // cached bytes exceed the budget. The kernel must only read cached matrices.
+    class XMatCache
+    {
+        public:
+            XMatCache(XHostPool & p_pool, unsigned long long p_budget = GEMX_hostMatCacheSize)
+                : m_Pool(p_pool), m_Budget(p_budget), m_Bytes(0), m_Hits(0), m_Misses(0)
+            {
+            }
+
+            // Returns the copy of the p_sz bytes at p_ptr with one more reference.
+            // p_miss is set if the copy is new and still has to be sent to the device.
+            // nullptr if the budget is taken by referenced copies.
+            char* acquire(const void * p_ptr, unsigned long long p_sz, bool & p_miss)
+            {
+                unsigned long long l_hash = hash((const char*)p_ptr, p_sz);
+                auto l_range = m_ByHash.equal_range(l_hash);
+                for (auto l_it = l_range.first; l_it != l_range.second; ++l_it) {
+                    Entry & l_entry = m_Entries[l_it->second];
+                    if (l_entry.m_Sz == p_sz && memcmp(l_it->second, p_ptr, p_sz) == 0) {
+                        if (l_entry.m_Refs++ == 0) {
+                            m_Lru.erase(l_entry.m_Lru);
+                        }
+                        ++m_Hits;
+                        p_miss = false;
+                        return l_it->second;
+                    }
+                }
+                ++m_Misses;
+                evict(p_sz);
+                if (m_Bytes + p_sz > m_Budget) {
+                    return nullptr;
+                }
+                char * l_ptr = (char*)m_Pool.alloc(p_sz);
+                if (l_ptr == nullptr) {
+                    return nullptr;
+                }
+                memcpy(l_ptr, p_ptr, p_sz);
+                Entry & l_entry = m_Entries[l_ptr];
+                l_entry.m_Sz = p_sz;
+                l_entry.m_Hash = l_hash;
+                l_entry.m_Refs = 1;
+                m_ByHash.insert(make_pair(l_hash, l_ptr));
+                m_Bytes += p_sz;
+                p_miss = true;
+                return l_ptr;
+            }
+
+            bool release(char * p_ptr)
+            {
+                auto l_it = m_Entries.find(p_ptr);
+                if (l_it == m_Entries.end() || l_it->second.m_Refs == 0) {
+                    return false;
+                }
+                if (--l_it->second.m_Refs == 0) {
+                    m_Lru.push_front(p_ptr);
+                    l_it->second.m_Lru = m_Lru.begin();
+                    evict(0);
+                }
+                return true;
+            }
+
+            void setBudget(unsigned long long p_budget)
+            {
+                m_Budget = p_budget;
+                evict(0);
+            }
+
+            unsigned long long hits() const { return m_Hits; }
+            unsigned long long misses() const { return m_Misses; }
+            unsigned long long bytes() const { return m_Bytes; }
+
+        private:
+            struct Entry {
+                unsigned long long m_Sz;
+                unsigned long long m_Hash;
+                unsigned int m_Refs;
+                list<char*>::iterator m_Lru;    // valid while m_Refs is 0
+            };
+
+            // four independent multiply-xorshift lanes over 8 byte words
+            static unsigned long long hash(const char * p_ptr, unsigned long long p_sz)
+            {
+                const unsigned long long l_mul = 0x9E3779B97F4A7C15ULL;
+                unsigned long long l_h[4] = {p_sz, l_mul, ~p_sz, l_mul >> 1};
+                unsigned long long l_words = p_sz / 8;
+                unsigned long long i = 0;
+                for (; i + 4 <= l_words; i += 4) {
+                    for (unsigned int l = 0; l < 4; ++l) {
+                        unsigned long long l_w;
+                        memcpy(&l_w, p_ptr + (i + l) * 8, 8);
+                        l_h[l] = (l_h[l] ^ l_w) * l_mul;
+                        l_h[l] ^= l_h[l] >> 29;
+                    }
+                }
+                unsigned long long l_tail = 0;
+                for (unsigned long long l_off = i * 8; l_off < p_sz; l_off += 8) {
+                    unsigned long long l_w = 0;
+                    memcpy(&l_w, p_ptr + l_off, min(8ULL, p_sz - l_off));
+                    l_tail = (l_tail ^ l_w) * l_mul;
+                }
+                unsigned long long l_res = l_tail;
+                for (unsigned int l = 0; l < 4; ++l) {
+                    l_res = (l_res ^ l_h[l]) * l_mul;
+                    l_res ^= l_res >> 32;
+                }
+                return l_res;
+            }
+
+            // drops unreferenced copies until p_sz more bytes fit in the budget
+            void evict(unsigned long long p_sz)
+            {
+                while (m_Bytes + p_sz > m_Budget && !m_Lru.empty()) {
+                    char * l_ptr = m_Lru.back();
+                    m_Lru.pop_back();
+                    Entry & l_entry = m_Entries[l_ptr];
+                    auto l_range = m_ByHash.equal_range(l_entry.m_Hash);
+                    for (auto l_it = l_range.first; l_it != l_range.second; ++l_it) {
+                        if (l_it->second == l_ptr) {
+                            m_ByHash.erase(l_it);
+                            break;
+                        }
+                    }
+                    m_Bytes -= l_entry.m_Sz;
+                    m_Entries.erase(l_ptr);
+                    m_Pool.release(l_ptr);
+                }
+            }
+
+            XHostPool & m_Pool;
+            unsigned long long m_Budget;
+            unsigned long long m_Bytes;
+            unsigned long long m_Hits, m_Misses;
+            unordered_map<char*, Entry> m_Entries;
+            unordered_multimap<unsigned long long, char*> m_ByHash;
+            list<char*> m_Lru;                  // unreferenced copies, most recent first
+    };
 
     template<typename HType>
         class XHost
@@ -177,57 +747,61 @@ namespace gemx
                 XHost() = delete;
 
                 XHost ( const string & xclbin, const string & kernelName)
+                    : _fpga_stream(XStream::create(xclbin, kernelName)), _pool(_fpga_stream), _cache(_pool)
                 {
-                    _fpga_stream = shared_ptr<XStream>(new XStream(xclbin, kernelName));
+                    _numInstr = min(_fpga_stream->getNumInstr(), INSTR_BUF_SIZE / KERN_INSTR_SIZE);
+                    _instrBuf.assign(INSTR_BUF_SIZE, 0);
+                    _instr_offset = 0;
+                    _chunkInstrs = 0;
+                    _capturing = false;
+
                     void *aligned_mem = nullptr;
                     int mem_alloc_status;
-                    mem_alloc_status=posix_memalign(&aligned_mem, PAGE_SIZE, INSTR_BUF_SIZE);
+                    mem_alloc_status=posix_memalign(&aligned_mem, PAGE_SIZE, RING_BUF_SIZE);
                     cout<<"The posix mem alloc returned value::"<<mem_alloc_status<<"\n";
                     assert(!mem_alloc_status);
-                    _instrBuf = (char*) aligned_mem;
-                    _progBuf = (char*)aligned_mem;
-                    cout<<"@step ... 1\n";
-                    memset(_instrBuf, 0, INSTR_BUF_SIZE);
+                    _ringBuf = (char*) aligned_mem;
+                    memset(_ringBuf, 0, RING_BUF_SIZE);
+                    _progBuf = nullptr;
 
-                    cout<<"@step ... 2\n";
-                    _instr_offset = 0;
                     cout<<"Stating copying instruction to FPGA.......\n";
-                    this->_cl_instr_buf = this->_fpga_stream->copyToFpga(_instrBuf, INSTR_BUF_SIZE+KERN_DBG_BUF_SIZE,
-                            true);
-
+                    this->_cl_ring_buf = this->_fpga_stream->copyToFpga(_ringBuf, RING_BUF_SIZE, true);
+                    if (!InitSlots(this->_cl_ring_buf)) {
+                        cerr << "ERROR: failed to create instr sub buffers" << endl;
+                    }
                     cout<<"Done copying instruction to FPGA\n";
-                    xclGetMemObjDeviceAddress(this->_cl_instr_buf.get(),
-                            XHost<HType>::_fpga_stream->m_Device.get(),
-                            sizeof(unsigned long long), &this->_ddrDeviceBaseAddr);
                 }
 
                 bool AllocProgBuf(unsigned int buf_sz){
                     bool l_res = true;
+                    _fpga_stream->wait();
                     if (_progBuf != nullptr) {
                         free(_progBuf);
                     }
                     _progBuf =(char*)aligned_alloc(PAGE_SIZE, buf_sz);
                     assert(_progBuf != nullptr);
-                    memset(_progBuf, 0, INSTR_BUF_SIZE);
-                    _instr_offset = 0;
+                    assert(buf_sz >= RING_BUF_SIZE);
+                    memset(_progBuf, 0, RING_BUF_SIZE);
+                    ClearInstrBuf();
+                    vector<HType> l_devBufs;
+                    for (auto & l_mat : _matIds) {
+                        if (_mats[l_mat.second].m_DevBuf) {
+                            l_devBufs.push_back(l_mat.first);
+                        }
+                    }
+                    for (auto & l_handle : l_devBufs) {
+                        RemoveMat(l_handle);
+                    }
 
+                    // the instruction slots move to the first pages of the program buffer
                     _cl_prog_buf = this->_fpga_stream->createBuf(_progBuf, buf_sz);
-                    _allocated_pages = 2;
                     _total_prog_pages = buf_sz / PAGE_SIZE;
-
-                    cl_buffer_region l_region;
-                    l_region.origin=0;
-                    l_region.size = PAGE_SIZE;
-
-                    cl_int l_err;
-                    _cl_instr_buf = _cl_prog_buf.createSubBuffer(CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &l_region, &l_err);
-                    if (l_err != CL_SUCCESS) {
-                        cerr << "ERROR: failed to create instr sub buffer" << endl;
-                        l_res = false;
+                    _freePages.clear();
+                    if (_total_prog_pages > RING_BUF_SIZE / PAGE_SIZE) {
+                        _freePages[RING_BUF_SIZE / PAGE_SIZE] = _total_prog_pages - RING_BUF_SIZE / PAGE_SIZE;
                     }
-                    l_region.origin = PAGE_SIZE;
-                    _cl_stats_buf = _cl_prog_buf.createSubBuffer(CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &l_region, &l_err);
-                    if (l_err != CL_SUCCESS) {
+
+                    if (!InitSlots(_cl_prog_buf)) {
                         cerr << "ERROR: failed to create instr sub buffer" << endl;
                         l_res = false;
                     }
@@ -236,53 +810,55 @@ namespace gemx
 
                 virtual ~XHost()
                 {
+                    _fpga_stream->wait();
+                    free(_ringBuf);
                     if (_progBuf != nullptr) {
                         free(_progBuf);
                     }
                 }
 
-                const cl::Program* loadxclbin (const string & xclbin)
-                {
-
-                    vector<cl::Device> l_devices;
-                    l_devices.push_back(_fpga_stream->m_Device);
-                    cl::Program::Binaries l_bins = xcl::import_binary_file(xclbin);
-                    cl_int l_err;
-                    static cl::Program l_program(_fpga_stream->m_Context, l_devices, l_bins, NULL, &l_err);
-                    if (l_err != CL_SUCCESS) {
-                        exit(EXIT_FAILURE);
-                    }
-                    return &l_program;
-                }
-
                 virtual void Execute( bool sync_exec = true) = 0;
 
                 bool AddMat(const HType & handle, void * mat_ptr, unsigned long long buf_sz) {
-                    auto &h = _hostMat;   //auto: type inferred by the compiler
-                    auto &hz = _hostMatSz;
-                    if (h.find(handle) == h.end()) {
-                        h[handle] = mat_ptr;
-                        hz[handle] = buf_sz;
+                    int l_id = GetMatId(handle);
+                    if (l_id < 0) {
+                        MatEntry & l_mat = _mats[NewMat(handle)];
+                        l_mat.m_HostPtr = mat_ptr;
+                        l_mat.m_Sz = buf_sz;
                         return true;
                     }
-                    else if (hz[handle] != buf_sz ){
-                        h[handle] = mat_ptr;
-                        hz[handle] = buf_sz;
-                        this->_devHandle.erase(handle);
+                    MatEntry & l_mat = _mats[l_id];
+                    if (l_mat.m_Sz != buf_sz || l_mat.m_Cached) {
+                        UnbindCachedMat(l_mat);
+                        l_mat.m_HostPtr = mat_ptr;
+                        l_mat.m_Sz = buf_sz;
+                        DropBuf(l_mat);
                         return true;
                     }
                     return false;
                 }
 
+                // Registers a matrix like AddMat and returns its ID for the *ById ops
+                unsigned int RegisterMat(const HType & handle, void * mat_ptr, unsigned long long buf_sz) {
+                    AddMat(handle, mat_ptr, buf_sz);
+                    return _matIds[handle];
+                }
+
+                // Dense ID of a matrix from AddMat or AddDevBuf, -1 if unknown
+                int GetMatId(const HType & handle) const {
+                    auto l_it = _matIds.find(handle);
+                    return (l_it == _matIds.end()) ? -1 : (int)l_it->second;
+                }
+
                 void * GetMat(const HType & handle,
                         bool queryFPGA = false, bool sync_get = true)
                 {
-                    auto& h = _hostMat;
+                    int l_id = GetMatId(handle);
                     void * ret_ptr = nullptr;
-                    if (h.find(handle) != h.end()) {
+                    if (l_id >= 0 && !_mats[l_id].m_DevBuf) {
                         if (queryFPGA)
                             GetFromFPGA(handle, sync_get);
-                        ret_ptr = h[handle];
+                        ret_ptr = _mats[l_id].m_HostPtr;
                     }
                     return ret_ptr;
                 }
@@ -292,23 +868,26 @@ namespace gemx
                     _fpga_stream->wait();
                 }
 
+                // With cached set the matrix is treated as constant and bound to the device
+                // copy of identical bytes sent before, see XMatCache
                 void SendToFPGA(const HType & handle, void * mat_ptr, unsigned long long buf_sz,
-                        bool sync_send = false) {
+                        bool sync_send = false, bool cached = false) {
+                    if (cached && BindCachedMat(handle, mat_ptr, buf_sz, sync_send)) {
+                        return;
+                    }
                     AddMat(handle, mat_ptr, buf_sz);
                     SendToFPGA(handle, sync_send);
                 }
 
                 void SendToFPGA(const HType & handle, bool sync_send = false) {
                     XTimer t;
-                    auto &h = _hostMat;
-                    auto &d = _devHandle;
-                    assert(h.find(handle) != h.end());
-
-                    if (d.find(handle) != d.end()) {
-                        _fpga_stream->copyToFpga(d[handle], sync_send);
-                    } else {
-                        d[handle] = _fpga_stream->copyToFpga(h[handle], _hostMatSz[handle], sync_send);
+                    int l_id = GetMatId(handle);
+                    assert(l_id >= 0);
+                    MatEntry & l_mat = _mats[l_id];
+                    if (!l_mat.m_HasBuf) {
+                        CreateMatBuf(l_mat);
                     }
+                    _fpga_stream->copyToFpga(l_mat.m_Buf, sync_send);
                     #ifdef GEMX_PERF_DBG
                     cout << "SendToFPGA: " << t.elapsed() << endl;
                     #endif
@@ -316,111 +895,770 @@ namespace gemx
 
                 void GetFromFPGA(const HType & handle, bool sync_get) {
                     XTimer t;
-                    auto &d = _devHandle;
-                    assert(d.find(handle) != d.end());
-                    _fpga_stream->copyFromFpga(d[handle], sync_get);
+                    int l_id = GetMatId(handle);
+                    assert(l_id >= 0 && _mats[l_id].m_HasBuf);
+                    _fpga_stream->copyFromFpga(_mats[l_id].m_Buf, sync_get, _mats[l_id].m_Slot);
                     #ifdef GEMX_PERF_DBG
                     cout << "GetFromFPGA: " << t.elapsed() << endl;
                     #endif
                 }
 
                 void* AddDevBuf(const HType & handle, unsigned long long buf_sz) {
-                    auto &h = _hostMatPageOffset;   //auto: type inferred by the compiler
-                    auto &hz = _hostMatSz;
-                    auto &d = _devHandle;
-
                     unsigned int l_pages = (buf_sz + PAGE_SIZE-1) / PAGE_SIZE;
-                    assert((_allocated_pages + l_pages)<=_total_prog_pages);
-
-
-                    if (h.find(handle) == h.end()) {
-                        h[handle] = _allocated_pages;
-                        hz[handle] = l_pages * PAGE_SIZE;
-                        cl_buffer_region l_region;
-                        l_region.origin= _allocated_pages * PAGE_SIZE;
-                        l_region.size = l_pages * PAGE_SIZE;
+                    int l_id = GetMatId(handle);
 
-                        cl_int l_err;
-                        d[handle] = _cl_prog_buf.createSubBuffer(CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &l_region, &l_err);
-                        if (l_err != CL_SUCCESS) {
+                    if (l_id < 0) {
+                        // best fit over the free page ranges
+                        auto l_fit = _freePages.end();
+                        for (auto l_it = _freePages.begin(); l_it != _freePages.end(); ++l_it) {
+                            if (l_it->second >= l_pages && (l_fit == _freePages.end() || l_it->second < l_fit->second)) {
+                                l_fit = l_it;
+                            }
+                        }
+                        if (l_fit == _freePages.end()) {
+                            cerr << "ERROR: no " << l_pages << " free pages in program buffer, FreeDevBuf or CompactDevBuf first" << endl;
+                            return nullptr;
+                        }
+                        unsigned int l_start = l_fit->first;
+                        if (l_fit->second > l_pages) {
+                            _freePages[l_start + l_pages] = l_fit->second - l_pages;
+                        }
+                        _freePages.erase(l_fit);
+                        l_id = NewMat(handle);
+                        MatEntry & l_mat = _mats[l_id];
+                        l_mat.m_DevBuf = true;
+                        l_mat.m_PageOffset = l_start;
+                        l_mat.m_Sz = l_pages * PAGE_SIZE;
+                        l_mat.m_HostPtr = &_progBuf[l_start * PAGE_SIZE];
+                        l_mat.m_HasBuf = true;
+                        if (!_fpga_stream->createSubBuf(_cl_prog_buf, l_start * PAGE_SIZE, l_pages * PAGE_SIZE, l_mat.m_Buf)) {
                             cerr << "ERROR: failed to create device buffer" << endl;
                         }
-                        _allocated_pages += l_pages;
                     }
-                    else if (hz[handle] < buf_sz ){
+                    else if (!_mats[l_id].m_DevBuf) {
+                        cerr << "ERROR: handle already used by a host matrix" << endl;
+                        return nullptr;
+                    }
+                    else if (_mats[l_id].m_Sz < buf_sz ){
                         cerr << "ERROR: smaller bufer already allocated" << endl;
                     }
-                    return &_progBuf[h[handle]*PAGE_SIZE];
+                    return &_progBuf[_mats[l_id].m_PageOffset*PAGE_SIZE];
                 }
 
 
+                // Returns the pages of a buffer from AddDevBuf to the program buffer
+                bool FreeDevBuf(const HType & handle) {
+                    int l_id = GetMatId(handle);
+                    if (l_id < 0 || !_mats[l_id].m_DevBuf) {
+                        cerr << "ERROR: device buffer not found" << endl;
+                        return false;
+                    }
+                    MatEntry & l_mat = _mats[l_id];
+                    if (l_mat.m_Slot != XStream::LAST_SLOT) {
+                        _fpga_stream->waitSlot(l_mat.m_Slot);
+                    }
+                    unsigned int l_start = l_mat.m_PageOffset;
+                    unsigned int l_pages = l_mat.m_Sz / PAGE_SIZE;
+                    RemoveMat(handle);
+
+                    // coalesce with the neighbouring free ranges
+                    auto l_next = _freePages.lower_bound(l_start);
+                    if (l_next != _freePages.end() && l_next->first == l_start + l_pages) {
+                        l_pages += l_next->second;
+                        l_next = _freePages.erase(l_next);
+                    }
+                    if (l_next != _freePages.begin()) {
+                        auto l_prev = prev(l_next);
+                        if (l_prev->first + l_prev->second == l_start) {
+                            l_prev->second += l_pages;
+                            return true;
+                        }
+                    }
+                    _freePages[l_start] = l_pages;
+                    return true;
+                }
+
+                // Moves all live buffers from AddDevBuf to the front of the program buffer,
+                // leaving one free range at the end. Offsets already encoded in the staged
+                // program are rewritten; pointers from AddDevBuf/GetDevBuf must be queried
+                // again with GetDevBuf.
+                bool CompactDevBuf() {
+                    XTimer t;
+                    if (_freePages.size() <= 1 && (_freePages.empty() || _freePages.begin()->first + _freePages.begin()->second == _total_prog_pages)) {
+                        return true;
+                    }
+                    _fpga_stream->wait();
+                    map<unsigned int, unsigned int> l_live;
+                    for (auto & l_id : _matIds) {
+                        if (_mats[l_id.second].m_DevBuf) {
+                            l_live[_mats[l_id.second].m_PageOffset] = l_id.second;
+                        }
+                    }
+                    map<unsigned int, pair<unsigned int, unsigned int> > l_moves;
+                    unsigned int l_next = RING_BUF_SIZE / PAGE_SIZE;
+                    bool l_res = true;
+                    for (auto & l_buf : l_live) {
+                        MatEntry & l_mat = _mats[l_buf.second];
+                        unsigned int l_pages = l_mat.m_Sz / PAGE_SIZE;
+                        if (l_buf.first != l_next) {
+                            // the device copy may be newer than the host one
+                            _fpga_stream->copyFromFpga(l_mat.m_Buf, true);
+                            memmove(&_progBuf[l_next * PAGE_SIZE], &_progBuf[l_buf.first * PAGE_SIZE], l_pages * PAGE_SIZE);
+                            l_res = _fpga_stream->createSubBuf(_cl_prog_buf, l_next * PAGE_SIZE, l_pages * PAGE_SIZE, l_mat.m_Buf) && l_res;
+                            _fpga_stream->copyToFpga(l_mat.m_Buf, false);
+                            l_moves[l_buf.first] = make_pair(l_pages, l_next);
+                            l_mat.m_PageOffset = l_next;
+                            l_mat.m_HostPtr = &_progBuf[l_next * PAGE_SIZE];
+                        }
+                        l_next += l_pages;
+                    }
+                    _fpga_stream->wait();
+                    _freePages.clear();
+                    if (l_next < _total_prog_pages) {
+                        _freePages[l_next] = _total_prog_pages - l_next;
+                    }
+
+                    for (auto & l_reloc : _relocs) {
+                        unsigned int * l_offsets = reinterpret_cast<unsigned int*>(&_instrBuf[l_reloc.first + sizeof(int)]);
+                        for (unsigned int i = 0; i < l_reloc.second; ++i) {
+                            auto l_move = l_moves.upper_bound(l_offsets[i]);
+                            if (l_offsets[i] == 0 || l_move == l_moves.begin()) {
+                                continue;
+                            }
+                            --l_move;
+                            if (l_offsets[i] < l_move->first + l_move->second.first) {
+                                l_offsets[i] = l_offsets[i] - l_move->first + l_move->second.second;
+                            }
+                        }
+                    }
+                    if (!l_res) {
+                        cerr << "ERROR: failed to relocate device buffers" << endl;
+                    }
+                    #ifdef GEMX_PERF_DBG
+                    cout << "CompactDevBuf: " << l_moves.size() << " buffers moved " << t.elapsed() << endl;
+                    #endif
+                    return l_res;
+                }
+
                 void* GetDevBuf(const HType & handle, bool queryFPGA = false, bool sync_get = true)
                 {
-                    auto& h = _hostMatPageOffset;
-                    auto &hz = _hostMatSz;
+                    int l_id = GetMatId(handle);
                     void* ret_ptr = nullptr;
-                    if (h.find(handle) != h.end()) {
+                    if (l_id >= 0 && _mats[l_id].m_DevBuf) {
                         if (queryFPGA)
                             GetFromFPGA(handle, sync_get);
-                        ret_ptr = &_progBuf[h[handle]*PAGE_SIZE];
+                        ret_ptr = &_progBuf[_mats[l_id].m_PageOffset*PAGE_SIZE];
                     }
                     return ret_ptr;
                 }
 
+                // Page offset of a buffer from AddDevBuf, relative to instruction slot 0
                 unsigned int GetMatOffset(const HType &handle) {
-                    auto& h = _hostMatPageOffset;
-                    assert(h.find(handle) != h.end());
-                    return h[handle];
+                    int l_id = GetMatId(handle);
+                    assert(l_id >= 0 && _mats[l_id].m_DevBuf);
+                    return GetIdPageOffset(l_id);
+                }
+
+                // Page offset of a buffer sent with SendToFPGA, relative to instruction slot 0
+                unsigned long long GetDevPageOffset(const HType &handle) {
+                    int l_id = GetMatId(handle);
+                    return (l_id < 0) ? 0 : GetIdPageOffset(l_id);
+                }
+
+                // Page offset of a matrix ID, relative to instruction slot 0. It is computed
+                // once per device buffer; 0 if the matrix was never sent.
+                unsigned long long GetIdPageOffset(unsigned int id) {
+                    MatEntry & l_mat = _mats[id];
+                    if (!l_mat.m_HasBuf) {
+                        return 0;
+                    }
+                    if (!l_mat.m_InProg) {
+                        l_mat.m_InProg = true;
+                        _progIds.push_back(id);
+                    }
+                    if (l_mat.m_PageOffset == 0) {
+                        l_mat.m_PageOffset = GetDevPageOffset(l_mat.m_Buf);
+                    }
+                    return l_mat.m_PageOffset;
+                }
+
+                // Looks up the IDs of matrices from AddMat (or AddDevBuf if dev is set)
+                bool FindMats(initializer_list<HType> handles, bool dev, unsigned int * ids) const {
+                    for (auto & l_handle : handles) {
+                        auto l_it = _matIds.find(l_handle);
+                        if (l_it == _matIds.end() || _mats[l_it->second].m_DevBuf != dev) {
+                            return false;
+                        }
+                        *ids++ = l_it->second;
+                    }
+                    return true;
+                }
+
+                unsigned long long GetDevPageOffset(const XBuf &buf) {
+                    unsigned long long l_off = _fpga_stream->getDevAddr(buf);
+                    assert(l_off >= _ddrDeviceBaseAddr + RING_BUF_SIZE);
+                    l_off -= _ddrDeviceBaseAddr;
+                    assert(l_off % PAGE_SIZE == 0);
+                    return l_off / PAGE_SIZE;
+                }
+
+                // Device view of bytes [offset, offset + sz) of a matrix added with AddMat.
+                // The buffer of the whole matrix is created on first use without
+                // transferring it, so only the regions actually sent move over PCIe.
+                bool GetMatRegion(const HType & handle, unsigned long long offset, unsigned long long sz, XBuf & region) {
+                    int l_id = GetMatId(handle);
+                    if (l_id < 0 || _mats[l_id].m_DevBuf || offset + sz > _mats[l_id].m_Sz) {
+                        cerr << "ERROR: matrix region not found" << endl;
+                        return false;
+                    }
+                    MatEntry & l_mat = _mats[l_id];
+                    if (!l_mat.m_HasBuf) {
+                        CreateMatBuf(l_mat);
+                    }
+                    return _fpga_stream->createSubBuf(l_mat.m_Buf, offset, sz, region);
+                }
+
+                void SendRegion(const XBuf & region, bool sync_send = false) {
+                    _fpga_stream->copyToFpga(region, sync_send);
+                }
+
+                // Reads back a region written by the program launched from slot
+                void GetRegion(const XBuf & region, bool sync_get, unsigned int slot) {
+                    _fpga_stream->copyFromFpga(region, sync_get, slot);
+                }
+
+                // Instruction slot used by the most recent Execute
+                unsigned int GetLastSlot() {
+                    return (_nextSlot + GEMX_hostInstrSlots - 1) % GEMX_hostInstrSlots;
+                }
+
+                // Page aligned memory from the pinned pool; SendToFPGA of it reuses the
+                // pool's device buffers
+                void* AllocHostMat(unsigned long long buf_sz) {
+                    return _pool.alloc(buf_sz);
+                }
+
+                // The memory is reused after the next ClearBuf
+                bool FreeHostMat(void * mat_ptr) {
+                    if (!_pool.release(mat_ptr)) {
+                        cerr << "ERROR: " << mat_ptr << " was not allocated by AllocHostMat" << endl;
+                        return false;
+                    }
+                    return true;
+                }
+
+                // Packs the strided, optionally transposed matrix at src into the zero padded
+                // dst_rows x dst_ld matrix dst in one pass and sends dst, which is the handle.
+                // dst null takes the memory from the pinned pool. Returns dst, or null if
+                // the pool is out of memory.
+                template<typename T>
+                T* SendStridedMat(const T * src, unsigned int rows, unsigned int cols, unsigned int ld, bool trans,
+                        T * dst, unsigned int dst_rows, unsigned int dst_ld, bool sync_send = false, bool cached = false) {
+                    unsigned long long l_sz = sizeof(T) * (unsigned long long)dst_rows * dst_ld;
+                    if (dst == nullptr) {
+                        dst = (T*) AllocHostMat(l_sz);
+                        if (dst == nullptr) {
+                            cerr << "ERROR: failed to allocate " << l_sz << " bytes of host memory for a "
+                                << dst_rows << " x " << dst_ld << " matrix" << endl;
+                            return nullptr;
+                        }
+                    }
+                    CopyStrided(src, rows, cols, ld, trans, dst, dst_rows, dst_ld, dst_ld);
+                    SendToFPGA(dst, dst, l_sz, sync_send, cached);
+                    return dst;
+                }
+
+                // Reads back the matrix of handle and copies its top left rows x cols
+                // corner, or the transpose of it, to dst with leading dimension dst_ld
+                template<typename T>
+                bool GetStridedMat(const HType & handle, unsigned int rows, unsigned int cols, unsigned int ld, bool trans,
+                        T * dst, unsigned int dst_ld) {
+                    const T * l_src = (const T*) GetMat(handle, true, true);
+                    if (l_src == nullptr) {
+                        cerr << "ERROR: matrix " << handle << " was not sent to the FPGA" << endl;
+                        return false;
+                    }
+                    unsigned int l_rows = trans ? cols : rows;
+                    unsigned int l_cols = trans ? rows : cols;
+                    CopyStrided(l_src, rows, cols, ld, trans, dst, l_rows, l_cols, dst_ld);
+                    return true;
+                }
+
+                void RemoveMat(const HType & handle) {
+                    auto l_it = _matIds.find(handle);
+                    if (l_it == _matIds.end()) {
+                        return;
+                    }
+                    unsigned int l_id = l_it->second;
+                    bool l_inProg = _mats[l_id].m_InProg;
+                    UnbindCachedMat(_mats[l_id]);
+                    _matIds.erase(l_it);
+                    _mats[l_id] = MatEntry();
+                    _freeIds.push_back(l_id);
+                    if (l_inProg) {
+                        _progIds.erase(remove(_progIds.begin(), _progIds.end(), l_id), _progIds.end());
+                    }
                 }
 
                 void SendDevBuf(const HType & handle, bool sync_send = false) {
                     XTimer t;
-                    auto &h = _hostMatPageOffset;
-                    auto &d = _devHandle;
-                    assert(h.find(handle) != h.end());
-                    assert(d.find(handle) != d.end());
-                    _fpga_stream->copyToFpga(d[handle], sync_send);
+                    int l_id = GetMatId(handle);
+                    assert(l_id >= 0 && _mats[l_id].m_DevBuf);
+                    _fpga_stream->copyToFpga(_mats[l_id].m_Buf, sync_send);
                     #ifdef GEMX_PERF_DBG
                     cout << "SendToFPGA: " << t.elapsed() << endl;
                     #endif
                 }
 
+                // Programs longer than one kernel run are staged as a sequence of
+                // instruction pages, each holding at most GEMX_numInstr ops
                 void AddInstr  ( kArgs * args )
                 {
                     char * instr = args->asByteArray();
-                    char * curr_pos = &_progBuf[_instr_offset];
+                    assert(args->sizeInBytes() <= INSTR_BUF_SIZE);
+                    if (_chunkInstrs == _numInstr || _instr_offset + args->sizeInBytes() > _instrBuf.size()) {
+                        _instr_offset = _instrBuf.size();
+                        _instrBuf.resize(_instr_offset + INSTR_BUF_SIZE, 0);
+                        _chunkInstrs = 0;
+                    }
+                    char * curr_pos = &_instrBuf[_instr_offset];
                     memcpy(curr_pos, instr, args->sizeInBytes());
+                    if (args->numPageOffsets() > 0) {
+                        _relocs.push_back(make_pair(_instr_offset, args->numPageOffsets()));
+                    }
                     _instr_offset += args->sizeInBytes();
+                    ++_chunkInstrs;
                 }
 
                 void ClearInstrBuf()
                 {
-                    memset(this->_progBuf, 0, PAGE_SIZE);
+                    this->_instrBuf.assign(INSTR_BUF_SIZE, 0);
                     this->_instr_offset = 0;
+                    this->_chunkInstrs = 0;
+                    this->_relocs.clear();
+                    for (auto l_id : this->_progIds) {
+                        this->_mats[l_id].m_InProg = false;
+                    }
+                    this->_progIds.clear();
                 }
                 
+                // Sends a mapped sparse image; the mapping is the host copy and its
+                // data pointer is the handle until FreeImage
+                void * SendImage(unique_ptr<SpImage> p_image, bool sync_send = false) {
+                    void * l_ptr = p_image->data();
+                    SendToFPGA(l_ptr, l_ptr, p_image->sizeBytes(), sync_send);
+                    _images[l_ptr] = std::move(p_image);
+                    return l_ptr;
+                }
+
+                bool FreeImage(void * p_ptr) {
+                    auto l_it = _images.find(p_ptr);
+                    if (l_it == _images.end()) {
+                        cerr << "ERROR: " << p_ptr << " was not returned by a sparse image load" << endl;
+                        return false;
+                    }
+                    _fpga_stream->wait();
+                    RemoveMat(p_ptr);
+                    _images.erase(l_it);
+                    return true;
+                }
+
+                // Limits the bytes of unreferenced cached matrices kept on the device
+                void SetMatCacheSize(unsigned long long buf_sz) {
+                    _cache.setBudget(buf_sz);
+                }
+
+                const XMatCache & GetMatCache() const {
+                    return _cache;
+                }
+
+                // Drops the device buffers of all matrices from AddMat, cached matrices stay
                 void ClearBuf()
                 {
-                    this->_devHandle.clear();
+                    for (auto & l_mat : _mats) {
+                        if (!l_mat.m_DevBuf && !l_mat.m_Cached) {
+                            DropBuf(l_mat);
+                        }
+                        l_mat.m_Slot = XStream::LAST_SLOT;
+                    }
+                    if (_pool.hasReleased()) {
+                        _fpga_stream->wait();
+                        _pool.recycle();
+                    }
+                }
+
+                // Ops added until EndCapture are recorded instead of executed
+                void BeginCapture()
+                {
+                    ClearInstrBuf();
+                    _capturing = true;
+                }
+
+                // Freezes the recorded ops into a graph whose instruction pages are
+                // uploaded once to reserved slots. Returns the graph ID, -1 on failure.
+                int EndCapture()
+                {
+                    if (!_capturing) {
+                        cerr << "ERROR: EndCapture without BeginCapture" << endl;
+                        return -1;
+                    }
+                    _capturing = false;
+                    unsigned int l_numPages = _instrBuf.size() / INSTR_BUF_SIZE;
+                    Graph l_graph;
+                    for (unsigned int i = 0; i < GEMX_hostGraphSlots && l_graph.m_Slots.size() < l_numPages; ++i) {
+                        if (!_graphSlotUsed[i]) {
+                            l_graph.m_Slots.push_back(GEMX_hostInstrSlots + i);
+                        }
+                    }
+                    if (l_graph.m_Slots.size() < l_numPages) {
+                        cerr << "ERROR: captured program needs " << l_numPages << " instruction pages, "
+                            << l_graph.m_Slots.size() << " graph slots are free" << endl;
+                        ClearInstrBuf();
+                        return -1;
+                    }
+
+                    // offset words that point at a matrix of the program are patched by Replay,
+                    // the others (e.g. regions from AddGEMMOpAt) are replayed as captured
+                    unordered_map<unsigned long long, unsigned int> l_byOffset;
+                    for (auto l_id : _progIds) {
+                        l_byOffset[_mats[l_id].m_PageOffset] = l_id;
+                    }
+                    unordered_map<unsigned int, unsigned int> l_idIdx;
+                    for (auto & l_reloc : _relocs) {
+                        const unsigned int * l_offsets = reinterpret_cast<const unsigned int*>(&_instrBuf[l_reloc.first + sizeof(int)]);
+                        for (unsigned int i = 0; i < l_reloc.second; ++i) {
+                            auto l_mat = l_byOffset.find(l_offsets[i]);
+                            if (l_offsets[i] == 0 || l_mat == l_byOffset.end()) {
+                                continue;
+                            }
+                            auto l_idx = l_idIdx.emplace(l_mat->second, l_graph.m_Ids.size());
+                            if (l_idx.second) {
+                                l_graph.m_Ids.push_back(l_mat->second);
+                                l_graph.m_Offsets.push_back(l_offsets[i]);
+                                l_graph.m_Uses.push_back(vector<pair<unsigned int, unsigned int> >());
+                            }
+                            unsigned int l_pos = l_reloc.first + sizeof(int) + i * sizeof(unsigned int);
+                            l_graph.m_Uses[l_idx.first->second].push_back(make_pair(l_pos / INSTR_BUF_SIZE, l_pos % INSTR_BUF_SIZE));
+                        }
+                    }
+
+                    auto l_reloc = _relocs.begin();
+                    for (unsigned int p = 0; p < l_numPages; ++p) {
+                        _graphSlotUsed[l_graph.m_Slots[p] - GEMX_hostInstrSlots] = true;
+                        StageInstrPage(p, l_graph.m_Slots[p], l_reloc);
+                    }
+                    ClearInstrBuf();
+
+                    unsigned int l_graphId = 0;
+                    while (l_graphId < _graphs.size() && !_graphs[l_graphId].m_Slots.empty()) {
+                        ++l_graphId;
+                    }
+                    if (l_graphId == _graphs.size()) {
+                        _graphs.push_back(Graph());
+                    }
+                    _graphs[l_graphId] = l_graph;
+                    return l_graphId;
+                }
+
+                // Runs a captured graph. binds maps captured matrices to the ones used
+                // this time; only the offset words of changed matrices are rewritten,
+                // and only the pages holding them are uploaded again.
+                bool Replay(int graph, const vector<pair<HType, HType> > & binds, bool sync_exec = true)
+                {
+                    XTimer t;
+                    if (graph < 0 || graph >= (int)_graphs.size() || _graphs[graph].m_Slots.empty()) {
+                        cerr << "ERROR: unknown graph " << graph << endl;
+                        return false;
+                    }
+                    Graph & l_graph = _graphs[graph];
+                    vector<unsigned int> l_ids(l_graph.m_Ids);
+                    for (auto & l_bind : binds) {
+                        int l_from = GetMatId(l_bind.first);
+                        int l_to = GetMatId(l_bind.second);
+                        auto l_it = find(l_graph.m_Ids.begin(), l_graph.m_Ids.end(), (unsigned int)l_from);
+                        if (l_from < 0 || l_it == l_graph.m_Ids.end()) {
+                            cerr << "ERROR: bound matrix is not used by graph " << graph << endl;
+                            return false;
+                        }
+                        if (l_to < 0 || !_mats[l_to].m_HasBuf) {
+                            cerr << "ERROR: bound matrix was not sent to the device" << endl;
+                            return false;
+                        }
+                        l_ids[l_it - l_graph.m_Ids.begin()] = l_to;
+                    }
+                    for (auto l_id : l_ids) {
+                        if (!_mats[l_id].m_HasBuf) {
+                            cerr << "ERROR: graph " << graph << " uses a matrix that is no longer on the device" << endl;
+                            return false;
+                        }
+                    }
+
+                    // the previous run of the graph must be done before its pages change
+                    _fpga_stream->waitSlot(l_graph.m_Slots.back());
+                    vector<bool> l_dirty(l_graph.m_Slots.size(), false);
+                    for (unsigned int i = 0; i < l_ids.size(); ++i) {
+                        MatEntry & l_mat = _mats[l_ids[i]];
+                        if (l_mat.m_PageOffset == 0) {
+                            l_mat.m_PageOffset = GetDevPageOffset(l_mat.m_Buf);
+                        }
+                        if (l_mat.m_PageOffset == l_graph.m_Offsets[i]) {
+                            continue;
+                        }
+                        for (auto & l_use : l_graph.m_Uses[i]) {
+                            unsigned int l_slot = l_graph.m_Slots[l_use.first];
+                            unsigned int * l_word = reinterpret_cast<unsigned int*>(_cl_instr_bufs[l_slot].m_HostPtr + l_use.second);
+                            *l_word = l_mat.m_PageOffset - l_slot * SLOT_PAGES;
+                            l_dirty[l_use.first] = true;
+                        }
+                        l_graph.m_Offsets[i] = l_mat.m_PageOffset;
+                    }
+
+                    for (unsigned int p = 0; p < l_graph.m_Slots.size(); ++p) {
+                        XBuf & l_instrBuf = _cl_instr_bufs[l_graph.m_Slots[p]];
+                        if (l_dirty[p]) {
+                            _fpga_stream->copyToFpga(l_instrBuf, false);
+                        }
+                        _fpga_stream->execKernel(l_instrBuf, sync_exec && p + 1 == l_graph.m_Slots.size(), l_graph.m_Slots[p]);
+                    }
+                    for (auto l_id : l_ids) {
+                        _mats[l_id].m_Slot = l_graph.m_Slots.back();
+                    }
+                    #ifdef GEMX_PERF_DBG
+                    cout << "Replay: " << t.elapsed() << endl;
+                    #endif
+                    return true;
+                }
+
+                bool FreeGraph(int graph)
+                {
+                    if (graph < 0 || graph >= (int)_graphs.size() || _graphs[graph].m_Slots.empty()) {
+                        cerr << "ERROR: unknown graph " << graph << endl;
+                        return false;
+                    }
+                    Graph & l_graph = _graphs[graph];
+                    _fpga_stream->waitSlot(l_graph.m_Slots.back());
+                    for (auto l_slot : l_graph.m_Slots) {
+                        _graphSlotUsed[l_slot - GEMX_hostInstrSlots] = false;
+                    }
+                    l_graph = Graph();
+                    return true;
                 }
             protected:
+                // Copies the program staged by AddInstr into the next instruction slot
+                // and starts the kernel on it. While it runs, the caller can already
+                // send the inputs of the next batch and read back the previous one;
+                // the host only blocks when it wraps around to a busy slot.
+                // A program of several instruction pages takes one slot per page; the
+                // runs are queued back to back and the streams keep them in order.
+                void Launch(bool sync_exec, bool with_stats)
+                {
+                    if (_capturing) {
+                        cerr << "ERROR: cannot execute while capturing, call EndCapture first" << endl;
+                        return;
+                    }
+                    unsigned int l_numChunks = _instrBuf.size() / INSTR_BUF_SIZE;
+                    unsigned int l_slot = _nextSlot;
+                    auto l_reloc = _relocs.begin();
+                    for (unsigned int c = 0; c < l_numChunks; ++c) {
+                        bool l_lastChunk = (c + 1 == l_numChunks);
+                        l_slot = _nextSlot;
+                        _nextSlot = (_nextSlot + 1) % GEMX_hostInstrSlots;
+                        XBuf & l_instrBuf = _cl_instr_bufs[l_slot];
+                        XBuf & l_statsBuf = _cl_stats_bufs[l_slot];
+
+                        _fpga_stream->waitSlot(l_slot);
+                        StageInstrPage(c, l_slot, l_reloc);
+                        if (with_stats) {
+                            _fpga_stream->copyToFpga(l_statsBuf, false);
+                        }
+                        _fpga_stream->execKernel(l_instrBuf, sync_exec && l_lastChunk, l_slot);
+                        if (with_stats) {
+                            _fpga_stream->copyFromFpga(l_statsBuf, sync_exec && l_lastChunk, l_slot);
+                        }
+                    }
+                    for (auto l_id : _progIds) {
+                        _mats[l_id].m_Slot = l_slot;
+                    }
+                }
+
+                // Copies page p_page of the staged program into p_slot and uploads it.
+                // Offsets were encoded against slot 0 and are shifted to the slot's base;
+                // p_reloc walks _relocs in step with the pages.
+                void StageInstrPage(unsigned int p_page, unsigned int p_slot, vector<pair<unsigned int, unsigned int> >::iterator & p_reloc)
+                {
+                    XBuf & l_instrBuf = _cl_instr_bufs[p_slot];
+                    unsigned int l_pageBase = p_page * INSTR_BUF_SIZE;
+                    memcpy(l_instrBuf.m_HostPtr, &_instrBuf[l_pageBase], INSTR_BUF_SIZE);
+                    unsigned int l_delta = p_slot * SLOT_PAGES;
+                    for (; p_reloc != _relocs.end() && p_reloc->first < l_pageBase + INSTR_BUF_SIZE; ++p_reloc) {
+                        unsigned int * l_offsets = reinterpret_cast<unsigned int*>(l_instrBuf.m_HostPtr + p_reloc->first - l_pageBase + sizeof(int));
+                        for (unsigned int i = 0; i < p_reloc->second; ++i) {
+                            if (l_offsets[i] != 0) {
+                                l_offsets[i] -= l_delta;
+                            }
+                        }
+                    }
+                    _fpga_stream->copyToFpga(l_instrBuf, false);
+                }
+
+                // A program frozen by EndCapture, one reserved slot per instruction page
+                struct Graph {
+                    vector<unsigned int> m_Slots;
+                    vector<unsigned int> m_Ids;                  // matrices the offset words point at
+                    vector<unsigned long long> m_Offsets;        // their offsets as currently encoded
+                    vector<vector<pair<unsigned int, unsigned int> > > m_Uses;   // (page, byte) of each word
+                };
+
+                // One entry per matrix. The device buffer and its page offset are cached
+                // here, so encoding an op costs one lookup of each handle.
+                struct MatEntry {
+                    MatEntry() : m_HostPtr(nullptr), m_Sz(0), m_HasBuf(false), m_DevBuf(false),
+                        m_Cached(false), m_InProg(false), m_PageOffset(0), m_Slot(XStream::LAST_SLOT) {}
+
+                    void* m_HostPtr;
+                    unsigned long long m_Sz;
+                    XBuf m_Buf;
+                    bool m_HasBuf;
+                    bool m_DevBuf;      // pages of the program buffer, from AddDevBuf
+                    bool m_Cached;      // m_HostPtr is a copy held by _cache
+                    bool m_InProg;      // listed in _progIds
+                    unsigned long long m_PageOffset;
+                    unsigned int m_Slot;
+                };
+
+                unsigned int NewMat(const HType & handle)
+                {
+                    unsigned int l_id;
+                    if (_freeIds.empty()) {
+                        l_id = _mats.size();
+                        _mats.push_back(MatEntry());
+                    } else {
+                        l_id = _freeIds.back();
+                        _freeIds.pop_back();
+                    }
+                    _matIds[handle] = l_id;
+                    return l_id;
+                }
+
+                void CreateMatBuf(MatEntry & p_mat)
+                {
+                    if (!_pool.find(p_mat.m_HostPtr, p_mat.m_Sz, p_mat.m_Buf)) {
+                        p_mat.m_Buf = _fpga_stream->createBuf(p_mat.m_HostPtr, p_mat.m_Sz);
+                    }
+                    p_mat.m_HasBuf = true;
+                    p_mat.m_PageOffset = 0;
+                }
+
+                // Points handle at the cached copy of the matrix, transferring it only if
+                // the content is new. False if the cache has no room left.
+                bool BindCachedMat(const HType & handle, void * mat_ptr, unsigned long long buf_sz, bool sync_send)
+                {
+                    XTimer t;
+                    bool l_miss = false;
+                    char * l_ptr = _cache.acquire(mat_ptr, buf_sz, l_miss);
+                    if (l_ptr == nullptr) {
+                        return false;
+                    }
+                    int l_id = GetMatId(handle);
+                    if (l_id < 0) {
+                        l_id = NewMat(handle);
+                    }
+                    MatEntry & l_mat = _mats[l_id];
+                    UnbindCachedMat(l_mat);
+                    l_mat.m_HostPtr = l_ptr;
+                    l_mat.m_Sz = buf_sz;
+                    l_mat.m_Cached = true;
+                    DropBuf(l_mat);
+                    CreateMatBuf(l_mat);
+                    if (l_miss) {
+                        _fpga_stream->copyToFpga(l_mat.m_Buf, sync_send);
+                    }
+                    #ifdef GEMX_PERF_DBG
+                    cout << "BindCachedMat: " << t.elapsed() << (l_miss ? " miss" : " hit") << endl;
+                    #endif
+                    return true;
+                }
+
+                void UnbindCachedMat(MatEntry & p_mat)
+                {
+                    if (p_mat.m_Cached) {
+                        _cache.release((char*)p_mat.m_HostPtr);
+                        p_mat.m_Cached = false;
+                    }
+                }
+
+                void DropBuf(MatEntry & p_mat)
+                {
+                    p_mat.m_Buf = XBuf();
+                    p_mat.m_HasBuf = false;
+                    p_mat.m_PageOffset = 0;
+                    p_mat.m_Slot = XStream::LAST_SLOT;
+                }
+
+                unsigned int GetHandleSlot(const HType & handle)
+                {
+                    int l_id = GetMatId(handle);
+                    return (l_id < 0) ? XStream::LAST_SLOT : _mats[l_id].m_Slot;
+                }
+
+                // Carves the instruction and stats pages of every slot out of p_buf.
+                // Graphs captured in the old slots are dropped.
+                bool InitSlots(const XBuf & p_buf)
+                {
+                    bool l_res = true;
+                    _nextSlot = 0;
+                    _graphs.clear();
+                    fill(_graphSlotUsed, _graphSlotUsed + GEMX_hostGraphSlots, false);
+                    _ddrDeviceBaseAddr = _fpga_stream->getDevAddr(p_buf);
+                    // cached offsets are relative to the old base
+                    for (auto & l_mat : _mats) {
+                        if (!l_mat.m_DevBuf) {
+                            l_mat.m_PageOffset = 0;
+                        }
+                        l_mat.m_Slot = XStream::LAST_SLOT;
+                    }
+                    for (unsigned int i = 0; i < NUM_SLOTS; ++i) {
+                        size_t l_base = i * SLOT_PAGES * PAGE_SIZE;
+                        l_res = _fpga_stream->createSubBuf(p_buf, l_base, INSTR_BUF_SIZE, _cl_instr_bufs[i]) && l_res;
+                        l_res = _fpga_stream->createSubBuf(p_buf, l_base + INSTR_BUF_SIZE, KERN_DBG_BUF_SIZE, _cl_stats_bufs[i]) && l_res;
+                    }
+                    return l_res;
+                }
+
                 static const unsigned int PAGE_SIZE = 4096;
                 static const unsigned int INSTR_BUF_SIZE = PAGE_SIZE;
+                static const unsigned int KERN_INSTR_SIZE = 64;
                 static const unsigned int KERN_DBG_BUF_SIZE = PAGE_SIZE;
-                unordered_map<HType, unsigned int> _hostMatPageOffset;
-                unordered_map<HType, void*  > _hostMat;
-                unordered_map<HType, unsigned long long > _hostMatSz;
-                unordered_map<HType, cl::Buffer> _devHandle;
+                static const unsigned int SLOT_PAGES = (INSTR_BUF_SIZE + KERN_DBG_BUF_SIZE) / PAGE_SIZE;
+                static const unsigned int NUM_SLOTS = GEMX_hostInstrSlots + GEMX_hostGraphSlots;
+                static const unsigned int RING_BUF_SIZE = NUM_SLOTS * SLOT_PAGES * PAGE_SIZE;
+                // before _mats so the mappings outlive the device buffers using them
+                unordered_map<void*, unique_ptr<SpImage> > _images;
+                unordered_map<HType, unsigned int> _matIds;
+                vector<MatEntry> _mats;
+                vector<unsigned int> _freeIds;
+                vector<unsigned int> _progIds;   // matrices used by the staged program
+                vector<pair<unsigned int, unsigned int> > _relocs;
                 shared_ptr<XStream> _fpga_stream;
-
+                XHostPool _pool;
+                XMatCache _cache;
 
                 unsigned long long _ddrDeviceBaseAddr;
                 char* _progBuf;
-                char* _instrBuf;
-                cl::Buffer _cl_prog_buf, _cl_instr_buf, _cl_stats_buf;
-                unsigned int _allocated_pages;
+                vector<char> _instrBuf;          // staged program, one page per kernel run
+                char* _ringBuf;
+                XBuf _cl_prog_buf, _cl_ring_buf;
+                // ring slots come first, then the graph slots
+                XBuf _cl_instr_bufs[NUM_SLOTS], _cl_stats_bufs[NUM_SLOTS];
+                unsigned int _nextSlot;
+                map<unsigned int, unsigned int> _freePages;   // first page -> pages
                 unsigned int _total_prog_pages;
                 unsigned int _instr_offset;
+                unsigned int _chunkInstrs;       // ops in the last page of _instrBuf
+                unsigned int _numInstr;
+                bool _capturing;
+                vector<Graph> _graphs;
+                bool _graphSlotUsed[GEMX_hostGraphSlots];
         };
 
 
@@ -40,6 +40,34 @@ class GEMXManager:
                                    np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"), 
                                    np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"), 
                                    c_uint, c_uint, c_uint, c_int, c_int, c_uint] 
+    self._lib.AddFCNOpTrans.argtypes = [np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                  np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                  np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                  np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                  c_uint, c_uint, c_uint, c_uint, c_uint, c_uint, c_uint, c_int, c_int, c_short, c_short,
+                                  c_bool, c_bool, c_bool, c_uint]
+    self._lib.AddGEMMOpTrans.argtypes = [np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),
+                                   c_uint, c_uint, c_uint, c_uint, c_uint, c_uint, c_uint, c_int, c_int,
+                                   c_bool, c_bool, c_bool, c_uint]
+    self._lib.AllocHostMat.argtypes = [c_ulonglong, c_uint]
+    self._lib.AllocHostMat.restype = c_void_p
+    self._lib.FreeHostMat.argtypes = [c_void_p, c_uint]
+    self._lib.FreeHostMat.restype = c_bool
+    self._lib.GemmAutoShrt.argtypes = [np.ctypeslib.ndpointer(c_short, flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(c_short, flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(c_short, flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                   c_uint, c_uint, c_uint, c_int, c_int]
+    self._lib.GemmAutoShrt.restype = c_bool
+    self._lib.GemmAutoFloat.argtypes = [np.ctypeslib.ndpointer(c_float, flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(c_float, flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(c_float, flags="C_CONTIGUOUS"),
+                                   np.ctypeslib.ndpointer(c_float, flags="C_CONTIGUOUS"),
+                                   c_uint, c_uint, c_uint, c_int, c_int]
+    self._lib.GemmAutoFloat.restype = c_bool
     self._lib.AddUSPMVOp.argtypes = [c_void_p, 
                                    np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"), 
                                    np.ctypeslib.ndpointer(flags="C_CONTIGUOUS"),  
@@ -69,9 +97,13 @@ class GEMXManager:
     self._lib.SendUSpMat.restype = c_void_p  
     self._lib.AddFCNOp.restype = c_bool
     self._lib.AddGEMMOp.restype = c_bool
+    self._lib.AddFCNOpTrans.restype = c_bool
+    self._lib.AddGEMMOpTrans.restype = c_bool
     self._lib.AddUSPMVOp.restype = c_bool
     self._lib.AddSPMVOp.restype = c_bool
     self._lib.Execute.argtypes = [c_bool, c_uint]
+    self._lib.ExecuteCpuImage.argtypes = [np.ctypeslib.ndpointer(c_uint8, flags="C_CONTIGUOUS"), c_ulonglong]
+    self._lib.ExecuteCpuImage.restype = c_bool
     self._lib.GetFromFPGA.argtypes = [np.ctypeslib.ndpointer(c_short, flags="C_CONTIGUOUS"), c_uint, c_bool]
     self._lib.GetFromFPGA.restype = c_void_p
     self._lib.GetFromFPGAInt.argtypes = [np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"), c_uint, c_bool]
@@ -118,7 +150,69 @@ class GEMXManager:
     self._lib.AddUSPMVDevOp.restype=c_bool
     self._lib.GetDevBuf.argtypes=[c_char_p,c_uint,c_bool]
     self._lib.GetDevBuf.restype = c_void_p
+    self._lib.FreeDevBuf.argtypes=[c_char_p,c_uint]
+    self._lib.FreeDevBuf.restype = c_bool
+    self._lib.CompactDevBuf.argtypes=[c_uint]
+    self._lib.CompactDevBuf.restype = c_bool
     self._lib.ExecuteDev.argtypes=[c_bool,c_uint]
+    self._lib.BeginCapture.argtypes = [c_uint]
+    self._lib.EndCapture.argtypes = [c_uint]
+    self._lib.EndCapture.restype = c_int
+    self._lib.Replay.argtypes = [c_int, POINTER(c_void_p), POINTER(c_void_p), c_uint, c_bool, c_uint]
+    self._lib.Replay.restype = c_bool
+    self._lib.FreeGraph.argtypes = [c_int, c_uint]
+    self._lib.FreeGraph.restype = c_bool
+    self._lib.SendCachedMat.argtypes = [c_void_p, c_ulonglong, c_uint, c_bool]
+    self._lib.SendStridedMat.argtypes = [c_void_p, c_uint, c_uint, c_uint, c_bool, c_uint, c_void_p, c_uint, c_uint, c_bool, c_uint, c_bool]
+    self._lib.SendStridedMat.restype = c_void_p
+    self._lib.GetStridedMat.argtypes = [c_void_p, c_uint, c_uint, c_uint, c_bool, c_uint, c_void_p, c_uint, c_uint]
+    self._lib.GetStridedMat.restype = c_bool
+    self._lib.ReleaseMat.argtypes = [c_void_p, c_uint]
+    self._lib.SetMatCacheSize.argtypes = [c_ulonglong, c_uint]
+    self._lib.GetMatCacheStats.argtypes = [POINTER(c_ulonglong), POINTER(c_ulonglong), POINTER(c_ulonglong), c_uint]
+    self._lib.EstimateGEMMOp.argtypes = [c_uint, c_uint, c_uint, c_double,
+                                         POINTER(c_ulonglong), POINTER(c_ulonglong), POINTER(c_double)]
+    self._lib.EstimateGEMMOp.restype = c_bool
+    self._lib.EstimateFCNOp.argtypes = [c_uint, c_uint, c_uint, c_double,
+                                        POINTER(c_ulonglong), POINTER(c_ulonglong), POINTER(c_double)]
+    self._lib.EstimateFCNOp.restype = c_bool
+    self._lib.EstimateGEMVOp.argtypes = [c_uint, c_uint, c_double,
+                                         POINTER(c_ulonglong), POINTER(c_ulonglong), POINTER(c_double)]
+    self._lib.EstimateGEMVOp.restype = c_bool
+    self._lib.EstimateTRANSPOp.argtypes = [c_uint, c_uint, c_double,
+                                           POINTER(c_ulonglong), POINTER(c_ulonglong), POINTER(c_double)]
+    self._lib.EstimateTRANSPOp.restype = c_bool
+    self._lib.EstimateSPMVOp.argtypes = [np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                         np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                         c_uint, c_uint, c_uint, c_double,
+                                         POINTER(c_ulonglong), POINTER(c_ulonglong), POINTER(c_double)]
+    self._lib.EstimateSPMVOp.restype = c_bool
+    self._lib.EstimateUSPMVOp.argtypes = [np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                          np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                          np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                          c_uint, c_double,
+                                          POINTER(c_ulonglong), POINTER(c_ulonglong), POINTER(c_double)]
+    self._lib.EstimateUSPMVOp.restype = c_bool
+    self._lib.WriteSpImage.argtypes = [c_char_p, np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_float, flags="C_CONTIGUOUS"),c_uint,c_uint,c_uint,
+                                       c_uint,c_uint,c_uint,c_uint,c_uint,c_bool]
+    self._lib.WriteSpImage.restype = c_bool
+    self._lib.SendSpImage.argtypes = [c_char_p, c_uint, c_uint, c_uint, c_uint, c_uint, c_bool, POINTER(c_uint), c_uint]
+    self._lib.SendSpImage.restype = c_void_p
+    self._lib.WriteUSpImage.argtypes = [c_char_p, np.ctypeslib.ndpointer(c_uint16, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_uint16, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_float, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_int, flags="C_CONTIGUOUS"),
+                                       np.ctypeslib.ndpointer(c_float, flags="C_CONTIGUOUS"),
+                                       c_uint,c_uint]
+    self._lib.WriteUSpImage.restype = c_bool
+    self._lib.SendUSpImage.argtypes = [c_char_p, c_uint, c_uint, c_uint]
+    self._lib.SendUSpImage.restype = c_void_p
+    self._lib.FreeSpImage.argtypes = [c_void_p, c_uint]
+    self._lib.FreeSpImage.restype = c_bool
         
   def createFCNHandle (self, xclbin, numHandles):
     """
@@ -178,10 +272,54 @@ class GEMXManager:
     b_xclbin = xclbin.encode('utf-8')
     self._lib.MakeSPMVHost(b_xclbin, int(numHandles))
 
-  def sendMat ( self, A, PE, sync_send = False):
+  def allocMat ( self, shape, dtype, PE, zero = True):
+    """
+    allocate a dense matrix from the pinned host memory pool of the kernel
+    
+    Parameters
+    ----------
+    shape:     tuple
+               shape of the matrix
+    dtype:     numpy type
+               type of the matrix elements
+    PE:        int
+               index of kernel
+    zero:      boolean
+               zero the matrix. Default value is true.
+    
+    Return
+    ------
+    ndarray
+               matrix backed by the pool, release it with freeMat
+    """
+    dtype = np.dtype(dtype)
+    nbytes = int(np.prod(shape)) * dtype.itemsize
+    ptr = self._lib.AllocHostMat(c_ulonglong(nbytes), c_uint(PE))
+    if not ptr:
+        raise MemoryError("AllocHostMat failed for", shape, dtype)
+    A = np.frombuffer((c_char * nbytes).from_address(ptr), dtype=dtype).reshape(shape)
+    if zero:
+        A.fill(0)
+    return A
+
+  def freeMat ( self, A, PE):
+    """
+    return a matrix from allocMat to the pool, the memory is reused after clearBuf
+    
+    Parameters
+    ----------
+    A:         ndarray
+               matrix returned by allocMat
+    PE:        int
+               index of kernel
+    """
+    return self._lib.FreeHostMat(A.ctypes.data, c_uint(PE))
+
+  def sendMat ( self, A, PE, sync_send = False, cached = False):
     """
     send dense matrix to kernel
     if sync_send is true, will only create the buffer for that matrix, and will need to send it when executing the kernel
+    if cached is true, the matrix is treated as constant and shares the device copy of identical data sent before
     
     Parameters
     ----------  
@@ -192,11 +330,17 @@ class GEMXManager:
     sync_send: boolean
                controls when to send the data to kernel. \n
                If false, send immediately, else need to send together when executing the kernel. Default value is false. 
+    cached:    boolean
+               look the matrix up in the device matrix cache by content, release it with releaseMat. Default value is false.
     """
     if A.flags['C_CONTIGUOUS'] == False:
         A = np.ascontiguousarray(A)
         print ("Warning: not C_CONTIGUOUS, performance will be affected")      
-    if A.dtype == np.int32:
+    if cached:
+        if A.dtype not in (np.int32, np.int16, np.float32):
+            raise TypeError("type", A.dtype, "not supported")
+        self._lib.SendCachedMat( A.ctypes.data, c_ulonglong(A.nbytes), c_uint(PE), sync_send )
+    elif A.dtype == np.int32:
         self._lib.SendToFPGAInt( A, c_ulonglong(A.size), c_uint(PE), sync_send )
     elif A.dtype == np.int16:
         self._lib.SendToFPGAShrt( A, c_ulonglong(A.size), c_uint(PE), sync_send ) 
@@ -205,6 +349,104 @@ class GEMXManager:
     else:
         raise TypeError("type", A.dtype, "not supported")
       
+  def _stridedView ( self, A):
+    """
+    describe a 2-D view by its C ordered base, shape, leading dimension and orientation;
+    views with neither contiguous rows nor contiguous columns are copied
+    """
+    if A.ndim == 1:
+        A = A.reshape(1, -1)
+    if A.dtype not in (np.int32, np.int16, np.float32):
+        raise TypeError("type", A.dtype, "not supported")
+    item = A.itemsize
+    s0, s1 = A.strides
+    if s1 == item and s0 >= 0 and s0 % item == 0:
+        return A, A.shape[0], A.shape[1], s0 // item, False
+    if s0 == item and s1 >= 0 and s1 % item == 0:
+        return A, A.shape[1], A.shape[0], s1 // item, True
+    print ("Warning: no contiguous dimension, performance will be affected")
+    A = np.ascontiguousarray(A)
+    return A, A.shape[0], A.shape[1], A.shape[1], False
+
+  def sendStridedMat ( self, A, shape, PE, dst = None, sync_send = False, cached = False):
+    """
+    pad a matrix to shape and send it, in a single copy into pinned memory
+    A may be a strided, transposed or broadcast view, e.g. np.transpose(w) or
+    np.broadcast_to(b, ...), no copy of it is made in numpy
+    
+    Parameters
+    ----------  
+    A:         ndarray
+               2-D view with contiguous rows or columns
+    shape:     tuple
+               padded shape, at least A.shape
+    PE:        int
+               index of kernel
+    dst:       ndarray
+               C contiguous matrix of shape from allocMat to pack into. Default is a new one from allocMat.
+    sync_send: boolean
+               as in sendMat
+    cached:    boolean
+               as in sendMat
+    
+    Return
+    ------
+    ndarray
+               the padded matrix, use it as the operand of ops
+    """
+    if A.ndim == 1:
+        A = A.reshape(1, -1)
+    if A.shape[0] > shape[0] or A.shape[1] > shape[1]:
+        raise ValueError("shape", shape, "is smaller than", A.shape)
+    src, rows, cols, ld, trans = self._stridedView(A)
+    if dst is None:
+        # every element is written by the packing copy
+        dst = self.allocMat(shape, A.dtype, PE, zero=False)
+    elif dst.dtype != A.dtype or tuple(dst.shape) != tuple(shape) or not dst.flags['C_CONTIGUOUS']:
+        raise ValueError("dst must be a C contiguous", A.dtype, "matrix of shape", shape)
+    ptr = self._lib.SendStridedMat( c_void_p(src.ctypes.data), c_uint(rows), c_uint(cols), c_uint(ld), trans,
+                                    c_uint(A.itemsize), c_void_p(dst.ctypes.data), c_uint(shape[0]), c_uint(shape[1]),
+                                    cached, c_uint(PE), sync_send )
+    if not ptr:
+        raise MemoryError("SendStridedMat failed for", shape, A.dtype)
+    return dst
+
+  def getStridedMat ( self, A, shape, PE, out = None):
+    """
+    get a matrix from kernel and copy the top left corner of the given shape out of its padding
+    
+    Parameters
+    ----------  
+    A:         ndarray
+               dense matrix sent to the kernel
+    shape:     tuple
+               rows and columns to copy
+    PE:        int
+               index of kernel
+    out:       ndarray
+               2-D view of shape with contiguous rows or columns, e.g. the transpose
+               of a C contiguous result. Default is a new C contiguous matrix.
+    
+    Return
+    ------
+    ndarray
+               out
+    """
+    if shape[0] > A.shape[0] or shape[1] > A.shape[1]:
+        raise ValueError("shape", shape, "is larger than", A.shape)
+    if out is None:
+        out = np.empty(shape, dtype=A.dtype)
+    elif out.dtype != A.dtype or tuple(out.shape) != tuple(shape):
+        raise ValueError("out must be a", A.dtype, "matrix of shape", shape)
+    dst, rows, cols, ld, trans = self._stridedView(out)
+    if dst is not out:
+        raise ValueError("out needs contiguous rows or columns")
+    # dst describes out as rows x cols, A is copied to it row for row or transposed
+    if not self._lib.GetStridedMat( c_void_p(A.ctypes.data), c_uint(shape[0]), c_uint(shape[1]), c_uint(A.shape[1]),
+                                    trans, c_uint(A.itemsize), c_void_p(dst.ctypes.data), c_uint(ld), c_uint(PE) ):
+        raise RuntimeError("GetStridedMat failed, matrix was not sent")
+    return out
+
   def sendSpMat(self, row, col, data, m, k, nnz, xclbin_opts, PE):
     """
     send sparse matrix to kernel (for spmv engine). 
@@ -284,7 +526,78 @@ class GEMXManager:
     """
     return self._lib.SendUSpMat(rows,cols,datas, ms, ks, nnzs, pRelus,int(xclbin_opts["GEMX_ddrWidth"]), int(xclbin_opts["GEMX_uspmvStages"]), c_uint(PE))
   
-  def addFCNOp(self, A, B, C, bias, postScale, postShift, PReLUScale, PReLUAlpha, PE):
+  def _spmvConfig(self, xclbin_opts):
+    ddrWidth = int(xclbin_opts["GEMX_ddrWidth"])
+    spmv_width = int(xclbin_opts["GEMX_spmvWidth"])
+    num_cblocks = int(xclbin_opts["GEMX_spmvNumCblocks"])
+    spmvMacGroups = int(xclbin_opts["GEMX_spmvMacGroups"])
+    t_mVectorBlocks =((1 << (16 - int(xclbin_opts["GEMX_spmvColAddIdxBits"]))) // spmv_width // spmvMacGroups // ddrWidth)
+    capacity_Cblocks =  int(spmv_width * spmvMacGroups * t_mVectorBlocks * ddrWidth)
+    capacity_Bblocks = int(spmv_width * int(xclbin_opts["GEMX_spmvkVectorBlocks"]) * ddrWidth)
+    if xclbin_opts["GEMX_dataType"] not in ("float", "int32_t"):
+      raise TypeError("type", xclbin_opts["GEMX_dataType"], "not supported")
+    is_int = xclbin_opts["GEMX_dataType"] == "int32_t"
+    return ddrWidth, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, is_int
+
+  def writeSpImage(self, fileName, row, col, data, m, k, nnz, xclbin_opts):
+    """
+    pack a sparse matrix for the spmv engine once and store the device image in a file,
+    see sendSpImage. Parameters as for sendSpMat.
+    """
+    ddrWidth, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, is_int = self._spmvConfig(xclbin_opts)
+    return self._lib.WriteSpImage(fileName.encode('utf-8'), row, col, data, m, k, nnz, ddrWidth, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, is_int)
+
+  def sendSpImage(self, fileName, xclbin_opts, PE):
+    """
+    map a file from writeSpImage and send it to the kernel without repacking.
+    The image must have been built for the same xclbin configuration.
+    
+    Return
+    ------
+    tuple
+                 (pointer to the sparse matrix for addSPMVOp, m, k, nnz), pointer is None on failure
+    """
+    ddrWidth, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, is_int = self._spmvConfig(xclbin_opts)
+    dims = (c_uint * 3)()
+    A = self._lib.SendSpImage(fileName.encode('utf-8'), ddrWidth, spmv_width, num_cblocks, capacity_Cblocks, capacity_Bblocks, is_int, dims, c_uint(PE))
+    return A, dims[0], dims[1], dims[2]
+
+  def writeUSpImage(self, fileName, rows, cols, datas, ms, ks, nnzs, pRelus, xclbin_opts):
+    """
+    pack sparse matrices for the uspmv engine once and store the device image in a file,
+    see sendUSpImage. Parameters as for sendUSpMat.
+    """
+    return self._lib.WriteUSpImage(fileName.encode('utf-8'), rows, cols, datas, ms, ks, nnzs, pRelus, int(xclbin_opts["GEMX_ddrWidth"]), int(xclbin_opts["GEMX_uspmvStages"]))
+
+  def sendUSpImage(self, fileName, xclbin_opts, PE):
+    """
+    map a file from writeUSpImage and send it to the kernel without repacking,
+    returns the pointer for addUSPMVOp or None on failure
+    """
+    return self._lib.SendUSpImage(fileName.encode('utf-8'), int(xclbin_opts["GEMX_ddrWidth"]), int(xclbin_opts["GEMX_uspmvStages"]), c_uint(PE))
+
+  def freeSpImage(self, A, PE):
+    """
+    forget a sparse image from sendSpImage or sendUSpImage and unmap its file
+    """
+    return self._lib.FreeSpImage(A, c_uint(PE))
+
+  def _opShape(self, A, B, C, bias, transA, transB, transC, op):
+    """
+    m, k, n of an op from the stored shapes of its operands
+    """
+    m, k = (A.shape[1], A.shape[0]) if transA else A.shape
+    kb, n = (B.shape[1], B.shape[0]) if transB else B.shape
+    if k != kb:
+        raise ValueError("Cannot perform " + op + " with matrices", A.shape, B.shape )
+    c_shape = (n, m) if transC else (m, n)
+    if C.shape != c_shape:
+        raise ValueError("Output matrix shape", C.shape, "doesn't match", c_shape)
+    if C.shape != bias.shape:
+        raise ValueError("Bias matrix shape", bias.shape, "doesn't match output shape", C.shape)
+    return m, k, n
+
+  def addFCNOp(self, A, B, C, bias, postScale, postShift, PReLUScale, PReLUAlpha, PE, transA=False, transB=False, transC=False):
     """
     create FCN instruction for C = relu ((A * B + bias) * postScale >> postShift) 
     
@@ -308,14 +621,16 @@ class GEMXManager:
                shift the output values with specific scalar when output values < 0              
     PE:        int
                index of kernel
+    transA, transB, transC: bool
+               A is stored as k x m, B as n x k, C and bias as n x m; the kernel
+               reads and writes them transposed
     """
-    if A.shape[1] != B.shape[0]:
-        raise ValueError("Cannot perform FCN with matrices", A.shape, B.shape )
-    if C.shape != bias.shape:
-        raise ValueError("Bias matrix shape", bias.shape, "doesn't match output shape", C.shape)
+    m, k, n = self._opShape(A, B, C, bias, transA, transB, transC, "FCN")
+    if transA or transB or transC:
+        return self._lib.AddFCNOpTrans( A, B, C, bias, c_uint(m), c_uint(k), c_uint(n), c_uint(A.shape[1]), c_uint(B.shape[1]), c_uint(C.shape[1]), c_uint(bias.shape[1]), c_int(postScale), c_int(postShift), c_short(PReLUScale), c_short(PReLUAlpha), c_bool(transA), c_bool(transB), c_bool(transC), c_uint(PE))
     return self._lib.AddFCNOp( A, B, C, bias, c_uint(A.shape[0]), c_uint( A.shape[1] ), c_uint( B.shape[1]), c_int(postScale), c_int(postShift), c_short(PReLUScale), c_short(PReLUAlpha), c_uint(PE))
   
-  def addGEMMOp(self, A, B, C, bias, postScale, postShift, PE):
+  def addGEMMOp(self, A, B, C, bias, postScale, postShift, PE, transA=False, transB=False, transC=False):
     """
     create GEMM instruction for C = (A * B + bias) * postScale >> postShift
     
@@ -335,13 +650,45 @@ class GEMXManager:
                shift the output values with specific scalar          
     PE:        int
                index of kernel
+    transA, transB, transC: bool
+               A is stored as k x m, B as n x k, C and bias as n x m; the kernel
+               reads and writes them transposed
+    """
+    m, k, n = self._opShape(A, B, C, bias, transA, transB, transC, "GEMM")
+    if transA or transB or transC:
+        return self._lib.AddGEMMOpTrans(A, B, C, bias, c_uint(m), c_uint(k), c_uint(n), c_uint(A.shape[1]), c_uint(B.shape[1]), c_uint(C.shape[1]), c_uint(bias.shape[1]), c_int(postScale), c_int(postShift), c_bool(transA), c_bool(transB), c_bool(transC), c_uint(PE))
+    return self._lib.AddGEMMOp(A,B, C, bias, c_uint(A.shape[0]), c_uint( A.shape[1] ), c_uint( B.shape[1]), c_int(postScale), c_int(postShift), c_uint(PE))
+  
+  def gemmAuto(self, A, B, C, bias, postScale, postShift):
+    """
+    run C = (A * B + bias) * postScale >> postShift on all PEs of the GEMM or FCN handle
+    
+    Parameters
+    ----------
+    A:         ndarray
+               dense matrix in the host memory
+    B:         ndarray
+               dense matrix in the host memory
+    C:         ndarray
+               dense matrix in the host memory
+    bias:      ndarray
+               dense matrix in the host memory
+    postScale: int
+               multiply the output values with specific scalar
+    postShift: int
+               shift the output values with specific scalar
     """
     if A.shape[1] != B.shape[0]:
         raise ValueError("Cannot perform GEMM with matrices", A.shape, B.shape )
     if C.shape != bias.shape:
-        raise ValueError("Bias matrix shape", bias.shape, "doesn't match output shape")      
-    return self._lib.AddGEMMOp(A,B, C, bias, c_uint(A.shape[0]), c_uint( A.shape[1] ), c_uint( B.shape[1]), c_int(postScale), c_int(postShift), c_uint(PE))
-  
+        raise ValueError("Bias matrix shape", bias.shape, "doesn't match output shape")
+    if A.dtype == np.int16:
+        return self._lib.GemmAutoShrt(A, B, C, bias, c_uint(A.shape[0]), c_uint( A.shape[1] ), c_uint( B.shape[1]), c_int(postScale), c_int(postShift))
+    elif A.dtype == np.float32:
+        return self._lib.GemmAutoFloat(A, B, C, bias, c_uint(A.shape[0]), c_uint( A.shape[1] ), c_uint( B.shape[1]), c_int(postScale), c_int(postShift))
+    else:
+        raise TypeError("type", A.dtype, "not supported")
+
   def addSPMVOp(self, A, B, C, nnz, xclbin_opts, relu, PE):    
     """
     create SPMV instruction for C = relu (A (sparse matrix) * B (dense vector) )
@@ -403,7 +750,162 @@ class GEMXManager:
                It is suggested to use the default value for sync_send and sync_exec.
     """
     self._lib.Execute(sync_exec, PE)
+
+  def executeCpuImage(self, image):
+    """
+    run a device image in the gen_bin app.bin layout on the CPU kernels of the loaded engine.
+    Execution starts at code page 0 and follows chained code pages; results are written in place.
+
+    Parameters
+    ----------
+    image:     ndarray
+               uint8 device image, page offsets of the instructions count from its start
+    """
+    if not self._lib.ExecuteCpuImage(image, c_ulonglong(image.nbytes)):
+      raise RuntimeError("CPU execution of the device image failed")
+    
+  def beginCapture(self, PE):
+    """
+    start recording the instructions added on the kernel into a graph instead of executing them
     
+    Parameters
+    ----------  
+    PE:        int
+               index of kernel
+    """
+    self._lib.BeginCapture(PE)
+
+  def endCapture(self, PE):
+    """
+    upload the recorded instructions once and return the graph id, -1 on failure
+    
+    Parameters
+    ----------  
+    PE:        int
+               index of kernel
+    """
+    return self._lib.EndCapture(PE)
+
+  def replay(self, graph, binds, PE, sync_exec = True):
+    """
+    run a captured graph with a single launch
+    
+    Parameters
+    ----------  
+    graph:     int
+               id returned by endCapture
+    binds:     list
+               (captured matrix, matrix to use instead) pairs, both sent with sendMat before
+    PE:        int
+               index of kernel
+    """
+    n = len(binds)
+    src = (c_void_p * max(n, 1))(*[a.ctypes.data for a, _ in binds])
+    dst = (c_void_p * max(n, 1))(*[b.ctypes.data for _, b in binds])
+    return self._lib.Replay(graph, src, dst, c_uint(n), sync_exec, PE)
+
+  def freeGraph(self, graph, PE):
+    return self._lib.FreeGraph(graph, PE)
+
+  def releaseMat(self, A, PE):
+    """
+    forget a matrix sent to the kernel, dropping its reference to the device matrix cache
+    
+    Parameters
+    ----------
+    A:         ndarray
+               matrix passed to sendMat
+    PE:        int
+               index of kernel
+    """
+    self._lib.ReleaseMat(A.ctypes.data, c_uint(PE))
+
+  def setMatCacheSize(self, nbytes, PE):
+    """
+    set the device memory budget of the matrix cache, unreferenced matrices are evicted least recently used first
+    """
+    self._lib.SetMatCacheSize(c_ulonglong(nbytes), c_uint(PE))
+
+  def matCacheStats(self, PE):
+    """
+    return (hits, misses, cached bytes) of the device matrix cache
+    """
+    hits, misses, nbytes = c_ulonglong(0), c_ulonglong(0), c_ulonglong(0)
+    self._lib.GetMatCacheStats(byref(hits), byref(misses), byref(nbytes), c_uint(PE))
+    return hits.value, misses.value, nbytes.value
+
+  def _estimate(self, fn, *args):
+    cycles, nbytes, gops = c_ulonglong(0), c_ulonglong(0), c_double(0)
+    if not fn(*(args + (byref(cycles), byref(nbytes), byref(gops)))):
+      raise RuntimeError("estimate failed, a kernel must be loaded by a create*Handle call first")
+    return cycles.value, nbytes.value, gops.value
+
+  def estimateGEMMOp(self, m, k, n, clock_mhz = 250):
+    """
+    predict the cost of a GEMM op of C (m x n) = A (m x k) * B (k x n) from the analytic model of the loaded engine
+
+    Return
+    ------
+    tuple
+                 (cycles, DDR bytes, GOPS)
+    """
+    return self._estimate(self._lib.EstimateGEMMOp, c_uint(m), c_uint(k), c_uint(n), c_double(clock_mhz))
+
+  def estimateFCNOp(self, m, k, n, clock_mhz = 250):
+    """
+    predict the cost of an FCN op of C (m x n) = A (m x k) * B (k x n) from the analytic model of the loaded engine
+
+    Return
+    ------
+    tuple
+                 (cycles, DDR bytes, GOPS)
+    """
+    return self._estimate(self._lib.EstimateFCNOp, c_uint(m), c_uint(k), c_uint(n), c_double(clock_mhz))
+
+  def estimateGEMVOp(self, m, k, clock_mhz = 250):
+    """
+    predict the cost of a GEMV op of C (m) = A (m x k) * B (k) from the analytic model of the loaded engine
+
+    Return
+    ------
+    tuple
+                 (cycles, DDR bytes, GOPS)
+    """
+    return self._estimate(self._lib.EstimateGEMVOp, c_uint(m), c_uint(k), c_double(clock_mhz))
+
+  def estimateTRANSPOp(self, rows, cols, clock_mhz = 250):
+    """
+    predict the cost of transposing a rows x cols matrix from the analytic model of the loaded engine
+
+    Return
+    ------
+    tuple
+                 (cycles, DDR bytes, GOPS)
+    """
+    return self._estimate(self._lib.EstimateTRANSPOp, c_uint(rows), c_uint(cols), c_double(clock_mhz))
+
+  def estimateSPMVOp(self, row, col, m, k, nnz, clock_mhz = 250):
+    """
+    predict the cost of an SPMV op from the analytic model, using how the non-zeros of A fall into the blocks of the loaded engine
+
+    Return
+    ------
+    tuple
+                 (cycles, DDR bytes, GOPS)
+    """
+    return self._estimate(self._lib.EstimateSPMVOp, row, col, c_uint(m), c_uint(k), c_uint(nnz), c_double(clock_mhz))
+
+  def estimateUSPMVOp(self, ms, ks, nnzs, numRuns, clock_mhz = 250):
+    """
+    predict the cost of a USPMV op over numRuns columns of B from the analytic model, given the sizes of the stage matrices
+
+    Return
+    ------
+    tuple
+                 (cycles, DDR bytes, GOPS)
+    """
+    return self._estimate(self._lib.EstimateUSPMVOp, ms, ks, nnzs, c_uint(numRuns), c_double(clock_mhz))
+
   def wait(self, PE):
     """
     Wait until all events have completed. 
@@ -492,6 +994,8 @@ class GEMXManager:
   def addDevBuf(self,A,size_row,size_col,datatype,PE):
     buf_size=size_row*size_col*np.dtype(datatype).itemsize
     address = self._lib.AddDevBuf(A,buf_size,PE)
+    if not address:
+      raise MemoryError("program buffer full, use freeDevBuf or compactDevBuf")
     if datatype==np.int16:
       buff ={'shape':(size_row,size_col),'data':(address,False),'typestr':'<i2'}
     elif datatype==np.int32:
@@ -547,6 +1051,12 @@ class GEMXManager:
   def getDevBuf(self,A,PE,sync_get):
     return self._lib.GetDevBuf(A,PE,sync_get)
   
+  def freeDevBuf(self,A,PE):
+    return self._lib.FreeDevBuf(A,PE)
+
+  def compactDevBuf(self,PE):
+    return self._lib.CompactDevBuf(PE)
+
   def executeDev(self,sync_exec,PE):
     self._lib.ExecuteDev(sync_exec,PE)
     
@@ -582,11 +1092,68 @@ def addUSPMVDevOp(A,B,C,numRuns, PE=0):
 def getDevBuf(A,PE=0,sync_get=True):
     return _gemxManager.getDevBuf(A,PE,sync_get)    
 
+def freeDevBuf(A,PE=0):
+    return _gemxManager.freeDevBuf(A,PE)
+
+def compactDevBuf(PE=0):
+    return _gemxManager.compactDevBuf(PE)
+
 def executeDev(sync_exec=True,PE=0):
     return _gemxManager.executeDev(sync_exec,PE)
 
-def sendMat ( A,PE=0,sync_send=False):
-    _gemxManager.sendMat(A,PE,sync_send)
+def beginCapture(PE=0):
+    _gemxManager.beginCapture(PE)
+
+def endCapture(PE=0):
+    return _gemxManager.endCapture(PE)
+
+def replay(graph, binds=[], PE=0, sync_exec=True):
+    return _gemxManager.replay(graph, binds, PE, sync_exec)
+
+def freeGraph(graph, PE=0):
+    return _gemxManager.freeGraph(graph, PE)
+
+def allocMat ( shape, dtype, PE=0):
+    return _gemxManager.allocMat(shape, dtype, PE)
+
+def freeMat ( A, PE=0):
+    return _gemxManager.freeMat(A, PE)
+
+def sendMat ( A,PE=0,sync_send=False,cached=False):
+    _gemxManager.sendMat(A,PE,sync_send,cached)
+
+def sendStridedMat ( A, shape, PE=0, dst=None, sync_send=False, cached=False):
+    return _gemxManager.sendStridedMat(A, shape, PE, dst, sync_send, cached)
+
+def getStridedMat ( A, shape, PE=0, out=None):
+    return _gemxManager.getStridedMat(A, shape, PE, out)
+
+def releaseMat ( A, PE=0):
+    _gemxManager.releaseMat(A, PE)
+
+def setMatCacheSize ( nbytes, PE=0):
+    _gemxManager.setMatCacheSize(nbytes, PE)
+
+def matCacheStats ( PE=0):
+    return _gemxManager.matCacheStats(PE)
+
+def estimateGEMMOp ( m, k, n, clock_mhz=250):
+    return _gemxManager.estimateGEMMOp(m, k, n, clock_mhz)
+
+def estimateFCNOp ( m, k, n, clock_mhz=250):
+    return _gemxManager.estimateFCNOp(m, k, n, clock_mhz)
+
+def estimateGEMVOp ( m, k, clock_mhz=250):
+    return _gemxManager.estimateGEMVOp(m, k, clock_mhz)
+
+def estimateTRANSPOp ( rows, cols, clock_mhz=250):
+    return _gemxManager.estimateTRANSPOp(rows, cols, clock_mhz)
+
+def estimateSPMVOp ( row, col, m, k, nnz, clock_mhz=250):
+    return _gemxManager.estimateSPMVOp(row, col, m, k, nnz, clock_mhz)
+
+def estimateUSPMVOp ( ms, ks, nnzs, numRuns, clock_mhz=250):
+    return _gemxManager.estimateUSPMVOp(ms, ks, nnzs, numRuns, clock_mhz)
     
 def sendSpMat (row,col,data, m, k, nnz, xclbin_opts, PE=0):
     return _gemxManager.sendSpMat(row,col,data, m, k, nnz, xclbin_opts, PE)
@@ -594,14 +1161,32 @@ def sendSpMat (row,col,data, m, k, nnz, xclbin_opts, PE=0):
 def sendUSpMat(rows,cols,datas, ms, ks, nnzs,pRelus, xclbin_opts,PE=0): 
     return _gemxManager.sendUSpMat(rows,cols,datas, ms, ks, nnzs, pRelus,xclbin_opts,PE)
 
+def writeSpImage (fileName, row, col, data, m, k, nnz, xclbin_opts):
+    return _gemxManager.writeSpImage(fileName, row, col, data, m, k, nnz, xclbin_opts)
+
+def sendSpImage (fileName, xclbin_opts, PE=0):
+    return _gemxManager.sendSpImage(fileName, xclbin_opts, PE)
+
+def writeUSpImage (fileName, rows, cols, datas, ms, ks, nnzs, pRelus, xclbin_opts):
+    return _gemxManager.writeUSpImage(fileName, rows, cols, datas, ms, ks, nnzs, pRelus, xclbin_opts)
+
+def sendUSpImage (fileName, xclbin_opts, PE=0):
+    return _gemxManager.sendUSpImage(fileName, xclbin_opts, PE)
+
+def freeSpImage (A, PE=0):
+    return _gemxManager.freeSpImage(A, PE)
+
 def getMat (A, PE=0, sync_get = True):
     return _gemxManager.getMat(A, PE,sync_get)
     
-def addFCNOp( A,B,C, bias, postScale, postShift, PReLUScale, PReLUAlpha,PE=0):
-    _gemxManager.addFCNOp(A, B, C, bias, postScale, postShift, PReLUScale, PReLUAlpha, PE)
+def addFCNOp( A,B,C, bias, postScale, postShift, PReLUScale, PReLUAlpha,PE=0, transA=False, transB=False, transC=False):
+    _gemxManager.addFCNOp(A, B, C, bias, postScale, postShift, PReLUScale, PReLUAlpha, PE, transA, transB, transC)
     
-def addGEMMOp( A,B,C, bias, postScale, postShift,PE=0):
-    _gemxManager.addGEMMOp(A, B, C, bias, postScale, postShift, PE)
+def addGEMMOp( A,B,C, bias, postScale, postShift,PE=0, transA=False, transB=False, transC=False):
+    _gemxManager.addGEMMOp(A, B, C, bias, postScale, postShift, PE, transA, transB, transC)
+
+def gemmAuto( A,B,C, bias, postScale=1, postShift=0):
+    return _gemxManager.gemmAuto(A, B, C, bias, postScale, postShift)
 
 def addSPMVOp( A,B,C,nnz,xclbin_opts,relu=False, PE=0):
     _gemxManager.addSPMVOp(A,B,C,nnz,xclbin_opts,relu,PE)
@@ -611,6 +1196,9 @@ def addUSPMVOp(A,B,C,numRuns, PE=0):
 
 def execute(PE=0, sync_exec = True):
     _gemxManager.execute( PE, sync_exec)
+
+def executeCpuImage(image):
+    _gemxManager.executeCpuImage(image)
     
 def wait(PE=0):
     _gemxManager.wait(PE)    
@@ -680,7 +1268,7 @@ def printStats():
   return _gemxManager.printStats()
   
 def create_fpga_buf ( shape, np_type , PE=0):
-    a = np.zeros ( shape, dtype=np_type, order='C')
+    a = _gemxManager.allocMat ( shape, np_type, PE)
     _gemxManager.sendMat(a, PE)
     return a
 
@@ -61,10 +61,17 @@ class GemxRT():
       else:
           self._qw = [np.int16(np.around(a*b)) for a,b in zip(wgt, wgt_scale)]
           self._qb = [np.int32(np.around(a*b)) for a,b in zip(bias, bias_scale)]
+      # xclbins built with GEMX_gemmTrans read the weights as stored (in x out),
+      # older ones need them transposed on the host
+      self.trans_wgt = xclbin_opts.get("GEMX_gemmTrans", "0") == "1"
       for i,b in enumerate(self._qw):
-          b = np.transpose(b)
-          self._qw[i] = self.format_for_fpga( b, self.min_m, self.min_k)
-          gemx.sendMat(self._qw[i])
+          if self.trans_wgt:
+              shape = self.get_padded_shape(b.shape, self.min_k, self.min_m)
+          else:
+              b = np.transpose(b)
+              shape = self.get_padded_shape(b.shape, self.min_m, self.min_k)
+          # padded (and transposed) by the packing copy, models sharing these weights reuse the device copy
+          self._qw[i] = gemx.sendStridedMat( b, shape, cached=True)
           
       #in_row, in_col = self.get_padded_shape(in_dim, self.min_m, self.min_k)
       self.fpga_buf = []
@@ -72,7 +79,20 @@ class GemxRT():
       self.post_scale = post_scale
       self.relu_scale = relu_scale
       self.batch_sz = 0
+      self._graph = None
         
+    def release(self):
+      """
+      unload the model: drop its references to the device matrix cache, the
+      weights stay cached for other models until evicted
+      """
+      if self._graph is not None:
+          if self._graph >= 0:
+              gemx.freeGraph(self._graph)
+          self._graph = None
+      for w in self._qw:
+          gemx.releaseMat(w)
+
     def get_padded_shape ( self, shape, min_row, min_col):
       """
       return padded sizes for row and col
@@ -114,7 +134,7 @@ class GemxRT():
                padded numpy array
       """      
       row_padded, col_padded = self.get_padded_shape ( nparr.shape, min_row, min_col)
-      padded_arr = np.zeros ( (row_padded, col_padded), dtype=nparr.dtype, order='C')
+      padded_arr = gemx.allocMat ( (row_padded, col_padded), nparr.dtype)
       padded_arr[0:nparr.shape[0], 0:nparr.shape[1]] = nparr
       return padded_arr            
     
@@ -122,14 +142,20 @@ class GemxRT():
       if b.ndim == 1:
           b = np.broadcast_to(b, (dim[1],dim[0]) )
       
+      # views only, sendStridedMat packs the transposed and broadcast bias directly
       b = np.transpose(b)
-      b = self.format_for_fpga( b, min_row, min_col)
-      gemx.sendMat(b)    
-      return b
+      return gemx.sendStridedMat( b, self.get_padded_shape(b.shape, min_row, min_col))
     
     def init_fpgabuf (self, in_shape ):  
       if self.batch_sz != in_shape[0]:
           self.batch_sz = in_shape[0]
+          # the captured instructions point at the old buffers
+          if self._graph is not None:
+              if self._graph >= 0:
+                  gemx.freeGraph(self._graph)
+              self._graph = None
+          for buf in self.fpga_buf:
+              gemx.freeMat(buf)
           fpga_buf = []
           buf_dim = [in_shape]
       
@@ -144,8 +170,13 @@ class GemxRT():
           
           self.fpga_buf = fpga_buf
           
+          if not hasattr(self, '_qb_raw'):
+              self._qb_raw = self._qb
+          else:
+              for b in self._qb:
+                  gemx.freeMat(b)
           formatted_bias = []
-          for dim,b  in zip (buf_dim[1:], self._qb):
+          for dim,b  in zip (buf_dim[1:], self._qb_raw):
               b = self.format_bias (b, dim, self.min_m, self.min_n)
               formatted_bias.append(b)   
           
@@ -154,7 +185,7 @@ class GemxRT():
     def loadInstr(self):
       gemx.clearInstrBuf()
       for i,(w_i,b_i) in enumerate( zip( self._qw, self._qb) ):
-          gemx.addGEMMOp( w_i , self.fpga_buf[i], self.fpga_buf[i+1], b_i, self.post_scale[i][0], self.post_scale[i][1])
+          gemx.addGEMMOp( w_i , self.fpga_buf[i], self.fpga_buf[i+1], b_i, self.post_scale[i][0], self.post_scale[i][1], transA=self.trans_wgt)
             
     def predict ( self, inp, in_scale, xclbin_opts):
       """
@@ -172,17 +203,24 @@ class GemxRT():
                result prediction matrix
       
       """
+      if xclbin_opts["GEMX_dataType"] == "float":
+        inp = inp.astype(self._qw[0].dtype, copy=False)
+      else:
+        inp = np.int16(np.around(inp * in_scale))
       inp=np.transpose(inp)
       self.init_fpgabuf(inp.shape)
-      self.loadInstr()
-      if xclbin_opts["GEMX_dataType"] == "float":
-        padded_arr = self.format_for_fpga(inp, self.min_k, self.min_n)
-        np.copyto(self.fpga_buf[0],  padded_arr, casting='same_kind', where=True)
+      # the instructions are recorded once per batch size and replayed with a single launch
+      if self._graph is None:
+          gemx.beginCapture()
+          self.loadInstr()
+          self._graph = gemx.endCapture()
+      # the transposed input is packed straight into fpga_buf[0] and sent
+      gemx.sendStridedMat(inp, self.fpga_buf[0].shape, dst=self.fpga_buf[0])
+      if self._graph >= 0:
+          gemx.replay(self._graph)
       else:
-        padded_arr = self.format_for_fpga(inp * in_scale, self.min_k, self.min_n)
-        np.copyto(self.fpga_buf[0],  np.int16(np.around(padded_arr)), casting='same_kind', where=True)
-      gemx.sendMat(self.fpga_buf[0])
-      gemx.execute()
+          self.loadInstr()
+          gemx.execute()
       gemx.getMat (self.fpga_buf[-1])
       return np.transpose(self.fpga_buf[-1][:self.out_dim[0],:self.out_dim[1]])                
     
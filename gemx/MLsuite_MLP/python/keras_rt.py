@@ -46,11 +46,11 @@ class KerasRT(GemxRT):
           act = l.get_config()['activation']
           if self._qw[0].dtype == np.float32:
             if act == 'relu':
-              gemx.addFCNOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], 1, 0, 0, 0)
+              gemx.addFCNOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], 1, 0, 0, 0, transA=self.trans_wgt)
             else:
-              gemx.addGEMMOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], 1, 0)            
+              gemx.addGEMMOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], 1, 0, transA=self.trans_wgt)            
           else:
             if act == 'relu':
-              gemx.addFCNOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], self.post_scale[i][0], self.post_scale[i][1], 0, 0)
+              gemx.addFCNOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], self.post_scale[i][0], self.post_scale[i][1], 0, 0, transA=self.trans_wgt)
             else:
-              gemx.addGEMMOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], self.post_scale[i][0], self.post_scale[i][1])
+              gemx.addGEMMOp( self._qw[i], self.fpga_buf[i], self.fpga_buf[i+1], self._qb[i], self.post_scale[i][0], self.post_scale[i][1], transA=self.trans_wgt)
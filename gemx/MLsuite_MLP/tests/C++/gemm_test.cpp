@@ -23,7 +23,7 @@
 // Prerequisites:
 //  - Compiled GEMX engine to bitstream accelerator kernel gemx.xclbin file
 // Example command for Compiling this application:
-// g++ -g -O0 -std=c++11 -D FLOW_HLS_CSIM -I ./C++/src/ -D GEMX_dataType=short -D GEMX_ddrWidth=32 -D GEMX_gemmMBlocks=4 -D GEMX_gemmKBlocks=4 -D GEMX_gemmNBlocks=4 -I$XILINX_XRT/include -L$XILINX_XRT/lib  -lz -lxilinxopencl -lstdc++ -lrt -pthread -Wl,--rpath=$XILINX_XRT/lib tests/C++/gemm_test.cpp C++/src/xcl2/xcl2.cpp -o ./gemm_test.exe -lxilinxopencl 2>&1 | tee log
+// g++ -g -O0 -std=c++11 -D FLOW_HLS_CSIM -I ./C++/src/ -I ../src/host -D GEMX_dataType=short -D GEMX_ddrWidth=32 -D GEMX_gemmMBlocks=4 -D GEMX_gemmKBlocks=4 -D GEMX_gemmNBlocks=4 -I$XILINX_XRT/include -L$XILINX_XRT/lib  -lz -lxilinxopencl -lstdc++ -lrt -pthread -Wl,--rpath=$XILINX_XRT/lib tests/C++/gemm_test.cpp C++/src/xcl2/xcl2.cpp -o ./gemm_test.exe -lxilinxopencl 2>&1 | tee log
 // Example command for running this application
 // ./gemm_test.exe ../out_sw_emu/gemx.xclbin 2097152 128 128 128 128 128 128 128 1 0 A05 B05 C05 X05
 
@@ -16,7 +16,7 @@
 
 
 // Example command for Compiling this application:
-//g++ -g -O0 -std=c++11 -D FLOW_HLS_CSIM -I ./C++/src/ -D GEMX_dataType=float -D GEMX_ddrWidth=16 -D GEMX_spmvWidth=8 -D  GEMX_spmvMacGroups=12 -D GEMX_spmvNumCblocks=1024 -D GEMX_spmvColAddIdxBits=2 -D GEMX_spmvkVectorBlocks=2048 -D GEMX_runSpmv=1 -I$XILINX_XRT/include -L$XILINX_XRT/lib -lboost_iostreams -lz -lxilinxopencl -lstdc++ -lrt -pthread -Wl,--rpath=$XILINX_XRT/lib tests/C++/spmv_test.cpp C++/src/xcl2/xcl2.cpp -o ./spmv_test.exe -lxilinxopencl
+//g++ -g -O0 -std=c++11 -D FLOW_HLS_CSIM -I ./C++/src/ -I ../src/host -D GEMX_dataType=float -D GEMX_ddrWidth=16 -D GEMX_spmvWidth=8 -D  GEMX_spmvMacGroups=12 -D GEMX_spmvNumCblocks=1024 -D GEMX_spmvColAddIdxBits=2 -D GEMX_spmvkVectorBlocks=2048 -D GEMX_runSpmv=1 -I$XILINX_XRT/include -L$XILINX_XRT/lib -lboost_iostreams -lz -lxilinxopencl -lstdc++ -lrt -pthread -Wl,--rpath=$XILINX_XRT/lib tests/C++/spmv_test.cpp C++/src/xcl2/xcl2.cpp -o ./spmv_test.exe -lxilinxopencl
 
 #include <stdio.h>
 #include <string>
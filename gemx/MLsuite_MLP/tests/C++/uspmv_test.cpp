@@ -15,7 +15,7 @@
  * **********/
 
 // Example command for Compiling this application:
-//g++ -g -O0 -std=c++11 -D FLOW_HLS_CSIM -I ./C++/src/ -D GEMX_dataType=float -D GEMX_ddrWidth=16 -D GEMX_uspmvStages=1 -D GEMX_uspmvInterleaves=8 -D GEMX_uspmvNnzVectorBlocks=62500 -D GEMX_uspmvMvectorBlocks=152 -D GEMX_runUspmv=1 -I$XILINX_XRT/include -L$XILINX_XRT/lib -lboost_iostreams -lz -lxilinxopencl -lstdc++ -lrt -pthread -Wl,--rpath=$XILINX_XRT/lib tests/C++/uspmv_test.cpp C++/src/xcl2/xcl2.cpp -o ./uspmv_test.exe -lxilinxopencl
+//g++ -g -O0 -std=c++11 -D FLOW_HLS_CSIM -I ./C++/src/ -I ../src/host -D GEMX_dataType=float -D GEMX_ddrWidth=16 -D GEMX_uspmvStages=1 -D GEMX_uspmvInterleaves=8 -D GEMX_uspmvNnzVectorBlocks=62500 -D GEMX_uspmvMvectorBlocks=152 -D GEMX_runUspmv=1 -I$XILINX_XRT/include -L$XILINX_XRT/lib -lboost_iostreams -lz -lxilinxopencl -lstdc++ -lrt -pthread -Wl,--rpath=$XILINX_XRT/lib tests/C++/uspmv_test.cpp C++/src/xcl2/xcl2.cpp -o ./uspmv_test.exe -lxilinxopencl
 
 #include <stdio.h>
 #include <string>
@@ -0,0 +1,128 @@
+ # Copyright 2019 Xilinx, Inc.
+ #
+ # Licensed under the Apache License, Version 2.0 (the "License");
+ # you may not use this file except in compliance with the License.
+ # You may obtain a copy of the License at
+ #
+ #     http://www.apache.org/licenses/LICENSE-2.0
+ #
+ # Unless required by applicable law or agreed to in writing, software
+ # distributed under the License is distributed on an "AS IS" BASIS,
+ # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ # See the License for the specific language governing permissions and
+ # limitations under the License.
+########################################
+########################################
+# Brief: Checks the CPU backend of libgemxhost.so against the numpy golden results of test.py
+# Usage: 
+#  export PYTHONPATH=./python  #point the PYTHONPATH to the location of gemx.py file
+#  python tests/test_cpu_backend.py --xclbin ./xclbins/u200_201830_1/gemm_short/gemx.xclbin --cfg ./xclbins/u200_201830_1/gemm_short/config_info.dat --gemxlib ./C++/lib/libgemxhost.so
+#  python tests/test_cpu_backend.py --xclbin ./xclbins/u200_201830_1/fcn_short/gemx.xclbin --cfg ./xclbins/u200_201830_1/fcn_short/config_info.dat --gemxlib ./C++/lib/libgemxhost.so
+#
+# The CPU backend only reads config_info.dat next to the xclbin path, so no xclbin or FPGA card is needed.
+# GEMM configs run GemmTest, FCN configs run FcnTest. The PReLU settings are limited to the ones the
+# golden result of test.py models exactly: PReLU scale 0 or 1 for short, ReLU only for float.
+# test_chained_pages runs a gen_bin style device image whose program spans several chained code pages.
+
+import os
+os.environ["GEMX_BACKEND"] = "cpu"
+import sys
+import numpy as np
+import gemx
+from test import GemmTest, FcnTest
+
+PAGE_SIZE = 4096
+INSTR_SIZE = 64
+
+def test_chained_pages(xclbin_opts, is_fcn, m=64, k=64, n=64):
+    # Device image in the gen_bin layout: code page 0 and its result page 1, then one
+    # code/result page pair per chained page, then the operands of every op. Each full
+    # code page ends with a control op naming the next code page.
+    num_instr = int(xclbin_opts["GEMX_numInstr"])
+    num_pages = 3
+    num_ops = num_pages * (num_instr - 1) - 2
+    if xclbin_opts["GEMX_dataType"] == "short":
+        dtype, xtype = np.int16, np.int32
+    else:
+        dtype, xtype = np.float32, np.float32
+    print ("test_chained_pages: %d ops of %d %d %d on %d code pages" % (num_ops, m, k, n, num_pages))
+    def pages(rows, cols, t):
+        return (rows * cols * np.dtype(t).itemsize + PAGE_SIZE - 1) // PAGE_SIZE
+    op_pages = pages(m, k, dtype) + pages(k, n, dtype) + pages(m, n, dtype) + pages(m, n, xtype)
+    data_page = 2 * num_pages
+    image = np.zeros((data_page + num_ops * op_pages) * PAGE_SIZE, dtype=np.uint8)
+    def mat(page, rows, cols, t):
+        return image[page * PAGE_SIZE : page * PAGE_SIZE + rows * cols * np.dtype(t).itemsize].view(t).reshape(rows, cols)
+    def instr(page, pc):
+        return image[page * PAGE_SIZE + pc * INSTR_SIZE : page * PAGE_SIZE + (pc + 1) * INSTR_SIZE]
+    ops = []
+    page = data_page
+    for i in range(num_ops):
+        code_page = 2 * (i // (num_instr - 1))
+        pc = i % (num_instr - 1)
+        offsets = []
+        for rows, cols, t in ((m, k, dtype), (k, n, dtype), (m, n, dtype), (m, n, xtype)):
+            offsets.append(page)
+            page += pages(rows, cols, t)
+        A, B, C, X = [mat(o, r, c, t) for o, (r, c, t) in zip(offsets, ((m, k, dtype), (k, n, dtype), (m, n, dtype), (m, n, xtype)))]
+        A[:] = np.random.randint(low=-8, high=8, size=A.shape)
+        B[:] = np.random.randint(low=-8, high=8, size=B.shape)
+        X[:] = np.random.randint(low=-100, high=100, size=X.shape)
+        # GemmArgs/FcnArgs: op, A, B, C, X page offsets, M, K, N, lda, ldb, ldc, ldx, post scale 1 shift 0
+        instr(code_page, pc)[:52] = np.array([8 if is_fcn else 2] + offsets + [m, k, n, k, n, n, n, 1 << 8], dtype=np.int32).view(np.uint8)
+        ops.append((A, B, C, X))
+    for p in range(num_pages):
+        control = instr(2 * p, num_instr - 1)
+        if p + 1 < num_pages:
+            control[6:10] = np.array([2 * (p + 1)], dtype=np.uint32).view(np.uint8)
+        else:
+            control[4] = 1
+    gemx.executeCpuImage(image)
+    for A, B, C, X in ops:
+        golden = np.matmul(A.astype(np.float64), B.astype(np.float64)) + X
+        if is_fcn:
+            golden = np.maximum(golden, 0)
+        if not np.array_equal(C, golden.astype(dtype)):
+            print ("not equal, number of mismatches = ", np.count_nonzero(C != golden.astype(dtype)))
+            sys.exit(1)
+    print ("Success!\n")
+
+    # a next code page outside of the image must fail instead of returning a partial result
+    instr(0, num_instr - 1)[6:10] = np.array([image.nbytes // PAGE_SIZE], dtype=np.uint32).view(np.uint8)
+    try:
+        gemx.executeCpuImage(image)
+    except RuntimeError:
+        print ("Success!\n")
+    else:
+        print ("next code page outside of the image was not reported")
+        sys.exit(1)
+
+if __name__ == '__main__':
+  np.random.seed(123)  # for reproducibility
+  args, xclbin_opts = gemx.processCommandLine()
+  if int(xclbin_opts["GEMX_runFcn"]) == 1:
+      test = FcnTest()
+      gemx.createFCNHandle(args, xclbin_opts)
+      if xclbin_opts["GEMX_dataType"] == "short":
+          for j in range(1, 3):
+              for k in range(0, 8, 3):
+                  for m, n in ([0, 0], [1, 0], [1, 2]):
+                      test.test_basic_randint(0, xclbin_opts, [j, k], [m, n], 512)
+          test.test_basic_size(512, 512, 512, xclbin_opts)
+          test.test_basic_size(100, 300, 70, xclbin_opts)
+      else: #float, test_basic_size would compare against a golden result without ReLU
+          for i in range(4):
+              test.test_basic_randint(0, xclbin_opts, [1, 0], [0, 0], 512)
+      test_chained_pages(xclbin_opts, True)
+  else:
+      test = GemmTest()
+      gemx.createGEMMHandle(args, xclbin_opts)
+      if xclbin_opts["GEMX_dataType"] == "short":
+          for j in range(1, 3):
+              for k in range(0, 8, 3):
+                  test.test_basic_randint(0, xclbin_opts, [j, k], 512)
+      else: #float
+          test.test_basic_randint(0, xclbin_opts, [1, 0], 512)
+      test.test_basic_size(512, 512, 512, xclbin_opts)
+      test.test_basic_size(100, 300, 70, xclbin_opts)
+      test_chained_pages(xclbin_opts, False)
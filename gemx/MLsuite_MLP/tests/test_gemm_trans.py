@@ -0,0 +1,83 @@
+ # Copyright 2019 Xilinx, Inc.
+ #
+ # Licensed under the Apache License, Version 2.0 (the "License");
+ # you may not use this file except in compliance with the License.
+ # You may obtain a copy of the License at
+ #
+ #     http://www.apache.org/licenses/LICENSE-2.0
+ #
+ # Unless required by applicable law or agreed to in writing, software
+ # distributed under the License is distributed on an "AS IS" BASIS,
+ # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ # See the License for the specific language governing permissions and
+ # limitations under the License.
+########################################
+########################################
+# Brief: Checks the transA, transB and transC flags of addGEMMOp and addFCNOp against the numpy golden results of test.py
+# Usage: 
+#  export PYTHONPATH=./python  #point the PYTHONPATH to the location of gemx.py file
+#  python tests/test_gemm_trans.py --xclbin ./xclbins/u200_201830_1/gemm_short/gemx.xclbin --cfg ./xclbins/u200_201830_1/gemm_short/config_info.dat --gemxlib ./C++/lib/libgemxhost.so
+#
+# The FPGA kernel reads transposed operands only when it is built with GEMX_gemmTrans=1; with GEMX_BACKEND=cpu
+# any config can be used. A transposed operand is passed in its stored shape: A as k x m, B as n x k,
+# C and bias as n x m.
+
+import os
+import sys
+import itertools
+import numpy as np
+import gemx
+from test import GemmTest, FcnTest
+
+def stored(mat, trans):
+    return np.ascontiguousarray(mat.T) if trans else mat
+
+def test_trans(m, k, n, xclbin_opts, transA, transB, transC, post_scale=[1,0]):
+    ddrWidth = int(xclbin_opts["GEMX_ddrWidth"])
+    m = test.get_padded_size(m, int(xclbin_opts["GEMX_gemmMBlocks"]) * ddrWidth)
+    k = test.get_padded_size(k, int(xclbin_opts["GEMX_gemmKBlocks"]) * ddrWidth)
+    n = test.get_padded_size(n, int(xclbin_opts["GEMX_gemmNBlocks"]) * ddrWidth)
+    if xclbin_opts["GEMX_dataType"] == "short":
+        mat_A = test.gen_rand_matrix(np.int16, m, k)
+        mat_B = test.gen_rand_matrix(np.int16, k, n)
+        bias = test.gen_rand_matrix(np.int32, m, n)
+        dtype = np.int16
+    else: #float
+        mat_A = test.gen_rand_matrix(np.float32, m, k)
+        mat_B = test.gen_rand_matrix(np.float32, k, n)
+        bias = test.gen_rand_matrix(np.float32, m, n)
+        dtype = np.float32
+    print ("test_trans: %d %d %d transA %d transB %d transC %d" % (m, k, n, transA, transB, transC))
+    A = stored(mat_A, transA)
+    B = stored(mat_B, transB)
+    X = stored(bias, transC)
+    C = np.zeros(X.shape, dtype=dtype, order='C')
+    gemx.sendMat(A)
+    gemx.sendMat(B)
+    gemx.sendMat(C)
+    gemx.sendMat(X)
+    if isinstance(test, FcnTest):
+        gemx.addFCNOp(A, B, C, X, post_scale[0], post_scale[1], 1, 0, transA=transA, transB=transB, transC=transC)
+    else:
+        gemx.addGEMMOp(A, B, C, X, post_scale[0], post_scale[1], transA=transA, transB=transB, transC=transC)
+    gemx.execute()
+    gemx.clearInstrBuf()
+    gemx.getMat(C)
+    relu = [0,0] if isinstance(test, FcnTest) and dtype == np.float32 else [1,0]
+    test.multiply_and_cmp(stored(C, transC), mat_A, mat_B, bias, m, n, post_scale, relu)
+
+if __name__ == '__main__':
+  np.random.seed(123)  # for reproducibility
+  args, xclbin_opts = gemx.processCommandLine()
+  if xclbin_opts.get("GEMX_gemmTrans", "0") != "1" and os.environ.get("GEMX_BACKEND") != "cpu":
+      print ("the xclbin is not built with GEMX_gemmTrans=1, run with GEMX_BACKEND=cpu to check the flags on the CPU backend")
+      sys.exit(2)
+  if int(xclbin_opts["GEMX_runFcn"]) == 1:
+      test = FcnTest()
+      gemx.createFCNHandle(args, xclbin_opts)
+  else:
+      test = GemmTest()
+      gemx.createGEMMHandle(args, xclbin_opts)
+  for transA, transB, transC in itertools.product([False, True], repeat=3):
+      test_trans(256, 384, 128, xclbin_opts, transA, transB, transC)
+  test_trans(100, 300, 70, xclbin_opts, True, True, True, [3, 2])
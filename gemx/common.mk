@@ -252,6 +252,7 @@ XCLBIN = ${OUT_DIR}/gemx.xclbin
 OUT_HOST_DIR = out_host
 HOST_EXE = ${OUT_HOST_DIR}/gemx_host.exe
 GEN_BIN_EXE = ${OUT_HOST_DIR}/gemx_gen_bin.exe
+GEN_BIN_TEST_EXE = ${OUT_HOST_DIR}/gemx_gen_bin_test.exe
 
 APP_BIN      = ${OUT_HOST_DIR}/app.bin
 APP_GOLD_BIN = ${OUT_HOST_DIR}/app_gold.bin
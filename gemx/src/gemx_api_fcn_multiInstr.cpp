@@ -63,11 +63,6 @@ int main(int argc, char **argv)
       l_instrCount = ((argc-2)/15>1)?((argc-2)/15):1; //number of instructions
     }
     
-    if(l_instrCount > 15){
-        std::cerr << "  Too many instructions at same time\n";
-        exit(2);
-    }
-
     unsigned int l_ddrW = GEMX_ddrWidth;
     unsigned int l_m[l_instrCount];
     unsigned int l_k[l_instrCount];
@@ -197,7 +192,9 @@ int main(int argc, char **argv)
 
     for (int i=0; i<GEMX_numKernels; ++i) {
         for(int j=0;j<l_instrCount;++j){ //number of instructions
-            l_op = l_kargsRes[i].load(l_program[i].getBaseResAddr(), j * l_kargsRes[i].getInstrWidth());
+            unsigned int l_resPc = 0;
+            DdrFloatType *l_resAddr = l_program[i].getInstrResAddr(j, l_resPc);
+            l_op = l_kargsRes[i].load(l_resAddr, l_resPc);
             assert(l_op == KargsType::OpResult);
             l_instrRes = l_kargsRes[i].getInstrResArgs();
             l_cycleCount = l_instrRes.getDuration();
@@ -169,15 +169,24 @@ void compareMultiInstrs(float p_TolRel, float p_TolAbs, ProgramType &p_Program0,
   bool l_compareOk = true;
   KargsType l_kargs0, l_kargs1;
   unsigned int l_pc = 0;
+  unsigned int l_codePage = GEMX_codePage;
 
   do {
-      KargsOpType l_op0 = l_kargs0.load(p_Program0.getBaseInstrAddr(), l_pc);
-      KargsOpType l_op1 = l_kargs1.load(p_Program1.getBaseInstrAddr(), l_pc);
+      unsigned int l_nextCodePage = 0;
+      KargsOpType l_op0 = l_kargs0.load(p_Program0.getInstrAddr(l_codePage), l_pc);
+      KargsOpType l_op1 = l_kargs1.load(p_Program1.getInstrAddr(l_codePage), l_pc);
       if (l_op1 == KargsType::OpResult) {
           break;
       }
       assert(l_op0 == l_op1);
       switch(l_op0) {
+          case KargsType::OpControl: {
+              // Programs longer than one code page continue on the chained page
+              ControlArgsType l_controlArgs = l_kargs0.getControlArgs();
+              l_isLastOp = l_controlArgs.getIsLastOp();
+              l_nextCodePage = l_controlArgs.getNextCodePage();
+              break;
+          }
           #if GEMX_runGemm==1
           case KargsType::OpGemm: {
               GemmArgsType l_gemmArgs = l_kargs0.getGemmArgs();
@@ -203,7 +212,12 @@ void compareMultiInstrs(float p_TolRel, float p_TolAbs, ProgramType &p_Program0,
           }                
           #endif
       }
-      l_pc += l_kargs0.getInstrWidth();
+      if (l_nextCodePage != 0) {
+          l_codePage = l_nextCodePage;
+          l_pc = 0;
+      } else {
+          l_pc += l_kargs0.getInstrWidth();
+      }
   } while(!l_isLastOp);
 
   if (!l_compareOk) {
@@ -98,19 +98,28 @@ class InstrResArgs {
 
 
 //////////////////////////// CONTROL ////////////////////////////
+/*
+ * m_NextCodePage : when non-zero, the kernel continues with the chunk of
+ *  instructions stored at that page (results go to the page after it)
+ *  instead of returning to the host. Only valid in the last slot of a chunk.
+ */
 class ControlArgs {
   public:
     bool m_IsLastOp, m_Noop;
+    unsigned int m_NextCodePage;
   public:
     ControlArgs() {}
     ControlArgs(
         bool p_IsLastOp,
-        bool p_Noop
+        bool p_Noop,
+        unsigned int p_NextCodePage = 0
       ) : m_IsLastOp(p_IsLastOp),
-          m_Noop(p_Noop)
-      {assert(m_IsLastOp || m_Noop);}
+          m_Noop(p_Noop),
+          m_NextCodePage(p_NextCodePage)
+      {assert(m_IsLastOp || m_Noop || m_NextCodePage);}
     bool getIsLastOp() { return m_IsLastOp;}
     bool getNoop() { return m_Noop;}
+    unsigned int getNextCodePage() { return m_NextCodePage;}
 };
 
 //////////////////////////// GEMV ////////////////////////////
@@ -196,6 +205,8 @@ class UspmvArgs {
  *  m_M, m_K, m_Lda : Define the size of matrices
  *  A  and B are of size a m_M x m_K matrix and X and C are : m_M x m_N
  *  GEMM operation is defined as  : C = A*B+X ;
+ *  m_TransA, m_TransB, m_TransC : A is stored as m_K x m_M, B as m_N x m_K and
+ *  X and C as m_N x m_M, each with its own leading dimension
  */
 class GemmArgs {
 
@@ -204,23 +215,27 @@ class GemmArgs {
                  m_M, m_K, m_N,
                  m_Lda, m_Ldb, m_Ldc, m_Ldx;
     int32_t      m_postScale;
+    bool         m_TransA, m_TransB, m_TransC;
   public:
     GemmArgs() {}
     GemmArgs(
         unsigned int p_Aoffset, unsigned int p_Boffset, unsigned int p_Coffset, unsigned int p_Xoffset,
         unsigned int p_M, unsigned int p_K, unsigned int p_N,
         unsigned int p_Lda, unsigned int p_Ldb, unsigned int p_Ldc, unsigned int p_Ldx,
-        int32_t p_postScale
+        int32_t p_postScale,
+        bool p_TransA = false, bool p_TransB = false, bool p_TransC = false
       ) : m_Aoffset(p_Aoffset), m_Boffset(p_Boffset),  m_Coffset(p_Coffset), m_Xoffset(p_Xoffset),
           m_M(p_M), m_K(p_K), m_N(p_N),
           m_Lda(p_Lda),  m_Ldb(p_Ldb),  m_Ldc(p_Ldc), m_Ldx(p_Ldx),
-          m_postScale(p_postScale) 
+          m_postScale(p_postScale),
+          m_TransA(p_TransA), m_TransB(p_TransB), m_TransC(p_TransC)
       {}
     void init(
         unsigned int p_Aoffset, unsigned int p_Boffset, unsigned int p_Coffset, unsigned int p_Xoffset,
         unsigned int p_M, unsigned int p_K, unsigned int p_N,
         unsigned int p_Lda, unsigned int p_Ldb, unsigned int p_Ldc, unsigned int p_Ldx,
-        int32_t p_postScale)
+        int32_t p_postScale,
+        bool p_TransA = false, bool p_TransB = false, bool p_TransC = false)
         {
           m_Aoffset=p_Aoffset;
           m_Boffset=p_Boffset;
@@ -234,6 +249,9 @@ class GemmArgs {
           m_Ldc=p_Ldc; 
           m_Ldx=p_Ldx;
           m_postScale = p_postScale;
+          m_TransA = p_TransA;
+          m_TransB = p_TransB;
+          m_TransC = p_TransC;
         }
 };
 
@@ -244,6 +262,7 @@ class GemmArgs {
  *  m_M, m_K, m_Lda : Define the size of matrices
  *  A  and B are of size a m_M x m_K matrix and X and C are : m_M x m_N
  *  FCN operation is defined as  : C = A*B+X   plus scaling and ReLU
+ *  m_TransA, m_TransB, m_TransC : operand layouts as in GemmArgs
  */
 class FcnArgs {
   public:
@@ -252,23 +271,27 @@ class FcnArgs {
                  m_Lda, m_Ldb, m_Ldc, m_Ldx;
     int32_t m_postScale;
     int16_t m_PReluVal;
+    bool m_TransA, m_TransB, m_TransC;
   public:
     FcnArgs() {}
     FcnArgs(
         unsigned int p_Aoffset, unsigned int p_Boffset, unsigned int p_Coffset, unsigned int p_Xoffset,
         unsigned int p_M, unsigned int p_K, unsigned int p_N,
         unsigned int p_Lda, unsigned int p_Ldb, unsigned int p_Ldc, unsigned int p_Ldx,
-        int32_t p_postScale, int16_t p_PReluVal
+        int32_t p_postScale, int16_t p_PReluVal,
+        bool p_TransA = false, bool p_TransB = false, bool p_TransC = false
       ) : m_Aoffset(p_Aoffset), m_Boffset(p_Boffset),  m_Coffset(p_Coffset), m_Xoffset(p_Xoffset),
           m_M(p_M), m_K(p_K), m_N(p_N),
           m_Lda(p_Lda),  m_Ldb(p_Ldb),  m_Ldc(p_Ldc), m_Ldx(p_Ldx),
-          m_postScale(p_postScale),m_PReluVal(p_PReluVal)
+          m_postScale(p_postScale),m_PReluVal(p_PReluVal),
+          m_TransA(p_TransA), m_TransB(p_TransB), m_TransC(p_TransC)
       {}
       void
       init(
         unsigned int p_Aoffset, unsigned int p_Boffset, unsigned int p_Coffset, unsigned int p_Xoffset,
         unsigned int p_M, unsigned int p_K, unsigned int p_N,
-        unsigned int p_Lda, unsigned int p_Ldb, unsigned int p_Ldc, unsigned int p_Ldx,int32_t p_postScale, int16_t p_PReluVal) {
+        unsigned int p_Lda, unsigned int p_Ldb, unsigned int p_Ldc, unsigned int p_Ldx,int32_t p_postScale, int16_t p_PReluVal,
+        bool p_TransA = false, bool p_TransB = false, bool p_TransC = false) {
           m_Aoffset=p_Aoffset;
           m_Boffset=p_Boffset;
           m_Coffset=p_Coffset;
@@ -282,6 +305,9 @@ class FcnArgs {
           m_Ldx=p_Ldx;
           m_postScale = p_postScale;
           m_PReluVal = p_PReluVal;
+          m_TransA = p_TransA;
+          m_TransB = p_TransB;
+          m_TransC = p_TransC;
       }
 };
 
@@ -552,6 +578,7 @@ class Kargs
       assert(sizeof(l_args) <=  sizeof(m_Flat) - sizeof(OpType));
       loadVal(l_args.m_IsLastOp);
       loadVal(l_args.m_Noop);
+      loadVal(l_args.m_NextCodePage);
       ControlArgs l_ret = hlsReg<ControlArgs, t_ArgPipeline>(l_args);
       return l_ret;
     }
@@ -562,6 +589,7 @@ class Kargs
       storeValConst(int(OpControl));
       storeVal(p_args.m_IsLastOp);
       storeVal(p_args.m_Noop);
+      storeVal(p_args.m_NextCodePage);
     }
 
     GemvArgs
@@ -606,6 +634,9 @@ class Kargs
       loadVal(l_args.m_Ldc);
       loadVal(l_args.m_Ldx);
       loadVal(l_args.m_postScale);
+      loadVal(l_args.m_TransA);
+      loadVal(l_args.m_TransB);
+      loadVal(l_args.m_TransC);
       GemmArgs l_ret = hlsReg<GemmArgs, t_ArgPipeline>(l_args);
       return l_ret;
     }
@@ -626,6 +657,9 @@ class Kargs
       storeVal(p_args.m_Ldc);
       storeVal(p_args.m_Ldx);
       storeVal(p_args.m_postScale);
+      storeVal(p_args.m_TransA);
+      storeVal(p_args.m_TransB);
+      storeVal(p_args.m_TransC);
     }
     
     FcnArgs
@@ -645,6 +679,9 @@ class Kargs
       loadVal(l_args.m_Ldx);
       loadVal(l_args.m_postScale);
       loadVal(l_args.m_PReluVal);
+      loadVal(l_args.m_TransA);
+      loadVal(l_args.m_TransB);
+      loadVal(l_args.m_TransC);
       FcnArgs l_ret = hlsReg<FcnArgs, t_ArgPipeline>(l_args);
       return l_ret;
     }
@@ -666,6 +703,9 @@ class Kargs
       storeVal(p_args.m_Ldx);
       storeVal(p_args.m_postScale);
       storeVal(p_args.m_PReluVal);
+      storeVal(p_args.m_TransA);
+      storeVal(p_args.m_TransB);
+      storeVal(p_args.m_TransC);
     }
 
     TranspArgs
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Result comparator for gemx_gen_bin -compare
+ *
+ *  Rows are split across threads. Each row is first reduced by a branch-free
+ *  loop (exact and mismatch counts, error sums and maxima) that the compiler
+ *  vectorizes; only rows holding inexact values get the second pass that fills
+ *  the histogram, the ULP maximum and the worst offender list.
+ */
+
+#ifndef GEMX_COMPARE_H
+#define GEMX_COMPARE_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <type_traits>
+
+#ifndef GEMX_CMP_WIDTH
+#define GEMX_CMP_WIDTH 11
+#endif
+
+// Settings shared by all DenseMat::cmp calls of a run
+struct CmpOptions
+{
+  unsigned int m_Worst;     // offenders listed per comparison
+  unsigned int m_Threads;   // 0 - hardware concurrency
+  bool m_FailFast;          // stop the run at the first failing instruction
+  CmpOptions() : m_Worst(10), m_Threads(0), m_FailFast(false) {}
+  static CmpOptions &global() {
+      static CmpOptions l_options;
+      return l_options;
+    }
+};
+
+class CmpStats
+{
+  public:
+    // Relative error bins: exact, then < 1e-8, < 1e-7, ... < 1, >= 1
+    static const unsigned int t_Bins = 11;
+    struct Offender {
+      unsigned int m_Row, m_Col;
+      double m_Ref, m_Val, m_DiffAbs, m_DiffRel;
+      uint64_t m_Ulp;
+      bool operator<(const Offender &p_B) const {return(m_DiffAbs > p_B.m_DiffAbs);}
+    };
+  public:
+    uint64_t m_Total, m_Exact, m_Mismatch;
+    double m_SumAbs, m_SumRel, m_MaxAbs, m_MaxRel;
+    uint64_t m_MaxUlp;
+    uint64_t m_Hist[t_Bins];
+    std::vector<Offender> m_Worst;   // kept as a heap, worst first after sort()
+  public:
+    CmpStats()
+      : m_Total(0), m_Exact(0), m_Mismatch(0),
+        m_SumAbs(0), m_SumRel(0), m_MaxAbs(0), m_MaxRel(0), m_MaxUlp(0) {
+        memset(m_Hist, 0, sizeof(m_Hist));
+      }
+    static unsigned int bin(double p_DiffRel) {
+        double l_edge = 1e-8;
+        unsigned int l_bin = 1;
+        while ((l_bin < t_Bins - 1) && (p_DiffRel >= l_edge)) {
+          l_edge *= 10;
+          l_bin++;
+        }
+        return(l_bin);
+      }
+    static const char *binName(unsigned int p_Bin) {
+        static const char *l_names[t_Bins] = {"exact", "<1e-8", "<1e-7", "<1e-6", "<1e-5",
+                                              "<1e-4", "<1e-3", "<1e-2", "<1e-1", "<1", ">=1"};
+        return(l_names[p_Bin]);
+      }
+    void offer(const Offender &p_Off, unsigned int p_Keep) {
+        if (p_Keep == 0) return;
+        if (m_Worst.size() < p_Keep) {
+          m_Worst.push_back(p_Off);
+          std::push_heap(m_Worst.begin(), m_Worst.end());
+        } else if (p_Off.m_DiffAbs > m_Worst.front().m_DiffAbs) {
+          std::pop_heap(m_Worst.begin(), m_Worst.end());
+          m_Worst.back() = p_Off;
+          std::push_heap(m_Worst.begin(), m_Worst.end());
+        }
+      }
+    void merge(const CmpStats &p_B, unsigned int p_Keep) {
+        m_Total += p_B.m_Total;
+        m_Exact += p_B.m_Exact;
+        m_Mismatch += p_B.m_Mismatch;
+        m_SumAbs += p_B.m_SumAbs;
+        m_SumRel += p_B.m_SumRel;
+        m_MaxAbs = std::max(m_MaxAbs, p_B.m_MaxAbs);
+        m_MaxRel = std::max(m_MaxRel, p_B.m_MaxRel);
+        m_MaxUlp = std::max(m_MaxUlp, p_B.m_MaxUlp);
+        for (unsigned int i = 0; i < t_Bins; ++i) {
+          m_Hist[i] += p_B.m_Hist[i];
+        }
+        for (const Offender &l_off : p_B.m_Worst) {
+          offer(l_off, p_Keep);
+        }
+      }
+    void
+    print(std::ostream &os) {
+        uint64_t l_withinTolerance = m_Total - m_Exact - m_Mismatch;
+        os << "  Compared " << m_Total << " values:"
+           << "  exact match " << m_Exact
+           << "  within tolerance " << l_withinTolerance
+           << "  mismatch " << m_Mismatch << "\n";
+        if (m_Total == 0) return;
+        os << "  Error:  max abs " << m_MaxAbs
+           << "  mean abs " << m_SumAbs / m_Total
+           << "  max rel " << m_MaxRel
+           << "  mean rel " << m_SumRel / m_Total
+           << "  max ulp " << m_MaxUlp << "\n";
+        os << "  Rel error histogram:";
+        for (unsigned int i = 0; i < t_Bins; ++i) {
+          if (m_Hist[i] != 0) {
+            os << "  " << binName(i) << " " << m_Hist[i];
+          }
+        }
+        os << "\n";
+        std::sort_heap(m_Worst.begin(), m_Worst.end());
+        if (!m_Worst.empty()) {
+          os << "  Worst " << m_Worst.size() << ":\n";
+        }
+        for (const Offender &l_off : m_Worst) {
+          os << "      row " << l_off.m_Row << " col " << l_off.m_Col
+             << "  ValRef " << std::left << std::setw(GEMX_CMP_WIDTH) << l_off.m_Ref
+             << " Val "     << std::left << std::setw(GEMX_CMP_WIDTH) << l_off.m_Val
+             << "  DifRel " << std::left << std::setw(GEMX_CMP_WIDTH) << l_off.m_DiffRel
+             << " DifAbs "  << std::left << std::setw(GEMX_CMP_WIDTH) << l_off.m_DiffAbs
+             << "  Ulp " << l_off.m_Ulp
+             << std::right << "\n";
+        }
+      }
+};
+
+// Distance in units in the last place; plain difference for integer types
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, uint64_t>::type
+cmpUlp(T p_A, T p_B) {
+  int64_t l_d = (int64_t)p_A - (int64_t)p_B;
+  return(l_d < 0 ? -l_d : l_d);
+}
+inline int64_t cmpOrdered(float p_V) {
+  int32_t l_i;
+  memcpy(&l_i, &p_V, sizeof(l_i));
+  return(l_i < 0 ? (int64_t)INT32_MIN - l_i : l_i);
+}
+inline int64_t cmpOrdered(double p_V) {
+  int64_t l_i;
+  memcpy(&l_i, &p_V, sizeof(l_i));
+  return(l_i < 0 ? INT64_MIN - l_i : l_i);
+}
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, uint64_t>::type
+cmpUlp(T p_A, T p_B) {
+  if (std::isnan(p_A) || std::isnan(p_B)) return(UINT64_MAX);
+  int64_t l_a = cmpOrdered(p_A), l_b = cmpOrdered(p_B);
+  return(l_a > l_b ? (uint64_t)l_a - (uint64_t)l_b : (uint64_t)l_b - (uint64_t)l_a);
+}
+
+// Compares p_Val against p_Ref, both p_Rows x p_Cols with leading dimension
+// p_Ld. A value passes when it is equal, or within p_TolRel or p_TolAbs.
+template <typename T>
+CmpStats
+cmpMat(float p_TolRel, float p_TolAbs,
+       const T *p_Ref, const T *p_Val,
+       unsigned int p_Rows, unsigned int p_Cols, unsigned int p_Ld,
+       const CmpOptions &p_Options = CmpOptions::global()) {
+  const unsigned int l_keep = p_Options.m_Worst;
+  unsigned int l_threads = p_Options.m_Threads ? p_Options.m_Threads : std::thread::hardware_concurrency();
+  l_threads = std::max(1u, std::min(l_threads, (unsigned int)(((uint64_t)p_Rows * p_Cols) >> 16) + 1));
+  l_threads = std::min(l_threads, std::max(1u, p_Rows));
+  std::vector<CmpStats> l_part(l_threads);
+
+  auto l_work = [&](unsigned int p_Id) {
+    CmpStats &l_s = l_part[p_Id];
+    uint64_t l_rowBegin = (uint64_t)p_Rows * p_Id / l_threads,
+             l_rowEnd = (uint64_t)p_Rows * (p_Id + 1) / l_threads;
+    for (uint64_t row = l_rowBegin; row < l_rowEnd; ++row) {
+      const T *l_ref = p_Ref + row * p_Ld;
+      const T *l_val = p_Val + row * p_Ld;
+      // Pass 1, vectorizable reduction
+      uint64_t l_exact = 0, l_mismatch = 0;
+      double l_sumAbs = 0, l_sumRel = 0, l_maxAbs = 0, l_maxRel = 0;
+      for (unsigned int col = 0; col < p_Cols; ++col) {
+        // Same float arithmetic as gemx::cmpVal so both agree on pass/fail
+        float l_diffAbs = std::abs(l_val[col] - l_ref[col]);
+        float l_diffRel = (l_ref[col] != 0) ? l_diffAbs / (float)std::abs(l_ref[col]) : l_diffAbs;
+        bool l_isExact = (l_ref[col] == l_val[col]);
+        bool l_ok = l_isExact || (l_diffRel <= p_TolRel) || (l_diffAbs <= p_TolAbs);
+        l_exact += l_isExact;
+        l_mismatch += !l_ok;
+        l_sumAbs += l_diffAbs;
+        l_sumRel += l_diffRel;
+        l_maxAbs = (l_diffAbs > l_maxAbs) ? l_diffAbs : l_maxAbs;
+        l_maxRel = (l_diffRel > l_maxRel) ? l_diffRel : l_maxRel;
+      }
+      l_s.m_Total += p_Cols;
+      l_s.m_Exact += l_exact;
+      l_s.m_Mismatch += l_mismatch;
+      l_s.m_SumAbs += l_sumAbs;
+      l_s.m_SumRel += l_sumRel;
+      l_s.m_MaxAbs = std::max(l_s.m_MaxAbs, l_maxAbs);
+      l_s.m_MaxRel = std::max(l_s.m_MaxRel, l_maxRel);
+      l_s.m_Hist[0] += l_exact;
+      if (l_exact == p_Cols) continue;
+      // Pass 2, inexact values only
+      for (unsigned int col = 0; col < p_Cols; ++col) {
+        if (l_ref[col] == l_val[col]) continue;
+        CmpStats::Offender l_off;
+        l_off.m_Row = row;
+        l_off.m_Col = col;
+        l_off.m_Ref = l_ref[col];
+        l_off.m_Val = l_val[col];
+        float l_diffAbs = std::abs(l_val[col] - l_ref[col]);
+        l_off.m_DiffAbs = l_diffAbs;
+        l_off.m_DiffRel = (l_ref[col] != 0) ? l_diffAbs / (float)std::abs(l_ref[col]) : l_diffAbs;
+        l_off.m_Ulp = cmpUlp<T>(l_val[col], l_ref[col]);
+        l_s.m_Hist[CmpStats::bin(l_off.m_DiffRel)]++;
+        l_s.m_MaxUlp = std::max(l_s.m_MaxUlp, l_off.m_Ulp);
+        l_s.offer(l_off, l_keep);
+      }
+    }
+  };
+
+  std::vector<std::thread> l_workers;
+  for (unsigned int i = 1; i < l_threads; ++i) {
+    l_workers.push_back(std::thread(l_work, i));
+  }
+  l_work(0);
+  for (std::thread &l_w : l_workers) {
+    l_w.join();
+  }
+  CmpStats l_stats;
+  for (const CmpStats &l_s : l_part) {
+    l_stats.merge(l_s, l_keep);
+  }
+  return(l_stats);
+}
+
+#endif
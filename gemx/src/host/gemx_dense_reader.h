@@ -0,0 +1,273 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Dense matrix file reader for NumPy .npy and raw binary files
+ *
+ *  The file is mmapped and its rows are copied, or converted when the file
+ *  type differs from the matrix type, straight into the destination buffer
+ *  by several threads. Columns between the file width and the leading
+ *  dimension are zeroed.
+ */
+
+#ifndef GEMX_DENSE_READER_H
+#define GEMX_DENSE_READER_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <type_traits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class DenseReader
+{
+  public:
+    enum ElemType {ElemInt16, ElemInt32, ElemFloat32, ElemUnknown};
+  private:
+    const char *m_Map;
+    size_t m_MapSize;
+    const char *m_Data;      // first element
+    unsigned long long m_Rows, m_Cols;
+    ElemType m_Type;
+    bool m_Fortran;
+    unsigned int m_Threads;
+  private:
+    static unsigned int
+    elemBytes(ElemType p_Type) {
+        return((p_Type == ElemInt16) ? 2 : 4);
+      }
+    static bool
+    endsWith(const std::string &p_Str, const std::string &p_End) {
+        return((p_Str.size() >= p_End.size()) &&
+               (p_Str.compare(p_Str.size() - p_End.size(), p_End.size(), p_End) == 0));
+      }
+    // Value of 'p_Key': in the header dictionary, nullptr if absent
+    static const char *
+    findKey(const std::string &p_Dict, const char *p_Key) {
+        size_t l_pos = p_Dict.find(p_Key);
+        if (l_pos == std::string::npos) return(nullptr);
+        l_pos = p_Dict.find(':', l_pos);
+        if (l_pos == std::string::npos) return(nullptr);
+        l_pos = p_Dict.find_first_not_of(" ", l_pos + 1);
+        return((l_pos == std::string::npos) ? nullptr : p_Dict.c_str() + l_pos);
+      }
+    bool
+    parseNpy(const std::string &p_FileName) {
+        static const char l_magic[] = "\x93NUMPY";
+        if ((m_MapSize < 10) || (memcmp(m_Map, l_magic, 6) != 0)) {
+          std::cerr << "ERROR: DenseReader " << p_FileName << " is not a .npy file\n";
+          return(false);
+        }
+        unsigned int l_major = (unsigned char)m_Map[6];
+        size_t l_lenBytes = (l_major == 1) ? 2 : 4;
+        size_t l_headerLen = 0;
+        for (size_t i = 0; i < l_lenBytes; ++i) {
+          l_headerLen |= (size_t)(unsigned char)m_Map[8 + i] << (8 * i);
+        }
+        size_t l_offset = 8 + l_lenBytes + l_headerLen;
+        if (l_offset > m_MapSize) {
+          std::cerr << "ERROR: DenseReader " << p_FileName << " has a truncated header\n";
+          return(false);
+        }
+        std::string l_dict(m_Map + 8 + l_lenBytes, l_headerLen);
+        const char *l_descr = findKey(l_dict, "'descr'");
+        const char *l_fortran = findKey(l_dict, "'fortran_order'");
+        const char *l_shape = findKey(l_dict, "'shape'");
+        if (!l_descr || !l_fortran || !l_shape) {
+          std::cerr << "ERROR: DenseReader " << p_FileName << " header lacks descr, fortran_order or shape\n";
+          return(false);
+        }
+        std::string l_type(l_descr, std::min<size_t>(5, strlen(l_descr)));
+        if (l_type == "'<i2'") {
+          m_Type = ElemInt16;
+        } else if (l_type == "'<i4'") {
+          m_Type = ElemInt32;
+        } else if (l_type == "'<f4'") {
+          m_Type = ElemFloat32;
+        } else {
+          std::cerr << "ERROR: DenseReader " << p_FileName << " has unsupported type " << l_type
+                    << ", expected little-endian int16, int32 or float32\n";
+          return(false);
+        }
+        m_Fortran = (strncmp(l_fortran, "True", 4) == 0);
+        std::vector<unsigned long long> l_dims;
+        const char *p = l_shape + 1;
+        while (*p && (*p != ')')) {
+          char *l_next;
+          unsigned long long l_dim = strtoull(p, &l_next, 10);
+          if (l_next == p) {
+            ++p;
+          } else {
+            l_dims.push_back(l_dim);
+            p = l_next;
+          }
+        }
+        if (l_dims.size() == 1) {
+          m_Rows = 1;
+          m_Cols = l_dims[0];
+        } else if (l_dims.size() == 2) {
+          m_Rows = l_dims[0];
+          m_Cols = l_dims[1];
+        } else {
+          std::cerr << "ERROR: DenseReader " << p_FileName << " is not 1 or 2 dimensional\n";
+          return(false);
+        }
+        m_Data = m_Map + l_offset;
+        if (m_Rows * m_Cols * elemBytes(m_Type) > m_MapSize - l_offset) {
+          std::cerr << "ERROR: DenseReader " << p_FileName << " holds fewer elements than its shape\n";
+          return(false);
+        }
+        return(true);
+      }
+    template <typename T, typename t_FileType>
+    void
+    copyRows(T *p_Dst, unsigned int p_Rows, unsigned int p_Cols, unsigned int p_Ld) {
+        const t_FileType *l_src = (const t_FileType *)m_Data;
+        auto l_work = [&](unsigned int p_Id, unsigned int p_Num) {
+          unsigned long long l_rowBegin = (unsigned long long)p_Rows * p_Id / p_Num,
+                             l_rowEnd = (unsigned long long)p_Rows * (p_Id + 1) / p_Num;
+          for (unsigned long long row = l_rowBegin; row < l_rowEnd; ++row) {
+            T *l_dst = p_Dst + row * p_Ld;
+            if (m_Fortran) {
+              for (unsigned int col = 0; col < p_Cols; ++col) {
+                l_dst[col] = static_cast<T>(l_src[col * m_Rows + row]);
+              }
+            } else if (sizeof(T) == sizeof(t_FileType) && std::is_integral<T>::value == std::is_integral<t_FileType>::value) {
+              memcpy(l_dst, l_src + row * m_Cols, sizeof(T) * p_Cols);
+            } else {
+              const t_FileType *l_row = l_src + row * m_Cols;
+              for (unsigned int col = 0; col < p_Cols; ++col) {
+                l_dst[col] = static_cast<T>(l_row[col]);
+              }
+            }
+            memset(l_dst + p_Cols, 0, sizeof(T) * (p_Ld - p_Cols));
+          }
+        };
+        unsigned int l_threads = m_Threads ? m_Threads : std::thread::hardware_concurrency();
+        l_threads = std::max(1u, std::min(l_threads, (unsigned int)(((unsigned long long)p_Rows * p_Ld) >> 18) + 1));
+        l_threads = std::min(l_threads, std::max(1u, p_Rows));
+        std::vector<std::thread> l_workers;
+        for (unsigned int i = 1; i < l_threads; ++i) {
+          l_workers.push_back(std::thread(l_work, i, l_threads));
+        }
+        l_work(0, l_threads);
+        for (std::thread &l_w : l_workers) l_w.join();
+      }
+  public:
+    DenseReader(unsigned int p_Threads = 0)
+      : m_Map(nullptr), m_MapSize(0), m_Data(nullptr), m_Rows(0), m_Cols(0),
+        m_Type(ElemUnknown), m_Fortran(false), m_Threads(p_Threads) {}
+    ~DenseReader() {
+        if (m_Map) munmap((void*)m_Map, m_MapSize);
+      }
+    DenseReader(const DenseReader&) = delete;
+    DenseReader &operator=(const DenseReader&) = delete;
+
+    // .npy and raw binary files are read by this class, others are text
+    static bool
+    isBinaryFile(const std::string &p_FileName) {
+        return(endsWith(p_FileName, ".npy") || endsWith(p_FileName, ".raw"));
+      }
+    template <typename T>
+    static ElemType
+    elemType() {
+        return(std::is_floating_point<T>::value ? ElemFloat32 : (sizeof(T) == 2 ? ElemInt16 : ElemInt32));
+      }
+
+    // Raw files hold elements of p_RawType in row major order without a header;
+    // their shape is taken from the destination
+    bool
+    open(const std::string &p_FileName, ElemType p_RawType) {
+        int l_fd = ::open(p_FileName.c_str(), O_RDONLY);
+        struct stat l_st;
+        if ((l_fd < 0) || (fstat(l_fd, &l_st) != 0) || (l_st.st_size == 0)) {
+          std::cerr << "ERROR: DenseReader failed to open file " << p_FileName << "\n";
+          if (l_fd >= 0) close(l_fd);
+          return(false);
+        }
+        m_MapSize = l_st.st_size;
+        void *l_map = mmap(nullptr, m_MapSize, PROT_READ, MAP_PRIVATE, l_fd, 0);
+        close(l_fd);
+        if (l_map == MAP_FAILED) {
+          std::cerr << "ERROR: DenseReader failed to map file " << p_FileName << "\n";
+          m_MapSize = 0;
+          return(false);
+        }
+        m_Map = (const char*)l_map;
+        madvise(l_map, m_MapSize, MADV_SEQUENTIAL);
+        if (endsWith(p_FileName, ".npy")) {
+          return(parseNpy(p_FileName));
+        }
+        m_Type = p_RawType;
+        if (m_MapSize % elemBytes(m_Type) != 0) {
+          std::cerr << "ERROR: DenseReader raw file size " << m_MapSize << " of " << p_FileName
+                    << " is not a multiple of the element size\n";
+          return(false);
+        }
+        m_Data = m_Map;
+        m_Rows = 1;
+        m_Cols = m_MapSize / elemBytes(m_Type);
+        return(true);
+      }
+
+    /*
+     * read : Copies the file into the p_Rows x p_Ld matrix at p_Dst. The file
+     * has p_Rows rows of either p_Cols or p_Ld elements, a 1-D or raw file
+     * holds them back to back.
+     */
+    template <typename T>
+    bool
+    read(T *p_Dst, unsigned int p_Rows, unsigned int p_Cols, unsigned int p_Ld) {
+        if (m_Data == nullptr) return(false);
+        unsigned long long l_elements = m_Rows * m_Cols;
+        if ((m_Rows == 1) && (p_Rows != 1)) {
+          // Flat data, the width follows from the element count
+          if (l_elements == (unsigned long long)p_Rows * p_Ld) {
+            m_Cols = p_Ld;
+          } else if (l_elements == (unsigned long long)p_Rows * p_Cols) {
+            m_Cols = p_Cols;
+          } else {
+            std::cerr << "ERROR: DenseReader file holds " << l_elements << " elements, expected "
+                      << p_Rows << "x" << p_Cols << " or " << p_Rows << "x" << p_Ld << "\n";
+            return(false);
+          }
+          m_Rows = p_Rows;
+        }
+        if ((m_Rows != p_Rows) || ((m_Cols != p_Cols) && (m_Cols != p_Ld))) {
+          std::cerr << "ERROR: DenseReader file shape " << m_Rows << "x" << m_Cols << " does not match "
+                    << p_Rows << "x" << p_Cols << " with leading dimension " << p_Ld << "\n";
+          return(false);
+        }
+        unsigned int l_cols = m_Cols;
+        switch (m_Type) {
+          case ElemInt16: copyRows<T, int16_t>(p_Dst, p_Rows, l_cols, p_Ld); break;
+          case ElemInt32: copyRows<T, int32_t>(p_Dst, p_Rows, l_cols, p_Ld); break;
+          case ElemFloat32: copyRows<T, float>(p_Dst, p_Rows, l_cols, p_Ld); break;
+          default: return(false);
+        }
+        return(true);
+      }
+};
+
+#endif
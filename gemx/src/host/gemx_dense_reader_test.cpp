@@ -0,0 +1,155 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Self checking test of DenseReader
+ *
+ *  Writes small NumPy (.npy) and raw files of int16, int32 and float32 in C and
+ *  Fortran order to a temporary directory, reads them back into a matrix with
+ *  a padded leading dimension and compares with the values written. Wrong
+ *  shapes, unsupported types and truncated files must fail.
+ *
+ *  Compile and run:
+ *    g++ -O2 -std=c++11 -I src/host src/host/gemx_dense_reader_test.cpp -pthread -o gemx_dense_reader_test.exe
+ *    ./gemx_dense_reader_test.exe
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include "gemx_dense_reader.h"
+
+static unsigned int g_Errors = 0;
+
+static void
+check(bool p_Cond, const std::string &p_What) {
+  if (!p_Cond) {
+    std::cerr << "ERROR: " << p_What << "\n";
+    g_Errors++;
+  }
+}
+
+static void
+writeFile(const std::string &p_FileName, const std::string &p_Data) {
+  std::ofstream l_of(p_FileName.c_str(), std::ios::binary);
+  l_of.write(p_Data.data(), p_Data.size());
+}
+
+// Version 1.0 .npy file, header padded to a multiple of 64 bytes
+static void
+writeNpy(const std::string &p_FileName, const std::string &p_Descr, bool p_Fortran,
+         const std::string &p_Shape, const void *p_Data, size_t p_Bytes) {
+  std::string l_dict = "{'descr': '" + p_Descr + "', 'fortran_order': " + (p_Fortran ? "True" : "False") +
+                       ", 'shape': " + p_Shape + ", }";
+  size_t l_len = l_dict.size() + 1;
+  l_len += (64 - (10 + l_len) % 64) % 64;
+  l_dict.append(l_len - l_dict.size() - 1, ' ');
+  l_dict += '\n';
+  std::string l_data("\x93NUMPY\x01\x00", 8);
+  l_data += (char)(l_len & 0xff);
+  l_data += (char)(l_len >> 8);
+  l_data += l_dict;
+  l_data.append((const char*)p_Data, p_Bytes);
+  writeFile(p_FileName, l_data);
+}
+
+static void
+testNpy(const std::string &p_Dir) {
+  const unsigned int l_rows = 37, l_cols = 21, l_ld = 32;
+  std::vector<int16_t> l_i16(l_rows * l_cols), l_i16F(l_rows * l_cols);
+  std::vector<int32_t> l_i32(l_rows * l_cols);
+  std::vector<float> l_f32(l_rows * l_cols);
+  for (unsigned int r = 0; r < l_rows; ++r) {
+    for (unsigned int c = 0; c < l_cols; ++c) {
+      int16_t l_val = (int16_t)(r * 1000 + c * 3 - 17000);
+      l_i16[r * l_cols + c] = l_val;
+      l_i16F[c * l_rows + r] = l_val;
+      l_i32[r * l_cols + c] = l_val;
+      l_f32[r * l_cols + c] = (float)l_val;
+    }
+  }
+  writeNpy(p_Dir + "/c.npy", "<i2", false, "(37, 21)", l_i16.data(), l_i16.size() * 2);
+  writeNpy(p_Dir + "/f.npy", "<i2", true, "(37, 21)", l_i16F.data(), l_i16F.size() * 2);
+  writeNpy(p_Dir + "/i.npy", "<i4", false, "(37, 21)", l_i32.data(), l_i32.size() * 4);
+  writeNpy(p_Dir + "/s.npy", "<f4", false, "(37, 21)", l_f32.data(), l_f32.size() * 4);
+  writeNpy(p_Dir + "/flat.npy", "<i2", false, "(777,)", l_i16.data(), l_i16.size() * 2);
+  writeFile(p_Dir + "/r.raw", std::string((const char*)l_i16.data(), l_i16.size() * 2));
+
+  // Destination rows are padded to l_ld; the padding must come back zeroed
+  for (const char *l_name : {"/c.npy", "/f.npy", "/i.npy", "/s.npy", "/flat.npy", "/r.raw"}) {
+    DenseReader l_reader(3);
+    std::vector<int16_t> l_dst(l_rows * l_ld, 0x5555);
+    bool l_ok = l_reader.open(p_Dir + l_name, DenseReader::elemType<int16_t>()) &&
+                l_reader.read(l_dst.data(), l_rows, l_cols, l_ld);
+    check(l_ok, std::string(l_name) + " failed to read");
+    unsigned int l_bad = 0;
+    for (unsigned int r = 0; r < l_rows; ++r) {
+      for (unsigned int c = 0; c < l_ld; ++c) {
+        int16_t l_exp = (c < l_cols) ? l_i16[r * l_cols + c] : 0;
+        l_bad += (l_dst[r * l_ld + c] != l_exp);
+      }
+    }
+    check(!l_ok || (l_bad == 0), std::string(l_name) + " has " + std::to_string(l_bad) + " wrong values");
+  }
+
+  // Files already laid out with the leading dimension are copied as is
+  std::vector<float> l_wide(l_rows * l_ld);
+  for (unsigned int i = 0; i < l_wide.size(); ++i) l_wide[i] = 0.5f * i;
+  writeNpy(p_Dir + "/w.npy", "<f4", false, "(37, 32)", l_wide.data(), l_wide.size() * 4);
+  DenseReader l_wideReader;
+  std::vector<float> l_wideDst(l_rows * l_ld);
+  check(l_wideReader.open(p_Dir + "/w.npy", DenseReader::ElemFloat32) &&
+        l_wideReader.read(l_wideDst.data(), l_rows, l_cols, l_ld) && (l_wideDst == l_wide),
+        "/w.npy with leading dimension columns differs");
+
+  std::cerr << "INFO: the next DenseReader errors are expected\n";
+  std::vector<int16_t> l_dst(l_rows * l_ld);
+  DenseReader l_shape;
+  check(!(l_shape.open(p_Dir + "/c.npy", DenseReader::ElemInt16) && l_shape.read(l_dst.data(), l_rows - 1, l_cols, l_ld)),
+        ".npy with the wrong shape is accepted");
+  writeNpy(p_Dir + "/d.npy", "<f8", false, "(2, 2)", l_f32.data(), 32);
+  DenseReader l_type;
+  check(!l_type.open(p_Dir + "/d.npy", DenseReader::ElemInt16), ".npy of float64 is accepted");
+  writeNpy(p_Dir + "/t.npy", "<i2", false, "(37, 21)", l_i16.data(), 100);
+  DenseReader l_trunc;
+  check(!l_trunc.open(p_Dir + "/t.npy", DenseReader::ElemInt16), "truncated .npy is accepted");
+  DenseReader l_missing;
+  check(!l_missing.open(p_Dir + "/none.npy", DenseReader::ElemInt16), "missing .npy file is accepted");
+}
+
+int main()
+{
+  char l_template[] = "/tmp/gemx_dense_reader_test.XXXXXX";
+  if (mkdtemp(l_template) == nullptr) {
+    std::cerr << "ERROR: failed to create a temporary directory\n";
+    return(EXIT_FAILURE);
+  }
+  std::string l_dir(l_template);
+  testNpy(l_dir);
+  std::string l_rm = "rm -rf " + l_dir;
+  if (system(l_rm.c_str()) != 0) {
+    std::cerr << "WARNING: failed to remove " << l_dir << "\n";
+  }
+  if (g_Errors != 0) {
+    std::cout << "FAIL: " << g_Errors << " DenseReader checks failed\n";
+    return(EXIT_FAILURE);
+  }
+  std::cout << "PASS: gemx_dense_reader_test\n";
+  return(EXIT_SUCCESS);
+}
@@ -48,6 +48,10 @@
 #include "gemx_gen_fcn.h"
 #endif
 
+#if GEMX_runGemm ==1 || GEMX_runFcn ==1
+#include "gemx_gen_tiler.h"
+#endif
+
 #if GEMX_runTransp ==1
 #include "gemx_gen_transp.h"
 #endif
@@ -56,15 +60,40 @@
 #include "gemx_gen_gemv.h"
 #endif
 
+// Optional trans=<letters> argument of gemm and fcn, e.g. trans=AC for
+// a transposed A and a transposed C and X
+bool parseTrans(int argc, char** argv, unsigned int &p_argIdx, bool &p_TransA, bool &p_TransB, bool &p_TransC)
+{
+  p_TransA = p_TransB = p_TransC = false;
+  if ((p_argIdx >= (unsigned int)argc) || (std::string(argv[p_argIdx]).compare(0, 6, "trans=") != 0)) {
+    return(true);
+  }
+  std::string l_flags(argv[p_argIdx++] + 6);
+  for (char l_c : l_flags) {
+    switch (l_c) {
+      case 'A': p_TransA = true; break;
+      case 'B': p_TransB = true; break;
+      case 'C': p_TransC = true; break;
+      default:
+        std::cerr << "ERROR: trans=" << l_flags << " may only name A, B and C\n";
+        return(false);
+    }
+  }
+  return(true);
+}
+
 int main(int argc, char** argv)
 {
   if (argc < 3 ){
     printf("ERROR: passed %d arguments instead of %d, exiting\n",
            argc, 3);
-    std::cout << "  Usage:\n    gemx_gen_bin.exe  <-write | -read> app.bin [op1 arg arg ...] [op2 arg arg ...] ... | -compare tol_rel tol_abs app_gold.bin app_out.bin\n"
+    std::cout << "  Usage:\n    gemx_gen_bin.exe  <-write | -read> app.bin [-plan] [op1 arg arg ...] [op2 arg arg ...] ... | -compare tol_rel tol_abs app_gold.bin app_out.bin [-worst N] [-threads N] [-failfast]\n"
               << "    Ops:\n"
               << "      gemv   M K   LdA            HandleA HandleB HandleC\n"
-              << "      gemm   M K N LdA  LdB  LdC LdX postScalVal postScaleShift HandleA HandleB HandleC HandleX\n"
+              << "      gemm   M K N LdA  LdB  LdC LdX postScalVal postScaleShift HandleA HandleB HandleC HandleX [trans=ABC]\n"
+              << "      gemm   0 0 0 insFile matAFile matBFile matXFile    (matrix files are text, .npy or .raw)\n"
+              << "      gemmauto M K N MaxK postScalVal postScaleShift HandleA HandleB HandleC HandleX\n"
+              << "      fcnauto  M K N MaxK postScalVal postScaleShift PReluScale PReluAlpha HandleA HandleB HandleC HandleX\n"
               << "      transp M N   LdIn LdOut  FormatA FormatB  HandleA HandleB\n"
               << "      spmv   M K   Nnz  mtxFile   HandleA HandleB HandleC whether_use_PRelu\n"
               << "      uspmv M0 ... Mstages-1 NNZ0 ... NNZstages-1 K0 PReLU0 ... PReLUstages-1 mtxFile0 ... mtxFile_stages-1 numRuns HandleA HandleB HandleC\n"
@@ -74,9 +103,14 @@ int main(int argc, char** argv)
               << "      gemx_gen_bin.exe -write app.bin transp  4 4 8 12 rm gvfa A0 A1  gemv 4 4 12 A0 B0 C1\n"
               << "      gemx_gen_bin.exe -write app.bin spmv 8 8 16 none A0 B0 C0 true\n"
               << "      gemx_gen_bin.exe -write app.bin uspmv 0 0 0 0 0 0 0 weight0.mtx weight1.mtx weight2.mtx 300 A B C\n"
+              << "      gemx_gen_bin.exe -write app.bin gemm 0 0 0 gemm.ins A0.npy B0.npy X0.raw\n"
+              << "      gemx_gen_bin.exe -write app.bin gemm 64 128 64 64 128 64 64 1 0 A0 B0 C0 X0 trans=AC\n"
+              << "      gemx_gen_bin.exe -write app.bin gemmauto 130 300 70 0 1 0 A0 B0 C0 X0\n"
+              << "      gemx_gen_bin.exe -write app.bin -plan gemm 64 64 64 64 64 64 64 1 0 A0 B0 C0 X0  gemm 64 64 64 64 64 64 64 1 0 C0 B1 C1 X1\n"
               << "      gemx_gen_bin.exe -read app_gold.bin\n"
               << "      gemx_gen_bin.exe -read app_gold.bin\n"
               << "      gemx_gen_bin.exe -compare 1e-3 1e-9 app_gold.bin app_out.bin\n"
+              << "      gemx_gen_bin.exe -compare 1e-3 1e-9 app_gold.bin app_out.bin -worst 20 -failfast\n"
               << "\n";
     return EXIT_FAILURE;
   }
@@ -102,6 +136,20 @@ int main(int argc, char** argv)
     l_TolAbsS >> l_TolAbs;
     l_binFile[0] = argv[4];
     l_binFile[1] = argv[5];
+    CmpOptions &l_cmpOptions = CmpOptions::global();
+    for (int i = 6; i < argc; ++i) {
+      std::string l_opt(argv[i]);
+      if ((l_opt == "-worst") && (i + 1 < argc)) {
+        l_cmpOptions.m_Worst = atoi(argv[++i]);
+      } else if ((l_opt == "-threads") && (i + 1 < argc)) {
+        l_cmpOptions.m_Threads = atoi(argv[++i]);
+      } else if (l_opt == "-failfast") {
+        l_cmpOptions.m_FailFast = true;
+      } else {
+        std::cerr << "ERROR: unknown compare option " << l_opt << "\n";
+        return EXIT_FAILURE;
+      }
+    }
     printf("GEMX:  %s %s %g %g %s %s\n",
            argv[0], l_mode.c_str(),
            l_TolRel, l_TolAbs,
@@ -139,20 +187,25 @@ int main(int argc, char** argv)
   GenUspmv<GEMX_dataType, GEMX_idxType, GEMX_uspmvStages, GEMX_ddrWidth> l_uspmv;
   #endif
   if (l_write) {
-    ProgramType l_p[2];  // 0 - no golden, 1 with golden
+    // The inputs are generated once. The image is written without the reference
+    // results, which are then computed in place and the image written again.
+    // With -plan the handle live ranges are taken from the built program, whose
+    // handles are then moved so that those of disjoint lifetimes share pages.
+    bool l_plan = (argc > 3) && (std::string(argv[3]) == "-plan");
+    unsigned int l_firstArg = l_plan ? 4 : 3;
 
-    for(unsigned int wGolden = 0; wGolden < 2; ++wGolden) {
-      
-      unsigned int l_argIdx = 3;
+    // Adds the command line ops and the closing control instructions
+    auto l_addOps = [&](ProgramType &l_p) {
+      unsigned int l_argIdx = l_firstArg;
       unsigned int l_instrCount = 0;
-      
+    
       while (l_argIdx < argc) {
         std::string l_opName(argv[l_argIdx++]);
         TimePointType l_t1 = std::chrono::high_resolution_clock::now(), l_t2;
         if (l_opName == "control") {
           bool l_isLastOp = atoi(argv[l_argIdx++]);
           bool l_noop = atoi(argv[l_argIdx++]);
-          l_control.addInstr(l_p[wGolden], l_isLastOp, l_noop);
+          l_control.addInstr(l_p, l_isLastOp, l_noop);
         } else if (l_opName == "gemv") {
           #if GEMX_runGemv ==1
           unsigned int l_m = atoi(argv[l_argIdx++]);
@@ -162,7 +215,7 @@ int main(int argc, char** argv)
           std::string l_handleB(argv[l_argIdx++]);
           std::string l_handleC(argv[l_argIdx++]);
           if (!l_gemv.check(l_m, l_k, l_lda)) exit(1);
-          l_gemv.addInstr(l_p[wGolden], l_m,  l_k, l_lda, l_handleA, l_handleB, l_handleC, wGolden);
+          l_gemv.addInstr(l_p, l_m,  l_k, l_lda, l_handleA, l_handleB, l_handleC, false);
           #else
           std::cerr << "ERROR: GEMX_runGemv ==0, gemv op is not supported.\n";
           exit (EXIT_FAILURE);
@@ -177,7 +230,7 @@ int main(int argc, char** argv)
               std::string l_matAFileName(argv[l_argIdx++]);
               std::string l_matBFileName(argv[l_argIdx++]);
               std::string l_matXFileName(argv[l_argIdx++]);
-              l_gemm.addInstrFromFiles(l_instrCount, l_p[wGolden], l_insFileName, l_matAFileName, l_matBFileName, l_matXFileName, wGolden);
+              if (!l_gemm.addInstrFromFiles(l_instrCount, l_p, l_insFileName, l_matAFileName, l_matBFileName, l_matXFileName, false)) exit(EXIT_FAILURE);
           }else{
               unsigned int l_lda = atoi(argv[l_argIdx++]);
               unsigned int l_ldb = atoi(argv[l_argIdx++]);
@@ -190,13 +243,15 @@ int main(int argc, char** argv)
               std::string l_handleB(argv[l_argIdx++]);
               std::string l_handleC(argv[l_argIdx++]);
               std::string l_handleX(argv[l_argIdx++]);
-              assert(l_lda >= l_k);
-              assert(l_ldb >= l_n);
-              assert(l_ldc >= l_n);
-              assert(l_ldx >= l_n);
-              if (!l_gemm.check(l_m, l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx)) exit(1);
-              l_gemm.addInstr(l_p[wGolden], l_m,  l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx, l_postScale,
-              l_handleA, l_handleB, l_handleC, l_handleX, wGolden);
+              bool l_transA, l_transB, l_transC;
+              if (!parseTrans(argc, argv, l_argIdx, l_transA, l_transB, l_transC)) exit(1);
+              assert(l_lda >= (l_transA ? l_m : l_k));
+              assert(l_ldb >= (l_transB ? l_k : l_n));
+              assert(l_ldc >= (l_transC ? l_m : l_n));
+              assert(l_ldx >= (l_transC ? l_m : l_n));
+              if (!l_gemm.check(l_m, l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx, l_transA, l_transB, l_transC)) exit(1);
+              l_gemm.addInstr(l_p, l_m,  l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx, l_postScale,
+              l_handleA, l_handleB, l_handleC, l_handleX, false, l_transA, l_transB, l_transC);
           }
           #else
           std::cerr << "ERROR: GEMX_runGemm ==0, gemm op is not supported.\n";
@@ -210,13 +265,13 @@ int main(int argc, char** argv)
           if ((l_m == 0) && (l_k == 0) && (l_n == 0)) {
             if(argc == 8){
               std::string l_mtxFileName(argv[l_argIdx++]);
-              l_fcn.addInstrFromFile(l_p[wGolden], l_mtxFileName, wGolden);
+              l_fcn.addInstrFromFile(l_p, l_mtxFileName, false);
             }else{
               std::string l_insFileName(argv[l_argIdx++]);
               std::string l_matAFileName(argv[l_argIdx++]);
               std::string l_matBFileName(argv[l_argIdx++]);
               std::string l_matXFileName(argv[l_argIdx++]);
-              l_fcn.addInstrFromFiles(l_instrCount, l_p[wGolden], l_insFileName, l_matAFileName, l_matBFileName, l_matXFileName, wGolden);
+              if (!l_fcn.addInstrFromFiles(l_instrCount, l_p, l_insFileName, l_matAFileName, l_matBFileName, l_matXFileName, false)) exit(EXIT_FAILURE);
             }
           }else {
           unsigned int l_lda = atoi(argv[l_argIdx++]);
@@ -233,18 +288,92 @@ int main(int argc, char** argv)
           std::string l_handleB(argv[l_argIdx++]);
           std::string l_handleC(argv[l_argIdx++]);
           std::string l_handleX(argv[l_argIdx++]);
-          assert(l_lda >= l_k);
-          assert(l_ldb >= l_n);
-          assert(l_ldc >= l_n);
-          assert(l_ldx >= l_n);
-          if (!l_fcn.check(l_m, l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx)) exit(1);
-          l_fcn.addInstr(l_p[wGolden], l_m,  l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx, l_postScale, l_PReluVal,
-                         l_handleA, l_handleB, l_handleC, l_handleX,  wGolden);          
+          bool l_transA, l_transB, l_transC;
+          if (!parseTrans(argc, argv, l_argIdx, l_transA, l_transB, l_transC)) exit(1);
+          assert(l_lda >= (l_transA ? l_m : l_k));
+          assert(l_ldb >= (l_transB ? l_k : l_n));
+          assert(l_ldc >= (l_transC ? l_m : l_n));
+          assert(l_ldx >= (l_transC ? l_m : l_n));
+          if (!l_fcn.check(l_m, l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx, l_transA, l_transB, l_transC)) exit(1);
+          l_fcn.addInstr(l_p, l_m,  l_k, l_n, l_lda, l_ldb, l_ldc, l_ldx, l_postScale, l_PReluVal,
+                         l_handleA, l_handleB, l_handleC, l_handleX, false, l_transA, l_transB, l_transC);          
           } 
           #else
           std::cerr << "ERROR: GEMX_runFcn ==0, fcn op is not supported.\n";
           exit (EXIT_FAILURE);
           #endif
+        } else if (l_opName == "gemmauto") {
+          #if GEMX_runGemm ==1
+          unsigned int l_m = atoi(argv[l_argIdx++]);
+          unsigned int l_k = atoi(argv[l_argIdx++]);
+          unsigned int l_n = atoi(argv[l_argIdx++]);
+          unsigned int l_maxK = atoi(argv[l_argIdx++]);
+          int32_t l_postScaleVal = atoi(argv[l_argIdx++]);
+          int32_t l_postScaleShift = atoi(argv[l_argIdx++]);
+          int32_t l_postScale = (l_postScaleVal << 8) | (l_postScaleShift & 0x000000ff);
+          std::string l_handleA(argv[l_argIdx++]);
+          std::string l_handleB(argv[l_argIdx++]);
+          std::string l_handleC(argv[l_argIdx++]);
+          std::string l_handleX(argv[l_argIdx++]);
+          // Partial sums are exact only when C can be read back as X and the
+          // last chunk does not scale them, the kernel keeps t_FloatBits of each
+          bool l_canSplitK = (sizeof(GEMX_XdataType) == sizeof(GEMX_dataType)) && (l_postScale == (1 << 8));
+          GemmTiler l_tiler;
+          if (!l_tiler.plan(l_m, l_k, l_n, l_maxK, l_canSplitK)) exit(1);
+          l_tiler.report(std::cout);
+          bool l_ok = l_tiler.lower(l_p, l_handleA, l_handleB, l_handleC, l_handleX,
+            [&](unsigned int p_M, unsigned int p_K, unsigned int p_N, unsigned int p_LdA, unsigned int p_LdB,
+                std::string p_HandleA, std::string p_HandleB, std::string p_HandleC, std::string p_HandleX,
+                bool p_Last) {
+              l_gemm.addInstr(l_p, p_M, p_K, p_N, p_LdA, p_LdB, p_N, p_N, p_Last ? l_postScale : (1 << 8),
+                              p_HandleA, p_HandleB, p_HandleC, p_HandleX, false);
+              std::cout << "\n";
+            });
+          if (!l_ok) exit(1);
+          #else
+          std::cerr << "ERROR: GEMX_runGemm ==0, gemmauto op is not supported.\n";
+          exit (EXIT_FAILURE);
+          #endif
+        } else if (l_opName == "fcnauto") {
+          #if GEMX_runFcn==1
+          unsigned int l_m = atoi(argv[l_argIdx++]);
+          unsigned int l_k = atoi(argv[l_argIdx++]);
+          unsigned int l_n = atoi(argv[l_argIdx++]);
+          unsigned int l_maxK = atoi(argv[l_argIdx++]);
+          int32_t l_postScaleVal = atoi(argv[l_argIdx++]);
+          int32_t l_postScaleShift = atoi(argv[l_argIdx++]);
+          int32_t l_postScale = (l_postScaleVal << 8) | (l_postScaleShift & 0x000000ff);
+          int16_t l_PReluScale = atoi(argv[l_argIdx++]);
+          int16_t l_PReluAlpha = atoi(argv[l_argIdx++]);
+          int16_t l_PReluVal = (l_PReluScale << 6) | (l_PReluAlpha & 0x003f);
+          std::string l_handleA(argv[l_argIdx++]);
+          std::string l_handleB(argv[l_argIdx++]);
+          std::string l_handleC(argv[l_argIdx++]);
+          std::string l_handleX(argv[l_argIdx++]);
+          // Without GEMX_keepMacBits the kernel applies ReLU to every instruction
+          #if GEMX_keepMacBits
+          bool l_canSplitK = (sizeof(GEMX_XdataType) == sizeof(GEMX_dataType)) &&
+                             (l_postScale == (1 << 8)) && (l_PReluVal == (int16_t)(1 << 6));
+          #else
+          bool l_canSplitK = false;
+          #endif
+          GemmTiler l_tiler;
+          if (!l_tiler.plan(l_m, l_k, l_n, l_maxK, l_canSplitK)) exit(1);
+          l_tiler.report(std::cout);
+          bool l_ok = l_tiler.lower(l_p, l_handleA, l_handleB, l_handleC, l_handleX,
+            [&](unsigned int p_M, unsigned int p_K, unsigned int p_N, unsigned int p_LdA, unsigned int p_LdB,
+                std::string p_HandleA, std::string p_HandleB, std::string p_HandleC, std::string p_HandleX,
+                bool p_Last) {
+              l_fcn.addInstr(l_p, p_M, p_K, p_N, p_LdA, p_LdB, p_N, p_N,
+                             p_Last ? l_postScale : (1 << 8), p_Last ? l_PReluVal : (int16_t)(1 << 6),
+                             p_HandleA, p_HandleB, p_HandleC, p_HandleX, false);
+              std::cout << "\n";
+            });
+          if (!l_ok) exit(1);
+          #else
+          std::cerr << "ERROR: GEMX_runFcn ==0, fcnauto op is not supported.\n";
+          exit (EXIT_FAILURE);
+          #endif
         } else if (l_opName == "transp") {
           #if GEMX_runTransp ==1
           unsigned int l_m = atoi(argv[l_argIdx++]);
@@ -261,8 +390,8 @@ int main(int argc, char** argv)
           }
           assert(l_lda >= l_n);
           assert((l_ldb >= l_m) || (l_formatB == MatFormatType::GvA));
-          l_transp.addInstr(l_p[wGolden], l_m, l_n, l_lda, l_ldb, l_formatA, l_formatB,
-                            l_handleA, l_handleB, wGolden);
+          l_transp.addInstr(l_p, l_m, l_n, l_lda, l_ldb, l_formatA, l_formatB,
+                            l_handleA, l_handleB, false);
           #else
           std::cerr << "ERROR: GEMX_runTransp ==0, transp op is not supported.\n";
           exit (EXIT_FAILURE);
@@ -280,8 +409,8 @@ int main(int argc, char** argv)
           MtxFileUram l_mtxFile(l_mtxFileName);
           // check function will also rewrite l_m, l_k, l_nnz when necessary
           if (!l_spmv.check(l_m, l_k, l_nnz, l_mtxFile)) exit(1);
-          l_spmv.addInstr(l_p[wGolden], l_m,  l_k, l_nnz, l_mtxFile,
-                          l_handleA, l_handleB, l_handleC, wGolden);
+          l_spmv.addInstr(l_p, l_m,  l_k, l_nnz, l_mtxFile,
+                          l_handleA, l_handleB, l_handleC, false);
           #else
           std::string l_usePreluStr(argv[l_argIdx++]);
           bool l_usePrelu = false;
@@ -291,8 +420,8 @@ int main(int argc, char** argv)
           MtxFile l_mtxFile(l_mtxFileName);
           // check function will also rewrite l_m, l_k, l_nnz when necessary
           if (!l_spmv.check(l_m, l_k, l_nnz, l_mtxFile)) exit(1);
-          l_spmv.addInstr(l_p[wGolden], l_m,  l_k, l_nnz, l_mtxFile,
-                          l_handleA, l_handleB, l_handleC, l_usePrelu,  wGolden);
+          l_spmv.addInstr(l_p, l_m,  l_k, l_nnz, l_mtxFile,
+                          l_handleA, l_handleB, l_handleC, l_usePrelu, false);
           #endif
           #else
           std::cerr << "ERROR: GEMX_runSpmv ==0, spmv op is not supported.\n";
@@ -331,7 +460,7 @@ int main(int argc, char** argv)
           std::string l_handleB(argv[l_argIdx++]);
           std::string l_handleC(argv[l_argIdx++]);
           if (!l_uspmv.check(l_m, l_k, l_nnz, l_mtxFiles)) exit(1);
-          l_uspmv.addInstr(l_p[wGolden], l_m, l_k, l_nnz, l_pRelu, l_numRuns, l_mtxFiles, l_handleA, l_handleB, l_handleC, wGolden);
+          l_uspmv.addInstr(l_p, l_m, l_k, l_nnz, l_pRelu, l_numRuns, l_mtxFiles, l_handleA, l_handleB, l_handleC, false);
           #else
           std::cerr << "ERROR: GEMX_runUspmv==0, uspmv op is not supported.\n";
           exit (EXIT_FAILURE);
@@ -341,28 +470,218 @@ int main(int argc, char** argv)
           exit (EXIT_FAILURE);
         }
         l_instrCount++;
-        assert(l_instrCount < GEMX_numInstr - 1); // 1 is for the mandatory control instruction
         assert(l_argIdx <= argc);
-        if (wGolden) {
-          showTimeData("  " + l_opName + " with golden took ", l_t1, l_t2);
-        } else {
-          std::cout << "\n";
-        }
+        showTimeData("  " + l_opName + " took ", l_t1, l_t2);
       }
      // Fill noops (workaround for HLS issue with dataflow loops)
-      while (l_instrCount < GEMX_numInstr - 1) {
-       l_control.addInstr(l_p[wGolden], false, true);
+     // Long programs are chained across code pages by Program::addInstr, so only
+     // the last page needs padding up to the mandatory control instruction
+      while (l_p.getNumInstr() < GEMX_numInstr - 1) {
+       l_control.addInstr(l_p, false, true);
        std::cout << "\n";
        l_instrCount++;
       }
-     
-      l_control.addInstr(l_p[wGolden], true, false);
+   
+      l_control.addInstr(l_p, true, false);
       std::cout << "\n";
       l_instrCount++;
-      assert(l_instrCount == GEMX_numInstr);
-     
-      l_p[wGolden].writeToBinFile(l_binFile[wGolden]);
+      assert(l_p.getNumInstr() == GEMX_numInstr);
+    };
+
+    // Reference result tasks, ordered by the handles they touch
+    auto l_addGolden = [&](ProgramType &l_p, TaskGraph &l_golden) {
+      KargsType l_kargs;
+      unsigned int l_pc = 0;
+      unsigned int l_codePage = GEMX_codePage;
+      bool l_isLastOp = false;
+      do {
+        unsigned int l_nextCodePage = 0;
+        KargsOpType l_op = l_kargs.load(l_p.getInstrAddr(l_codePage), l_pc);
+        switch(l_op) {
+          case KargsType::OpControl: {
+            ControlArgsType l_controlArgs = l_kargs.getControlArgs();
+            l_isLastOp = l_controlArgs.getIsLastOp();
+            l_nextCodePage = l_controlArgs.getNextCodePage();
+            break;
+          }
+          #if GEMX_runGemv ==1
+          case KargsType::OpGemv: {
+            GemvArgsType l_args = l_kargs.getGemvArgs();
+            l_golden.add(l_p.getAliasPages({l_args.m_Aoffset, l_args.m_Boffset}), l_p.getAliasPages({l_args.m_Coffset}),
+                         [&l_gemv, &l_p, l_args]() {l_gemv.golden(l_p, l_args);});
+            break;
+          }
+          #endif
+          #if GEMX_runGemm ==1
+          case KargsType::OpGemm: {
+            GemmArgsType l_args = l_kargs.getGemmArgs();
+            l_golden.add(l_p.getAliasPages({l_args.m_Aoffset, l_args.m_Boffset, l_args.m_Xoffset}), l_p.getAliasPages({l_args.m_Coffset}),
+                         [&l_gemm, &l_p, l_args]() {l_gemm.golden(l_p, l_args);});
+            break;
+          }
+          #endif
+          #if GEMX_runFcn==1
+          case KargsType::OpFcn: {
+            FcnArgsType l_args = l_kargs.getFcnArgs();
+            l_golden.add(l_p.getAliasPages({l_args.m_Aoffset, l_args.m_Boffset, l_args.m_Xoffset}), l_p.getAliasPages({l_args.m_Coffset}),
+                         [&l_fcn, &l_p, l_args]() {l_fcn.golden(l_p, l_args);});
+            break;
+          }
+          #endif
+          #if GEMX_runTransp ==1
+          case KargsType::OpTransp: {
+            TranspArgsType l_args = l_kargs.getTranspArgs();
+            l_golden.add(l_p.getAliasPages({l_args.m_Src.m_Offset}), l_p.getAliasPages({l_args.m_Dst.m_Offset}),
+                         [&l_transp, &l_p, l_args]() {l_transp.golden(l_p, l_args);});
+            break;
+          }
+          #endif
+          #if GEMX_runSpmv ==1
+          case KargsType::OpSpmv: {
+            SpmvArgsType l_args = l_kargs.getSpmvArgs();
+            l_golden.add(l_p.getAliasPages({l_args.m_Aoffset, l_args.m_Boffset}), l_p.getAliasPages({l_args.m_Coffset}),
+                         [&l_spmv, &l_p, l_args]() {l_spmv.golden(l_p, l_args);});
+            break;
+          }
+          #endif
+          #if GEMX_runUspmv== 1
+          case KargsType::OpUspmv: {
+            gemx::UspmvArgs l_args = l_kargs.getUspmvArgs();
+            l_golden.add(l_p.getAliasPages({l_args.m_Aoffset, l_args.m_Boffset}), l_p.getAliasPages({l_args.m_Coffset}),
+                         [&l_uspmv, &l_p, l_args]() {l_uspmv.golden(l_p, l_args);});
+            break;
+          }
+          #endif
+          default: {
+            assert(false);
+          }
+        }
+        if (l_nextCodePage != 0) {
+          l_codePage = l_nextCodePage;
+          l_pc = 0;
+        } else {
+          l_pc += l_kargs.getInstrWidth();
+        }
+      } while(!l_isLastOp);
+    };
+
+    // Rewrites the operand offsets and code page links after the handles have moved
+    auto l_relocate = [&](ProgramType &l_p, const std::map<unsigned int, unsigned int> &l_map) {
+      KargsType l_kargs;
+      unsigned int l_pc = 0;
+      unsigned int l_codePage = GEMX_codePage;
+      bool l_isLastOp = false;
+      do {
+        unsigned int l_nextCodePage = 0;
+        KargsOpType l_op = l_kargs.load(l_p.getInstrAddr(l_codePage), l_pc);
+        switch(l_op) {
+          case KargsType::OpControl: {
+            ControlArgsType l_controlArgs = l_kargs.getControlArgs();
+            l_isLastOp = l_controlArgs.getIsLastOp();
+            if (l_controlArgs.getNextCodePage() != 0) {
+              l_nextCodePage = l_map.at(l_controlArgs.getNextCodePage());
+              l_kargs.setControlArgs(ControlArgsType(l_isLastOp, l_controlArgs.getNoop(), l_nextCodePage));
+            }
+            break;
+          }
+          #if GEMX_runGemv ==1
+          case KargsType::OpGemv: {
+            GemvArgsType l_args = l_kargs.getGemvArgs();
+            l_args.m_Aoffset = l_map.at(l_args.m_Aoffset);
+            l_args.m_Boffset = l_map.at(l_args.m_Boffset);
+            l_args.m_Coffset = l_map.at(l_args.m_Coffset);
+            l_kargs.setGemvArgs(l_args);
+            break;
+          }
+          #endif
+          #if GEMX_runGemm ==1
+          case KargsType::OpGemm: {
+            GemmArgsType l_args = l_kargs.getGemmArgs();
+            l_args.m_Aoffset = l_map.at(l_args.m_Aoffset);
+            l_args.m_Boffset = l_map.at(l_args.m_Boffset);
+            l_args.m_Coffset = l_map.at(l_args.m_Coffset);
+            l_args.m_Xoffset = l_map.at(l_args.m_Xoffset);
+            l_kargs.setGemmArgs(l_args);
+            break;
+          }
+          #endif
+          #if GEMX_runFcn==1
+          case KargsType::OpFcn: {
+            FcnArgsType l_args = l_kargs.getFcnArgs();
+            l_args.m_Aoffset = l_map.at(l_args.m_Aoffset);
+            l_args.m_Boffset = l_map.at(l_args.m_Boffset);
+            l_args.m_Coffset = l_map.at(l_args.m_Coffset);
+            l_args.m_Xoffset = l_map.at(l_args.m_Xoffset);
+            l_kargs.setFcnArgs(l_args);
+            break;
+          }
+          #endif
+          #if GEMX_runTransp ==1
+          case KargsType::OpTransp: {
+            TranspArgsType l_args = l_kargs.getTranspArgs();
+            l_args.m_Src.m_Offset = l_map.at(l_args.m_Src.m_Offset);
+            l_args.m_Dst.m_Offset = l_map.at(l_args.m_Dst.m_Offset);
+            l_kargs.setTranspArgs(l_args);
+            break;
+          }
+          #endif
+          #if GEMX_runSpmv ==1
+          case KargsType::OpSpmv: {
+            SpmvArgsType l_args = l_kargs.getSpmvArgs();
+            l_args.m_Aoffset = l_map.at(l_args.m_Aoffset);
+            l_args.m_Boffset = l_map.at(l_args.m_Boffset);
+            l_args.m_Coffset = l_map.at(l_args.m_Coffset);
+            l_kargs.setSpmvArgs(l_args);
+            break;
+          }
+          #endif
+          #if GEMX_runUspmv== 1
+          case KargsType::OpUspmv: {
+            gemx::UspmvArgs l_args = l_kargs.getUspmvArgs();
+            l_args.m_Aoffset = l_map.at(l_args.m_Aoffset);
+            l_args.m_Boffset = l_map.at(l_args.m_Boffset);
+            l_args.m_Coffset = l_map.at(l_args.m_Coffset);
+            l_kargs.setUspmvArgs(l_args);
+            break;
+          }
+          #endif
+          default: {
+            assert(false);
+          }
+        }
+        l_kargs.store(l_p.getInstrAddr(l_codePage), l_pc);
+        if (l_nextCodePage != 0) {
+          l_codePage = l_nextCodePage;
+          l_pc = 0;
+        } else {
+          l_pc += l_kargs.getInstrWidth();
+        }
+      } while(!l_isLastOp);
+    };
+
+    // Inputs are generated once; with -plan the same program is then relocated
+    ProgramType l_p;
+    l_addOps(l_p);
+    if (l_plan) {
+      std::cout << "INFO: planning device memory\n";
+      TaskGraph l_graph;
+      l_addGolden(l_p, l_graph);
+      MemPlanner l_memPlan(l_p.getHandles());
+      for (unsigned int i = 0; i < l_graph.size(); ++i) {
+        l_memPlan.add(l_graph.getReads(i), l_graph.getWrites(i));
+      }
+      l_memPlan.plan();
+      l_relocate(l_p, l_p.applyMemPlan(l_memPlan));
     }
+    l_p.writeToBinFile(l_binFile[0]);
+
+    // Reference results, independent instructions in parallel
+    TimePointType l_t1 = std::chrono::high_resolution_clock::now(), l_t2;
+    TaskGraph l_golden;
+    l_addGolden(l_p, l_golden);
+    l_golden.run();
+    showTimeData("  golden took ", l_t1, l_t2);
+    l_p.writeToBinFile(l_binFile[1]);
 
   } else if (l_read) {
     
@@ -379,38 +698,51 @@ int main(int argc, char** argv)
               << std::right << std::setw(12) << "duration"
               << std::right << std::setw(14) << "ms@250MHz"
               << "\n";
-    for (unsigned int l_pc = 0; l_pc < GEMX_numInstr; ++l_pc) {
-      KargsOpType l_op = l_kargsRes.load(l_p.getBaseResAddr(), l_pc * l_kargsRes.getInstrWidth());
-      assert(l_op == KargsType::OpResult || l_op == KargsType::OpControl); // OpControl is 0 which is ok
-      gemx::InstrResArgs l_instrRes = l_kargsRes.getInstrResArgs();
-      std::cout << "  DATA: cycles "
-                << std::setw(4) << l_pc
-                << std::setw(12) << l_instrRes.m_StartTime
-                << std::setw(12) << l_instrRes.m_EndTime
-                << std::setw(12) << l_instrRes.getDuration()
-                << std::setw(14) << std::fixed << std::setprecision(6) << (l_instrRes.getDuration() / 250e6 * 1e3)
-                << "\n";
+    std::vector<unsigned int> l_codePages = l_p.getCodePages();
+    std::vector<unsigned long long> l_measured;
+    for (unsigned int l_chunk = 0; l_chunk < l_codePages.size(); ++l_chunk) {
+      for (unsigned int l_pc = 0; l_pc < GEMX_numInstr; ++l_pc) {
+        KargsOpType l_op = l_kargsRes.load(l_p.getResAddr(l_codePages[l_chunk]), l_pc * l_kargsRes.getInstrWidth());
+        assert(l_op == KargsType::OpResult || l_op == KargsType::OpControl); // OpControl is 0 which is ok
+        gemx::InstrResArgs l_instrRes = l_kargsRes.getInstrResArgs();
+        l_measured.push_back(l_instrRes.getDuration());
+        std::cout << "  DATA: cycles "
+                  << std::setw(4) << l_chunk * GEMX_numInstr + l_pc
+                  << std::setw(12) << l_instrRes.m_StartTime
+                  << std::setw(12) << l_instrRes.m_EndTime
+                  << std::setw(12) << l_instrRes.getDuration()
+                  << std::setw(14) << std::fixed << std::setprecision(6) << (l_instrRes.getDuration() / 250e6 * 1e3)
+                  << "\n";
+    }
     }
     std::cout << "\n";
     
-    // Show all instructions
+    // Show all instructions and the cost the model predicts for them
     KargsType l_kargs;
+    gemx::perfmodel::PerfModel l_model;
+    std::vector<std::pair<unsigned int, gemx::perfmodel::Estimate> > l_estimates;
     unsigned int l_pc = 0;
+    unsigned int l_codePage = GEMX_codePage;
+    unsigned int l_chunk = 0;
     bool l_isLastOp = false;
     do {
-      KargsOpType l_op = l_kargs.load(l_p.getBaseInstrAddr(), l_pc);
+      unsigned int l_nextCodePage = 0;
+      unsigned int l_slot = l_chunk * GEMX_numInstr + l_pc / l_kargs.getInstrWidth();
+      KargsOpType l_op = l_kargs.load(l_p.getInstrAddr(l_codePage), l_pc);
       switch(l_op) {
         case KargsType::OpControl: {
           ControlArgsType l_controlArgs = l_kargs.getControlArgs();
           l_isLastOp = l_controlArgs.getIsLastOp();
           bool l_noop = l_controlArgs.getNoop();
-          assert(l_isLastOp || l_noop);
+          l_nextCodePage = l_controlArgs.getNextCodePage();
+          assert(l_isLastOp || l_noop || l_nextCodePage);
           break;
         }
         #if GEMX_runGemv ==1
         case KargsType::OpGemv: {
           GemvArgsType l_gemvArgs = l_kargs.getGemvArgs();
           l_gemv.show(l_p, l_gemvArgs);
+          l_estimates.push_back(std::make_pair(l_slot, l_model.gemv(l_gemvArgs)));
           break;
         }
         #endif
@@ -418,6 +750,7 @@ int main(int argc, char** argv)
         case KargsType::OpGemm: {
           GemmArgsType l_gemmArgs = l_kargs.getGemmArgs();
           l_gemm.show(l_p, l_gemmArgs);
+          l_estimates.push_back(std::make_pair(l_slot, l_model.gemm(l_gemmArgs)));
           break;
         }
         #endif
@@ -426,6 +759,7 @@ int main(int argc, char** argv)
         case KargsType::OpFcn: {
           FcnArgsType l_fcnArgs = l_kargs.getFcnArgs();
           l_fcn.show(l_p, l_fcnArgs);
+          l_estimates.push_back(std::make_pair(l_slot, l_model.fcn(l_fcnArgs)));
           break;
         }
         #endif
@@ -434,6 +768,7 @@ int main(int argc, char** argv)
         case KargsType::OpTransp: {
           TranspArgsType l_transpArgs = l_kargs.getTranspArgs();
           l_transp.show(l_p, l_transpArgs);
+          l_estimates.push_back(std::make_pair(l_slot, l_model.transp(l_transpArgs)));
           break;
         }
         #endif
@@ -441,6 +776,9 @@ int main(int argc, char** argv)
         case KargsType::OpSpmv: {
           SpmvArgsType l_spmvArgs = l_kargs.getSpmvArgs();
           l_spmv.show(l_p, l_spmvArgs);
+          #if !GEMX_useURAM
+          l_estimates.push_back(std::make_pair(l_slot, l_spmv.model(l_model, l_p, l_spmvArgs)));
+          #endif
           break;
         }
         #endif
@@ -448,6 +786,7 @@ int main(int argc, char** argv)
         case KargsType::OpUspmv: {
            gemx::UspmvArgs l_uspmvArgs = l_kargs.getUspmvArgs();
            l_uspmv.show(l_p, l_uspmvArgs);
+           l_estimates.push_back(std::make_pair(l_slot, l_uspmv.model(l_model, l_p, l_uspmvArgs)));
            break;
         }
         #endif
@@ -455,86 +794,227 @@ int main(int argc, char** argv)
           assert(false);
         }
       }
-      l_pc += l_kargs.getInstrWidth();
+      if (l_nextCodePage != 0) {
+        l_codePage = l_nextCodePage;
+        l_pc = 0;
+        l_chunk++;
+      } else {
+        l_pc += l_kargs.getInstrWidth();
+      }
     } while(!l_isLastOp);
+
+    std::cout << "\nINFO:   model "
+              << std::right << std::setw(4)  << "op"
+              << std::right << std::setw(12) << "cycles"
+              << std::right << std::setw(14) << "ms@250MHz"
+              << std::right << std::setw(14) << "DDR bytes"
+              << std::right << std::setw(10) << "GB/s"
+              << std::right << std::setw(10) << "GOPS"
+              << std::right << std::setw(12) << "measured"
+              << "\n";
+    gemx::perfmodel::Estimate l_total(l_model.getConfig().m_ClockMHz);
+    for (auto &l_est : l_estimates) {
+      std::cout << "  DATA: model "
+                << std::setw(4) << l_est.first
+                << l_est.second
+                << std::setw(12) << ((l_est.first < l_measured.size()) ? l_measured[l_est.first] : 0)
+                << "\n";
+      l_total += l_est.second;
+    }
+    std::cout << "  DATA: model  all" << l_total << "\n";
     
   } else if (l_compare) {
     // Read files
     ProgramType l_p[2];
     l_p[0].readFromBinFile(l_binFile[0]);
     l_p[1].readFromBinFile(l_binFile[1]);
-    
+
+    // Output page ranges of all instructions. With a -plan image, handles may share
+    // pages, so an output overwritten by a later instruction cannot be compared.
+    std::vector<std::pair<unsigned int, unsigned int> > l_outPages;
+    {
+      auto l_range = [](unsigned int p_Page, size_t p_Elements) {
+        return(std::make_pair(p_Page, p_Page + (unsigned int)((p_Elements * sizeof(GEMX_dataType)
+                                                + GEMX_pageSizeBytes - 1) / GEMX_pageSizeBytes)));
+      };
+      KargsType l_kargs;
+      unsigned int l_pc = 0;
+      unsigned int l_codePage = GEMX_codePage;
+      bool l_isLastOp = false;
+      do {
+        unsigned int l_nextCodePage = 0;
+        KargsOpType l_op = l_kargs.load(l_p[0].getInstrAddr(l_codePage), l_pc);
+        switch(l_op) {
+          case KargsType::OpControl: {
+            ControlArgsType l_controlArgs = l_kargs.getControlArgs();
+            l_isLastOp = l_controlArgs.getIsLastOp();
+            l_nextCodePage = l_controlArgs.getNextCodePage();
+            break;
+          }
+          #if GEMX_runGemv ==1
+          case KargsType::OpGemv: {
+            GemvArgsType l_args = l_kargs.getGemvArgs();
+            l_outPages.push_back(l_range(l_args.m_Coffset, l_args.m_M));
+            break;
+          }
+          #endif
+          #if GEMX_runGemm ==1
+          case KargsType::OpGemm: {
+            GemmArgsType l_args = l_kargs.getGemmArgs();
+            l_outPages.push_back(l_range(l_args.m_Coffset, (size_t)(l_args.m_TransC ? l_args.m_N : l_args.m_M) * l_args.m_Ldc));
+            break;
+          }
+          #endif
+          #if GEMX_runFcn==1
+          case KargsType::OpFcn: {
+            FcnArgsType l_args = l_kargs.getFcnArgs();
+            l_outPages.push_back(l_range(l_args.m_Coffset, (size_t)(l_args.m_TransC ? l_args.m_N : l_args.m_M) * l_args.m_Ldc));
+            break;
+          }
+          #endif
+          #if GEMX_runTransp ==1
+          case KargsType::OpTransp: {
+            TranspArgsType l_args = l_kargs.getTranspArgs();
+            l_outPages.push_back(l_range(l_args.m_Dst.m_Offset, (size_t)l_args.m_Dst.m_Rows * l_args.m_Dst.m_Ld));
+            break;
+          }
+          #endif
+          #if GEMX_runSpmv ==1
+          case KargsType::OpSpmv: {
+            SpmvArgsType l_args = l_kargs.getSpmvArgs();
+            l_outPages.push_back(l_range(l_args.m_Coffset, l_args.m_M));
+            break;
+          }
+          #endif
+          #if GEMX_runUspmv == 1
+          case KargsType::OpUspmv: {
+            gemx::UspmvArgs l_args = l_kargs.getUspmvArgs();
+            UspMat<GEMX_dataType, GEMX_idxType, GEMX_uspmvStages, GEMX_ddrWidth> l_matA(
+              l_args.m_NumRuns, l_p[0].getPageAddr(l_args.m_Aoffset));
+            l_outPages.push_back(l_range(l_args.m_Coffset,
+                                         (size_t)l_args.m_NumRuns * l_matA.getRows(GEMX_uspmvStages-1)));
+            break;
+          }
+          #endif
+          default: {
+            assert(false);
+          }
+        }
+        if (l_nextCodePage != 0) {
+          l_codePage = l_nextCodePage;
+          l_pc = 0;
+        } else {
+          l_pc += l_kargs.getInstrWidth();
+        }
+      } while(!l_isLastOp);
+    }
+    // Index of the first later instruction writing over the output of p_Idx, or 0
+    auto l_overwrittenBy = [&](unsigned int p_Idx) {
+      for (unsigned int l_next = p_Idx + 1; l_next < l_outPages.size(); ++l_next) {
+        if ((l_outPages[l_next].first < l_outPages[p_Idx].second) &&
+            (l_outPages[p_Idx].first < l_outPages[l_next].second)) {
+          return(l_next);
+        }
+      }
+      return(0u);
+    };
+
     // Compare all instructions
     KargsType l_kargs0, l_kargs1;
     unsigned int l_pc = 0;
+    unsigned int l_codePage = GEMX_codePage;
     bool l_isLastOp = false;
     bool l_compareOk = true;
+    unsigned int l_opIdx = 0;
     do {
-      KargsOpType l_op0 = l_kargs0.load(l_p[0].getBaseInstrAddr(), l_pc);
-      KargsOpType l_op1 = l_kargs1.load(l_p[1].getBaseInstrAddr(), l_pc);
+      unsigned int l_nextCodePage = 0;
+      KargsOpType l_op0 = l_kargs0.load(l_p[0].getInstrAddr(l_codePage), l_pc);
+      KargsOpType l_op1 = l_kargs1.load(l_p[1].getInstrAddr(l_codePage), l_pc);
       if (l_op1 == KargsType::OpResult) {
         break;
       }
       assert(l_op0 == l_op1);
-      switch(l_op0) {
-        case KargsType::OpControl: {
-          ControlArgsType l_controlArgs = l_kargs0.getControlArgs();
-          l_isLastOp = l_controlArgs.getIsLastOp();
-          break;
+      bool l_skip = false;
+      if (l_op0 != KargsType::OpControl) {
+        unsigned int l_by = l_overwrittenBy(l_opIdx);
+        if (l_by != 0) {
+          std::cout << "INFO: skipping instruction " << l_opIdx
+                    << ", its output pages are overwritten by instruction " << l_by << "\n";
+          l_skip = true;
         }
-        #if GEMX_runGemv ==1
-        case KargsType::OpGemv: {
-          GemvArgsType l_gemvArgs = l_kargs0.getGemvArgs();
-          bool l_opOk = l_gemv.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_gemvArgs);
-          l_compareOk = l_compareOk && l_opOk;
-          break;
-        }
-        #endif
-        #if GEMX_runGemm ==1
-        case KargsType::OpGemm: {
-          GemmArgsType l_gemmArgs = l_kargs0.getGemmArgs();
-          bool l_opOk = l_gemm.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_gemmArgs);
-          l_compareOk = l_compareOk && l_opOk;
-          break;
-        }
-        #endif
-        #if GEMX_runFcn==1
-        case KargsType::OpFcn: {
-          FcnArgsType l_fcnArgs = l_kargs0.getFcnArgs();
-          bool l_opOk = l_fcn.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_fcnArgs);
-          l_compareOk = l_compareOk && l_opOk;
-          break;
-        }
-        #endif
-        #if GEMX_runTransp ==1
-        case KargsType::OpTransp: {
-          TranspArgsType l_transpArgs = l_kargs0.getTranspArgs();
-          bool l_opOk = l_transp.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_transpArgs);
-          l_compareOk = l_compareOk && l_opOk;
-          break;
-        }
-        #endif
-        #if GEMX_runSpmv ==1
-        case KargsType::OpSpmv: {
-          SpmvArgsType l_spmvArgs = l_kargs0.getSpmvArgs();
-          bool l_opOk = l_spmv.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_spmvArgs);
-          l_compareOk = l_compareOk && l_opOk;
-          break;
-        }
-        #endif
-        #if GEMX_runUspmv == 1
-	case KargsType::OpUspmv: {
-           gemx::UspmvArgs l_uspmvArgs = l_kargs0.getUspmvArgs();
-           bool l_opOk = l_uspmv.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_uspmvArgs);
-           l_compareOk = l_compareOk && l_opOk;
-           break;
-        }
-        #endif
-        default: {
-          assert(false);
+        ++l_opIdx;
+      }
+      if (!l_skip) {
+        switch(l_op0) {
+          case KargsType::OpControl: {
+            ControlArgsType l_controlArgs = l_kargs0.getControlArgs();
+            l_isLastOp = l_controlArgs.getIsLastOp();
+            l_nextCodePage = l_controlArgs.getNextCodePage();
+            break;
+          }
+          #if GEMX_runGemv ==1
+          case KargsType::OpGemv: {
+            GemvArgsType l_gemvArgs = l_kargs0.getGemvArgs();
+            bool l_opOk = l_gemv.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_gemvArgs);
+            l_compareOk = l_compareOk && l_opOk;
+            break;
+          }
+          #endif
+          #if GEMX_runGemm ==1
+          case KargsType::OpGemm: {
+            GemmArgsType l_gemmArgs = l_kargs0.getGemmArgs();
+            bool l_opOk = l_gemm.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_gemmArgs);
+            l_compareOk = l_compareOk && l_opOk;
+            break;
+          }
+          #endif
+          #if GEMX_runFcn==1
+          case KargsType::OpFcn: {
+            FcnArgsType l_fcnArgs = l_kargs0.getFcnArgs();
+            bool l_opOk = l_fcn.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_fcnArgs);
+            l_compareOk = l_compareOk && l_opOk;
+            break;
+          }
+          #endif
+          #if GEMX_runTransp ==1
+          case KargsType::OpTransp: {
+            TranspArgsType l_transpArgs = l_kargs0.getTranspArgs();
+            bool l_opOk = l_transp.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_transpArgs);
+            l_compareOk = l_compareOk && l_opOk;
+            break;
+          }
+          #endif
+          #if GEMX_runSpmv ==1
+          case KargsType::OpSpmv: {
+            SpmvArgsType l_spmvArgs = l_kargs0.getSpmvArgs();
+            bool l_opOk = l_spmv.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_spmvArgs);
+            l_compareOk = l_compareOk && l_opOk;
+            break;
+          }
+          #endif
+          #if GEMX_runUspmv == 1
+          case KargsType::OpUspmv: {
+            gemx::UspmvArgs l_uspmvArgs = l_kargs0.getUspmvArgs();
+            bool l_opOk = l_uspmv.compare(l_TolRel, l_TolAbs, l_p[0], l_p[1], l_uspmvArgs);
+            l_compareOk = l_compareOk && l_opOk;
+            break;
+          }
+          #endif
+          default: {
+            assert(false);
+          }
         }
       }
-      l_pc += l_kargs0.getInstrWidth();
+      if (!l_compareOk && CmpOptions::global().m_FailFast) {
+        std::cout << "INFO: stopping at the first failing instruction (-failfast)\n";
+        break;
+      }
+      if (l_nextCodePage != 0) {
+        l_codePage = l_nextCodePage;
+        l_pc = 0;
+      } else {
+        l_pc += l_kargs0.getInstrWidth();
+      }
     } while(!l_isLastOp);
     
     // Exit status from compare
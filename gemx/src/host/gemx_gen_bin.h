@@ -23,16 +23,27 @@
 #define GEMX_GEN_BIN_H
 
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <array>
 #include <map>
 #include <fstream>
 #include <iostream>
 #include <stdlib.h>
+#include <errno.h>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/mman.h>
 
 #include "gemx_kernel.h"
+#include "gemx_perfmodel.h"
 
 ////////////////////////  COMMON  ////////////////////////
 
@@ -54,6 +65,11 @@ typedef gemx::DdrMatrixShape DdrMatrixShapeType;
 typedef DdrMatrixShapeType::FormatType MatFormatType;
 #define GEMX_maxNumInstr 64
 
+// Address space reserved per Program; only the pages actually used are committed
+#ifndef GEMX_maxProgramBytes
+#define GEMX_maxProgramBytes (64ULL << 30)
+#endif
+
 #define VERBOSE 1 
 typedef std::chrono::time_point<std::chrono::high_resolution_clock> TimePointType;
 inline void
@@ -108,9 +124,298 @@ class PageHandleDescriptor {
 };
 
 typedef std::array<uint8_t, GEMX_instructionSizeBytes> InstrControlType;
-typedef std::vector<Page<uint8_t, GEMX_pageSizeBytes > > PageVectorType;
 typedef Page<uint8_t, GEMX_pageSizeBytes> PageType;
 
+/*
+ * PageArena : Page storage of a Program. GEMX_maxProgramBytes of address space is
+ * reserved up front and committed in steps as the program grows, so growing never
+ * copies, page addresses stay valid, and new pages are zero-filled by the OS.
+ */
+class PageArena {
+  private:
+    static const size_t t_CommitPages = 256;
+    PageType *m_Pages;
+    size_t m_Size;
+    size_t m_Committed;
+    size_t m_MaxPages;
+  public:
+    PageArena()
+      : m_Pages(0), m_Size(0), m_Committed(0), m_MaxPages(GEMX_maxProgramBytes / sizeof(PageType))
+      {
+        void *l_addr = mmap(0, m_MaxPages * sizeof(PageType), PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (l_addr == MAP_FAILED) {
+          std::cerr << "ERROR: failed to reserve " << GEMX_maxProgramBytes << " bytes for program pages: "
+                    << strerror(errno) << "\n";
+          exit(EXIT_FAILURE);
+        }
+        m_Pages = (PageType*)l_addr;
+      }
+    ~PageArena() {
+        munmap(m_Pages, m_MaxPages * sizeof(PageType));
+      }
+    PageArena(const PageArena &) = delete;
+    PageArena& operator=(const PageArena &) = delete;
+    PageType& operator[](size_t p_Idx) {return m_Pages[p_Idx];}
+    PageType* data() {return m_Pages;}
+    size_t size() const {return m_Size;}
+    // Pages dropped by shrinking read back as zeros when grown again
+    void
+    resize(size_t p_NumPages) {
+        if (p_NumPages > m_Committed) {
+          size_t l_commit = std::min(m_MaxPages, (p_NumPages + t_CommitPages - 1) / t_CommitPages * t_CommitPages);
+          if (p_NumPages > m_MaxPages) {
+            std::cerr << "ERROR: program of " << p_NumPages << " pages exceeds GEMX_maxProgramBytes\n";
+            exit(EXIT_FAILURE);
+          }
+          if (mprotect(m_Pages + m_Committed, (l_commit - m_Committed) * sizeof(PageType), PROT_READ | PROT_WRITE) != 0) {
+            std::cerr << "ERROR: failed to commit " << l_commit << " program pages: " << strerror(errno) << "\n";
+            exit(EXIT_FAILURE);
+          }
+          m_Committed = l_commit;
+        } else if (p_NumPages < m_Size) {
+          madvise(m_Pages + p_NumPages, (m_Size - p_NumPages) * sizeof(PageType), MADV_DONTNEED);
+        }
+        m_Size = p_NumPages;
+      }
+    void
+    clear() {resize(0);}
+    void
+    swap(PageArena &p_Other) {
+        std::swap(m_Pages, p_Other.m_Pages);
+        std::swap(m_Size, p_Other.m_Size);
+        std::swap(m_Committed, p_Other.m_Committed);
+        std::swap(m_MaxPages, p_Other.m_MaxPages);
+      }
+};
+typedef PageArena PageVectorType;
+
+/*
+ * TaskGraph : Runs tasks on a thread pool, ordered only by the pages they touch.
+ * A task starts after the last earlier writer of each page it reads or writes
+ * and, for the pages it writes, after the earlier readers since that write.
+ * Operands are addressed by the start page of their handle, so pages identify
+ * handles.
+ */
+class TaskGraph {
+  private:
+    struct Task {
+      std::function<void()> m_Fn;
+      std::vector<unsigned int> m_Reads, m_Writes;
+      std::vector<unsigned int> m_Succs;
+      unsigned int m_Deps;
+    };
+    std::vector<Task> m_Tasks;
+    std::map<unsigned int, unsigned int> m_LastWriter;
+    std::map<unsigned int, std::vector<unsigned int> > m_Readers;
+  public:
+    void
+    add(const std::vector<unsigned int> &p_Reads, const std::vector<unsigned int> &p_Writes, std::function<void()> p_Fn) {
+        unsigned int l_id = m_Tasks.size();
+        std::set<unsigned int> l_deps;
+        for (unsigned int l_page : p_Reads) {
+          auto l_it = m_LastWriter.find(l_page);
+          if (l_it != m_LastWriter.end()) {
+            l_deps.insert(l_it->second);
+          }
+        }
+        for (unsigned int l_page : p_Writes) {
+          auto l_it = m_LastWriter.find(l_page);
+          if (l_it != m_LastWriter.end()) {
+            l_deps.insert(l_it->second);
+          }
+          for (unsigned int l_reader : m_Readers[l_page]) {
+            l_deps.insert(l_reader);
+          }
+        }
+        Task l_task;
+        l_task.m_Fn = p_Fn;
+        l_task.m_Reads = p_Reads;
+        l_task.m_Writes = p_Writes;
+        l_task.m_Deps = l_deps.size();
+        m_Tasks.push_back(l_task);
+        for (unsigned int l_dep : l_deps) {
+          m_Tasks[l_dep].m_Succs.push_back(l_id);
+        }
+        for (unsigned int l_page : p_Reads) {
+          m_Readers[l_page].push_back(l_id);
+        }
+        for (unsigned int l_page : p_Writes) {
+          m_LastWriter[l_page] = l_id;
+          m_Readers[l_page].clear();
+        }
+      }
+    unsigned int size() const {return m_Tasks.size();}
+    const std::vector<unsigned int>& getReads(unsigned int p_Id) const {return m_Tasks[p_Id].m_Reads;}
+    const std::vector<unsigned int>& getWrites(unsigned int p_Id) const {return m_Tasks[p_Id].m_Writes;}
+    void
+    run(unsigned int p_Threads = std::thread::hardware_concurrency()) {
+        std::mutex l_mutex;
+        std::condition_variable l_cv;
+        std::deque<unsigned int> l_ready;
+        unsigned int l_left = m_Tasks.size();
+        for (unsigned int i = 0; i < m_Tasks.size(); ++i) {
+          if (m_Tasks[i].m_Deps == 0) {
+            l_ready.push_back(i);
+          }
+        }
+        auto l_worker = [&]() {
+          std::unique_lock<std::mutex> l_lock(l_mutex);
+          while (true) {
+            l_cv.wait(l_lock, [&]() {return !l_ready.empty() || l_left == 0;});
+            if (l_left == 0) {
+              break;
+            }
+            unsigned int l_id = l_ready.front();
+            l_ready.pop_front();
+            l_lock.unlock();
+            m_Tasks[l_id].m_Fn();
+            l_lock.lock();
+            for (unsigned int l_succ : m_Tasks[l_id].m_Succs) {
+              if (--m_Tasks[l_succ].m_Deps == 0) {
+                l_ready.push_back(l_succ);
+              }
+            }
+            --l_left;
+            l_cv.notify_all();
+          }
+        };
+        unsigned int l_threads = std::max(1u, std::min<unsigned int>(p_Threads, m_Tasks.size()));
+        std::vector<std::thread> l_pool;
+        for (unsigned int t = 1; t < l_threads; ++t) {
+          l_pool.push_back(std::thread(l_worker));
+        }
+        l_worker();
+        for (auto &l_thread : l_pool) {
+          l_thread.join();
+        }
+        m_Tasks.clear();
+        m_LastWriter.clear();
+        m_Readers.clear();
+      }
+};
+
+/*
+ * MemPlanner : Lets handles whose live ranges do not intersect share device pages.
+ * Instructions are added in program order with the start pages they read and write.
+ * A handle first read is loaded by the host and lives from the program start; a
+ * handle not read after its last write is a result and lives to the program end;
+ * other handles live from their first write to their last read. Handles are then
+ * placed by decreasing size, each at the lowest offset not used by an already
+ * placed handle whose live range intersects its own.
+ */
+class MemPlanner {
+  public:
+    struct Buffer {
+      unsigned int m_SizePages, m_First, m_Last, m_LastRead, m_LastWrite, m_Offset;
+      bool m_Used, m_Loaded;
+      Buffer() : m_SizePages(0), m_First(0), m_Last(0), m_LastRead(0), m_LastWrite(0),
+                 m_Offset(0), m_Used(false), m_Loaded(true) {}
+    };
+  private:
+    std::map<unsigned int, std::string> m_PageHandles;
+    std::map<std::string, Buffer> m_Buffers;
+    unsigned int m_NumOps;
+    unsigned int m_NumPages;
+  private:
+    void
+    touch(unsigned int p_Page, bool p_Write) {
+        auto l_it = m_PageHandles.find(p_Page);
+        assert(l_it != m_PageHandles.end());
+        Buffer &l_buf = m_Buffers[l_it->second];
+        if (!l_buf.m_Used) {
+          l_buf.m_Used = true;
+          l_buf.m_First = m_NumOps;
+          l_buf.m_Loaded = !p_Write;
+        }
+        // Op indices are stored one-based so that 0 means never
+        if (p_Write) {
+          l_buf.m_LastWrite = m_NumOps + 1;
+        } else {
+          l_buf.m_LastRead = m_NumOps + 1;
+        }
+        l_buf.m_Last = m_NumOps;
+      }
+  public:
+    MemPlanner() : m_NumOps(0), m_NumPages(0) {}
+    MemPlanner(const std::map<std::string, PageHandleDescriptor> &p_Handles)
+      : m_NumOps(0), m_NumPages(0) {
+        for (auto &l_handle : p_Handles) {
+          m_PageHandles[l_handle.second.m_StartPage] = l_handle.first;
+          m_Buffers[l_handle.first].m_SizePages = l_handle.second.m_SizePages;
+        }
+      }
+    bool empty() const {return m_Buffers.empty();}
+    unsigned int getNumPages() const {return m_NumPages;}
+    void
+    add(const std::vector<unsigned int> &p_Reads, const std::vector<unsigned int> &p_Writes) {
+        // Reads first, an operand read and written by its first op is loaded
+        for (unsigned int l_page : p_Reads) {
+          touch(l_page, false);
+        }
+        for (unsigned int l_page : p_Writes) {
+          touch(l_page, true);
+        }
+        m_NumOps++;
+      }
+    // Assigns page offsets and returns the number of pages of the shared region
+    unsigned int
+    plan() {
+        std::vector<Buffer*> l_order;
+        unsigned int l_unplannedPages = 0;
+        for (auto &l_it : m_Buffers) {
+          Buffer &l_buf = l_it.second;
+          if (!l_buf.m_Used || l_buf.m_Loaded) {
+            l_buf.m_First = 0;
+          }
+          if (!l_buf.m_Used || (l_buf.m_LastWrite > l_buf.m_LastRead)) {
+            l_buf.m_Last = m_NumOps;
+          }
+          l_order.push_back(&l_buf);
+          l_unplannedPages += l_buf.m_SizePages;
+        }
+        std::stable_sort(l_order.begin(), l_order.end(), [](const Buffer *p_A, const Buffer *p_B) {
+            return(p_A->m_SizePages > p_B->m_SizePages);
+          });
+        m_NumPages = 0;
+        std::vector<Buffer*> l_placed;
+        for (Buffer *l_buf : l_order) {
+          std::vector<std::pair<unsigned int, unsigned int> > l_busy;
+          for (Buffer *l_other : l_placed) {
+            if ((l_other->m_First <= l_buf->m_Last) && (l_buf->m_First <= l_other->m_Last)) {
+              l_busy.push_back(std::make_pair(l_other->m_Offset, l_other->m_Offset + l_other->m_SizePages));
+            }
+          }
+          std::sort(l_busy.begin(), l_busy.end());
+          unsigned int l_offset = 0;
+          for (auto &l_range : l_busy) {
+            if (l_range.first >= l_offset + l_buf->m_SizePages) {
+              break;
+            }
+            l_offset = std::max(l_offset, l_range.second);
+          }
+          l_buf->m_Offset = l_offset;
+          m_NumPages = std::max(m_NumPages, l_offset + l_buf->m_SizePages);
+          l_placed.push_back(l_buf);
+        }
+        std::cout << "INFO: memory plan places " << m_Buffers.size() << " handles in "
+                  << m_NumPages << " pages instead of " << l_unplannedPages << "\n";
+        return(m_NumPages);
+      }
+    // Placement of p_Handle at p_BasePage; p_Loaded tells whether the host provides its contents
+    bool
+    getPlacement(const std::string &p_Handle, unsigned int p_BasePage,
+                 PageHandleDescriptor &p_Desc, bool &p_Loaded) const {
+        auto l_it = m_Buffers.find(p_Handle);
+        if (l_it == m_Buffers.end()) {
+          return(false);
+        }
+        p_Desc = PageHandleDescriptor(p_BasePage + l_it->second.m_Offset, l_it->second.m_SizePages);
+        p_Loaded = l_it->second.m_Loaded;
+        return(true);
+      }
+};
+
 template <
     typename t_FloatType  // to simplify client-side interfaces
   >
@@ -119,8 +424,11 @@ class Program {
     typedef std::array<InstrControlType, GEMX_maxNumInstr> InstrType;
   private:
     PageVectorType m_PageVector;
-    unsigned int m_NumInstr;
+    unsigned int m_NumInstr;     // in the current code page
+    unsigned int m_CodePage;     // code page receiving new instructions
     std::map<std::string, PageHandleDescriptor> m_Handles;
+    std::map<std::string, std::pair<std::string, unsigned int> > m_Views;  // parent handle, page offset
+    MemPlanner m_MemPlan;
   private:
     // Utilities
     std::ifstream::pos_type getFileSize(std::string p_FileName)
@@ -130,13 +438,13 @@ class Program {
     }
   public:
     Program()
-      : m_NumInstr(0)
+      : m_NumInstr(0), m_CodePage(GEMX_codePage)
       {
         // Reserve instruction and result pages
         m_PageVector.resize(GEMX_dataPage);
       }
     Program(size_t p_NumPages)  // Constructor typically used to store output from FPGA
-      : m_NumInstr(0)
+      : m_NumInstr(0), m_CodePage(GEMX_codePage)
       {
         // Reserve space for entire output FPGA image
         m_PageVector.resize(p_NumPages);
@@ -144,6 +452,7 @@ class Program {
         void
         init (size_t p_NumPages) {
           m_NumInstr=0;
+          m_CodePage=GEMX_codePage;
           m_PageVector.resize(p_NumPages);
         }
     unsigned int
@@ -160,10 +469,18 @@ class Program {
         size_t l_numPages = (p_NumElements * sizeof(t_FloatType)
                              + GEMX_pageSizeBytes - 1)  /  GEMX_pageSizeBytes;
         unsigned int l_startPage = 0;
+        auto l_view = m_Views.find(p_Handle);
+        if (l_view != m_Views.end()) {
+          const PageHandleDescriptor &l_parent = m_Handles.at(l_view->second.first);
+          assert(l_numPages <= l_parent.m_SizePages);
+          p_NewAlloc = false;
+          return(l_parent.m_StartPage + l_view->second.second);
+        }
         // Create a page descriptor that will contains start address of the page
         // and the page size
         PageHandleDescriptor l_desc = m_Handles[p_Handle];
         if (l_desc.m_StartPage == 0) {
+          assert(m_MemPlan.empty());
           l_startPage = m_PageVector.size();
           m_PageVector.resize(l_startPage + l_numPages);
           m_Handles[p_Handle] = PageHandleDescriptor(l_startPage, l_numPages);
@@ -176,6 +493,121 @@ class Program {
         //std::cout << "  DEBUG allocPages Start page for " << p_Handle << " is " << l_startPage << "\n";
         return(l_startPage);
       }
+    const std::map<std::string, PageHandleDescriptor>&
+    getHandles() const {return m_Handles;}
+    /*
+     * addView : Names the pages of handle p_Parent from p_PageOffset on p_View, so that
+     * an instruction can address a page aligned row or column slice of it. A view has
+     * the size of its parent: a column slice read with the parent's leading dimension
+     * ends inside the parent although it starts p_PageOffset pages later. Views are not
+     * handles of their own, they follow the parent through applyMemPlan. Adding the
+     * same view again is allowed.
+     */
+    bool
+    addView(std::string p_View, std::string p_Parent, unsigned int p_PageOffset) {
+        auto l_parent = m_Handles.find(p_Parent);
+        if ((l_parent == m_Handles.end()) || (p_PageOffset >= l_parent->second.m_SizePages)) {
+          std::cerr << "ERROR: view " << p_View << " at page " << p_PageOffset
+                    << " is outside of handle " << p_Parent << "\n";
+          return(false);
+        }
+        auto l_view = m_Views.find(p_View);
+        if (l_view != m_Views.end()) {
+          if (l_view->second != std::make_pair(p_Parent, p_PageOffset)) {
+            std::cerr << "ERROR: view " << p_View << " already names other pages\n";
+            return(false);
+          }
+          return(true);
+        }
+        if (m_Handles.count(p_View) != 0) {
+          std::cerr << "ERROR: view " << p_View << " is already a handle\n";
+          return(false);
+        }
+        m_Views[p_View] = std::make_pair(p_Parent, p_PageOffset);
+        return(true);
+      }
+    /*
+     * applyMemPlan : Moves the handles of p_Plan into a shared region after the reserved
+     * pages, followed by the chained code pages. Only host-loaded handles are copied, so
+     * handles sharing pages keep the inputs intact. Returns the new start page of every
+     * moved handle and code page; the instructions still hold the old offsets and must
+     * be rewritten by the caller. No pages may be allocated afterwards.
+     */
+    std::map<unsigned int, unsigned int>
+    applyMemPlan(const MemPlanner &p_Plan) {
+        std::map<unsigned int, unsigned int> l_map;
+        for (auto &l_view : m_Views) {
+          unsigned int l_oldPage = m_Handles.at(l_view.second.first).m_StartPage + l_view.second.second;
+          PageHandleDescriptor l_desc;
+          bool l_loaded;
+          if (p_Plan.getPlacement(l_view.second.first, GEMX_dataPage, l_desc, l_loaded)) {
+            l_map[l_oldPage] = l_desc.m_StartPage + l_view.second.second;
+          }
+        }
+        PageVectorType l_pages;
+        l_pages.resize(GEMX_dataPage + p_Plan.getNumPages());
+        memcpy(l_pages.data(), m_PageVector.data(), GEMX_dataPage * sizeof(PageType));
+        for (auto &l_handle : m_Handles) {
+          PageHandleDescriptor l_desc;
+          bool l_loaded = true;
+          if (!p_Plan.getPlacement(l_handle.first, GEMX_dataPage, l_desc, l_loaded)) {
+            std::cerr << "ERROR: handle " << l_handle.first << " is missing from the memory plan\n";
+            exit(EXIT_FAILURE);
+          }
+          assert(l_handle.second.m_SizePages <= l_desc.m_SizePages);
+          if (l_loaded) {
+            memcpy(l_pages.data() + l_desc.m_StartPage, m_PageVector.data() + l_handle.second.m_StartPage,
+                   l_handle.second.m_SizePages * sizeof(PageType));
+          }
+          l_map[l_handle.second.m_StartPage] = l_desc.m_StartPage;
+          l_handle.second = l_desc;
+        }
+        std::vector<unsigned int> l_codePages = getCodePages();
+        l_map[GEMX_codePage] = GEMX_codePage;
+        for (unsigned int i = 1; i < l_codePages.size(); ++i) {
+          unsigned int l_newPage = l_pages.size();
+          l_pages.resize(l_newPage + GEMX_dataPage - GEMX_codePage);
+          memcpy(l_pages.data() + l_newPage, m_PageVector.data() + l_codePages[i],
+                 (GEMX_dataPage - GEMX_codePage) * sizeof(PageType));
+          l_map[l_codePages[i]] = l_newPage;
+        }
+        m_CodePage = l_map.at(m_CodePage);
+        m_PageVector.swap(l_pages);
+        m_MemPlan = p_Plan;
+        return(l_map);
+      }
+    // Start pages of all handles sharing pages with the handles or views starting at
+    // p_Pages; a view stands for its parent
+    std::vector<unsigned int>
+    getAliasPages(const std::vector<unsigned int> &p_Pages) {
+        std::vector<unsigned int> l_pages(p_Pages);
+        for (unsigned int &l_page : l_pages) {
+          for (auto &l_view : m_Views) {
+            unsigned int l_parentPage = m_Handles.at(l_view.second.first).m_StartPage;
+            if (l_page == l_parentPage + l_view.second.second) {
+              l_page = l_parentPage;
+              break;
+            }
+          }
+        }
+        if (m_MemPlan.empty()) {
+          return(l_pages);
+        }
+        std::set<unsigned int> l_aliases;
+        for (unsigned int l_page : l_pages) {
+          l_aliases.insert(l_page);
+          for (auto &l_a : m_Handles) {
+            if (l_a.second.m_StartPage != l_page) continue;
+            for (auto &l_b : m_Handles) {
+              if ((l_b.second.m_StartPage < l_a.second.m_StartPage + l_a.second.m_SizePages) &&
+                  (l_a.second.m_StartPage < l_b.second.m_StartPage + l_b.second.m_SizePages)) {
+                l_aliases.insert(l_b.second.m_StartPage);
+              }
+            }
+          }
+        }
+        return(std::vector<unsigned int>(l_aliases.begin(), l_aliases.end()));
+      }
     t_FloatType *
     getPageAddr(unsigned int p_PageIdx) {
         t_FloatType* l_addr = (t_FloatType*)&m_PageVector[p_PageIdx];
@@ -186,13 +618,70 @@ class Program {
     DdrFloatType *
     getBaseResAddr() {return (DdrFloatType*)&m_PageVector[GEMX_resPage];}
     DdrFloatType *
-    addInstr() {
-        assert(m_NumInstr * sizeof(InstrControlType) <= GEMX_pageSizeBytes);
-        InstrControlType *l_instrBased = (InstrControlType *)&m_PageVector[GEMX_codePage];
+    getInstrAddr(unsigned int p_CodePage) {return (DdrFloatType*)&m_PageVector[p_CodePage];}
+    DdrFloatType *
+    getResAddr(unsigned int p_CodePage) {
+        return (DdrFloatType*)&m_PageVector[p_CodePage + GEMX_resPage - GEMX_codePage];
+      }
+    unsigned int
+    getNumInstr() {return m_NumInstr;}
+    /*
+     * addInstr : Returns the slot for the next instruction. Once the current code page
+     * holds GEMX_numInstr - 1 instructions, its last slot is filled with a control op
+     * chaining to a freshly allocated code and result page pair, so programs are not
+     * limited to a single kernel-sized chunk. Only the final IsLastOp control op may
+     * take the last slot of a chunk.
+     */
+    DdrFloatType *
+    addInstr(bool p_IsLastOp = false) {
+        if ((m_NumInstr == GEMX_numInstr - 1) && !p_IsLastOp) {
+          unsigned int l_nextCodePage = m_PageVector.size();
+          m_PageVector.resize(l_nextCodePage + GEMX_dataPage - GEMX_codePage);
+          ControlArgsType l_controlArgs(false, false, l_nextCodePage);
+          KargsType l_kargs;
+          l_kargs.setControlArgs(l_controlArgs);
+          l_kargs.store(getInstrAddr(m_CodePage), m_NumInstr * KargsType::getInstrWidth());
+          m_CodePage = l_nextCodePage;
+          m_NumInstr = 0;
+        }
+        assert(m_NumInstr < GEMX_numInstr);
+        assert((m_NumInstr + 1) * sizeof(InstrControlType) <= GEMX_pageSizeBytes);
+        InstrControlType *l_instrBased = (InstrControlType *)&m_PageVector[m_CodePage];
         DdrFloatType* l_instrAdd = (DdrFloatType*)&l_instrBased[m_NumInstr];
         ++m_NumInstr;
         return(l_instrAdd);
       }
+    // Code pages in execution order, found by following the chaining control ops
+    std::vector<unsigned int>
+    getCodePages() {
+        std::vector<unsigned int> l_pages;
+        unsigned int l_codePage = GEMX_codePage;
+        while (l_codePage + GEMX_resPage - GEMX_codePage < m_PageVector.size()) {
+          l_pages.push_back(l_codePage);
+          KargsType l_kargs;
+          KargsOpType l_op = l_kargs.load(getInstrAddr(l_codePage),
+                                          (GEMX_numInstr - 1) * KargsType::getInstrWidth());
+          if (l_op != KargsType::OpControl) {
+            break;
+          }
+          l_codePage = l_kargs.getControlArgs().getNextCodePage();
+          if (l_codePage == 0) {
+            break;
+          }
+        }
+        return(l_pages);
+      }
+    // Result page of the p_Idx-th instruction added with addInstr; p_Pc receives its offset
+    DdrFloatType *
+    getInstrResAddr(unsigned int p_Idx, unsigned int &p_Pc) {
+        std::vector<unsigned int> l_pages = getCodePages();
+        assert(!l_pages.empty());
+        // Every page but the last holds GEMX_numInstr - 1 instructions and the chaining op
+        unsigned int l_chunk = std::min<unsigned int>(p_Idx / (GEMX_numInstr - 1), l_pages.size() - 1);
+        p_Pc = (p_Idx - l_chunk * (GEMX_numInstr - 1)) * KargsType::getInstrWidth();
+        assert(p_Pc < GEMX_numInstr * KargsType::getInstrWidth());
+        return(getResAddr(l_pages[l_chunk]));
+      }
     bool
     writeToBinFile(std::string p_FileName)
     {
@@ -226,7 +715,6 @@ class Program {
         assert(l_FileSize % sizeof(m_PageVector[0]) == 0);
 
         // Bin file storage
-        m_PageVector.reserve(l_FileSizeInPages);
         m_PageVector.resize(l_FileSizeInPages);
 
         // Read the bin file
@@ -273,7 +761,7 @@ class GenControl
       );
     KargsType l_kargs;
     l_kargs.setControlArgs(l_controlArgs);
-    l_kargs.store(p_Program.addInstr(), 0);
+    l_kargs.store(p_Program.addInstr(p_IsLastOp), 0);
 
     std::cout << "Added CONTROL  IsLastOp=" << p_IsLastOp << " Noop=" << p_Noop << "  ";
   }
@@ -288,6 +776,7 @@ class GenControl
       std::cout << "\n###########  Op Control  ###########\n"
         << "  IsLastOp=" << l_isLastOp
         << " Noop=" << l_Noop
+        << " NextCodePage=" << p_ControlArgs.m_NextCodePage
         << "\n";
     }
       
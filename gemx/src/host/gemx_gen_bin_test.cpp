@@ -0,0 +1,488 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Self checking test of the gen_bin program builder helpers
+ *
+ *  MemPlanner: handles whose live ranges intersect never share pages, handles
+ *  that do not are aliased, and Program::applyMemPlan moves the host-loaded
+ *  contents to their planned pages.
+ *  GemmTiler: M, K and N are padded to their block edges, split K chunks are
+ *  balanced and chained through C, and the K padding of a generated operand
+ *  is zeroed.
+ *
+ *  Built with the same GEMX_* configuration as gemx_gen_bin.exe:
+ *    make gen_bin_test GEMX_ddrWidth=32 GEMX_XddrWidth=16 GEMX_runGemm=1 GEMX_gemmMBlocks=4 GEMX_gemmKBlocks=4 GEMX_gemmNBlocks=4
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <iostream>
+#include "gemx_gen_tiler.h"
+
+static unsigned int g_Errors = 0;
+
+static void
+check(bool p_Cond, const std::string &p_What) {
+  if (!p_Cond) {
+    std::cerr << "ERROR: " << p_What << "\n";
+    g_Errors++;
+  }
+}
+
+////////////////////////  MEMPLANNER  ////////////////////////
+
+struct PlanOp {
+  std::vector<std::string> m_Reads, m_Writes;
+};
+
+// Live range [first op, last op] of every handle, derived from the op list
+// independently of MemPlanner. p_Loaded tells whether the first access reads.
+static void
+liveRanges(const std::map<std::string, PageHandleDescriptor> &p_Handles, const std::vector<PlanOp> &p_Ops,
+           std::map<std::string, std::pair<unsigned int, unsigned int> > &p_Ranges,
+           std::map<std::string, bool> &p_Loaded) {
+  unsigned int l_end = p_Ops.size();
+  for (auto &l_h : p_Handles) {
+    int l_first = -1, l_lastRead = -1, l_lastWrite = -1;
+    bool l_loaded = true;
+    for (unsigned int i = 0; i < p_Ops.size(); ++i) {
+      for (const std::string &l_r : p_Ops[i].m_Reads) {
+        if (l_r != l_h.first) continue;
+        if (l_first < 0) l_first = i;
+        l_lastRead = i;
+      }
+      for (const std::string &l_w : p_Ops[i].m_Writes) {
+        if (l_w != l_h.first) continue;
+        if (l_first < 0) {
+          l_first = i;
+          l_loaded = false;
+        }
+        l_lastWrite = i;
+      }
+    }
+    unsigned int l_begin = (l_loaded || (l_first < 0)) ? 0 : l_first;
+    unsigned int l_last = ((l_first < 0) || (l_lastWrite > l_lastRead)) ? l_end : l_lastRead;
+    p_Ranges[l_h.first] = std::make_pair(l_begin, l_last);
+    p_Loaded[l_h.first] = l_loaded;
+  }
+}
+
+// Plans p_Ops and checks the placement against the independent live ranges;
+// returns the planned pages
+static unsigned int
+checkPlan(const std::string &p_Name, const std::map<std::string, PageHandleDescriptor> &p_Handles,
+          const std::vector<PlanOp> &p_Ops, MemPlanner &p_Plan) {
+  p_Plan = MemPlanner(p_Handles);
+  for (const PlanOp &l_op : p_Ops) {
+    std::vector<unsigned int> l_reads, l_writes;
+    for (const std::string &l_r : l_op.m_Reads) l_reads.push_back(p_Handles.at(l_r).m_StartPage);
+    for (const std::string &l_w : l_op.m_Writes) l_writes.push_back(p_Handles.at(l_w).m_StartPage);
+    p_Plan.add(l_reads, l_writes);
+  }
+  unsigned int l_pages = p_Plan.plan();
+  std::map<std::string, std::pair<unsigned int, unsigned int> > l_ranges;
+  std::map<std::string, bool> l_loaded;
+  liveRanges(p_Handles, p_Ops, l_ranges, l_loaded);
+  std::map<std::string, PageHandleDescriptor> l_placed;
+  for (auto &l_h : p_Handles) {
+    bool l_isLoaded = false;
+    check(p_Plan.getPlacement(l_h.first, GEMX_dataPage, l_placed[l_h.first], l_isLoaded),
+          p_Name + ": " + l_h.first + " has no placement");
+    check(l_isLoaded == l_loaded[l_h.first], p_Name + ": " + l_h.first + " has the wrong loaded flag");
+    check(l_placed[l_h.first].m_SizePages == l_h.second.m_SizePages, p_Name + ": " + l_h.first + " changed size");
+    check(l_placed[l_h.first].m_StartPage + l_h.second.m_SizePages <= GEMX_dataPage + l_pages,
+          p_Name + ": " + l_h.first + " is placed beyond the planned pages");
+  }
+  for (auto &l_a : l_placed) {
+    for (auto &l_b : l_placed) {
+      if (l_a.first >= l_b.first) continue;
+      bool l_liveTogether = (l_ranges[l_a.first].first <= l_ranges[l_b.first].second) &&
+                            (l_ranges[l_b.first].first <= l_ranges[l_a.first].second);
+      bool l_sharePages = (l_a.second.m_StartPage < l_b.second.m_StartPage + l_b.second.m_SizePages) &&
+                          (l_b.second.m_StartPage < l_a.second.m_StartPage + l_a.second.m_SizePages);
+      check(!(l_liveTogether && l_sharePages), p_Name + ": live handles " + l_a.first + " and " + l_b.first + " share pages");
+    }
+  }
+  return(l_pages);
+}
+
+static void
+testMemPlanner() {
+  // 3 layer MLP: In -> C1 -> C2 -> C3 with weights W and biases b
+  std::map<std::string, PageHandleDescriptor> l_handles;
+  unsigned int l_page = GEMX_dataPage, l_unplanned = 0;
+  for (auto &l_h : std::vector<std::pair<std::string, unsigned int> >{
+         {"In", 10}, {"W1", 5}, {"b1", 40}, {"C1", 40}, {"W2", 5}, {"b2", 40},
+         {"C2", 40}, {"W3", 5}, {"b3", 40}, {"C3", 40}, {"Unused", 3}}) {
+    l_handles.emplace(l_h.first, PageHandleDescriptor(l_page, l_h.second));
+    l_page += l_h.second;
+    l_unplanned += l_h.second;
+  }
+  std::vector<PlanOp> l_mlp = {
+    {{"In", "W1", "b1"}, {"C1"}},
+    {{"C1", "W2", "b2"}, {"C2"}},
+    {{"C2", "W3", "b3"}, {"C3"}}};
+  MemPlanner l_plan;
+  unsigned int l_pages = checkPlan("mlp", l_handles, l_mlp, l_plan);
+  check(l_pages < l_unplanned, "mlp: no handles were aliased");
+  PageHandleDescriptor l_c1, l_c3;
+  bool l_loaded;
+  l_plan.getPlacement("C1", GEMX_dataPage, l_c1, l_loaded);
+  l_plan.getPlacement("C3", GEMX_dataPage, l_c3, l_loaded);
+  check(l_c1.m_StartPage == l_c3.m_StartPage, "mlp: C3 does not reuse the pages of C1, dead after op 1");
+
+  // An operand read and written by its first op, like C = A * B + C, keeps its contents
+  std::vector<PlanOp> l_inPlace = {
+    {{"In", "W1", "C1"}, {"C1"}},
+    {{"C1", "W2", "b2"}, {"C2"}},
+    {{"C2", "W3", "b3"}, {"b1"}},
+    {{"b1", "W3", "b3"}, {"C3"}}};
+  checkPlan("in place", l_handles, l_inPlace, l_plan);
+
+  // Program::applyMemPlan moves only loaded contents; the code page stays put
+  ProgramType l_p;
+  GenControl l_control;
+  l_control.addInstr(l_p, true, false);
+  for (auto &l_h : l_handles) {
+    bool l_new;
+    unsigned int l_start = l_p.allocPages(l_h.first, l_new,
+                                          l_h.second.m_SizePages * GEMX_pageSizeBytes / sizeof(GEMX_dataType));
+    GEMX_dataType *l_addr = l_p.getPageAddr(l_start);
+    for (unsigned int i = 0; i < l_h.second.m_SizePages * GEMX_pageSizeBytes / sizeof(GEMX_dataType); ++i) {
+      l_addr[i] = (GEMX_dataType)(l_start + i % 97);
+    }
+  }
+  checkPlan("program", l_p.getHandles(), l_mlp, l_plan);
+  std::map<std::string, PageHandleDescriptor> l_before = l_p.getHandles();
+  std::map<unsigned int, unsigned int> l_map = l_p.applyMemPlan(l_plan);
+  check(l_map.at(GEMX_codePage) == GEMX_codePage, "program: the first code page moved");
+  for (auto &l_h : l_p.getHandles()) {
+    PageHandleDescriptor l_want;
+    l_plan.getPlacement(l_h.first, GEMX_dataPage, l_want, l_loaded);
+    check(l_h.second.m_StartPage == l_want.m_StartPage, "program: " + l_h.first + " is not at its planned page");
+    check(l_map.at(l_before[l_h.first].m_StartPage) == l_h.second.m_StartPage,
+          "program: relocation map of " + l_h.first + " is wrong");
+    if (!l_loaded) continue;
+    GEMX_dataType *l_addr = l_p.getPageAddr(l_h.second.m_StartPage);
+    unsigned int l_bad = 0;
+    for (unsigned int i = 0; i < l_h.second.m_SizePages * GEMX_pageSizeBytes / sizeof(GEMX_dataType); ++i) {
+      l_bad += (l_addr[i] != (GEMX_dataType)(l_before[l_h.first].m_StartPage + i % 97));
+    }
+    check(l_bad == 0, "program: loaded handle " + l_h.first + " lost its contents");
+  }
+  std::vector<unsigned int> l_alias = l_p.getAliasPages({l_p.getHandles().at("C1").m_StartPage});
+  check(std::find(l_alias.begin(), l_alias.end(), l_p.getHandles().at("C3").m_StartPage) != l_alias.end(),
+        "program: C3 is not reported as an alias of C1");
+  l_alias = l_p.getAliasPages({l_p.getHandles().at("In").m_StartPage});
+  check(l_alias.size() == 1, "program: loaded handle In shares pages with another handle");
+}
+
+////////////////////////  TILER  ////////////////////////
+
+struct TilerCall {
+  unsigned int m_M, m_K, m_N, m_LdA, m_LdB;
+  std::string m_A, m_B, m_C, m_X;
+  bool m_Last;
+  unsigned int m_PageA, m_PageB, m_PageC, m_PageX;
+};
+
+// Allocates the operands of each call like GenGemm::addInstr; new A and B get
+// nonzero contents so that the K padding must be zeroed by the tiler
+static GemmTiler::AddFnType
+recordCalls(ProgramType &p_Program, std::vector<TilerCall> &p_Calls,
+            unsigned int p_XElements = sizeof(GEMX_XdataType) / sizeof(GEMX_dataType)) {
+  return [&p_Program, &p_Calls, p_XElements](unsigned int p_M, unsigned int p_K, unsigned int p_N,
+                                             unsigned int p_LdA, unsigned int p_LdB,
+                                             std::string p_A, std::string p_B, std::string p_C, std::string p_X,
+                                             bool p_Last) {
+    TilerCall l_call{p_M, p_K, p_N, p_LdA, p_LdB, p_A, p_B, p_C, p_X, p_Last, 0, 0, 0, 0};
+    bool l_new;
+    l_call.m_PageA = p_Program.allocPages(p_A, l_new, (size_t)p_M * p_LdA);
+    if (l_new) std::fill_n(p_Program.getPageAddr(l_call.m_PageA), (size_t)p_M * p_LdA, (GEMX_dataType)1);
+    l_call.m_PageB = p_Program.allocPages(p_B, l_new, (size_t)p_K * p_LdB);
+    if (l_new) std::fill_n(p_Program.getPageAddr(l_call.m_PageB), (size_t)p_K * p_LdB, (GEMX_dataType)1);
+    l_call.m_PageC = p_Program.allocPages(p_C, l_new, (size_t)p_M * p_N);
+    l_call.m_PageX = p_Program.allocPages(p_X, l_new, (size_t)p_M * p_N * p_XElements);
+    p_Calls.push_back(l_call);
+  };
+}
+
+// Counts the elements of the p_Rows x p_Ld matrix at p_Handle that differ from
+// the expected value: 0 in the padding columns from p_ZeroCol and rows from
+// p_ZeroRow, 1 elsewhere
+static unsigned int
+countBad(ProgramType &p_Program, const std::string &p_Handle, unsigned int p_Rows, unsigned int p_Ld,
+         unsigned int p_ZeroRow, unsigned int p_ZeroCol) {
+  GEMX_dataType *l_addr = p_Program.getPageAddr(p_Program.getHandles().at(p_Handle).m_StartPage);
+  unsigned int l_bad = 0;
+  for (unsigned int row = 0; row < p_Rows; ++row) {
+    for (unsigned int col = 0; col < p_Ld; ++col) {
+      GEMX_dataType l_exp = ((row >= p_ZeroRow) || (col >= p_ZeroCol)) ? 0 : 1;
+      l_bad += (l_addr[(unsigned long long)row * p_Ld + col] != l_exp);
+    }
+  }
+  return(l_bad);
+}
+
+// C = A * B + X of p_M x p_K x p_N at the given pages, X of the C type as in a split op
+static void
+gemmPages(ProgramType &p_Program, unsigned int p_M, unsigned int p_K, unsigned int p_N,
+          unsigned int p_LdA, unsigned int p_LdB,
+          unsigned int p_PageA, unsigned int p_PageB, unsigned int p_PageX, GEMX_dataType *p_C) {
+  GEMX_dataType *l_a = p_Program.getPageAddr(p_PageA);
+  GEMX_dataType *l_b = p_Program.getPageAddr(p_PageB);
+  GEMX_dataType *l_x = p_Program.getPageAddr(p_PageX);
+  std::vector<long long> l_acc(p_N);
+  for (unsigned int i = 0; i < p_M; ++i) {
+    for (unsigned int j = 0; j < p_N; ++j) {
+      l_acc[j] = l_x[(unsigned long long)i * p_N + j];
+    }
+    for (unsigned int k = 0; k < p_K; ++k) {
+      long long l_aVal = l_a[(unsigned long long)i * p_LdA + k];
+      const GEMX_dataType *l_bRow = l_b + (unsigned long long)k * p_LdB;
+      for (unsigned int j = 0; j < p_N; ++j) {
+        l_acc[j] += l_aVal * l_bRow[j];
+      }
+    }
+    for (unsigned int j = 0; j < p_N; ++j) {
+      p_C[(unsigned long long)i * p_N + j] = (GEMX_dataType)l_acc[j];
+    }
+  }
+}
+
+// Runs the instructions of a split op and compares C with one unsplit GEMM of
+// the valid p_K columns of A and rows of B
+static void
+checkSplitResult(ProgramType &p_Program, const std::vector<TilerCall> &p_Calls, unsigned int p_K,
+                 const std::string &p_What) {
+  for (const TilerCall &l_call : p_Calls) {
+    gemmPages(p_Program, l_call.m_M, l_call.m_K, l_call.m_N, l_call.m_LdA, l_call.m_LdB,
+              l_call.m_PageA, l_call.m_PageB, l_call.m_PageX, p_Program.getPageAddr(l_call.m_PageC));
+  }
+  const TilerCall &l_last = p_Calls.back();
+  const std::map<std::string, PageHandleDescriptor> &l_handles = p_Program.getHandles();
+  std::vector<GEMX_dataType> l_golden((size_t)l_last.m_M * l_last.m_N);
+  gemmPages(p_Program, l_last.m_M, p_K, l_last.m_N, l_last.m_LdA, l_last.m_LdB,
+            l_handles.at("A").m_StartPage, l_handles.at("B").m_StartPage, l_handles.at("X").m_StartPage,
+            l_golden.data());
+  check(std::equal(l_golden.begin(), l_golden.end(), p_Program.getPageAddr(l_handles.at("C").m_StartPage)),
+        p_What + " does not compute A * B + X");
+}
+
+// Small values keep every partial sum exact in GEMX_dataType
+static void
+fillHandle(ProgramType &p_Program, const std::string &p_Handle, size_t p_Elements, unsigned int p_Mod) {
+  bool l_new;
+  GEMX_dataType *l_addr = p_Program.getPageAddr(p_Program.allocPages(p_Handle, l_new, p_Elements));
+  for (size_t i = 0; i < p_Elements; ++i) {
+    l_addr[i] = (GEMX_dataType)((int)((i * 7) % p_Mod) - (int)(p_Mod / 2));
+  }
+}
+
+static void
+testTiler() {
+  const unsigned int l_mMin = GEMX_gemmMBlocks * GEMX_ddrWidth;
+  const unsigned int l_kMin = GEMX_gemmKBlocks * GEMX_ddrWidth;
+  const unsigned int l_nMin = GEMX_gemmNBlocks * GEMX_ddrWidth;
+  const unsigned int l_align = GemmTiler::getSplitAlign();
+  check((l_align % l_kMin == 0) && ((l_align * sizeof(GEMX_dataType)) % GEMX_pageSizeBytes == 0),
+        "tiler split alignment is not a page of A");
+
+  // Padding to the next block edge of each dimension
+  for (auto &l_s : std::vector<std::array<unsigned int, 3> >{
+         {{1, 1, 1}}, {{l_mMin, l_kMin, l_nMin}}, {{l_mMin + 1, 3 * l_kMin - 1, 2 * l_nMin + 7}}, {{100, 300, 70}}}) {
+    GemmTiler l_tiler;
+    std::string l_what = "tiler " + std::to_string(l_s[0]) + "x" + std::to_string(l_s[1]) + "x" + std::to_string(l_s[2]);
+    check(l_tiler.plan(l_s[0], l_s[1], l_s[2], 0, false), l_what + " failed to plan");
+    check((l_tiler.getPaddedM() % l_mMin == 0) && (l_tiler.getPaddedM() >= l_s[0]) && (l_tiler.getPaddedM() < l_s[0] + l_mMin) &&
+          (l_tiler.getPaddedK() % l_kMin == 0) && (l_tiler.getPaddedK() >= l_s[1]) && (l_tiler.getPaddedK() < l_s[1] + l_kMin) &&
+          (l_tiler.getPaddedN() % l_nMin == 0) && (l_tiler.getPaddedN() >= l_s[2]) && (l_tiler.getPaddedN() < l_s[2] + l_nMin),
+          l_what + " is not padded to the next block edges");
+    check((l_tiler.getChunks().size() == 1) && (l_tiler.getChunks()[0] == l_tiler.getPaddedK()),
+          l_what + " splits K without p_MaxK");
+  }
+
+  // Split K: fewest chunks within p_MaxK, each starting on a page of A, balanced
+  // to one alignment unit
+  for (auto &l_s : std::vector<std::array<unsigned int, 2> >{
+         {{8 * l_align, 2 * l_align}}, {{9 * l_align - 5, 4 * l_align}}, {{9 * l_align, 4 * l_align + 1}},
+         {{11 * l_align, 4 * l_align}}, {{3 * l_align + l_kMin, l_align}},
+         {{2 * l_align, 8 * l_align}}, {{5 * l_kMin, 8 * l_kMin}}}) {
+    GemmTiler l_tiler;
+    std::string l_what = "tiler K " + std::to_string(l_s[0]) + " max " + std::to_string(l_s[1]);
+    check(l_tiler.plan(l_mMin, l_s[0], l_nMin, l_s[1], true), l_what + " failed to plan");
+    const std::vector<unsigned int> &l_chunks = l_tiler.getChunks();
+    if (l_tiler.getPaddedK() <= l_s[1]) {
+      check(l_chunks.size() == 1, l_what + " splits a K within p_MaxK");
+      continue;
+    }
+    unsigned int l_units = (l_tiler.getPaddedK() + l_align - 1) / l_align;
+    unsigned int l_maxUnits = l_s[1] / l_align;
+    unsigned int l_sum = 0, l_min = l_chunks[0], l_max = l_chunks[0];
+    for (unsigned int l_k : l_chunks) {
+      check((l_sum % l_align == 0) && (l_k % l_kMin == 0) && (l_k > 0) && (l_k <= l_s[1]),
+            l_what + " has a chunk of " + std::to_string(l_k) + " at " + std::to_string(l_sum));
+      l_sum += l_k;
+      l_min = std::min(l_min, l_k);
+      l_max = std::max(l_max, l_k);
+    }
+    check(l_sum == l_tiler.getPaddedK(), l_what + " chunks do not add up to the padded K");
+    check(l_chunks.size() == (l_units + l_maxUnits - 1) / l_maxUnits, l_what + " does not use the fewest chunks");
+    check(l_max - l_min <= l_align, l_what + " chunks are not balanced");
+  }
+
+  std::cerr << "INFO: the next GemmTiler errors are expected\n";
+  GemmTiler l_refuse;
+  check(!l_refuse.plan(l_mMin, 4 * l_kMin, l_nMin, l_kMin, false), "tiler splits K of an op that cannot split");
+  check(l_refuse.plan(l_mMin, l_kMin, l_nMin, l_kMin, false), "tiler refuses an op that needs no split");
+  check(!l_refuse.plan(0, l_kMin, l_nMin, 0, true), "tiler accepts an empty dimension");
+  if (l_align > l_kMin) {
+    check(!l_refuse.plan(l_mMin, 2 * l_align, l_nMin, l_align - l_kMin, true),
+          "tiler splits K into chunks that do not start on a page of A");
+  }
+
+  // One instruction, K padding zeroed in the new A
+  {
+    ProgramType l_p;
+    std::vector<TilerCall> l_calls;
+    GemmTiler l_tiler;
+    l_tiler.plan(100, 300, 70, 0, true);
+    check(l_tiler.lower(l_p, "A", "B", "C", "X", recordCalls(l_p, l_calls)), "tiler failed to lower 100x300x70");
+    check((l_calls.size() == 1) && (l_calls[0].m_A == "A") && (l_calls[0].m_B == "B") && (l_calls[0].m_C == "C") &&
+          (l_calls[0].m_X == "X") && l_calls[0].m_Last && (l_calls[0].m_M == l_tiler.getPaddedM()) &&
+          (l_calls[0].m_K == l_tiler.getPaddedK()) && (l_calls[0].m_N == l_tiler.getPaddedN()) &&
+          (l_calls[0].m_LdA == l_tiler.getPaddedK()) && (l_calls[0].m_LdB == l_tiler.getPaddedN()),
+          "tiler 100x300x70 issued the wrong instruction");
+    check(countBad(l_p, "A", l_tiler.getPaddedM(), l_tiler.getPaddedK(), l_tiler.getPaddedM(), 300) == 0,
+          "tiler did not zero exactly the K padding columns of A");
+    check(countBad(l_p, "B", l_tiler.getPaddedK(), l_tiler.getPaddedN(), l_tiler.getPaddedK(), l_tiler.getPaddedN()) == 0,
+          "tiler changed B although A holds the K padding");
+  }
+
+  // A given by an earlier op, the K padding goes to the rows of the new B
+  {
+    ProgramType l_p;
+    std::vector<TilerCall> l_calls;
+    GemmTiler l_tiler;
+    l_tiler.plan(100, 300, 70, 0, true);
+    bool l_new;
+    unsigned int l_page = l_p.allocPages("A", l_new, (size_t)l_tiler.getPaddedM() * l_tiler.getPaddedK());
+    std::fill_n(l_p.getPageAddr(l_page), (size_t)l_tiler.getPaddedM() * l_tiler.getPaddedK(), (GEMX_dataType)1);
+    check(l_tiler.lower(l_p, "A", "B", "C", "X", recordCalls(l_p, l_calls)), "tiler failed to lower with an existing A");
+    check(countBad(l_p, "B", l_tiler.getPaddedK(), l_tiler.getPaddedN(), 300, l_tiler.getPaddedN()) == 0,
+          "tiler did not zero exactly the K padding rows of B");
+    std::vector<TilerCall> l_calls2;
+    check(!l_tiler.lower(l_p, "A", "B", "C2", "X2", recordCalls(l_p, l_calls2)) && l_calls2.empty(),
+          "tiler pads K of two existing operands");
+    GemmTiler l_small;
+    l_small.plan(2 * l_tiler.getPaddedM(), 300, 70, 0, true);
+    check(!l_small.lower(l_p, "A", "B3", "C3", "X3", recordCalls(l_p, l_calls2)) && l_calls2.empty(),
+          "tiler accepts an existing operand smaller than the padded shape");
+  }
+
+  // Split K on A, B and X of earlier ops: each chunk reads views of A and B and
+  // the partial sums are chained X, C_k0, C_k1, ... with C written last. gen_bin
+  // only splits when C can be read back as X, so the chain is recorded and run
+  // with X of the C type
+  const unsigned int l_xElements = sizeof(GEMX_XdataType) / sizeof(GEMX_dataType);
+  {
+    ProgramType l_p;
+    std::vector<TilerCall> l_calls;
+    GemmTiler l_tiler;
+    const unsigned int l_k = 5 * l_align / 2 / l_kMin * l_kMin;
+    l_tiler.plan(l_mMin, l_k, l_nMin, l_align, true);
+    fillHandle(l_p, "A", (size_t)l_mMin * l_k, 5);
+    fillHandle(l_p, "B", (size_t)l_k * l_nMin, 3);
+    fillHandle(l_p, "X", (size_t)l_mMin * l_nMin * l_xElements, 11);
+    check(l_tiler.lower(l_p, "A", "B", "C", "X", recordCalls(l_p, l_calls, 1)), "tiler failed to split K of existing operands");
+    check((l_calls.size() == l_tiler.getChunks().size()) && (l_calls.size() > 1),
+          "tiler issued a wrong number of split K instructions");
+    const std::map<std::string, PageHandleDescriptor> &l_handles = l_p.getHandles();
+    unsigned int l_k0 = 0;
+    std::string l_x = "X";
+    for (unsigned int i = 0; i < l_calls.size(); ++i) {
+      std::string l_suffix = "_k" + std::to_string(i);
+      bool l_last = (i + 1 == l_calls.size());
+      std::string l_c = l_last ? "C" : "C" + l_suffix;
+      check((l_calls[i].m_A == "A" + l_suffix) && (l_calls[i].m_B == "B" + l_suffix) && (l_calls[i].m_C == l_c) &&
+            (l_calls[i].m_X == l_x) && (l_calls[i].m_Last == l_last) && (l_calls[i].m_K == l_tiler.getChunks()[i]) &&
+            (l_calls[i].m_LdA == l_k) && (l_calls[i].m_LdB == l_nMin),
+            "tiler split K instruction " + std::to_string(i) + " has the wrong operands");
+      check((l_calls[i].m_PageA * GEMX_pageSizeBytes ==
+             l_handles.at("A").m_StartPage * GEMX_pageSizeBytes + l_k0 * sizeof(GEMX_dataType)) &&
+            (l_calls[i].m_PageB * GEMX_pageSizeBytes ==
+             l_handles.at("B").m_StartPage * GEMX_pageSizeBytes + (size_t)l_k0 * l_nMin * sizeof(GEMX_dataType)),
+            "tiler split K instruction " + std::to_string(i) + " does not address a slice of A and B");
+      l_x = l_c;
+      l_k0 += l_calls[i].m_K;
+    }
+    checkSplitResult(l_p, l_calls, l_k, "tiler split K of existing operands");
+
+    // The views follow A and B through the memory plan
+    MemPlanner l_plan(l_handles);
+    for (const TilerCall &l_call : l_calls) {
+      l_plan.add(l_p.getAliasPages({l_call.m_PageA, l_call.m_PageB, l_call.m_PageX}), l_p.getAliasPages({l_call.m_PageC}));
+    }
+    l_plan.plan();
+    unsigned int l_oldA = l_handles.at("A").m_StartPage, l_oldB = l_handles.at("B").m_StartPage;
+    std::map<unsigned int, unsigned int> l_map = l_p.applyMemPlan(l_plan);
+    for (const TilerCall &l_call : l_calls) {
+      check((l_map.count(l_call.m_PageA) == 1) && (l_map.count(l_call.m_PageB) == 1) &&
+            (l_map.at(l_call.m_PageA) - l_handles.at("A").m_StartPage == l_call.m_PageA - l_oldA) &&
+            (l_map.at(l_call.m_PageB) - l_handles.at("B").m_StartPage == l_call.m_PageB - l_oldB),
+            "memory plan does not move the views of " + l_call.m_A + " and " + l_call.m_B + " with their parents");
+    }
+  }
+
+  // Split K of a new A and B: the tiler generates them and zeroes the K padding of A
+  {
+    ProgramType l_p;
+    std::vector<TilerCall> l_calls;
+    GemmTiler l_tiler;
+    const unsigned int l_k = 2 * l_align + l_kMin - 9;
+    l_tiler.plan(l_mMin, l_k, l_nMin, l_align, true);
+    fillHandle(l_p, "X", (size_t)l_mMin * l_nMin * l_xElements, 11);
+    check(l_tiler.lower(l_p, "A", "B", "C", "X", recordCalls(l_p, l_calls, 1)), "tiler failed to split K of new operands");
+    GEMX_dataType *l_a = l_p.getPageAddr(l_p.getHandles().at("A").m_StartPage);
+    unsigned int l_bad = 0;
+    for (unsigned int row = 0; row < l_mMin; ++row) {
+      for (unsigned int col = l_k; col < l_tiler.getPaddedK(); ++col) {
+        l_bad += (l_a[(unsigned long long)row * l_tiler.getPaddedK() + col] != 0);
+      }
+    }
+    check((l_bad == 0) && (std::count(l_a, l_a + l_k, (GEMX_dataType)0) < (long)l_k),
+          "tiler did not generate A with zeroed K padding");
+    checkSplitResult(l_p, l_calls, l_k, "tiler split K of new operands");
+  }
+}
+
+int main()
+{
+  testMemPlanner();
+  testTiler();
+  if (g_Errors != 0) {
+    std::cout << "FAIL: " << g_Errors << " gen_bin checks failed\n";
+    return(EXIT_FAILURE);
+  }
+  std::cout << "PASS: gemx_gen_bin_test\n";
+  return(EXIT_SUCCESS);
+}
@@ -19,45 +19,48 @@
 
 #include "gemx_gen_bin.h"
 #include "gemx_matrix.h"
+#include "gemx_ref_gemm.h"
 
 typedef FcnType::FcnArgsType FcnArgsType;
 typedef DenseMat<GEMX_XdataType> XMatType;
 
+// The matrices are given in their stored layout, as for gemm_ref
 template <typename T>
-void fcn_ref(DenseMat<T> & p_A, DenseMat<T> & p_B, DenseMat<T> & p_C, DenseMat<GEMX_XdataType> & p_X,  int32_t p_postScale, int16_t p_PReluVal) {
-        assert(p_A.rows() == p_C.rows());
-        assert(p_A.cols() == p_B.rows());
-        assert(p_B.cols() == p_C.cols());
+void fcn_ref(DenseMat<T> & p_A, DenseMat<T> & p_B, DenseMat<T> & p_C, DenseMat<GEMX_XdataType> & p_X,  int32_t p_postScale, int16_t p_PReluVal,
+             bool p_TransA = false, bool p_TransB = false, bool p_TransC = false) {
+        const unsigned int l_M = p_TransC ? p_C.cols() : p_C.rows();
+        const unsigned int l_N = p_TransC ? p_C.rows() : p_C.cols();
+        const unsigned int l_K = p_TransA ? p_A.rows() : p_A.cols();
+        assert((p_TransA ? p_A.cols() : p_A.rows()) == l_M);
+        assert((p_TransB ? p_B.cols() : p_B.rows()) == l_K);
+        assert((p_TransB ? p_B.rows() : p_B.cols()) == l_N);
         assert(p_X.rows() == p_C.rows());
         assert(p_X.cols() == p_C.cols());
-        for (unsigned int row = 0; row < p_C.rows(); ++row) {
-          for (unsigned int col = 0; col < p_C.cols(); ++col) {
-            #if GEMX_keepMacBits
-                int64_t l_val = 0;
-            #else
-                T l_val=0;
-            #endif
-            for (unsigned int k = 0; k < p_A.cols(); ++k) {
-                l_val += p_A.getVal(row, k) * p_B.getVal(k, col);
-            }
-            l_val += p_X.getVal(row,col);
-            #if GEMX_keepMacBits
-                unsigned int l_psShift = p_postScale & 0x00ff;
-                int64_t l_psVal =  p_postScale >> 8;
-                l_val = l_val * l_psVal;
-                l_val = l_val >> l_psShift;
-            #endif
-            T l_entry = (T)(l_val);
+        #if GEMX_keepMacBits
+          typedef int64_t AccType;
+          auto l_post = [p_postScale, p_PReluVal](AccType p_Acc, GEMX_XdataType p_X) {
+            T l_entry = gemx::refPostScaleMacBits<T>(p_Acc + (int64_t)p_X, p_postScale);
             if (l_entry < 0) {
-              #if GEMX_keepMacBits
-                  l_entry = l_entry * (p_PReluVal >> 6) >> (p_PReluVal & 0x003f);
-              #else
-                  l_entry = 0;
-              #endif
+              l_entry = l_entry * (p_PReluVal >> 6) >> (p_PReluVal & 0x003f);
             }
-            p_C.getVal(row, col) = l_entry;
-          }
-        }
+            return l_entry;
+          };
+        #else
+          typedef typename std::conditional<std::is_floating_point<T>::value, T, int64_t>::type AccType;
+          auto l_post = [](AccType p_Acc, GEMX_XdataType p_X) {
+            T l_entry = (T)(p_Acc + p_X);
+            return (l_entry < 0) ? T(0) : l_entry;
+          };
+        #endif
+        gemx::refGemm<AccType>(
+          l_M, l_K, l_N,
+          &p_A.getVal(0, 0), p_A.ld(),
+          &p_B.getVal(0, 0), p_B.ld(),
+          &p_X.getVal(0, 0), p_X.ld(),
+          &p_C.getVal(0, 0), p_C.ld(),
+          l_post,
+          p_TransA, p_TransB, p_TransC
+        );
 }
 
 class GenFcn
@@ -81,7 +84,8 @@ class GenFcn
     bool check(
       unsigned int p_M, unsigned int p_K, unsigned int p_N,
       unsigned int p_LdA, unsigned int p_LdB, unsigned int p_LdC,
-      unsigned int p_LdX
+      unsigned int p_LdX,
+      bool p_TransA = false, bool p_TransB = false, bool p_TransC = false
     ) {
         bool ok = true;
         const unsigned int l_Edge = GEMX_ddrWidth;
@@ -92,10 +96,10 @@ class GenFcn
         ok = checkDim("M", p_M, l_mMin, l_mMin) &&
              checkDim("K", p_K, l_kMin, l_kMin) &&
              checkDim("N", p_N, l_nMin, l_nMin) &&
-             checkDim("LdA", p_LdA, l_Edge, p_K) &&
-             checkDim("LdB", p_LdB, l_Edge, p_N) &&
-             checkDim("LdC", p_LdC, l_Edge, p_N) &&
-             checkDim("LdX", p_LdX, l_Edge, p_N);
+             checkDim("LdA", p_LdA, l_Edge, p_TransA ? p_M : p_K) &&
+             checkDim("LdB", p_LdB, l_Edge, p_TransB ? p_K : p_N) &&
+             checkDim("LdC", p_LdC, l_Edge, p_TransC ? p_M : p_N) &&
+             checkDim("LdX", p_LdX, l_Edge, p_TransC ? p_M : p_N);
         return(ok);
       }
     
@@ -211,7 +215,10 @@ class GenFcn
         }
       }
       
-    void addInstrFromFiles(
+    // Returns false, with the error printed, when the instruction or a matrix
+    // file cannot be used
+    bool
+    addInstrFromFiles(
       unsigned int l_instrIndex,
       ProgramType &p_Program,
       std::string p_InsName, std::string p_MatAName, std::string p_MatBName, std::string p_MatXName,
@@ -255,17 +262,16 @@ class GenFcn
            checkDim("K", l_K, l_Edge, 2*l_Edge) &&
            checkDim("LdA", l_LdA, l_Edge, l_K);
           if (!ok) {
-            return;
+            return(false);
           }
           //allocate host memory and initialize it with data from the file
           l_pageA = p_Program.allocPages(l_handleA, l_newAllocA, l_M * l_LdA);
           MatType l_matA(l_M, l_K, l_LdA, p_Program.getPageAddr(l_pageA));
           
-          if (l_fs_matA.good()){
-            while (l_fs_matA.peek()=='#') l_fs_matA.ignore(2048, '\n');
-            if (l_newAllocA) {
-              l_matA.fillFromFile(l_fs_matA);      
-            }
+          if (l_newAllocA && !l_matA.fillFromFile(p_MatAName, l_fs_matA)) {
+            std::cerr << "ERROR: failed to load matrix A from " << p_MatAName << "\n";
+            l_fs_ins.close();
+            return(false);
           }
           //read matrix B dimensions
           unsigned int l_bK;
@@ -275,16 +281,15 @@ class GenFcn
           ok = checkDim("N", l_N, l_Edge, 1) && checkDim("LdB", l_LdB, l_Edge, l_N);
           if (!ok) {
             l_fs_ins.close();
-            return;
+            return(false);
           }
 
           l_pageB = p_Program.allocPages(l_handleB, l_newAllocB, l_K * l_LdB);
           MatType l_matB(l_K, l_N, l_LdB, p_Program.getPageAddr(l_pageB));
-          if (l_fs_matB.good()){
-            while (l_fs_matB.peek()=='#') l_fs_matB.ignore(2048, '\n');
-            if (l_newAllocB) {
-              l_matB.fillFromFile(l_fs_matB);      
-            }
+          if (l_newAllocB && !l_matB.fillFromFile(p_MatBName, l_fs_matB)) {
+            std::cerr << "ERROR: failed to load matrix B from " << p_MatBName << "\n";
+            l_fs_ins.close();
+            return(false);
           }
           //read matrix X dimensions
           unsigned int l_xM, l_xN;
@@ -295,16 +300,15 @@ class GenFcn
           ok = checkDim("LdX", l_LdX, l_Edge, l_N);
           if (!ok) {
             l_fs_ins.close();
-            return;
+            return(false);
           }
 
           l_pageX = p_Program.allocPages(l_handleX, l_newAllocX, l_M*l_N*(sizeof(GEMX_XdataType)/sizeof(GEMX_dataType)));
           XMatType l_matX(l_M, l_N, l_LdX, (GEMX_XdataType *) p_Program.getPageAddr(l_pageX));
-          if (l_fs_matX.good()){
-            while (l_fs_matX.peek()=='#') l_fs_matX.ignore(2048, '\n');
-            if (l_newAllocX) {
-              l_matX.fillFromFile(l_fs_matX);
-            }
+          if (l_newAllocX && !l_matX.fillFromFile(p_MatXName, l_fs_matX)) {
+            std::cerr << "ERROR: failed to load matrix X from " << p_MatXName << "\n";
+            l_fs_ins.close();
+            return(false);
           }
           //read matrix C dimensions
           unsigned int l_cM, l_cN;
@@ -315,7 +319,7 @@ class GenFcn
           ok = checkDim("LdC", l_LdC, l_Edge, l_N);
           if (!ok) {
             l_fs_ins.close();
-            return;
+            return(false);
           }  
           l_pageC = p_Program.allocPages(l_handleC, l_newAllocC, l_M * l_LdC);
           MatType l_matC(l_M, l_N, l_LdC, p_Program.getPageAddr(l_pageC));
@@ -341,8 +345,10 @@ class GenFcn
           l_fs_matB.close();
           l_fs_matX.close();
           
+          return(true);
         } else {
-          std::cout << "ERROR: bad filename" << "\n";
+          std::cerr << "ERROR: bad filename " << p_InsName << "\n";
+          return(false);
         }
       }
       
@@ -354,20 +360,26 @@ class GenFcn
       int32_t p_postScale, int16_t p_PReluVal,
       std::string p_handleA, std::string p_handleB, std::string p_handleC,
       std::string p_handleX,
-      bool p_WithGolden
+      bool p_WithGolden,
+      bool p_TransA = false, bool p_TransB = false, bool p_TransC = false
     ) {    
+        // Stored shapes, transposed operands keep their rows along M or N
+        unsigned int l_aRows = p_TransA ? p_K : p_M, l_aCols = p_TransA ? p_M : p_K;
+        unsigned int l_bRows = p_TransB ? p_N : p_K, l_bCols = p_TransB ? p_K : p_N;
+        unsigned int l_cRows = p_TransC ? p_N : p_M, l_cCols = p_TransC ? p_M : p_N;
+
         // Allocate all pages before getting any address
         bool l_newAllocA, l_newAllocB, l_newAllocC, l_newAllocX;
-        unsigned int l_pageA = p_Program.allocPages(p_handleA, l_newAllocA, p_M * p_LdA);
-        unsigned int l_pageB = p_Program.allocPages(p_handleB, l_newAllocB, p_K * p_LdB);
-        unsigned int l_pageC = p_Program.allocPages(p_handleC, l_newAllocC, p_M * p_LdC);
-        unsigned int l_pageX = p_Program.allocPages(p_handleX, l_newAllocX, p_M * p_LdX * (sizeof(GEMX_XdataType)/sizeof(GEMX_dataType)));
+        unsigned int l_pageA = p_Program.allocPages(p_handleA, l_newAllocA, l_aRows * p_LdA);
+        unsigned int l_pageB = p_Program.allocPages(p_handleB, l_newAllocB, l_bRows * p_LdB);
+        unsigned int l_pageC = p_Program.allocPages(p_handleC, l_newAllocC, l_cRows * p_LdC);
+        unsigned int l_pageX = p_Program.allocPages(p_handleX, l_newAllocX, l_cRows * p_LdX * (sizeof(GEMX_XdataType)/sizeof(GEMX_dataType)));
         
         // Get addresses where matrices are stored
-        MatType l_matA(p_M, p_K, p_LdA, p_Program.getPageAddr(l_pageA));
-        MatType l_matB(p_K, p_N, p_LdB, p_Program.getPageAddr(l_pageB));
-        XMatType l_matX(p_M, p_N, p_LdX, (GEMX_XdataType *) p_Program.getPageAddr(l_pageX));
-        MatType l_matC(p_M, p_N, p_LdC, p_Program.getPageAddr(l_pageC));
+        MatType l_matA(l_aRows, l_aCols, p_LdA, p_Program.getPageAddr(l_pageA));
+        MatType l_matB(l_bRows, l_bCols, p_LdB, p_Program.getPageAddr(l_pageB));
+        XMatType l_matX(l_cRows, l_cCols, p_LdX, (GEMX_XdataType *) p_Program.getPageAddr(l_pageX));
+        MatType l_matC(l_cRows, l_cCols, p_LdC, p_Program.getPageAddr(l_pageC));
         
         // Instruction
         FcnArgsType l_fcnArgs(
@@ -375,7 +387,8 @@ class GenFcn
             p_M, p_K, p_N,
             p_LdA, p_LdB, p_LdC, p_LdX,
             p_postScale,
-            p_PReluVal
+            p_PReluVal,
+            p_TransA, p_TransB, p_TransC
           );
         KargsType l_kargs;
         l_kargs.setFcnArgs(l_fcnArgs);
@@ -393,11 +406,28 @@ class GenFcn
       
         // Calculate reference C = A * B
         if (p_WithGolden) {
-            fcn_ref<GEMX_dataType>(l_matA, l_matB, l_matC, l_matX, p_postScale, p_PReluVal);
+            fcn_ref<GEMX_dataType>(l_matA, l_matB, l_matC, l_matX, p_postScale, p_PReluVal, p_TransA, p_TransB, p_TransC);
         }
         std::cout << "Added FCN" << p_M << "x" << p_K << "x" << p_N << " postScale: " << p_postScale << " PReluVal: " << p_PReluVal << "  ";
       }
     
+    // Reference C = PRelu(postScale(A * B + X)) for an instruction already in p_Program
+    void golden(
+      ProgramType &p_Program,
+      FcnArgsType p_FcnArgs) {
+        unsigned int l_M = p_FcnArgs.m_M,
+                     l_K = p_FcnArgs.m_K,
+                     l_N = p_FcnArgs.m_N;
+        bool l_transA = p_FcnArgs.m_TransA,
+             l_transB = p_FcnArgs.m_TransB,
+             l_transC = p_FcnArgs.m_TransC;
+        MatType l_matA(l_transA ? l_K : l_M, l_transA ? l_M : l_K, p_FcnArgs.m_Lda, p_Program.getPageAddr(p_FcnArgs.m_Aoffset));
+        MatType l_matB(l_transB ? l_N : l_K, l_transB ? l_K : l_N, p_FcnArgs.m_Ldb, p_Program.getPageAddr(p_FcnArgs.m_Boffset));
+        XMatType l_matX(l_transC ? l_N : l_M, l_transC ? l_M : l_N, p_FcnArgs.m_Ldx, (GEMX_XdataType *)p_Program.getPageAddr(p_FcnArgs.m_Xoffset));
+        MatType l_matC(l_transC ? l_N : l_M, l_transC ? l_M : l_N, p_FcnArgs.m_Ldc, p_Program.getPageAddr(p_FcnArgs.m_Coffset));
+        fcn_ref<GEMX_dataType>(l_matA, l_matB, l_matC, l_matX, p_FcnArgs.m_postScale, p_FcnArgs.m_PReluVal, l_transA, l_transB, l_transC);
+      }
+
     void show(
       ProgramType &p_Program,
       FcnArgsType p_FcnArgs) {
@@ -410,15 +440,19 @@ class GenFcn
                      l_ldX = p_FcnArgs.m_Ldx;
         int32_t l_postScale = p_FcnArgs.m_postScale;
         int16_t l_PReluVal = p_FcnArgs.m_PReluVal;
+        bool l_transA = p_FcnArgs.m_TransA,
+             l_transB = p_FcnArgs.m_TransB,
+             l_transC = p_FcnArgs.m_TransC;
 
-        MatType l_matA(l_M, l_K, l_ldA, p_Program.getPageAddr(p_FcnArgs.m_Aoffset));
-        MatType l_matB(l_K, l_N, l_ldB, p_Program.getPageAddr(p_FcnArgs.m_Boffset));
-        XMatType l_matX(l_M, l_N, l_ldX, (GEMX_XdataType *)p_Program.getPageAddr(p_FcnArgs.m_Xoffset));
-        MatType l_matC(l_M, l_N, l_ldC, p_Program.getPageAddr(p_FcnArgs.m_Coffset));
+        MatType l_matA(l_transA ? l_K : l_M, l_transA ? l_M : l_K, l_ldA, p_Program.getPageAddr(p_FcnArgs.m_Aoffset));
+        MatType l_matB(l_transB ? l_N : l_K, l_transB ? l_K : l_N, l_ldB, p_Program.getPageAddr(p_FcnArgs.m_Boffset));
+        XMatType l_matX(l_transC ? l_N : l_M, l_transC ? l_M : l_N, l_ldX, (GEMX_XdataType *)p_Program.getPageAddr(p_FcnArgs.m_Xoffset));
+        MatType l_matC(l_transC ? l_N : l_M, l_transC ? l_M : l_N, l_ldC, p_Program.getPageAddr(p_FcnArgs.m_Coffset));
         std::cout << "\n###########  Op Fcn  ###########\n"
                   << "  C = A * B + X  postScale PReluVal " << "\n"
                   << l_M << "x" << l_N << " = " << l_M << "x" << l_K << " * " << l_K << "x" << l_N << " + " << l_M << " x " << l_N <<"\n"
                   << l_postScale << " " << l_PReluVal << "\n"
+                  << " transA " << l_transA << " transB " << l_transB << " transC " << l_transC << "\n"
                   << "  A " << l_matA << "\n"
                   << "  B " << l_matB << "\n"
                   << "  X " << l_matX << "\n"
@@ -439,8 +473,10 @@ class GenFcn
         int32_t      l_postScale = p_FcnArgs.m_postScale;
         int16_t      l_PReluVal = p_FcnArgs.m_PReluVal;
 
-        MatType l_matC0(l_M, l_N, l_ldC, p_Program0.getPageAddr(p_FcnArgs.m_Coffset)),
-            l_matC1(l_M, l_N, l_ldC, p_Program1.getPageAddr(p_FcnArgs.m_Coffset));
+        unsigned int l_cRows = p_FcnArgs.m_TransC ? l_N : l_M,
+                     l_cCols = p_FcnArgs.m_TransC ? l_M : l_N;
+        MatType l_matC0(l_cRows, l_cCols, l_ldC, p_Program0.getPageAddr(p_FcnArgs.m_Coffset)),
+            l_matC1(l_cRows, l_cCols, l_ldC, p_Program1.getPageAddr(p_FcnArgs.m_Coffset));
         std::cout << "\n###########  Op Fcn  ###########\n"
                   << "  C = A * B + X  postScale PReluVal "
                   << l_M << "x" << l_N << " = " << l_M << "x" << l_K << " * " << l_K << "x" << l_N << " + " << l_M << " x " << l_N <<"\n"
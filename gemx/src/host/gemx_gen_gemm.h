@@ -19,38 +19,44 @@
 
 #include "gemx_gen_bin.h"
 #include "gemx_matrix.h"
+#include "gemx_ref_gemm.h"
 
 typedef GemmType::GemmArgsType GemmArgsType;
 typedef DenseMat<GEMX_XdataType> XMatType;
 
+// The matrices are given in their stored layout, K x M for a transposed A,
+// N x K for B and N x M for X and C
 template <typename T>
-void gemm_ref(DenseMat<T> & p_A, DenseMat<T> & p_B,  DenseMat<T> & p_C, DenseMat<GEMX_XdataType> & p_X, int32_t p_postScale) {
-        assert(p_A.rows() == p_C.rows());
-        assert(p_A.cols() == p_B.rows());
-        assert(p_B.cols() == p_C.cols());
+void gemm_ref(DenseMat<T> & p_A, DenseMat<T> & p_B,  DenseMat<T> & p_C, DenseMat<GEMX_XdataType> & p_X, int32_t p_postScale,
+              bool p_TransA = false, bool p_TransB = false, bool p_TransC = false) {
+        const unsigned int l_M = p_TransC ? p_C.cols() : p_C.rows();
+        const unsigned int l_N = p_TransC ? p_C.rows() : p_C.cols();
+        const unsigned int l_K = p_TransA ? p_A.rows() : p_A.cols();
+        assert((p_TransA ? p_A.cols() : p_A.rows()) == l_M);
+        assert((p_TransB ? p_B.cols() : p_B.rows()) == l_K);
+        assert((p_TransB ? p_B.rows() : p_B.cols()) == l_N);
         assert(p_X.rows() == p_C.rows());
         assert(p_X.cols() == p_C.cols());
-        for (unsigned int row = 0; row < p_C.rows(); ++row) {
-          for (unsigned int col = 0; col < p_C.cols(); ++col) {
-            #if GEMX_keepMacBits
-                int64_t l_val = 0;
-            #else
-                T l_val=0;
-            #endif
-            for (unsigned int k = 0; k < p_A.cols(); ++k) {
-              l_val += p_A.getVal(row, k) * p_B.getVal(k, col);
-            }
-            l_val += p_X.getVal(row, col);
-            #if GEMX_keepMacBits
-              unsigned int l_psShift = p_postScale & 0x00ff;
-              int64_t l_psVal =  p_postScale >> 8;
-              l_val = l_val * l_psVal;
-              l_val = l_val >> l_psShift;
-            #endif
-            T l_entry = (T)(l_val);
-            p_C.getVal(row, col) = l_entry;
-          }
-        }
+        #if GEMX_keepMacBits
+          typedef int64_t AccType;
+          auto l_post = [p_postScale](AccType p_Acc, GEMX_XdataType p_X) {
+            return gemx::refPostScaleMacBits<T>(p_Acc + (int64_t)p_X, p_postScale);
+          };
+        #else
+          typedef typename std::conditional<std::is_floating_point<T>::value, T, int64_t>::type AccType;
+          auto l_post = [](AccType p_Acc, GEMX_XdataType p_X) {
+            return (T)(p_Acc + p_X);
+          };
+        #endif
+        gemx::refGemm<AccType>(
+          l_M, l_K, l_N,
+          &p_A.getVal(0, 0), p_A.ld(),
+          &p_B.getVal(0, 0), p_B.ld(),
+          &p_X.getVal(0, 0), p_X.ld(),
+          &p_C.getVal(0, 0), p_C.ld(),
+          l_post,
+          p_TransA, p_TransB, p_TransC
+        );
       }
 
 
@@ -79,7 +85,10 @@ class GenGemm
       unsigned int p_LdA,
       unsigned int p_LdB,
       unsigned int p_LdC,
-      unsigned int p_LdX
+      unsigned int p_LdX,
+      bool p_TransA = false,
+      bool p_TransB = false,
+      bool p_TransC = false
     ) {
         bool ok = true;
         const unsigned int l_Edge = GEMX_ddrWidth;
@@ -90,10 +99,10 @@ class GenGemm
         ok = checkDim("M", p_M, l_mMin, l_mMin) &&
              checkDim("K", p_K, l_kMin, l_kMin) &&
              checkDim("N", p_N, l_nMin, l_nMin) &&
-             checkDim("LdA", p_LdA, l_Edge, p_K) &&
-             checkDim("LdB", p_LdB, l_Edge, p_N) &&
-             checkDim("LdC", p_LdC, l_Edge, p_N) &&
-             checkDim("LdX", p_LdX, l_Edge, p_N);
+             checkDim("LdA", p_LdA, l_Edge, p_TransA ? p_M : p_K) &&
+             checkDim("LdB", p_LdB, l_Edge, p_TransB ? p_K : p_N) &&
+             checkDim("LdC", p_LdC, l_Edge, p_TransC ? p_M : p_N) &&
+             checkDim("LdX", p_LdX, l_Edge, p_TransC ? p_M : p_N);
         return(ok);
       }
     
@@ -112,28 +121,37 @@ class GenGemm
       std::string p_handleB,
       std::string p_handleC,
       std::string p_handleX,
-      bool p_WithGolden
+      bool p_WithGolden,
+      bool p_TransA = false,
+      bool p_TransB = false,
+      bool p_TransC = false
     ) {
     
+        // Stored shapes, transposed operands keep their rows along M or N
+        unsigned int l_aRows = p_TransA ? p_K : p_M, l_aCols = p_TransA ? p_M : p_K;
+        unsigned int l_bRows = p_TransB ? p_N : p_K, l_bCols = p_TransB ? p_K : p_N;
+        unsigned int l_cRows = p_TransC ? p_N : p_M, l_cCols = p_TransC ? p_M : p_N;
+
         // Allocate all pages before getting any address
         bool l_newAllocA, l_newAllocB, l_newAllocC, l_newAllocX;
-        unsigned int l_pageA = p_Program.allocPages(p_handleA, l_newAllocA, p_M * p_LdA);
-        unsigned int l_pageB = p_Program.allocPages(p_handleB, l_newAllocB, p_K * p_LdB);
-        unsigned int l_pageX = p_Program.allocPages(p_handleX, l_newAllocX, p_M * p_LdX * (sizeof(GEMX_XdataType)/sizeof(GEMX_dataType)));
-        unsigned int l_pageC = p_Program.allocPages(p_handleC, l_newAllocC, p_M * p_LdC);
+        unsigned int l_pageA = p_Program.allocPages(p_handleA, l_newAllocA, l_aRows * p_LdA);
+        unsigned int l_pageB = p_Program.allocPages(p_handleB, l_newAllocB, l_bRows * p_LdB);
+        unsigned int l_pageX = p_Program.allocPages(p_handleX, l_newAllocX, l_cRows * p_LdX * (sizeof(GEMX_XdataType)/sizeof(GEMX_dataType)));
+        unsigned int l_pageC = p_Program.allocPages(p_handleC, l_newAllocC, l_cRows * p_LdC);
         
         // Get addresses where matrices are stored
-        MatType l_matA(p_M, p_K, p_LdA, p_Program.getPageAddr(l_pageA));
-        MatType l_matB(p_K, p_N, p_LdB, p_Program.getPageAddr(l_pageB));
-        XMatType l_matX(p_M, p_N, p_LdX, (GEMX_XdataType *) p_Program.getPageAddr(l_pageX));
-        MatType l_matC(p_M, p_N, p_LdC, p_Program.getPageAddr(l_pageC));
+        MatType l_matA(l_aRows, l_aCols, p_LdA, p_Program.getPageAddr(l_pageA));
+        MatType l_matB(l_bRows, l_bCols, p_LdB, p_Program.getPageAddr(l_pageB));
+        XMatType l_matX(l_cRows, l_cCols, p_LdX, (GEMX_XdataType *) p_Program.getPageAddr(l_pageX));
+        MatType l_matC(l_cRows, l_cCols, p_LdC, p_Program.getPageAddr(l_pageC));
         
         // Instruction
         GemmArgsType l_gemmArgs(
             l_pageA, l_pageB, l_pageC, l_pageX,
             p_M, p_K, p_N,
             p_LdA, p_LdB, p_LdC, p_LdX,
-            p_postScale
+            p_postScale,
+            p_TransA, p_TransB, p_TransC
           );
         KargsType l_kargs;
         l_kargs.setGemmArgs(l_gemmArgs);
@@ -152,12 +170,14 @@ class GenGemm
         // Calculate reference C = postScale(A * B + X)
         if (p_WithGolden) {
           //l_matC.multiplyAddScale(l_matA, l_matB, l_matX, p_postScale);
-          gemm_ref<GEMX_dataType>(l_matA, l_matB, l_matC, l_matX, p_postScale);
+          gemm_ref<GEMX_dataType>(l_matA, l_matB, l_matC, l_matX, p_postScale, p_TransA, p_TransB, p_TransC);
         }
         std::cout << "Added GEMM " << p_M << "x" << p_K << "x" << p_N << "  ";
       }
     
-    void 
+    // Returns false, with the error printed, when the instruction or a matrix
+    // file cannot be used
+    bool
     addInstrFromFiles(
       unsigned int l_instrIndex,
       ProgramType &p_Program,
@@ -202,16 +222,15 @@ class GenGemm
                checkDim("K", l_K, l_Edge, 2*l_Edge) &&
                checkDim("LdA", l_LdA, l_Edge, l_K);
           if (!ok) {
-            return;
+            return(false);
           }
           //allocate host memory and initialize it with data from the file
           l_pageA = p_Program.allocPages(l_handleA, l_newAllocA, l_M * l_LdA);
           MatType l_matA(l_M, l_K, l_LdA, p_Program.getPageAddr(l_pageA));
-          if (l_fs_matA.good()){
-            while (l_fs_matA.peek()=='#') l_fs_matA.ignore(2048, '\n');
-            if (l_newAllocA) {
-              l_matA.fillFromFile(l_fs_matA);      
-            }
+          if (l_newAllocA && !l_matA.fillFromFile(p_MatAName, l_fs_matA)) {
+            std::cerr << "ERROR: failed to load matrix A from " << p_MatAName << "\n";
+            l_fs_ins.close();
+            return(false);
           }
           //read matrix B dimensions
           unsigned int l_bK;
@@ -222,17 +241,16 @@ class GenGemm
                checkDim("LdB", l_LdB, l_Edge, l_N);
           if (!ok) {
             l_fs_ins.close();
-            return;
+            return(false);
           }
 
           l_pageB = p_Program.allocPages(l_handleB, l_newAllocB, l_K * l_LdB);
           MatType l_matB(l_K, l_N, l_LdB, p_Program.getPageAddr(l_pageB));
-          if (l_fs_matB.good()){
-            while (l_fs_matB.peek()=='#') l_fs_matB.ignore(2048, '\n');
-            if (l_newAllocB) {
-              l_matB.fillFromFile(l_fs_matB);      
-            }
-          }          
+          if (l_newAllocB && !l_matB.fillFromFile(p_MatBName, l_fs_matB)) {
+            std::cerr << "ERROR: failed to load matrix B from " << p_MatBName << "\n";
+            l_fs_ins.close();
+            return(false);
+          }
           //read matrix X dimensions
           unsigned int l_xM, l_xN;
           l_fs_ins >> l_handleX >> l_xM >> l_xN >> l_LdX;
@@ -242,16 +260,15 @@ class GenGemm
           ok = checkDim("LdX", l_LdX, l_Edge, l_N);
           if (!ok) {
               l_fs_ins.close();
-              return;
+              return(false);
           }
 
           l_pageX = p_Program.allocPages(l_handleX, l_newAllocX, l_M*l_N*(sizeof(GEMX_XdataType)/sizeof(GEMX_dataType)));
           XMatType l_matX(l_M, l_N, l_LdX, (GEMX_XdataType *) p_Program.getPageAddr(l_pageX));
-          if (l_fs_matX.good()){
-            while (l_fs_matX.peek()=='#') l_fs_matX.ignore(2048, '\n');
-            if (l_newAllocX) {
-              l_matX.fillFromFile(l_fs_matX);
-            }
+          if (l_newAllocX && !l_matX.fillFromFile(p_MatXName, l_fs_matX)) {
+            std::cerr << "ERROR: failed to load matrix X from " << p_MatXName << "\n";
+            l_fs_ins.close();
+            return(false);
           }
           //read matrix C dimensions
           unsigned int l_cM, l_cN;
@@ -262,7 +279,7 @@ class GenGemm
           ok = checkDim("LdC", l_LdC, l_Edge, l_N);
           if (!ok) {
               l_fs_ins.close();
-              return;
+              return(false);
           }    
           l_pageC = p_Program.allocPages(l_handleC, l_newAllocC, l_M * l_LdC);
           MatType l_matC(l_M, l_N, l_LdC, p_Program.getPageAddr(l_pageC));
@@ -287,11 +304,31 @@ class GenGemm
           l_fs_matB.close();
           l_fs_matX.close();
           
+          return(true);
         } else {
-          std::cout << "ERROR: bad filename" << "\n";
+          std::cerr << "ERROR: bad filename " << p_InsName << "\n";
+          return(false);
         }
       }
     
+    // Reference C = postScale(A * B + X) for an instruction already in p_Program
+    void
+    golden(
+      ProgramType &p_Program,
+      GemmArgsType p_GemmArgs) {
+        unsigned int l_M = p_GemmArgs.m_M,
+                     l_K = p_GemmArgs.m_K,
+                     l_N = p_GemmArgs.m_N;
+        bool l_transA = p_GemmArgs.m_TransA,
+             l_transB = p_GemmArgs.m_TransB,
+             l_transC = p_GemmArgs.m_TransC;
+        MatType l_matA(l_transA ? l_K : l_M, l_transA ? l_M : l_K, p_GemmArgs.m_Lda, p_Program.getPageAddr(p_GemmArgs.m_Aoffset));
+        MatType l_matB(l_transB ? l_N : l_K, l_transB ? l_K : l_N, p_GemmArgs.m_Ldb, p_Program.getPageAddr(p_GemmArgs.m_Boffset));
+        XMatType l_matX(l_transC ? l_N : l_M, l_transC ? l_M : l_N, p_GemmArgs.m_Ldx, (GEMX_XdataType *)p_Program.getPageAddr(p_GemmArgs.m_Xoffset));
+        MatType l_matC(l_transC ? l_N : l_M, l_transC ? l_M : l_N, p_GemmArgs.m_Ldc, p_Program.getPageAddr(p_GemmArgs.m_Coffset));
+        gemm_ref<GEMX_dataType>(l_matA, l_matB, l_matC, l_matX, p_GemmArgs.m_postScale, l_transA, l_transB, l_transC);
+      }
+
     void
     show(
       ProgramType &p_Program,
@@ -304,14 +341,18 @@ class GenGemm
                      l_ldC = p_GemmArgs.m_Ldc,
                      l_ldX = p_GemmArgs.m_Ldx;
         int32_t l_postScale = p_GemmArgs.m_postScale;
-        MatType l_matA(l_M, l_K, l_ldA, p_Program.getPageAddr(p_GemmArgs.m_Aoffset));
-        MatType l_matB(l_K, l_N, l_ldB, p_Program.getPageAddr(p_GemmArgs.m_Boffset));
-          XMatType l_matX(l_M, l_N, l_ldX, (GEMX_XdataType *)p_Program.getPageAddr(p_GemmArgs.m_Xoffset));
-        MatType l_matC(l_M, l_N, l_ldC, p_Program.getPageAddr(p_GemmArgs.m_Coffset));
+        bool l_transA = p_GemmArgs.m_TransA,
+             l_transB = p_GemmArgs.m_TransB,
+             l_transC = p_GemmArgs.m_TransC;
+        MatType l_matA(l_transA ? l_K : l_M, l_transA ? l_M : l_K, l_ldA, p_Program.getPageAddr(p_GemmArgs.m_Aoffset));
+        MatType l_matB(l_transB ? l_N : l_K, l_transB ? l_K : l_N, l_ldB, p_Program.getPageAddr(p_GemmArgs.m_Boffset));
+          XMatType l_matX(l_transC ? l_N : l_M, l_transC ? l_M : l_N, l_ldX, (GEMX_XdataType *)p_Program.getPageAddr(p_GemmArgs.m_Xoffset));
+        MatType l_matC(l_transC ? l_N : l_M, l_transC ? l_M : l_N, l_ldC, p_Program.getPageAddr(p_GemmArgs.m_Coffset));
         std::cout << "\n###########  Op Gemm  ###########\n"
                   << "  C = postScale(A * B + X) "
                   << l_M << "x" << l_N << " = " << l_M << "x" << l_K << " * " << l_K << "x" << l_N << " + " << l_M << " x " << l_N <<"\n"
                   << " postScale " << l_postScale << "\n"
+                  << " transA " << l_transA << " transB " << l_transB << " transC " << l_transC << "\n"
                   << "  A " << l_matA << "\n"
                   << "  B " << l_matB << "\n"
                   << "  X    " << l_matX << "\n"
@@ -330,8 +371,10 @@ class GenGemm
                     l_ldA = p_GemmArgs.m_Lda,
                     l_ldB = p_GemmArgs.m_Ldb,
                     l_ldC = p_GemmArgs.m_Ldc;
-        MatType l_matC0(l_M, l_N, l_ldC, p_Program0.getPageAddr(p_GemmArgs.m_Coffset)),
-                l_matC1(l_M, l_N, l_ldC, p_Program1.getPageAddr(p_GemmArgs.m_Coffset));
+        unsigned int l_cRows = p_GemmArgs.m_TransC ? l_N : l_M,
+                     l_cCols = p_GemmArgs.m_TransC ? l_M : l_N;
+        MatType l_matC0(l_cRows, l_cCols, l_ldC, p_Program0.getPageAddr(p_GemmArgs.m_Coffset)),
+                l_matC1(l_cRows, l_cCols, l_ldC, p_Program1.getPageAddr(p_GemmArgs.m_Coffset));
         std::cout << "\n###########  Op Gemm  ###########\n"
                   << "  C = postScale(A * B + X) "
                   << l_M << "x" << l_N << " = " << l_M << "x" << l_K << " * " << l_K << "x" << l_N << " + " << l_M << " x " << l_N <<"\n"
@@ -114,6 +114,17 @@ class GenGemv
     std::cout << "Added GEMV " << p_M << "x" << p_K << "  ";
   }
   
+  // Reference C = A * B for an instruction already in p_Program
+  void
+  golden(
+      ProgramType &p_Program,
+      GemvArgsType p_GemvArgs
+    ) {
+      MatType l_matA(p_GemvArgs.m_M, p_GemvArgs.m_K, p_GemvArgs.m_Lda, p_Program.getPageAddr(p_GemvArgs.m_Aoffset));
+      MatType l_matB(p_GemvArgs.m_K, 1,   1,   p_Program.getPageAddr(p_GemvArgs.m_Boffset));
+      MatType l_matC(p_GemvArgs.m_M, 1,   1,   p_Program.getPageAddr(p_GemvArgs.m_Coffset));
+      gemv_ref<GEMX_dataType>(l_matA, l_matB, l_matC);
+    }
   void
   show(
       ProgramType &p_Program,
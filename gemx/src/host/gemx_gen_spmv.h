@@ -254,6 +254,18 @@ class GenSpmv
         //std::cout << "DEBUG A:\n" << l_matA << "\n";
   }
   
+  // Reference C = A * B for an instruction already in p_Program
+  void
+  golden(
+      ProgramType &p_Program,
+      SpmvArgsType p_SpmvArgs
+    ) {
+        SpMatType l_matA(p_SpmvArgs.m_M, p_SpmvArgs.m_K, p_SpmvArgs.m_Nnz, p_SpmvArgs.m_Bblocks, p_SpmvArgs.m_Cblocks,
+                         p_Program.getPageAddr(p_SpmvArgs.m_Aoffset));
+        MatType l_matB(p_SpmvArgs.m_K, 1,   1,   p_Program.getPageAddr(p_SpmvArgs.m_Boffset));
+        MatType l_matC(p_SpmvArgs.m_M, 1,   1,   p_Program.getPageAddr(p_SpmvArgs.m_Coffset));
+        spmv_ref<GEMX_dataType, SpmvAdType, SpmvAType>(l_matA, l_matB, l_matC, p_SpmvArgs.m_Prelu);
+    }
   void
   show(
       ProgramType &p_Program,
@@ -275,6 +287,21 @@ class GenSpmv
                   << "  B " << l_matB << "\n"
                   << "  C " << l_matC << "\n";
     }
+  // Predicted cost from the nnz of the descriptors stored with A
+  gemx::perfmodel::Estimate
+  model(
+      const gemx::perfmodel::PerfModel &p_Model,
+      ProgramType &p_Program,
+      SpmvArgsType p_SpmvArgs
+    ) {
+        SpMatType l_matA(p_SpmvArgs.m_M, p_SpmvArgs.m_K, p_SpmvArgs.m_Nnz, p_SpmvArgs.m_Bblocks, p_SpmvArgs.m_Cblocks,
+                         p_Program.getPageAddr(p_SpmvArgs.m_Aoffset));
+        std::vector<unsigned int> l_descNnz;
+        for (unsigned int i = 0; i < p_SpmvArgs.m_Bblocks * p_SpmvArgs.m_Cblocks; ++i) {
+          l_descNnz.push_back(l_matA.getDesc(i).getNnz());
+        }
+        return(p_Model.spmv(p_SpmvArgs, l_descNnz));
+    }
   bool
   compare(
       float p_TolRel, float p_TolAbs, 
@@ -456,6 +483,17 @@ class GenSpmvUram
         //std::cout << "DEBUG A:\n" << l_matA << "\n";
   }
   
+  // Reference C = A * B for an instruction already in p_Program
+  void
+  golden(
+      ProgramType &p_Program,
+      SpmvArgsType p_SpmvArgs
+    ) {
+        SpMatType l_matA(p_SpmvArgs.m_M, p_SpmvArgs.m_K, p_SpmvArgs.m_Nnz, p_Program.getPageAddr(p_SpmvArgs.m_Aoffset));
+        MatType l_matB(p_SpmvArgs.m_K, 1,   1,   p_Program.getPageAddr(p_SpmvArgs.m_Boffset));
+        MatType l_matC(p_SpmvArgs.m_M, 1,   1,   p_Program.getPageAddr(p_SpmvArgs.m_Coffset));
+        spmv_ref<GEMX_dataType, GEMX_idxType>(l_matA, l_matB, l_matC);
+    }
   void
   show(
       ProgramType &p_Program,
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Lowers GEMM and FCN ops of any shape to aligned kernel instructions
+ */
+
+#ifndef GEMX_GEN_TILER_H
+#define GEMX_GEN_TILER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cassert>
+#include "gemx_gen_bin.h"
+
+/*
+ * GemmTiler : Every kernel instruction computes whole blocks, so padding each
+ * dimension to the next multiple of its own block edge is the least padding any
+ * instruction sequence can have. K longer than p_MaxK is cut into balanced chunks;
+ * each chunk passes its partial sums to the next as the X operand. A chunk reads
+ * a column slice of A and a row slice of B through page views of the caller's
+ * handles, so chunks start on a page of A, a multiple of getSplitAlign(). The
+ * kernel cuts every partial C to t_FloatBits, so K is only split for ops with a
+ * unit post scale and no activation. The K padding is zeroed in a generated
+ * operand so that it does not reach the valid results.
+ */
+class GemmTiler
+{
+  public:
+    // Issues one aligned instruction: M, K, N, LdA, LdB, handles A, B, C, X, last chunk of K
+    typedef std::function<void(unsigned int, unsigned int, unsigned int, unsigned int, unsigned int,
+                               std::string, std::string, std::string, std::string,
+                               bool)> AddFnType;
+  private:
+    unsigned int m_M, m_K, m_N;
+    unsigned int m_Mp, m_Kp, m_Np;
+    std::vector<unsigned int> m_Chunks;   // K of each instruction
+  private:
+    static unsigned int
+    roundUp(unsigned int p_Val, unsigned int p_Mod) {
+        return((p_Val + p_Mod - 1) / p_Mod * p_Mod);
+      }
+    static unsigned int
+    numPages(unsigned long long p_Elements) {
+        return((p_Elements * sizeof(GEMX_dataType) + GEMX_pageSizeBytes - 1) / GEMX_pageSizeBytes);
+      }
+    bool
+    checkHandle(ProgramType &p_Program, std::string p_Handle, unsigned long long p_Elements) {
+        auto l_it = p_Program.getHandles().find(p_Handle);
+        if ((l_it != p_Program.getHandles().end()) && (l_it->second.m_SizePages < numPages(p_Elements))) {
+          std::cerr << "ERROR: handle " << p_Handle << " of " << l_it->second.m_SizePages
+                    << " pages is too small for the padded shape\n";
+          return(false);
+        }
+        return(true);
+      }
+    static bool
+    isNew(ProgramType &p_Program, std::string p_Handle) {
+        return(p_Program.getHandles().count(p_Handle) == 0);
+      }
+    // Allocates a new operand of a split op with generated contents, as
+    // GenGemm::addInstr does for the new operands of a single instruction
+    static void
+    genOperand(ProgramType &p_Program, std::string p_Handle, unsigned long long p_Elements,
+               unsigned int p_Max, unsigned int p_First) {
+        bool l_new;
+        GEMX_dataType *l_addr = p_Program.getPageAddr(p_Program.allocPages(p_Handle, l_new, p_Elements));
+        assert(l_new);
+        for (unsigned long long i = 0; i < p_Elements; ++i) {
+          l_addr[i] = (GEMX_dataType)((p_First + i) % p_Max);
+        }
+      }
+    void
+    zeroCols(ProgramType &p_Program, std::string p_Handle, unsigned int p_Rows, unsigned int p_Ld,
+             unsigned int p_ColBegin) {
+        GEMX_dataType *l_addr = p_Program.getPageAddr(p_Program.getHandles().at(p_Handle).m_StartPage);
+        for (unsigned int row = 0; row < p_Rows; ++row) {
+          for (unsigned int col = p_ColBegin; col < p_Ld; ++col) {
+            l_addr[(unsigned long long)row * p_Ld + col] = 0;
+          }
+        }
+      }
+    void
+    zeroRows(ProgramType &p_Program, std::string p_Handle, unsigned int p_RowBegin, unsigned int p_RowEnd,
+             unsigned int p_Ld) {
+        GEMX_dataType *l_addr = p_Program.getPageAddr(p_Program.getHandles().at(p_Handle).m_StartPage);
+        for (unsigned int row = p_RowBegin; row < p_RowEnd; ++row) {
+          for (unsigned int col = 0; col < p_Ld; ++col) {
+            l_addr[(unsigned long long)row * p_Ld + col] = 0;
+          }
+        }
+      }
+  public:
+    GemmTiler() : m_M(0), m_K(0), m_N(0), m_Mp(0), m_Kp(0), m_Np(0) {}
+    unsigned int getPaddedM() {return m_Mp;}
+    unsigned int getPaddedK() {return m_Kp;}
+    unsigned int getPaddedN() {return m_Np;}
+    const std::vector<unsigned int>& getChunks() {return m_Chunks;}
+    // Granularity of the K chunks of a split op: whole blocks that start a page of A
+    static unsigned int
+    getSplitAlign() {
+        unsigned int l_align = GEMX_gemmKBlocks * GEMX_ddrWidth;
+        while ((l_align * sizeof(GEMX_dataType)) % GEMX_pageSizeBytes != 0) {
+          l_align += GEMX_gemmKBlocks * GEMX_ddrWidth;
+        }
+        return(l_align);
+      }
+
+    // p_MaxK 0 keeps K in one instruction; p_CanSplitK tells whether the op
+    // can carry exact partial sums through X, which needs a unit post scale
+    // and PReLU since each partial C is cut to t_FloatBits
+    bool
+    plan(unsigned int p_M, unsigned int p_K, unsigned int p_N, unsigned int p_MaxK, bool p_CanSplitK) {
+        const unsigned int l_mMin = GEMX_gemmMBlocks * GEMX_ddrWidth;
+        const unsigned int l_kMin = GEMX_gemmKBlocks * GEMX_ddrWidth;
+        const unsigned int l_nMin = GEMX_gemmNBlocks * GEMX_ddrWidth;
+        if ((p_M == 0) || (p_K == 0) || (p_N == 0)) {
+          std::cerr << "ERROR: GEMM " << p_M << "x" << p_K << "x" << p_N << " has an empty dimension\n";
+          return(false);
+        }
+        m_M = p_M;
+        m_K = p_K;
+        m_N = p_N;
+        m_Mp = roundUp(p_M, l_mMin);
+        m_Kp = roundUp(p_K, l_kMin);
+        m_Np = roundUp(p_N, l_nMin);
+        m_Chunks.clear();
+        if ((p_MaxK == 0) || (m_Kp <= std::max(l_kMin, p_MaxK / l_kMin * l_kMin))) {
+          m_Chunks.push_back(m_Kp);
+          return(true);
+        }
+        if (!p_CanSplitK) {
+          std::cerr << "ERROR: K " << p_K << " cannot be split, partial sums would lose precision"
+                    << " between the C and X types, the post scale or the activation\n";
+          return(false);
+        }
+        const unsigned int l_align = getSplitAlign();
+        unsigned int l_maxUnits = p_MaxK / l_align;
+        if (l_maxUnits == 0) {
+          std::cerr << "ERROR: MaxK " << p_MaxK << " is below " << l_align
+                    << ", the K chunks of a split op must start on a page of A\n";
+          return(false);
+        }
+        unsigned int l_units = (m_Kp + l_align - 1) / l_align;
+        unsigned int l_numChunks = (l_units + l_maxUnits - 1) / l_maxUnits;
+        for (unsigned int i = 0; i < l_numChunks; ++i) {
+          unsigned int l_k0 = l_units * i / l_numChunks * l_align;
+          unsigned int l_k1 = std::min(m_Kp, l_units * (i + 1) / l_numChunks * l_align);
+          m_Chunks.push_back(l_k1 - l_k0);
+        }
+        return(true);
+      }
+
+    void
+    report(std::ostream &os) {
+        unsigned long long l_useful = (unsigned long long)m_M * m_K * m_N;
+        unsigned long long l_issued = (unsigned long long)m_Mp * m_Kp * m_Np;
+        os << "INFO: tiled " << m_M << "x" << m_K << "x" << m_N
+           << " as " << m_Chunks.size() << " instructions of up to "
+           << m_Mp << "x" << *std::max_element(m_Chunks.begin(), m_Chunks.end()) << "x" << m_Np
+           << "  padding M +" << m_Mp - m_M << " K +" << m_Kp - m_K << " N +" << m_Np - m_N
+           << "  MAC overhead " << std::fixed << std::setprecision(1)
+           << 100.0 * (l_issued - l_useful) / l_useful << "%\n";
+        os.unsetf(std::ios::floatfield);
+      }
+
+    /*
+     * lower : Issues the planned instructions through p_Add. A single chunk uses
+     * the given handles; split K addresses each chunk as views of A and B suffixed
+     * with the chunk index and chains the partial sums through C handles with the
+     * same suffix. New A and B of a split op are generated here, a single
+     * instruction leaves that to p_Add.
+     */
+    bool
+    lower(ProgramType &p_Program, std::string p_HandleA, std::string p_HandleB,
+          std::string p_HandleC, std::string p_HandleX, AddFnType p_Add) {
+        assert(!m_Chunks.empty());
+        const unsigned int l_xElements = sizeof(GEMX_XdataType) / sizeof(GEMX_dataType);
+        bool l_newA = isNew(p_Program, p_HandleA), l_newB = isNew(p_Program, p_HandleB);
+        if (!(checkHandle(p_Program, p_HandleA, (unsigned long long)m_Mp * m_Kp) &&
+              checkHandle(p_Program, p_HandleB, (unsigned long long)m_Kp * m_Np) &&
+              checkHandle(p_Program, p_HandleC, (unsigned long long)m_Mp * m_Np) &&
+              checkHandle(p_Program, p_HandleX, (unsigned long long)m_Mp * m_Np * l_xElements))) {
+          return(false);
+        }
+        if ((m_Kp > m_K) && !l_newA && !l_newB) {
+          std::cerr << "ERROR: K padding needs " << p_HandleA << " or " << p_HandleB
+                    << " to be a new operand\n";
+          return(false);
+        }
+        if (m_Chunks.size() == 1) {
+          p_Add(m_Mp, m_Kp, m_Np, m_Kp, m_Np, p_HandleA, p_HandleB, p_HandleC, p_HandleX, true);
+        } else {
+          if (l_newA) {
+            genOperand(p_Program, p_HandleA, (unsigned long long)m_Mp * m_Kp, 67, 1);
+          }
+          if (l_newB) {
+            genOperand(p_Program, p_HandleB, (unsigned long long)m_Kp * m_Np, 129, 65);
+          }
+        }
+        if (m_Kp > m_K) {
+          if (l_newA) {
+            zeroCols(p_Program, p_HandleA, m_Mp, m_Kp, m_K);
+          } else {
+            zeroRows(p_Program, p_HandleB, m_K, m_Kp, m_Np);
+          }
+        }
+        if (m_Chunks.size() == 1) {
+          return(true);
+        }
+        unsigned int l_k0 = 0;
+        std::string l_handleX = p_HandleX;
+        for (unsigned int i = 0; i < m_Chunks.size(); ++i) {
+          bool l_last = (i + 1 == m_Chunks.size());
+          std::string l_suffix = "_k" + std::to_string(i);
+          std::string l_handleC = l_last ? p_HandleC : p_HandleC + l_suffix;
+          unsigned long long l_aBytes = (unsigned long long)l_k0 * sizeof(GEMX_dataType);
+          unsigned long long l_bBytes = l_aBytes * m_Np;
+          assert(l_aBytes % GEMX_pageSizeBytes == 0);
+          if (!(p_Program.addView(p_HandleA + l_suffix, p_HandleA, l_aBytes / GEMX_pageSizeBytes) &&
+                p_Program.addView(p_HandleB + l_suffix, p_HandleB, l_bBytes / GEMX_pageSizeBytes))) {
+            return(false);
+          }
+          p_Add(m_Mp, m_Chunks[i], m_Np, m_Kp, m_Np, p_HandleA + l_suffix, p_HandleB + l_suffix,
+                l_handleC, l_handleX, l_last);
+          l_handleX = l_handleC;
+          l_k0 += m_Chunks[i];
+        }
+        return(true);
+      }
+};
+
+#endif
@@ -148,6 +148,24 @@ class GenTransp
     }
     std::cout << "Added TRANSP " << p_M << "x" << p_N << "  ";
   }
+  // Reference B = transpose(A) for an instruction already in p_Program
+  void
+  golden(
+      ProgramType &p_Program,
+      TranspArgsType p_TranspArgs
+    ) {
+      DdrMatrixShapeType l_src = p_TranspArgs.m_Src,
+                         l_dst = p_TranspArgs.m_Dst;
+      MatType l_matA(l_src.m_Rows, l_src.m_Cols, l_src.m_Ld, p_Program.getPageAddr(l_src.m_Offset));
+      MatType l_matB(l_dst.m_Rows, l_dst.m_Cols, l_dst.m_Ld, p_Program.getPageAddr(l_dst.m_Offset));
+      if (l_dst.m_Format == MatFormatType::Cm) {
+        l_matB.transpose(l_matA);
+      } else if (l_dst.m_Format == MatFormatType::GvA) {
+        l_matB.transposeGva(l_matA, GEMX_ddrWidth * GEMX_gemvmGroups, GEMX_ddrWidth);
+      } else {
+        assert(false);
+      }
+    }
   void
   show(
       ProgramType &p_Program,
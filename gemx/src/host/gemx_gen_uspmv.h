@@ -212,6 +212,20 @@ class GenUspmv
         }
         std::cout << "run " << p_numRuns << "times\n";
       }
+    // Reference C = A * B over all stages for an instruction already in p_program
+    void
+    golden(
+        Program<t_FloatType> &p_program,
+        gemx::UspmvArgs p_uspmvArgs
+    ) {
+        unsigned int l_numRuns = p_uspmvArgs.m_NumRuns;
+        UspMat<t_FloatType, t_IdxType, t_Stages, t_DdrWidth> l_matA(l_numRuns, p_program.getPageAddr(p_uspmvArgs.m_Aoffset));
+        unsigned int l_cols_0 = l_matA.getCols(0);
+        unsigned int l_rows_last = l_matA.getRows(t_Stages-1);
+        DenseMat<t_FloatType> l_matB(l_numRuns, l_cols_0, l_cols_0, p_program.getPageAddr(p_uspmvArgs.m_Boffset));
+        DenseMat<t_FloatType> l_matC(l_numRuns, l_rows_last, l_rows_last, p_program.getPageAddr(p_uspmvArgs.m_Coffset));
+        spmm_ref<t_FloatType, t_IdxType, t_Stages, t_DdrWidth>(l_matA, l_matB, l_numRuns, l_matC);
+    }
     void
     show(
         Program<t_FloatType> &p_program,
@@ -230,6 +244,23 @@ class GenUspmv
                   << "  B " << l_matB << "\n"
                   << "  C " << l_matC << "\n";
     }
+
+    // Predicted cost from the sizes of the stage matrices stored in A
+    gemx::perfmodel::Estimate
+    model(
+        const gemx::perfmodel::PerfModel &p_model,
+        Program<t_FloatType> &p_program,
+        gemx::UspmvArgs p_uspmvArgs
+    ) {
+        UspMat<t_FloatType, t_IdxType, t_Stages, t_DdrWidth> l_matA(p_uspmvArgs.m_NumRuns, p_program.getPageAddr(p_uspmvArgs.m_Aoffset));
+        std::vector<unsigned int> l_rows, l_cols, l_nnzs;
+        for (unsigned int i = 0; i < t_Stages; ++i) {
+          l_rows.push_back(l_matA.getRows(i));
+          l_cols.push_back(l_matA.getCols(i));
+          l_nnzs.push_back(l_matA.getNnzs(i));
+        }
+        return(p_model.uspmv(p_uspmvArgs.m_NumRuns, l_rows, l_cols, l_nnzs));
+    }
     
     bool
     compare (
@@ -36,73 +36,118 @@
 #include <iostream>
 #include <vector>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 
 #include "gemx_kernel.h"
 #if TEST_SDX
   #include "gemx_fpga.h"
 #endif
 
-std::ifstream::pos_type getFileSize(std::string p_FileName)
-{
-  std::ifstream in(p_FileName.c_str(), std::ifstream::ate | std::ifstream::binary);
-  return in.tellg(); 
-}
-
-std::vector<DdrType>
-loadBinFile(std::string p_BinFileName)
-{
-  std::vector<DdrType> l_memVec;
-  // Bin file existence
-  std::ifstream l_if(p_BinFileName.c_str(), std::ios::binary);
-  if (l_if.is_open()) {
-    // Bin file size
-    size_t l_binFileSize = getFileSize(p_BinFileName);
-    std::cout << "INFO: loading " + p_BinFileName + " of size " << l_binFileSize << "\n";
-    assert(l_binFileSize > 0);
-    size_t l_binFileSizeInDdrWords = l_binFileSize / sizeof(DdrType);
-    assert(l_binFileSize % sizeof(DdrType) == 0);
+/*
+ * BinImage : app.bin mapped once read-only. Every kernel gets a private copy-on-write
+ * view of it, so pages a kernel never writes stay shared through the page cache
+ * instead of being read into one vector per kernel.
+ */
+class BinImage {
+  private:
+    int m_Fd;
+    size_t m_SizeBytes;
+    char *m_Input;
+    std::vector<char*> m_Views;
+  public:
+    BinImage() : m_Fd(-1), m_SizeBytes(0), m_Input(0) {}
+    ~BinImage() {
+      for (auto l_view : m_Views) {
+        munmap(l_view, m_SizeBytes);
+      }
+      if (m_Input) {
+        munmap(m_Input, m_SizeBytes);
+      }
+      if (m_Fd >= 0) {
+        close(m_Fd);
+      }
+    }
+    BinImage(const BinImage &) = delete;
+    BinImage& operator=(const BinImage &) = delete;
 
-    // Bin file storage
-    //l_memVec.reserve(l_binFileSizeInDdrWords);
-    l_memVec.resize(l_binFileSizeInDdrWords);
-    DdrType *l_mem = &l_memVec[0];
+    size_t
+    sizeBytes() {return m_SizeBytes;}
 
-    // Read the bin file
-    l_if.read((char*)l_mem, l_binFileSize);
-    if (l_if) {
-      std::cout << "INFO: loaded " << l_binFileSize << " bytes from " << p_BinFileName << "\n";
-    } else {
-      l_memVec.clear();
-      std::cout << "ERROR: loaded only " << l_if.gcount() << " bytes from " << p_BinFileName << "\n";
+    bool
+    load(std::string p_BinFileName) {
+      m_Fd = open(p_BinFileName.c_str(), O_RDONLY);
+      struct stat l_stat;
+      if (m_Fd < 0 || fstat(m_Fd, &l_stat) != 0) {
+        std::cout << "ERROR: failed to open file " + p_BinFileName + "\n";
+        return false;
+      }
+      m_SizeBytes = l_stat.st_size;
+      std::cout << "INFO: loading " + p_BinFileName + " of size " << m_SizeBytes << "\n";
+      if (m_SizeBytes == 0 || m_SizeBytes % sizeof(DdrType) != 0) {
+        std::cout << "ERROR: " + p_BinFileName + " is not a whole number of DDR words\n";
+        return false;
+      }
+      void *l_addr = mmap(0, m_SizeBytes, PROT_READ, MAP_SHARED, m_Fd, 0);
+      if (l_addr == MAP_FAILED) {
+        std::cout << "ERROR: failed to map " + p_BinFileName + "\n";
+        return false;
+      }
+      m_Input = (char*)l_addr;
+      std::cout << "INFO: mapped " << m_SizeBytes << " bytes from " << p_BinFileName << "\n";
+      return true;
     }
-    l_if.close();
-
-    // Debug print the file content
-  } else {
-    std::cout << "ERROR: failed to open file " + p_BinFileName + "\n";
-  }
 
-  return(l_memVec);
-}
+    // Writable view of the image private to one kernel, 0 on failure
+    DdrType *
+    createView() {
+      void *l_addr = mmap(0, m_SizeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, m_Fd, 0);
+      if (l_addr == MAP_FAILED) {
+        std::cout << "ERROR: failed to map a kernel view of the bin file\n";
+        return 0;
+      }
+      m_Views.push_back((char*)l_addr);
+      return (DdrType*)l_addr;
+    }
 
-bool
-writeBinFile(std::string p_BinFileName, std::vector<DdrType> &p_MemVec)
-{
-  bool ok = false;  
-  std::ofstream l_of(p_BinFileName.c_str(), std::ios::binary);
-  if (l_of.is_open()) {
-    size_t l_sizeBytes =  sizeof(DdrType) * p_MemVec.size();
-    l_of.write((char*)&p_MemVec[0], l_sizeBytes);
-    if (l_of.tellp() == l_sizeBytes) {
-      std::cout << "INFO: wrote " << l_sizeBytes << " bytes to " << p_BinFileName << "\n";
-      ok = true;
-    } else {
-      std::cout << "ERROR: wrote only " << l_of.tellp() << " bytes to " << p_BinFileName << "\n";
+    // Copies the input file in kernel space, then overwrites only the pages of
+    // p_View that differ from it
+    bool
+    writeView(std::string p_BinFileName, DdrType *p_View) {
+      int l_fd = open(p_BinFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (l_fd < 0) {
+        return false;
+      }
+      bool ok = true;
+      off_t l_inOff = 0;
+      while (ok && (size_t)l_inOff < m_SizeBytes) {
+        ok = sendfile(l_fd, m_Fd, &l_inOff, m_SizeBytes - l_inOff) > 0;
+      }
+      const char *l_view = (const char*)p_View;
+      size_t l_changed = 0;
+      for (size_t l_off = 0; l_off < m_SizeBytes; l_off += GEMX_pageSizeBytes) {
+        size_t l_sz = std::min<size_t>(GEMX_pageSizeBytes, m_SizeBytes - l_off);
+        // without the copy every page has to be written
+        if (!ok || memcmp(l_view + l_off, m_Input + l_off, l_sz) != 0) {
+          if (pwrite(l_fd, l_view + l_off, l_sz, l_off) != (ssize_t)l_sz) {
+            std::cout << "ERROR: failed to write " << p_BinFileName << " at " << l_off << "\n";
+            close(l_fd);
+            return false;
+          }
+          l_changed += l_sz;
+        }
+      }
+      close(l_fd);
+      std::cout << "INFO: wrote " << m_SizeBytes << " bytes to " << p_BinFileName
+                << ", " << l_changed << " changed\n";
+      return true;
     }
-    l_of.close();
-  }
-  return(ok);
-}
+};
 
 #if TEST_SDX
   typedef std::chrono::time_point<std::chrono::high_resolution_clock> TimePointType;
@@ -135,17 +180,17 @@ int main(int argc, char** argv)
   printf("GEMX:   %s  %s  %s %s\n",
          argv[0], l_xclbinFile.c_str(), l_binFile.c_str(), l_binFileOut.c_str());
   
-  // Load the bin file
-  std::vector<DdrType> l_memVec[GEMX_numKernels];
+  // Map the bin file once, each kernel works on its own copy-on-write view
+  BinImage l_image;
   DdrType *l_mem[GEMX_numKernels];
-  
+  if (!l_image.load(l_binFile)) {
+    return EXIT_FAILURE;
+  }
   for (unsigned int i=0; i<GEMX_numKernels; ++i) {
-    l_memVec[i] = loadBinFile(l_binFile);
-  
-    if (l_memVec[i].empty()) {
+    l_mem[i] = l_image.createView();
+    if (!l_mem[i]) {
       return EXIT_FAILURE;
     }
-    l_mem[i] = &l_memVec[i][0];
   }
   
   #if TEST_SDX
@@ -181,8 +226,8 @@ int main(int argc, char** argv)
        
     gemx::MemDesc l_memDesc[GEMX_numKernels];
     for (unsigned int i=0; i<GEMX_numKernels; ++i) {
-      l_memDesc[i].init(l_memVec[i].size() * sizeof(DdrType) / GEMX_pageSizeBytes, l_memVec[i].data());
-      assert(l_memVec[i].size() * sizeof(DdrType) % GEMX_pageSizeBytes == 0);
+      l_memDesc[i].init(l_image.sizeBytes() / GEMX_pageSizeBytes, l_mem[i]);
+      assert(l_image.sizeBytes() % GEMX_pageSizeBytes == 0);
       if (!l_fpga.createBufferForKernel(i, l_memDesc[i])) {
         std::cerr << "ERROR: failed to create buffer for kernel " << i << std::endl;
       }   
@@ -245,7 +290,7 @@ int main(int argc, char** argv)
     //std::string binFileOutName = l_binFileOut.substr(0,10) + std::to_string(i) + l_binFileOut.substr(10,4);
     //std::string binFileOutName =l_binFileOut.substr(0,pos0+1)+l_binFileOut.substr(pos1,7) + std::to_string(i) + l_binFileOut.substr(pos2,4);
     std::string binFileOutName = "./" + l_binFileOut.substr(0,pos0+1)+l_binFileOut.substr(pos1,size_pos) + std::to_string(i) + l_binFileOut.substr(pos2,4);
-   if (!writeBinFile(binFileOutName, l_memVec[i])) {
+   if (!l_image.writeView(binFileOutName, l_mem[i])) {
       std::cerr << "ERROR: failed to write output file " + binFileOutName + "\n";
       return EXIT_FAILURE;
     }
@@ -19,10 +19,9 @@
 
 #include <iostream>
 #include <fstream> 
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-//#include <boost/iostreams/filter/bzip2.hpp>
+#include "gemx_mtx_reader.h"
+#include "gemx_compare.h"
+#include "gemx_dense_reader.h"
 
 class MtxRow {
   private:
@@ -338,6 +337,7 @@ class MtxFile
     std::string m_FileName;
     bool m_Good;
     unsigned int m_M, m_K, m_Nnz;
+    MtxCoo m_Coo;
     std::vector<MtxRow> m_Rows;
   private:
     void align( unsigned int &dst, unsigned int width) {dst = width * ((dst + width - 1) / width);}
@@ -355,43 +355,16 @@ class MtxFile
       {
         if (m_FileName != "none") {
           std::cout << "INFO: loading Mtx file  " << m_FileName << "\n";
-          std::ifstream l_fs(m_FileName.c_str(), std::ios_base::in | std::ios_base::binary);
-          
-          boost::iostreams::filtering_istream l_bs;
-          std::string l_ext = m_FileName.substr(m_FileName.find_last_of(".") + 1);
-          std::transform(l_ext.begin(), l_ext.end(), l_ext.begin(), ::tolower);
-
-          if (l_ext == "gz") {
-            l_bs.push(boost::iostreams::gzip_decompressor());
-          // Bzip2 did not work properly in boost 1.64
-          //} else if (l_ext == "bz2") {
-          //  l_bs.push(boost::iostreams::bzip2_decompressor());
-          } else if (l_ext == "mtx") {
-            // noop
-          } else{
-            std::cerr << "ERROR: MtxFile failed due to unknown extension \"" << l_ext << "\", file  "
-                      << m_FileName << "\n";
-            assert(0);
-          }
-          l_bs.push(l_fs);          
-          m_Good = l_bs.good();
+          MtxReader l_reader;
+          m_Good = l_reader.read(m_FileName, m_M, m_K, m_Nnz, m_Coo);
           if (m_Good) {
-            while (l_bs.peek() == '%') l_bs.ignore(2048, '\n');
-            l_bs >>  m_M >> m_K >> m_Nnz;
-            for (unsigned int i = 0; i < nnz(); ++i) {
-              MtxRow l_row;
-              l_row.scan(l_bs);
-              m_Rows.push_back(l_row);
-            }
-            boost::iostreams::close(l_bs);
             // Sort to make canonical
             //sort(m_Rows.begin(), m_Rows.end());
             // Pad with 0s
             #if GEMX_runSpmv==1
             while (m_Nnz % GEMX_spmvWidth != 0) {
               std::cout << "INFO: Added padding row to the mtx data\n";
-              MtxRow l_row;
-              m_Rows.push_back(l_row);
+              m_Coo.push(0, 0, 0);
               m_Nnz++;
             }
             // Adjust dimensions - needs to be aligned to both GEMX_spmvWidth and GEMX_ddrWidth
@@ -407,8 +380,7 @@ class MtxFile
             #elif GEMX_runUspmv==1
             while (m_Nnz % GEMX_ddrWidth != 0) {
               std::cout << "INFO: Added padding row to the mtx data\n";
-              MtxRow l_row;
-              m_Rows.push_back(l_row);
+              m_Coo.push(0, 0, 0);
               m_Nnz++;
             }
             // Adjust dimensions - needs to be aligned to both GEMX_spmvWidth and GEMX_ddrWidth
@@ -425,7 +397,21 @@ class MtxFile
           }
         }
       }
-    std::vector<MtxRow> &getRows() {return(m_Rows);}
+    // Valid until the first getRows
+    MtxCoo &getCoo() {return(m_Coo);}
+    // Row objects for the fillFromVector consumers, built on first use from the
+    // coordinate arrays, which are then released
+    std::vector<MtxRow> &getRows() {
+        if (m_Coo.size() != 0) {
+          m_Rows.clear();
+          m_Rows.reserve(m_Coo.size());
+          for (size_t i = 0; i < m_Coo.size(); ++i) {
+            m_Rows.push_back(MtxRow(m_Coo.m_Val[i], m_Coo.m_Row[i], m_Coo.m_Col[i]));
+          }
+          m_Coo = MtxCoo();
+        }
+        return(m_Rows);
+      }
 };
 
 #endif
@@ -743,6 +729,7 @@ class MtxFileUram
     bool m_Good;
     bool m_isDiag;
     unsigned int m_M, m_K, m_Nnz;
+    MtxCoo m_Coo;
     std::vector<MtxRow> m_Rows;
   private:
     void align( unsigned int &dst, unsigned int width) {dst = width * ((dst + width - 1) / width);}
@@ -761,54 +748,21 @@ class MtxFileUram
       {
         if (m_FileName != "none") {
           std::cout << "INFO: loading Mtx file  " << m_FileName << "\n";
-          std::ifstream l_fs(m_FileName.c_str(), std::ios_base::in | std::ios_base::binary);
-          
-          boost::iostreams::filtering_istream l_bs;
-          std::string l_ext = m_FileName.substr(m_FileName.find_last_of(".") + 1);
-          std::transform(l_ext.begin(), l_ext.end(), l_ext.begin(), ::tolower);
-          if (l_ext == "gz") {
-            l_bs.push(boost::iostreams::gzip_decompressor());
-          // Bzip2 did not work properly in boost 1.64
-          //} else if (l_ext == "bz2") {
-          //  l_bs.push(boost::iostreams::bzip2_decompressor());
-          } else if (l_ext == "mtx") {
-            // noop
-          } else{
-            std::cerr << "ERROR: MtxFile failed due to unknown extension \"" << l_ext << "\", file  "
-                      << m_FileName << "\n";
-            assert(0);
-          }
-          l_bs.push(l_fs);
-          
-          m_Good = l_bs.good();
-          unsigned int l_curRow=0;
-          unsigned int l_curCol=0;
+          MtxReader l_reader;
+          m_Good = l_reader.read(m_FileName, m_M, m_K, m_Nnz, m_Coo);
           if (m_Good) {
-            while (l_bs.peek() == '%') l_bs.ignore(2048, '\n');
-            l_bs >>  m_M >> m_K >> m_Nnz;
-            for (unsigned int i = 0; i < nnz(); ++i) {
-                MtxRow l_row;
-                l_row.scan(l_bs);
-                if (i==0) {
-                    l_curRow = l_row.getRow();
-                    l_curCol = l_row.getCol();
-                } else {
-                    if ((l_row.getRow() != (l_curRow+1)) || (l_row.getCol() != (l_curCol+1))){
-                        m_isDiag = false;
-                    }
-                l_curRow = l_row.getRow();
-                l_curCol = l_row.getCol();
+            for (unsigned int i = 1; i < nnz(); ++i) {
+                if ((m_Coo.m_Row[i] != (m_Coo.m_Row[i-1]+1)) || (m_Coo.m_Col[i] != (m_Coo.m_Col[i-1]+1))){
+                    m_isDiag = false;
+                    break;
                 }
-                m_Rows.push_back(l_row);
             }
-            boost::iostreams::close(l_bs);
             // Sort to make canonical
             //sort(m_Rows.begin(), m_Rows.end());
             // Pad with 0s
             while (m_Nnz % (GEMX_ddrWidth * GEMX_nnzBlocks) != 0) {
                 std::cout << "INFO: Added padding row to the mtx data\n";
-                MtxRow l_row;
-                m_Rows.push_back(l_row);
+                m_Coo.push(0, 0, 0);
                 m_Nnz++;
             }
             // Adjust dimensions - needs to be aligned to both GEMX_ddrWidth
@@ -823,7 +777,21 @@ class MtxFileUram
           }
         }
       }
-    std::vector<MtxRow> &getRows() {return(m_Rows);}
+    // Valid until the first getRows
+    MtxCoo &getCoo() {return(m_Coo);}
+    // Row objects for the fillFromVector consumers, built on first use from the
+    // coordinate arrays, which are then released
+    std::vector<MtxRow> &getRows() {
+        if (m_Coo.size() != 0) {
+          m_Rows.clear();
+          m_Rows.reserve(m_Coo.size());
+          for (size_t i = 0; i < m_Coo.size(); ++i) {
+            m_Rows.push_back(MtxRow(m_Coo.m_Val[i], m_Coo.m_Row[i], m_Coo.m_Col[i]));
+          }
+          m_Coo = MtxCoo();
+        }
+        return(m_Rows);
+      }
 };
 
 #endif
@@ -899,6 +867,21 @@ class DenseMat
         }
       }
     }
+    // .npy and .raw files are mmapped and copied by DenseReader, other files are
+    // text read from p_Is after any # comment lines; a missing text file is skipped
+    bool
+    fillFromFile(const std::string &p_FileName, std::istream& p_Is) {
+      if (DenseReader::isBinaryFile(p_FileName)) {
+        DenseReader l_reader;
+        return(l_reader.open(p_FileName, DenseReader::elemType<T>()) &&
+               l_reader.read(m_Addr, m_Rows, m_Cols, m_Ld));
+      }
+      if (p_Is.good()) {
+        while (p_Is.peek()=='#') p_Is.ignore(2048, '\n');
+        fillFromFile(p_Is);
+      }
+      return(true);
+    }
     #if GEMX_runTransp==1
     //Golden comparsion functions for transp engine
     void
@@ -943,32 +926,9 @@ class DenseMat
     }
     bool
     cmp(float p_TolRel, float p_TolAbs, DenseMat &p_Ref) {
-        bool ok = true;
-        unsigned int l_verbose = 1;  // 0 none, 1 if not exactly equal, 2 if passed tolerance, 3 show all
-        unsigned int l_numExactMatches = 0, l_numMismatches = 0;
-        for (unsigned int row = 0; row < rows(); ++row) {
-          for (unsigned int col = 0; col < cols(); ++col) {
-            std::string l_Prefix = "      row " + std::to_string(row) + " col " + std::to_string(col); 
-            T v = getVal(row, col);
-            T vRef = p_Ref.getVal(row, col);
-            bool l_exactMatch = false;
-            bool l_ok = gemx::cmpVal<T>(p_TolRel, p_TolAbs, vRef, v, l_Prefix, l_exactMatch, 1);
-            ok = ok && l_ok;
-            if (l_exactMatch) {
-              l_numExactMatches++;
-            }
-            if (!l_ok) {
-              l_numMismatches++;
-            }
-          }
-        }
-        unsigned int l_total = rows() * cols();
-        unsigned int l_withinTolerance = l_total - l_numExactMatches - l_numMismatches;
-        std::cout << "  Compared " << l_total << " values:"
-                  << "  exact match " << l_numExactMatches
-                  << "  within tolerance " << l_withinTolerance
-                  << "  mismatch " << l_numMismatches << "\n";
-        return(ok);
+        CmpStats l_stats = cmpMat<T>(p_TolRel, p_TolAbs, p_Ref.m_Addr, m_Addr, rows(), cols(), ld());
+        l_stats.print(std::cout);
+        return(l_stats.m_Mismatch == 0);
     }
 
 };
@@ -0,0 +1,469 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Matrix Market (.mtx, .mtx.gz) coordinate file reader
+ *
+ *  Plain files are mmapped and split into newline-aligned chunks that are
+ *  parsed in parallel. Gzip files are inflated by one thread into blocks that
+ *  are parsed by the others while the next block is decompressed.
+ */
+
+#ifndef GEMX_MTX_READER_H
+#define GEMX_MTX_READER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#ifndef GEMX_mtxGzBlockBytes
+#define GEMX_mtxGzBlockBytes (16 << 20)
+#endif
+
+// Nonzeros in coordinate format, one array per field, 0-based indices.
+// Values are kept in double so that the consumer does the only rounding.
+class MtxCoo
+{
+  public:
+    std::vector<unsigned int> m_Row, m_Col;
+    std::vector<double> m_Val;
+  public:
+    size_t size() const {return(m_Row.size());}
+    void reserve(size_t p_Size) {
+        m_Row.reserve(p_Size);
+        m_Col.reserve(p_Size);
+        m_Val.reserve(p_Size);
+      }
+    void resize(size_t p_Size) {
+        m_Row.resize(p_Size);
+        m_Col.resize(p_Size);
+        m_Val.resize(p_Size);
+      }
+    void clear() {
+        m_Row.clear();
+        m_Col.clear();
+        m_Val.clear();
+      }
+    void push(unsigned int p_Row, unsigned int p_Col, double p_Val) {
+        m_Row.push_back(p_Row);
+        m_Col.push_back(p_Col);
+        m_Val.push_back(p_Val);
+      }
+};
+
+class MtxReader
+{
+  private:
+    unsigned int m_Threads;
+    bool m_Pattern;
+
+  private:
+    static bool isBlank(char c) {return((c == ' ') || (c == '\t') || (c == '\r'));}
+    static bool isDigit(char c) {return((c >= '0') && (c <= '9'));}
+
+    static void
+    skipBlanks(const char *&p, const char *p_End) {
+        while ((p < p_End) && isBlank(*p)) ++p;
+      }
+    static void
+    skipLine(const char *&p, const char *p_End) {
+        const char *l_nl = (const char*)memchr(p, '\n', p_End - p);
+        p = l_nl ? l_nl + 1 : p_End;
+      }
+
+    static bool
+    parseUint(const char *&p, const char *p_End, unsigned int &p_Val) {
+        uint64_t l_val = 0;
+        const char *l_start = p;
+        while ((p < p_End) && isDigit(*p)) {
+          l_val = l_val * 10 + (*p - '0');
+          if (l_val > 0xffffffffULL) return(false);
+          ++p;
+        }
+        p_Val = (unsigned int)l_val;
+        return(p != l_start);
+      }
+
+    // Decimal or scientific notation. Exact on the fast path (mantissa below
+    // 2^53 and |exponent| <= 22), otherwise the token is handed to strtod.
+    static bool
+    parseReal(const char *&p, const char *p_End, double &p_Val) {
+        static const double l_pow10[] = {
+          1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const char *l_start = p;
+        bool l_neg = false;
+        if ((p < p_End) && ((*p == '-') || (*p == '+'))) {
+          l_neg = (*p == '-');
+          ++p;
+        }
+        uint64_t l_mant = 0;
+        int l_exp = 0, l_digits = 0;
+        bool l_exact = true;
+        for (; (p < p_End) && isDigit(*p); ++p, ++l_digits) {
+          if (l_mant < (1ULL << 53) / 10) {
+            l_mant = l_mant * 10 + (*p - '0');
+          } else {
+            l_exp++;
+            l_exact = false;
+          }
+        }
+        if ((p < p_End) && (*p == '.')) {
+          for (++p; (p < p_End) && isDigit(*p); ++p, ++l_digits) {
+            if (l_mant < (1ULL << 53) / 10) {
+              l_mant = l_mant * 10 + (*p - '0');
+              l_exp--;
+            } else {
+              l_exact = false;
+            }
+          }
+        }
+        if ((p < p_End) && ((*p == 'e') || (*p == 'E') || (*p == 'd') || (*p == 'D'))) {
+          ++p;
+          bool l_expNeg = false;
+          if ((p < p_End) && ((*p == '-') || (*p == '+'))) {
+            l_expNeg = (*p == '-');
+            ++p;
+          }
+          int l_e = 0;
+          const char *l_eStart = p;
+          for (; (p < p_End) && isDigit(*p); ++p) {
+            if (l_e < 100000) l_e = l_e * 10 + (*p - '0');
+          }
+          if (p == l_eStart) return(false);
+          l_exp += l_expNeg ? -l_e : l_e;
+        }
+        if (l_digits == 0) {
+          // inf, nan and the like
+          while ((p < p_End) && !isBlank(*p) && (*p != '\n')) ++p;
+          l_exact = false;
+        }
+        if (l_exact && (l_exp >= -22) && (l_exp <= 22)) {
+          double l_val = (double)l_mant;
+          l_val = (l_exp < 0) ? l_val / l_pow10[-l_exp] : l_val * l_pow10[l_exp];
+          p_Val = l_neg ? -l_val : l_val;
+          return(true);
+        }
+        char l_buf[128];
+        size_t l_len = p - l_start;
+        if ((l_len == 0) || (l_len >= sizeof(l_buf))) return(false);
+        memcpy(l_buf, l_start, l_len);
+        l_buf[l_len] = 0;
+        char *l_end;
+        p_Val = strtod(l_buf, &l_end);
+        return(l_end == l_buf + l_len);
+      }
+
+    // Banner, comments and the "M K Nnz" size line. Returns the start of the
+    // entries or nullptr.
+    const char *
+    parseHeader(const char *p, const char *p_End, unsigned int &p_M, unsigned int &p_K, unsigned int &p_Nnz) {
+        m_Pattern = false;
+        while (p < p_End) {
+          skipBlanks(p, p_End);
+          if ((p < p_End) && (*p == '%')) {
+            const char *l_line = p;
+            skipLine(p, p_End);
+            if ((p - l_line > 14) && (strncmp(l_line, "%%MatrixMarket", 14) == 0)) {
+              std::string l_banner(l_line, p);
+              std::transform(l_banner.begin(), l_banner.end(), l_banner.begin(), ::tolower);
+              m_Pattern = (l_banner.find("pattern") != std::string::npos);
+            }
+          } else if ((p < p_End) && (*p == '\n')) {
+            ++p;
+          } else {
+            break;
+          }
+        }
+        bool l_ok = parseUint(p, p_End, p_M);
+        skipBlanks(p, p_End);
+        l_ok = l_ok && parseUint(p, p_End, p_K);
+        skipBlanks(p, p_End);
+        l_ok = l_ok && parseUint(p, p_End, p_Nnz);
+        if (!l_ok) return(nullptr);
+        skipLine(p, p_End);
+        return(p);
+      }
+
+    // Entries in [p, p_End), which starts and ends on line boundaries
+    bool
+    parseChunk(const char *p, const char *p_End, MtxCoo &p_Coo) {
+        while (p < p_End) {
+          skipBlanks(p, p_End);
+          if (p == p_End) break;
+          if ((*p == '\n') || (*p == '%')) {
+            skipLine(p, p_End);
+            continue;
+          }
+          const char *l_line = p;
+          unsigned int l_row = 0, l_col = 0;
+          double l_val = 1.0;
+          bool l_ok = parseUint(p, p_End, l_row);
+          skipBlanks(p, p_End);
+          l_ok = l_ok && parseUint(p, p_End, l_col);
+          if (l_ok && !m_Pattern) {
+            skipBlanks(p, p_End);
+            l_ok = parseReal(p, p_End, l_val);
+          }
+          if (!l_ok || (l_row == 0) || (l_col == 0)) {
+            const char *l_eol = (const char*)memchr(l_line, '\n', p_End - l_line);
+            std::cerr << "  Error: invalid MTX file line \"" << std::string(l_line, l_eol ? l_eol : p_End) << "\"\n";
+            return(false);
+          }
+          // Indices start from 1 in MTX; 0 locally
+          p_Coo.push(l_row - 1, l_col - 1, l_val);
+          skipLine(p, p_End);
+        }
+        return(true);
+      }
+
+    // Concatenates the per-chunk results in order
+    void
+    gather(std::vector<MtxCoo> &p_Parts, MtxCoo &p_Coo) {
+        std::vector<size_t> l_offsets(p_Parts.size() + 1, 0);
+        for (size_t i = 0; i < p_Parts.size(); ++i) {
+          l_offsets[i + 1] = l_offsets[i] + p_Parts[i].size();
+        }
+        p_Coo.resize(l_offsets.back());
+        std::vector<std::thread> l_workers;
+        for (size_t i = 0; i < p_Parts.size(); ++i) {
+          l_workers.push_back(std::thread([&p_Parts, &p_Coo, &l_offsets, i]() {
+            MtxCoo &l_part = p_Parts[i];
+            std::copy(l_part.m_Row.begin(), l_part.m_Row.end(), p_Coo.m_Row.begin() + l_offsets[i]);
+            std::copy(l_part.m_Col.begin(), l_part.m_Col.end(), p_Coo.m_Col.begin() + l_offsets[i]);
+            std::copy(l_part.m_Val.begin(), l_part.m_Val.end(), p_Coo.m_Val.begin() + l_offsets[i]);
+            l_part.clear();
+            l_part.m_Row.shrink_to_fit();
+            l_part.m_Col.shrink_to_fit();
+            l_part.m_Val.shrink_to_fit();
+          }));
+          if (l_workers.size() == m_Threads) {
+            for (std::thread &l_w : l_workers) l_w.join();
+            l_workers.clear();
+          }
+        }
+        for (std::thread &l_w : l_workers) l_w.join();
+      }
+
+    bool
+    readMapped(const std::string &p_FileName, unsigned int &p_M, unsigned int &p_K, unsigned int &p_Nnz, MtxCoo &p_Coo) {
+        int l_fd = open(p_FileName.c_str(), O_RDONLY);
+        struct stat l_st;
+        if ((l_fd < 0) || (fstat(l_fd, &l_st) != 0) || (l_st.st_size == 0)) {
+          std::cerr << "ERROR: MtxReader failed to open file " << p_FileName << "\n";
+          if (l_fd >= 0) close(l_fd);
+          return(false);
+        }
+        size_t l_size = l_st.st_size;
+        void *l_map = mmap(nullptr, l_size, PROT_READ, MAP_PRIVATE, l_fd, 0);
+        close(l_fd);
+        if (l_map == MAP_FAILED) {
+          std::cerr << "ERROR: MtxReader failed to map file " << p_FileName << "\n";
+          return(false);
+        }
+        madvise(l_map, l_size, MADV_SEQUENTIAL);
+        const char *l_begin = (const char*)l_map, *l_end = l_begin + l_size;
+        const char *l_data = parseHeader(l_begin, l_end, p_M, p_K, p_Nnz);
+        bool l_ok = (l_data != nullptr);
+        if (!l_ok) {
+          std::cerr << "ERROR: MtxReader failed to read the size line of " << p_FileName << "\n";
+        } else {
+          // Newline-aligned chunk boundaries
+          unsigned int l_chunks = std::max(1u, std::min(m_Threads, (unsigned int)((l_end - l_data) >> 16) + 1));
+          std::vector<const char*> l_bounds(l_chunks + 1, l_end);
+          l_bounds[0] = l_data;
+          for (unsigned int i = 1; i < l_chunks; ++i) {
+            const char *p = std::max(l_bounds[i - 1], l_data + (l_end - l_data) / l_chunks * i);
+            skipLine(p, l_end);
+            l_bounds[i] = p;
+          }
+          std::vector<MtxCoo> l_parts(l_chunks);
+          std::vector<char> l_status(l_chunks, 0);
+          std::vector<std::thread> l_workers;
+          for (unsigned int i = 0; i < l_chunks; ++i) {
+            l_workers.push_back(std::thread([this, &l_bounds, &l_parts, &l_status, l_data, l_end, p_Nnz, i]() {
+              l_parts[i].reserve((size_t)((double)p_Nnz * (l_bounds[i + 1] - l_bounds[i]) / (l_end - l_data)) + 1024);
+              l_status[i] = parseChunk(l_bounds[i], l_bounds[i + 1], l_parts[i]);
+            }));
+          }
+          for (std::thread &l_w : l_workers) l_w.join();
+          l_ok = std::find(l_status.begin(), l_status.end(), 0) == l_status.end();
+          if (l_ok) gather(l_parts, p_Coo);
+        }
+        munmap(l_map, l_size);
+        return(l_ok);
+      }
+
+    bool
+    readGz(const std::string &p_FileName, unsigned int &p_M, unsigned int &p_K, unsigned int &p_Nnz, MtxCoo &p_Coo) {
+        gzFile l_gz = gzopen(p_FileName.c_str(), "rb");
+        if (l_gz == nullptr) {
+          std::cerr << "ERROR: MtxReader failed to open file " << p_FileName << "\n";
+          return(false);
+        }
+        gzbuffer(l_gz, 1 << 20);
+
+        // Bounded queue of newline-aligned blocks; a block with an empty
+        // buffer marks the end of the stream
+        struct Block {
+          size_t m_Id;
+          std::vector<char> m_Buf;
+        };
+        std::deque<Block> l_queue;
+        std::mutex l_mutex;
+        std::condition_variable l_notEmpty, l_notFull;
+        const size_t l_queueCap = 2 * m_Threads;
+        std::vector<MtxCoo> l_parts;
+        bool l_ok = true;
+
+        std::vector<char> l_carry;
+        bool l_header = true;
+        auto l_worker = [&]() {
+          for (;;) {
+            Block l_block;
+            {
+              std::unique_lock<std::mutex> l_lock(l_mutex);
+              l_notEmpty.wait(l_lock, [&]() {return(!l_queue.empty());});
+              if (l_queue.front().m_Buf.empty()) return;
+              l_block = std::move(l_queue.front());
+              l_queue.pop_front();
+              l_notFull.notify_one();
+            }
+            MtxCoo l_part;
+            l_part.reserve(l_block.m_Buf.size() / 16);
+            bool l_blockOk = parseChunk(l_block.m_Buf.data(), l_block.m_Buf.data() + l_block.m_Buf.size(), l_part);
+            std::lock_guard<std::mutex> l_lock(l_mutex);
+            l_ok = l_ok && l_blockOk;
+            l_parts[l_block.m_Id] = std::move(l_part);
+          }
+        };
+        std::vector<std::thread> l_workers;
+        for (unsigned int i = 0; i < std::max(1u, m_Threads - 1); ++i) {
+          l_workers.push_back(std::thread(l_worker));
+        }
+
+        // Inflate on this thread, overlapped with parsing on the workers
+        size_t l_id = 0;
+        for (;;) {
+          std::vector<char> l_buf(l_carry);
+          size_t l_carried = l_buf.size();
+          l_buf.resize(l_carried + GEMX_mtxGzBlockBytes);
+          int l_read = gzread(l_gz, l_buf.data() + l_carried, GEMX_mtxGzBlockBytes);
+          if (l_read < 0) {
+            int l_err;
+            std::cerr << "ERROR: MtxReader failed to decompress " << p_FileName
+                      << ": " << gzerror(l_gz, &l_err) << "\n";
+            l_ok = false;
+            break;
+          }
+          l_buf.resize(l_carried + l_read);
+          bool l_eof = (l_read == 0);
+          // Keep the partial last line for the next block
+          l_carry.clear();
+          if (!l_eof) {
+            size_t l_cut = l_buf.size();
+            while ((l_cut > 0) && (l_buf[l_cut - 1] != '\n')) --l_cut;
+            l_carry.assign(l_buf.begin() + l_cut, l_buf.end());
+            l_buf.resize(l_cut);
+          }
+          if (l_header && !l_buf.empty()) {
+            const char *l_data = parseHeader(l_buf.data(), l_buf.data() + l_buf.size(), p_M, p_K, p_Nnz);
+            if (l_data == nullptr) {
+              if (l_eof) {
+                std::cerr << "ERROR: MtxReader failed to read the size line of " << p_FileName << "\n";
+                l_ok = false;
+                break;
+              }
+              // Header spans blocks, retry with more data
+              l_carry.insert(l_carry.begin(), l_buf.begin(), l_buf.end());
+              continue;
+            }
+            l_buf.erase(l_buf.begin(), l_buf.begin() + (l_data - l_buf.data()));
+            l_header = false;
+          }
+          if (!l_buf.empty()) {
+            std::unique_lock<std::mutex> l_lock(l_mutex);
+            l_notFull.wait(l_lock, [&]() {return(l_queue.size() < l_queueCap);});
+            l_parts.resize(l_id + 1);
+            Block l_block;
+            l_block.m_Id = l_id++;
+            l_block.m_Buf = std::move(l_buf);
+            l_queue.push_back(std::move(l_block));
+            l_notEmpty.notify_one();
+          }
+          if (l_eof) break;
+        }
+        gzclose(l_gz);
+        {
+          std::lock_guard<std::mutex> l_lock(l_mutex);
+          l_queue.push_back(Block());
+          l_notEmpty.notify_all();
+        }
+        for (std::thread &l_w : l_workers) l_w.join();
+        if (l_ok && l_header) {
+          std::cerr << "ERROR: MtxReader failed to read the size line of " << p_FileName << "\n";
+          l_ok = false;
+        }
+        if (l_ok) gather(l_parts, p_Coo);
+        return(l_ok);
+      }
+
+  public:
+    MtxReader(unsigned int p_Threads = std::thread::hardware_concurrency())
+      : m_Threads(std::max(1u, p_Threads)),
+        m_Pattern(false)
+      {}
+
+    // Reads p_FileName (.mtx or .mtx.gz) into p_Coo. Entries keep file order;
+    // pattern matrices get the value 1.
+    bool
+    read(const std::string &p_FileName, unsigned int &p_M, unsigned int &p_K, unsigned int &p_Nnz, MtxCoo &p_Coo) {
+        std::string l_ext = p_FileName.substr(p_FileName.find_last_of(".") + 1);
+        std::transform(l_ext.begin(), l_ext.end(), l_ext.begin(), ::tolower);
+        p_Coo.clear();
+        bool l_ok;
+        if (l_ext == "gz") {
+          l_ok = readGz(p_FileName, p_M, p_K, p_Nnz, p_Coo);
+        } else if (l_ext == "mtx") {
+          l_ok = readMapped(p_FileName, p_M, p_K, p_Nnz, p_Coo);
+        } else {
+          std::cerr << "ERROR: MtxFile failed due to unknown extension \"" << l_ext << "\", file  "
+                    << p_FileName << "\n";
+          return(false);
+        }
+        if (l_ok && (p_Coo.size() != p_Nnz)) {
+          std::cerr << "ERROR: MtxReader expected " << p_Nnz << " entries in " << p_FileName
+                    << ", found " << p_Coo.size() << "\n";
+          l_ok = false;
+        }
+        return(l_ok);
+      }
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Self checking test of MtxReader
+ *
+ *  Writes small Matrix Market files (.mtx and .mtx.gz) to a temporary
+ *  directory, reads them back with one and several threads and compares the
+ *  entries with the values written. Malformed and missing files must fail.
+ *
+ *  Compile and run:
+ *    g++ -O2 -std=c++11 -I src/host src/host/gemx_mtx_reader_test.cpp -lz -pthread -o gemx_mtx_reader_test.exe
+ *    ./gemx_mtx_reader_test.exe
+ */
+
+// Small gzip blocks so that the pipelined inflate crosses many block edges
+#define GEMX_mtxGzBlockBytes 4096
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <zlib.h>
+#include "gemx_mtx_reader.h"
+
+static unsigned int g_Errors = 0;
+
+static void
+check(bool p_Cond, const std::string &p_What) {
+  if (!p_Cond) {
+    std::cerr << "ERROR: " << p_What << "\n";
+    g_Errors++;
+  }
+}
+
+static void
+writeFile(const std::string &p_FileName, const std::string &p_Data) {
+  std::ofstream l_of(p_FileName.c_str(), std::ios::binary);
+  l_of.write(p_Data.data(), p_Data.size());
+}
+
+static void
+writeGz(const std::string &p_FileName, const std::string &p_Data) {
+  gzFile l_gz = gzopen(p_FileName.c_str(), "wb");
+  gzwrite(l_gz, p_Data.data(), p_Data.size());
+  gzclose(l_gz);
+}
+
+static void
+testMtx(const std::string &p_Dir) {
+  // Values that take both the exact fast path and the strtod fallback
+  const double l_vals[] = {1.5, -2.25e-3, 3e10, 0.1, -7, 1.7976931348623157e308, 4.9e-324, 123456789012345678.0};
+  const unsigned int l_numVals = sizeof(l_vals) / sizeof(l_vals[0]);
+  const unsigned int l_m = 300, l_k = 200, l_nnz = 5000;
+  std::ostringstream l_os;
+  l_os.precision(17);
+  l_os << "%%MatrixMarket matrix coordinate real general\n% comment\n%\n" << l_m << " " << l_k << " " << l_nnz << "\n";
+  for (unsigned int i = 0; i < l_nnz; ++i) {
+    l_os << (i * 7) % l_m + 1 << "\t" << (i * 13) % l_k + 1 << "  " << l_vals[i % l_numVals] << ((i % 5) ? "\n" : "\r\n");
+  }
+  writeFile(p_Dir + "/a.mtx", l_os.str());
+  writeGz(p_Dir + "/a.mtx.gz", l_os.str());
+
+  for (const char *l_name : {"/a.mtx", "/a.mtx.gz"}) {
+    for (unsigned int l_threads : {1u, 4u}) {
+      std::string l_file = p_Dir + l_name;
+      MtxReader l_reader(l_threads);
+      MtxCoo l_coo;
+      unsigned int l_rm = 0, l_rk = 0, l_rnnz = 0;
+      std::string l_what = std::string(l_name) + " with " + std::to_string(l_threads) + " threads";
+      check(l_reader.read(l_file, l_rm, l_rk, l_rnnz, l_coo), l_what + " failed to read");
+      check((l_rm == l_m) && (l_rk == l_k) && (l_rnnz == l_nnz) && (l_coo.size() == l_nnz), l_what + " has the wrong size");
+      unsigned int l_bad = 0;
+      for (unsigned int i = 0; (i < l_nnz) && (i < l_coo.size()); ++i) {
+        if ((l_coo.m_Row[i] != (i * 7) % l_m) || (l_coo.m_Col[i] != (i * 13) % l_k) ||
+            (l_coo.m_Val[i] != l_vals[i % l_numVals])) {
+          l_bad++;
+        }
+      }
+      check(l_bad == 0, l_what + " has " + std::to_string(l_bad) + " wrong entries");
+    }
+  }
+
+  writeFile(p_Dir + "/p.mtx", "%%MatrixMarket matrix coordinate pattern general\n3 4 2\n1 2\n3 4\n");
+  MtxReader l_reader;
+  MtxCoo l_coo;
+  unsigned int l_m2, l_k2, l_nnz2;
+  check(l_reader.read(p_Dir + "/p.mtx", l_m2, l_k2, l_nnz2, l_coo) && (l_coo.size() == 2) &&
+        (l_coo.m_Row[1] == 2) && (l_coo.m_Col[1] == 3) && (l_coo.m_Val[0] == 1) && (l_coo.m_Val[1] == 1),
+        "pattern .mtx is not read as ones");
+
+  std::cerr << "INFO: the next MtxReader errors are expected\n";
+  writeFile(p_Dir + "/short.mtx", "%%MatrixMarket matrix coordinate real general\n3 3 3\n1 1 1.0\n2 2 2.0\n");
+  check(!l_reader.read(p_Dir + "/short.mtx", l_m2, l_k2, l_nnz2, l_coo), ".mtx with missing entries is accepted");
+  writeFile(p_Dir + "/bad.mtx", "%%MatrixMarket matrix coordinate real general\n3 3 2\n1 1 1.0\n2 x 2.0\n");
+  check(!l_reader.read(p_Dir + "/bad.mtx", l_m2, l_k2, l_nnz2, l_coo), "malformed .mtx line is accepted");
+  check(!l_reader.read(p_Dir + "/none.mtx", l_m2, l_k2, l_nnz2, l_coo), "missing .mtx file is accepted");
+  check(!l_reader.read(p_Dir + "/a.txt", l_m2, l_k2, l_nnz2, l_coo), "unknown extension is accepted");
+}
+
+int main()
+{
+  char l_template[] = "/tmp/gemx_mtx_reader_test.XXXXXX";
+  if (mkdtemp(l_template) == nullptr) {
+    std::cerr << "ERROR: failed to create a temporary directory\n";
+    return(EXIT_FAILURE);
+  }
+  std::string l_dir(l_template);
+  testMtx(l_dir);
+  std::string l_rm = "rm -rf " + l_dir;
+  if (system(l_rm.c_str()) != 0) {
+    std::cerr << "WARNING: failed to remove " << l_dir << "\n";
+  }
+  if (g_Errors != 0) {
+    std::cout << "FAIL: " << g_Errors << " MtxReader checks failed\n";
+    return(EXIT_FAILURE);
+  }
+  std::cout << "PASS: gemx_mtx_reader_test\n";
+  return(EXIT_SUCCESS);
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Analytic cycle and DDR traffic model of the GEMX engines
+ *
+ *  Predicts the cycles, DDR bytes and GOPS of one instruction from its
+ *  arguments and the engine configuration, without running the kernel.
+ *  Every engine moves at most one DDR word per cycle on each of its read and
+ *  write ports; the stages of an engine that run in a DATAFLOW region
+ *  overlap, sequential stages add up and each pays m_BurstLatency to start.
+ *  The model is meant for comparing tile configurations and batch sizes; it
+ *  does not know about DDR refresh, bank conflicts or the clock actually met.
+ */
+
+#ifndef GEMX_PERFMODEL_H
+#define GEMX_PERFMODEL_H
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+namespace gemx {
+namespace perfmodel {
+
+// Engine configuration, taken from the GEMX_* build settings when they are defined
+class Config {
+  public:
+    unsigned int m_DdrWidth, m_XddrWidth, m_ElemBytes;
+    unsigned int m_GemmMBlocks, m_GemmKBlocks, m_GemmNBlocks;
+    unsigned int m_TranspBlocks;
+    unsigned int m_SpmvWidth, m_SpmvMacGroups, m_SpmvmVectorBlocks, m_SpmvkVectorBlocks, m_SpmvFloatPerDesc;
+    unsigned int m_BurstLatency;   // cycles from a DDR burst request to its first word
+    double m_ClockMHz;
+  public:
+    Config()
+      : m_DdrWidth(32), m_XddrWidth(16), m_ElemBytes(2),
+        m_GemmMBlocks(1), m_GemmKBlocks(2), m_GemmNBlocks(1),
+        m_TranspBlocks(1),
+        m_SpmvWidth(8), m_SpmvMacGroups(12), m_SpmvmVectorBlocks(5), m_SpmvkVectorBlocks(2048), m_SpmvFloatPerDesc(2),
+        m_BurstLatency(100),
+        m_ClockMHz(250) {
+        #ifdef GEMX_ddrWidth
+        m_DdrWidth = GEMX_ddrWidth;
+        #endif
+        #ifdef GEMX_XddrWidth
+        m_XddrWidth = GEMX_XddrWidth;
+        #endif
+        #ifdef GEMX_dataType
+        m_ElemBytes = sizeof(GEMX_dataType);
+        #endif
+        #ifdef GEMX_gemmMBlocks
+        m_GemmMBlocks = GEMX_gemmMBlocks;
+        m_GemmKBlocks = GEMX_gemmKBlocks;
+        m_GemmNBlocks = GEMX_gemmNBlocks;
+        #endif
+        #ifdef GEMX_transpBlocks
+        m_TranspBlocks = GEMX_transpBlocks;
+        #endif
+        #ifdef GEMX_spmvWidth
+        m_SpmvWidth = GEMX_spmvWidth;
+        m_SpmvMacGroups = GEMX_spmvMacGroups;
+        m_SpmvkVectorBlocks = GEMX_spmvkVectorBlocks;
+        m_SpmvFloatPerDesc = GEMX_spmvFloatPerDesc;
+        #endif
+        #ifdef GEMX_spmvmVectorBlocks
+        m_SpmvmVectorBlocks = GEMX_spmvmVectorBlocks;
+        #endif
+      }
+    unsigned int getDdrWordBytes() const {return m_DdrWidth * m_ElemBytes;}
+    unsigned int getSpmvRowsInCblock() const {return m_SpmvWidth * m_SpmvMacGroups * m_SpmvmVectorBlocks * m_DdrWidth;}
+    unsigned int getSpmvColsInBblock() const {return m_SpmvWidth * m_SpmvkVectorBlocks * m_DdrWidth;}
+};
+
+class Estimate {
+  public:
+    unsigned long long m_Cycles, m_DdrRdBytes, m_DdrWrBytes, m_Ops;
+    double m_ClockMHz;
+  public:
+    Estimate(double p_ClockMHz = 250)
+      : m_Cycles(0), m_DdrRdBytes(0), m_DdrWrBytes(0), m_Ops(0), m_ClockMHz(p_ClockMHz) {}
+    unsigned long long getDdrBytes() const {return m_DdrRdBytes + m_DdrWrBytes;}
+    double getTimeMs() const {return m_Cycles / (m_ClockMHz * 1e3);}
+    double getGops() const {return m_Cycles ? m_Ops * m_ClockMHz * 1e-3 / m_Cycles : 0;}
+    double getDdrGBps() const {return m_Cycles ? getDdrBytes() * m_ClockMHz * 1e-3 / m_Cycles : 0;}
+    Estimate &operator+=(const Estimate &p_Val) {
+        m_Cycles += p_Val.m_Cycles;
+        m_DdrRdBytes += p_Val.m_DdrRdBytes;
+        m_DdrWrBytes += p_Val.m_DdrWrBytes;
+        m_Ops += p_Val.m_Ops;
+        return(*this);
+      }
+    void
+    print(std::ostream& os) const {
+        os << std::right << std::setw(12) << m_Cycles
+           << std::setw(14) << std::fixed << std::setprecision(6) << getTimeMs()
+           << std::setw(14) << getDdrBytes()
+           << std::setw(10) << std::setprecision(2) << getDdrGBps()
+           << std::setw(10) << getGops();
+      }
+};
+inline std::ostream& operator<<(std::ostream& os, const Estimate &p_Val) {
+  p_Val.print(os);
+  return(os);
+}
+
+class PerfModel {
+  private:
+    Config m_Config;
+  private:
+    static unsigned long long
+    ceilDiv(unsigned long long p_Val, unsigned long long p_Div) {
+        return((p_Val + p_Div - 1) / p_Div);
+      }
+    Estimate
+    newEstimate() const {
+        return(Estimate(m_Config.m_ClockMHz));
+      }
+  public:
+    PerfModel(const Config &p_Config = Config()) : m_Config(p_Config) {}
+    const Config &getConfig() const {return m_Config;}
+
+    /*
+     * gemm : C = A * B + X on the systolic array of m_DdrWidth x m_DdrWidth MACs.
+     * Each MBlocks x KBlocks x NBlocks tile of DDR words is read by one read port
+     * while the previous one is multiplied, so a tile costs the larger of its
+     * MACs over the array and its A plus B words.
+     */
+    Estimate
+    gemm(unsigned int p_M, unsigned int p_K, unsigned int p_N) const {
+        const Config &c = m_Config;
+        const unsigned long long l_aMH = c.m_DdrWidth * c.m_GemmMBlocks,
+                                 l_bKD = c.m_DdrWidth * c.m_GemmKBlocks,
+                                 l_bNW = c.m_DdrWidth * c.m_GemmNBlocks;
+        const unsigned long long l_rowBlocks = ceilDiv(p_M, l_aMH),
+                                 l_kBlocks = ceilDiv(p_K, l_bKD),
+                                 l_colBlocks = ceilDiv(p_N, l_bNW);
+        const unsigned long long l_cBlocks = l_rowBlocks * l_colBlocks,
+                                 l_tiles = l_cBlocks * l_kBlocks;
+        const unsigned long long l_tileCompute = l_aMH * c.m_GemmKBlocks * c.m_GemmNBlocks,
+                                 l_tileRead = l_aMH * c.m_GemmKBlocks + l_bKD * c.m_GemmNBlocks,
+                                 l_xRead = l_aMH * c.m_GemmNBlocks * c.m_DdrWidth / c.m_XddrWidth,
+                                 l_cWrite = l_aMH * c.m_GemmNBlocks;
+        const unsigned long long l_rdWords = l_tiles * l_tileRead + l_cBlocks * l_xRead,
+                                 l_wrWords = l_cBlocks * l_cWrite;
+        Estimate l_est = newEstimate();
+        l_est.m_Cycles = std::max(std::max(l_tiles * l_tileCompute, l_rdWords), l_wrWords) +
+                         c.m_BurstLatency + 2 * c.m_DdrWidth;
+        l_est.m_DdrRdBytes = l_rdWords * c.getDdrWordBytes();
+        l_est.m_DdrWrBytes = l_wrWords * c.getDdrWordBytes();
+        l_est.m_Ops = 2ULL * p_M * p_K * p_N + (unsigned long long)p_M * p_N;
+        return(l_est);
+      }
+    template <typename t_GemmArgs>
+    Estimate
+    gemm(const t_GemmArgs &p_Args) const {
+        return(gemm(p_Args.m_M, p_Args.m_K, p_Args.m_N));
+      }
+    // The scaling and PReLU of FCN are fused into the C write
+    Estimate
+    fcn(unsigned int p_M, unsigned int p_K, unsigned int p_N) const {
+        Estimate l_est = gemm(p_M, p_K, p_N);
+        l_est.m_Ops += (unsigned long long)p_M * p_N;
+        return(l_est);
+      }
+    template <typename t_FcnArgs>
+    Estimate
+    fcn(const t_FcnArgs &p_Args) const {
+        return(fcn(p_Args.m_M, p_Args.m_K, p_Args.m_N));
+      }
+
+    // gemv : B and C are loaded and C stored in sequence around the streaming of A
+    Estimate
+    gemv(unsigned int p_M, unsigned int p_K) const {
+        const Config &c = m_Config;
+        const unsigned long long l_mWords = ceilDiv(p_M, c.m_DdrWidth),
+                                 l_kWords = ceilDiv(p_K, c.m_DdrWidth),
+                                 l_aWords = l_mWords * l_kWords * c.m_DdrWidth;
+        Estimate l_est = newEstimate();
+        l_est.m_Cycles = l_kWords + l_mWords + l_aWords + l_mWords +
+                         4 * c.m_BurstLatency;
+        l_est.m_DdrRdBytes = (l_kWords + l_mWords + l_aWords) * c.getDdrWordBytes();
+        l_est.m_DdrWrBytes = l_mWords * c.getDdrWordBytes();
+        l_est.m_Ops = 2ULL * p_M * p_K;
+        return(l_est);
+      }
+    template <typename t_GemvArgs>
+    Estimate
+    gemv(const t_GemvArgs &p_Args) const {
+        return(gemv(p_Args.m_M, p_Args.m_K));
+      }
+
+    // transp : the source is read and the destination written in one DATAFLOW pass
+    Estimate
+    transp(unsigned int p_Rows, unsigned int p_Cols) const {
+        const Config &c = m_Config;
+        const unsigned long long l_words = ceilDiv((unsigned long long)p_Rows * p_Cols, c.m_DdrWidth);
+        Estimate l_est = newEstimate();
+        l_est.m_Cycles = l_words + c.m_BurstLatency + c.m_DdrWidth * c.m_TranspBlocks;
+        l_est.m_DdrRdBytes = l_words * c.getDdrWordBytes();
+        l_est.m_DdrWrBytes = l_words * c.getDdrWordBytes();
+        return(l_est);
+      }
+    template <typename t_TranspArgs>
+    Estimate
+    transp(const t_TranspArgs &p_Args) const {
+        return(transp(p_Args.m_Src.m_Rows, p_Args.m_Src.m_Cols));
+      }
+
+    /*
+     * spmv : runs descriptor by descriptor. For every B block the B vector
+     * slice is loaded, then for every C block C is loaded, the nnzs of the
+     * descriptor are multiplied m_SpmvWidth per cycle and C is stored again.
+     * p_DescNnz holds the padded nnz of the p_Bblocks x p_Cblocks descriptors
+     * in kernel order (B block major); empty blocks still pay the C traffic.
+     */
+    Estimate
+    spmv(unsigned int p_M, unsigned int p_K, unsigned int p_Nnz,
+         unsigned int p_Bblocks, unsigned int p_Cblocks,
+         const std::vector<unsigned int> &p_DescNnz) const {
+        const Config &c = m_Config;
+        const unsigned int l_rowsInCblock = c.getSpmvRowsInCblock(),
+                           l_colsInBblock = c.getSpmvColsInBblock(),
+                           l_rowsPerGroup = c.m_SpmvWidth * c.m_SpmvMacGroups;
+        unsigned long long l_cycles = 0, l_rdWords = 0, l_wrWords = 0;
+        const unsigned long long l_descWords = ceilDiv((unsigned long long)p_Bblocks * p_Cblocks,
+                                                       c.m_DdrWidth / c.m_SpmvFloatPerDesc);
+        l_cycles += l_descWords + c.m_BurstLatency;
+        l_rdWords += l_descWords;
+        for (unsigned int l_Bblock = 0; l_Bblock < p_Bblocks; ++l_Bblock) {
+          const unsigned int l_cols = ((l_Bblock < p_Bblocks - 1) || (p_K % l_colsInBblock == 0)) ?
+                                      l_colsInBblock : p_K % l_colsInBblock;
+          const unsigned long long l_bWords = ceilDiv(l_cols, c.m_DdrWidth);
+          l_cycles += l_bWords + c.m_BurstLatency;
+          l_rdWords += l_bWords;
+          for (unsigned int l_Cblock = 0; l_Cblock < p_Cblocks; ++l_Cblock) {
+            const unsigned int l_rows = ((l_Cblock < p_Cblocks - 1) || (p_M % l_rowsInCblock == 0)) ?
+                                        l_rowsInCblock : p_M % l_rowsInCblock;
+            const unsigned long long l_cWords = ceilDiv(l_rows, l_rowsPerGroup) * l_rowsPerGroup / c.m_DdrWidth;
+            const unsigned int l_idx = l_Bblock * p_Cblocks + l_Cblock;
+            const unsigned long long l_aWords = (l_idx < p_DescNnz.size()) ?
+                                                ceilDiv(p_DescNnz[l_idx], c.m_SpmvWidth) : 0;
+            l_cycles += 2 * l_cWords + l_aWords + 3 * c.m_BurstLatency;
+            l_rdWords += l_cWords + l_aWords;
+            l_wrWords += l_cWords;
+          }
+        }
+        Estimate l_est = newEstimate();
+        l_est.m_Cycles = l_cycles;
+        l_est.m_DdrRdBytes = l_rdWords * c.getDdrWordBytes();
+        l_est.m_DdrWrBytes = l_wrWords * c.getDdrWordBytes();
+        l_est.m_Ops = 2ULL * p_Nnz;
+        return(l_est);
+      }
+    template <typename t_SpmvArgs>
+    Estimate
+    spmv(const t_SpmvArgs &p_Args, const std::vector<unsigned int> &p_DescNnz) const {
+        return(spmv(p_Args.m_M, p_Args.m_K, p_Args.m_Nnz, p_Args.m_Bblocks, p_Args.m_Cblocks, p_DescNnz));
+      }
+    // Descriptor nnzs of a COO matrix as the host packs them: per block, padded to m_SpmvWidth
+    std::vector<unsigned int>
+    spmvDescNnz(const int *p_Row, const int *p_Col, unsigned int p_Nnz,
+                unsigned int p_Bblocks, unsigned int p_Cblocks) const {
+        const Config &c = m_Config;
+        std::vector<unsigned int> l_nnz((size_t)p_Bblocks * p_Cblocks, 0);
+        for (unsigned int i = 0; i < p_Nnz; ++i) {
+          unsigned int l_idx = (p_Col[i] / c.getSpmvColsInBblock()) * p_Cblocks + p_Row[i] / c.getSpmvRowsInCblock();
+          if (l_idx < l_nnz.size()) {
+            l_nnz[l_idx]++;
+          }
+        }
+        for (unsigned int &l_n : l_nnz) {
+          l_n = ceilDiv(l_n, c.m_SpmvWidth) * c.m_SpmvWidth;
+        }
+        return(l_nnz);
+      }
+
+    /*
+     * uspmv : the stage matrices are loaded once, then the p_NumRuns columns of
+     * B stream through the chain of stages. A stage spends, per run, the words
+     * of its B column, its nnz and its C column; the chain runs at the pace
+     * of its slowest stage once it is full.
+     */
+    Estimate
+    uspmv(unsigned int p_NumRuns, const std::vector<unsigned int> &p_Rows,
+          const std::vector<unsigned int> &p_Cols, const std::vector<unsigned int> &p_Nnzs) const {
+        const Config &c = m_Config;
+        const unsigned int l_stages = p_Nnzs.size();
+        const unsigned long long l_addrBlocks = ceilDiv(l_stages, 2 * c.m_DdrWidth);
+        unsigned long long l_loadA = 3 * l_addrBlocks + c.m_BurstLatency,
+                           l_fill = 0, l_slowest = 0, l_nnz = 0;
+        for (unsigned int l_stage = 0; l_stage < l_stages; ++l_stage) {
+          const unsigned long long l_nnzWords = ceilDiv(p_Nnzs[l_stage], c.m_DdrWidth);
+          const unsigned long long l_perRun = ceilDiv(p_Cols[l_stage], c.m_DdrWidth) + l_nnzWords +
+                                              ceilDiv(p_Rows[l_stage], c.m_DdrWidth);
+          l_loadA += 2 * l_nnzWords;
+          l_fill += l_perRun;
+          l_slowest = std::max(l_slowest, l_perRun);
+          l_nnz += p_Nnzs[l_stage];
+        }
+        const unsigned long long l_bWords = l_stages ? ceilDiv(p_Cols[0], c.m_DdrWidth) : 0,
+                                 l_cWords = l_stages ? ceilDiv(p_Rows[l_stages - 1], c.m_DdrWidth) : 0;
+        Estimate l_est = newEstimate();
+        l_est.m_Cycles = l_loadA + c.m_BurstLatency + l_fill +
+                         (p_NumRuns ? (unsigned long long)(p_NumRuns - 1) * l_slowest : 0);
+        l_est.m_DdrRdBytes = (l_loadA - c.m_BurstLatency + p_NumRuns * l_bWords) * c.getDdrWordBytes();
+        l_est.m_DdrWrBytes = p_NumRuns * l_cWords * c.getDdrWordBytes();
+        l_est.m_Ops = 2ULL * p_NumRuns * l_nnz;
+        return(l_est);
+      }
+};
+
+} // namespace perfmodel
+} // namespace gemx
+
+#endif
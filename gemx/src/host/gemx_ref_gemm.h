@@ -0,0 +1,253 @@
+/*
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+
+*/
+/**
+ *  @brief Host golden model for C = post(A * B + X)
+ *
+ *  Blocked and multi-threaded. For 16-bit integer types the products are
+ *  accumulated in packed doubles with AVX2 FMA when the CPU supports it;
+ *  int16 * int16 products and their sums stay below 2^53 for K < 2^23, so
+ *  the accumulation is exact and matches the integer MAC of the kernel.
+ *  Transposed operands are stored as K x M (A), N x K (B) and N x M (X, C).
+ */
+
+#ifndef GEMX_REF_GEMM_H
+#define GEMX_REF_GEMM_H
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GEMX_REF_X86 1
+#else
+#define GEMX_REF_X86 0
+#endif
+
+#ifndef GEMX_macBits
+#define GEMX_macBits 48
+#endif
+
+namespace gemx {
+
+// Calls p_Fn(begin, end) for chunks of [0, p_Num) on all hardware threads
+template <typename t_Fn>
+void
+refParallelFor(unsigned int p_Num, unsigned int p_Grain, t_Fn p_Fn) {
+    unsigned int l_chunks = (p_Num + p_Grain - 1) / p_Grain;
+    unsigned int l_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    l_threads = std::min(l_threads, l_chunks);
+    std::atomic<unsigned int> l_next(0);
+    auto l_worker = [&]() {
+      unsigned int l_chunk;
+      while ((l_chunk = l_next++) < l_chunks) {
+        p_Fn(l_chunk * p_Grain, std::min(p_Num, (l_chunk + 1) * p_Grain));
+      }
+    };
+    std::vector<std::thread> l_pool;
+    for (unsigned int t = 1; t < l_threads; ++t) {
+      l_pool.emplace_back(l_worker);
+    }
+    l_worker();
+    for (auto &l_thread : l_pool) {
+      l_thread.join();
+    }
+  }
+
+// Sign-extend the low GEMX_macBits bits, i.e. the ap_int<t_MacBits> wrap of the kernel
+inline int64_t
+refWrapMacBits(int64_t p_Val) {
+    const unsigned int l_shift = 64 - GEMX_macBits;
+    return (int64_t)((uint64_t)p_Val << l_shift) >> l_shift;
+  }
+
+// Kernel GemmAddX post-scale with keepMacBits: postScale bits 23..8 are an
+// unsigned multiplier, bits 7..0 an arithmetic right shift
+template <typename T>
+inline T
+refPostScaleMacBits(int64_t p_Abx, int32_t p_PostScale) {
+    int64_t l_psVal = ((uint32_t)p_PostScale >> 8) & 0xffff;
+    unsigned int l_psShift = p_PostScale & 0x00ff;
+    int64_t l_entry = refWrapMacBits(refWrapMacBits(p_Abx) * l_psVal);
+    l_entry = l_entry >> std::min(l_psShift, 63u);
+    return (T)(l_entry);
+  }
+
+#if GEMX_REF_X86
+inline bool
+refHasAvx2Fma() {
+    static const bool l_has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return l_has;
+  }
+
+// 4x12 register tile over packed panels A[K][4] and B[K][12]
+__attribute__((target("avx2,fma"), optimize("O3")))
+inline void
+refTileAvx2(const double *p_A, const double *p_B, unsigned int p_K, double *p_C) {
+    __m256d l_c00 = _mm256_setzero_pd(), l_c01 = _mm256_setzero_pd(), l_c02 = _mm256_setzero_pd();
+    __m256d l_c10 = _mm256_setzero_pd(), l_c11 = _mm256_setzero_pd(), l_c12 = _mm256_setzero_pd();
+    __m256d l_c20 = _mm256_setzero_pd(), l_c21 = _mm256_setzero_pd(), l_c22 = _mm256_setzero_pd();
+    __m256d l_c30 = _mm256_setzero_pd(), l_c31 = _mm256_setzero_pd(), l_c32 = _mm256_setzero_pd();
+    for (unsigned int k = 0; k < p_K; ++k) {
+      __m256d l_b0 = _mm256_loadu_pd(p_B);
+      __m256d l_b1 = _mm256_loadu_pd(p_B + 4);
+      __m256d l_b2 = _mm256_loadu_pd(p_B + 8);
+      __m256d l_a = _mm256_broadcast_sd(p_A);
+      l_c00 = _mm256_fmadd_pd(l_a, l_b0, l_c00);
+      l_c01 = _mm256_fmadd_pd(l_a, l_b1, l_c01);
+      l_c02 = _mm256_fmadd_pd(l_a, l_b2, l_c02);
+      l_a = _mm256_broadcast_sd(p_A + 1);
+      l_c10 = _mm256_fmadd_pd(l_a, l_b0, l_c10);
+      l_c11 = _mm256_fmadd_pd(l_a, l_b1, l_c11);
+      l_c12 = _mm256_fmadd_pd(l_a, l_b2, l_c12);
+      l_a = _mm256_broadcast_sd(p_A + 2);
+      l_c20 = _mm256_fmadd_pd(l_a, l_b0, l_c20);
+      l_c21 = _mm256_fmadd_pd(l_a, l_b1, l_c21);
+      l_c22 = _mm256_fmadd_pd(l_a, l_b2, l_c22);
+      l_a = _mm256_broadcast_sd(p_A + 3);
+      l_c30 = _mm256_fmadd_pd(l_a, l_b0, l_c30);
+      l_c31 = _mm256_fmadd_pd(l_a, l_b1, l_c31);
+      l_c32 = _mm256_fmadd_pd(l_a, l_b2, l_c32);
+      p_A += 4;
+      p_B += 12;
+    }
+    _mm256_storeu_pd(p_C +  0, l_c00); _mm256_storeu_pd(p_C +  4, l_c01); _mm256_storeu_pd(p_C +  8, l_c02);
+    _mm256_storeu_pd(p_C + 12, l_c10); _mm256_storeu_pd(p_C + 16, l_c11); _mm256_storeu_pd(p_C + 20, l_c12);
+    _mm256_storeu_pd(p_C + 24, l_c20); _mm256_storeu_pd(p_C + 28, l_c21); _mm256_storeu_pd(p_C + 32, l_c22);
+    _mm256_storeu_pd(p_C + 36, l_c30); _mm256_storeu_pd(p_C + 40, l_c31); _mm256_storeu_pd(p_C + 44, l_c32);
+  }
+
+// Exact double-accumulated path for 16-bit integer A and B
+template <typename t_AccType, typename T, typename TX, typename t_PostOp>
+void
+refGemmPacked(
+  unsigned int p_M, unsigned int p_K, unsigned int p_N,
+  const T *p_A, unsigned int p_Lda,
+  const T *p_B, unsigned int p_Ldb,
+  const TX *p_X, unsigned int p_Ldx,
+  T *p_C, unsigned int p_Ldc,
+  t_PostOp p_Post,
+  bool p_TransA, bool p_TransB, bool p_TransC
+) {
+    const size_t l_aRowStride = p_TransA ? 1 : p_Lda, l_aColStride = p_TransA ? p_Lda : 1;
+    const size_t l_bRowStride = p_TransB ? 1 : p_Ldb, l_bColStride = p_TransB ? p_Ldb : 1;
+    const size_t l_cRowStride = p_TransC ? 1 : p_Ldc, l_cColStride = p_TransC ? p_Ldc : 1;
+    const size_t l_xRowStride = p_TransC ? 1 : p_Ldx, l_xColStride = p_TransC ? p_Ldx : 1;
+    const unsigned int l_mr = 4, l_nr = 12;
+    const unsigned int l_nc = l_nr * 32;
+    std::vector<double> l_bPack;
+    for (unsigned int l_col0 = 0; l_col0 < p_N; l_col0 += l_nc) {
+      unsigned int l_cols = std::min(l_nc, p_N - l_col0);
+      unsigned int l_panels = (l_cols + l_nr - 1) / l_nr;
+      l_bPack.resize((size_t)l_panels * p_K * l_nr);
+      refParallelFor(l_panels, 1, [&](unsigned int p_Begin, unsigned int p_End) {
+        for (unsigned int p = p_Begin; p < p_End; ++p) {
+          double *l_dst = &l_bPack[(size_t)p * p_K * l_nr];
+          for (unsigned int k = 0; k < p_K; ++k) {
+            const T *l_src = p_B + k * l_bRowStride;
+            for (unsigned int j = 0; j < l_nr; ++j) {
+              unsigned int l_col = l_col0 + p * l_nr + j;
+              *l_dst++ = (l_col < p_N) ? (double)l_src[l_col * l_bColStride] : 0.0;
+            }
+          }
+        }
+      });
+      refParallelFor(p_M, 8 * l_mr, [&](unsigned int p_Begin, unsigned int p_End) {
+        std::vector<double> l_aPack((size_t)p_K * l_mr);
+        double l_tile[l_mr * l_nr];
+        for (unsigned int l_row0 = p_Begin; l_row0 < p_End; l_row0 += l_mr) {
+          unsigned int l_rows = std::min(l_mr, p_End - l_row0);
+          for (unsigned int k = 0; k < p_K; ++k) {
+            for (unsigned int i = 0; i < l_mr; ++i) {
+              l_aPack[k * l_mr + i] = (i < l_rows) ? (double)p_A[(l_row0 + i) * l_aRowStride + k * l_aColStride] : 0.0;
+            }
+          }
+          for (unsigned int p = 0; p < l_panels; ++p) {
+            refTileAvx2(&l_aPack[0], &l_bPack[(size_t)p * p_K * l_nr], p_K, l_tile);
+            unsigned int l_colBase = l_col0 + p * l_nr;
+            unsigned int l_tileCols = std::min(l_nr, p_N - l_colBase);
+            for (unsigned int i = 0; i < l_rows; ++i) {
+              size_t l_row = l_row0 + i;
+              for (unsigned int j = 0; j < l_tileCols; ++j) {
+                t_AccType l_acc = (t_AccType)(int64_t)l_tile[i * l_nr + j];
+                size_t l_col = l_colBase + j;
+                p_C[l_row * l_cRowStride + l_col * l_cColStride] = p_Post(l_acc, p_X[l_row * l_xRowStride + l_col * l_xColStride]);
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+#endif
+
+// C = p_Post(A * B, X) with products summed in t_AccType in k order
+template <typename t_AccType, typename T, typename TX, typename t_PostOp>
+void
+refGemm(
+  unsigned int p_M, unsigned int p_K, unsigned int p_N,
+  const T *p_A, unsigned int p_Lda,
+  const T *p_B, unsigned int p_Ldb,
+  const TX *p_X, unsigned int p_Ldx,
+  T *p_C, unsigned int p_Ldc,
+  t_PostOp p_Post,
+  bool p_TransA = false, bool p_TransB = false, bool p_TransC = false
+) {
+  #if GEMX_REF_X86
+    if (std::is_integral<T>::value && (sizeof(T) <= 2) && (p_K < (1u << 23)) && refHasAvx2Fma()) {
+      refGemmPacked<t_AccType>(p_M, p_K, p_N, p_A, p_Lda, p_B, p_Ldb, p_X, p_Ldx, p_C, p_Ldc, p_Post,
+                               p_TransA, p_TransB, p_TransC);
+      return;
+    }
+  #endif
+    const size_t l_aRowStride = p_TransA ? 1 : p_Lda, l_aColStride = p_TransA ? p_Lda : 1;
+    const size_t l_bRowStride = p_TransB ? 1 : p_Ldb, l_bColStride = p_TransB ? p_Ldb : 1;
+    const size_t l_cRowStride = p_TransC ? 1 : p_Ldc, l_cColStride = p_TransC ? p_Ldc : 1;
+    const size_t l_xRowStride = p_TransC ? 1 : p_Ldx, l_xColStride = p_TransC ? p_Ldx : 1;
+    // Row-parallel i-k-j order, K blocked so the B rows stay in cache
+    const unsigned int l_kc = 256;
+    refParallelFor(p_M, 16, [&](unsigned int p_Begin, unsigned int p_End) {
+      std::vector<t_AccType> l_acc((size_t)(p_End - p_Begin) * p_N, t_AccType(0));
+      for (unsigned int l_k0 = 0; l_k0 < p_K; l_k0 += l_kc) {
+        unsigned int l_k1 = std::min(p_K, l_k0 + l_kc);
+        for (unsigned int i = p_Begin; i < p_End; ++i) {
+          t_AccType *l_accRow = &l_acc[(size_t)(i - p_Begin) * p_N];
+          const T *l_aRow = p_A + i * l_aRowStride;
+          for (unsigned int k = l_k0; k < l_k1; ++k) {
+            const t_AccType l_a = l_aRow[k * l_aColStride];
+            const T *l_bRow = p_B + k * l_bRowStride;
+            for (unsigned int j = 0; j < p_N; ++j) {
+              l_accRow[j] += l_a * (t_AccType)l_bRow[j * l_bColStride];
+            }
+          }
+        }
+      }
+      for (unsigned int i = p_Begin; i < p_End; ++i) {
+        const t_AccType *l_accRow = &l_acc[(size_t)(i - p_Begin) * p_N];
+        for (unsigned int j = 0; j < p_N; ++j) {
+          p_C[i * l_cRowStride + j * l_cColStride] = p_Post(l_accRow[j], p_X[i * l_xRowStride + j * l_xColStride]);
+        }
+      }
+    });
+  }
+
+} // namespace
+
+#endif
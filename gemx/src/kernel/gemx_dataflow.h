@@ -0,0 +1,530 @@
+/**********
+ * Copyright 2019 Xilinx, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ * **********/
+/**
+ *  @brief Kernel streams and threaded C simulation of DATAFLOW regions
+ *
+ *  gemx::Stream is hls::stream, except in C simulation with
+ *  GEMX_threadedCsim=1 or GEMX_streamProfile=1. With GEMX_threadedCsim,
+ *  streams declared in a region opened with
+ *  GEMX_DATAFLOW_REGION are bounded lock-free single producer single
+ *  consumer FIFOs of their STREAM depth, and each GEMX_DATAFLOW_PROCESS of
+ *  the region runs on its own thread. A region whose streams stop moving
+ *  for GEMX_dataflowTimeoutSec is reported as deadlocked with the fill
+ *  level of its FIFOs. Streams declared elsewhere keep the unbounded
+ *  sequential behaviour of hls::stream.
+ *
+ *  Usage, with the HLS pragmas kept as they are:
+ *    GEMX_DATAFLOW_REGION(l_dataflow);             // before the streams
+ *    DdrStream l_s;
+ *    #pragma HLS STREAM variable=l_s depth=4
+ *    GEMX_STREAM_DEPTH(l_s, 4);
+ *    GEMX_DATAFLOW_PROCESS(l_dataflow, producer(l_s));
+ *    for (int w=0; w<t_W; ++w)
+ *      GEMX_DATAFLOW_PROCESS_AT(l_dataflow, w, consumer(l_s, w));
+ *    GEMX_DATAFLOW_WAIT(l_dataflow);               // after the last process
+ *
+ *  Without GEMX_threadedCsim the macros leave the plain sequential calls.
+ *
+ *  With GEMX_streamProfile=1 in C simulation every stream counts its traffic,
+ *  high-water mark and the reads that found it empty and writes that found it
+ *  full. GEMX_STREAM_REPORT prints these per stream name, summed over the
+ *  streams of that name since the last report, and restarts the counts.
+ *  Stall counts need GEMX_threadedCsim, which bounds the streams: a stream
+ *  often full stalls its producer on a slow consumer, one often empty
+ *  starves its consumer, and a high-water mark below the depth shows the
+ *  depth can shrink.
+ */
+
+#ifndef GEMX_DATAFLOW_H
+#define GEMX_DATAFLOW_H
+
+#include "hls_stream.h"
+
+// Depth of a stream without a depth option in its STREAM pragma
+#define GEMX_streamDefaultDepth 2
+
+#if (GEMX_threadedCsim || GEMX_streamProfile) && !defined(__SYNTHESIS__)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef GEMX_dataflowTimeoutSec
+#define GEMX_dataflowTimeoutSec 10
+#endif
+
+namespace gemx {
+
+////////////////////////////////////////////////////////////////////////////////
+// DataflowFifoBase
+//  the untyped part of a stream seen by the deadlock monitor
+////////////////////////////////////////////////////////////////////////////////
+class DataflowFifoBase
+{
+  protected:
+    std::string m_Name;
+    unsigned int m_Depth;
+    const bool m_Bounded;
+    // Counts of all writes and reads, the ring slot is the count modulo depth
+    alignas(64) std::atomic<unsigned long long> m_WrCnt;
+    alignas(64) std::atomic<unsigned long long> m_RdCnt;
+    // Profile counts, the consumer owns m_ReadEmpty and the producer the others
+    unsigned long long m_ReadEmpty;
+    alignas(64) unsigned long long m_WriteFull;
+    unsigned int m_HighWater;
+
+  protected:
+    DataflowFifoBase(const std::string &p_Name, bool p_Bounded);
+    ~DataflowFifoBase();
+    // Spin briefly, then yield and finally sleep, a blocked process must not
+    // take the core of the process it waits for
+    static void
+    wait(unsigned int &p_Spins) {
+        ++p_Spins;
+        if (p_Spins > 256) {
+          std::this_thread::sleep_for(std::chrono::microseconds(20));
+        } else if (p_Spins > 64) {
+          std::this_thread::yield();
+        }
+      }
+
+  public:
+    DataflowFifoBase(const DataflowFifoBase&) = delete;
+    DataflowFifoBase &operator=(const DataflowFifoBase&) = delete;
+    const std::string &getName() const {return m_Name;}
+    unsigned int getDepth() const {return m_Depth;}
+    unsigned long long
+    getTransfers() const {
+        return(m_WrCnt.load(std::memory_order_relaxed) + m_RdCnt.load(std::memory_order_relaxed));
+      }
+    unsigned int
+    size() const {
+        return(m_WrCnt.load(std::memory_order_acquire) - m_RdCnt.load(std::memory_order_acquire));
+      }
+    bool empty() const {return(size() == 0);}
+    bool full() const {return(m_Bounded && (size() >= m_Depth));}
+
+    // Streams constructed on this thread while it opens a region are bounded
+    static bool &
+    declaringRegion() {
+        static thread_local bool l_declaring = false;
+        return(l_declaring);
+      }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// DataflowMonitor
+//  registry of the bounded streams, their transfer count tells whether any
+//  region still makes progress
+////////////////////////////////////////////////////////////////////////////////
+class DataflowMonitor
+{
+  private:
+    std::mutex m_Mutex;
+    std::vector<const DataflowFifoBase*> m_Fifos;
+    DataflowMonitor() {}
+
+  public:
+    static DataflowMonitor &
+    instance() {
+        static DataflowMonitor l_monitor;
+        return(l_monitor);
+      }
+    void
+    add(const DataflowFifoBase *p_Fifo) {
+        std::lock_guard<std::mutex> l_lock(m_Mutex);
+        m_Fifos.push_back(p_Fifo);
+      }
+    void
+    remove(const DataflowFifoBase *p_Fifo) {
+        std::lock_guard<std::mutex> l_lock(m_Mutex);
+        for (unsigned int i = 0; i < m_Fifos.size(); ++i) {
+          if (m_Fifos[i] == p_Fifo) {
+            m_Fifos[i] = m_Fifos.back();
+            m_Fifos.pop_back();
+            break;
+          }
+        }
+      }
+    unsigned long long
+    getTransfers() {
+        std::lock_guard<std::mutex> l_lock(m_Mutex);
+        unsigned long long l_transfers = 0;
+        for (const DataflowFifoBase *l_fifo : m_Fifos) {
+          l_transfers += l_fifo->getTransfers();
+        }
+        return(l_transfers);
+      }
+    // Full and empty streams are the ends of a deadlocked chain
+    void
+    printBlocked(std::ostream &p_Os) {
+        std::lock_guard<std::mutex> l_lock(m_Mutex);
+        for (const DataflowFifoBase *l_fifo : m_Fifos) {
+          unsigned int l_size = l_fifo->size();
+          if ((l_size == 0) || (l_size >= l_fifo->getDepth())) {
+            p_Os << "  stream " << l_fifo->getName() << " " << l_size << "/" << l_fifo->getDepth()
+                 << ((l_size == 0) ? " empty" : " full") << "\n";
+          }
+        }
+      }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// DataflowProfile
+//  stream counts by name, added when a stream is destroyed
+////////////////////////////////////////////////////////////////////////////////
+class DataflowProfile
+{
+  public:
+    struct Counts {
+      unsigned int m_Streams, m_Depth, m_HighWater;
+      unsigned long long m_Traffic, m_ReadEmpty, m_WriteFull;
+    };
+  private:
+    std::mutex m_Mutex;
+    std::map<std::string, Counts> m_Counts;
+    DataflowProfile() {}
+
+  public:
+    static DataflowProfile &
+    instance() {
+        static DataflowProfile l_profile;
+        return(l_profile);
+      }
+    void
+    add(const std::string &p_Name, unsigned int p_Depth, unsigned int p_HighWater,
+        unsigned long long p_Traffic, unsigned long long p_ReadEmpty, unsigned long long p_WriteFull) {
+        std::lock_guard<std::mutex> l_lock(m_Mutex);
+        Counts &l_c = m_Counts[p_Name];
+        l_c.m_Streams++;
+        l_c.m_Depth = std::max(l_c.m_Depth, p_Depth);
+        l_c.m_HighWater = std::max(l_c.m_HighWater, p_HighWater);
+        l_c.m_Traffic += p_Traffic;
+        l_c.m_ReadEmpty += p_ReadEmpty;
+        l_c.m_WriteFull += p_WriteFull;
+      }
+    void
+    report(std::ostream &p_Os, unsigned int p_Instr) {
+        std::lock_guard<std::mutex> l_lock(m_Mutex);
+        if (m_Counts.empty()) {
+          return;
+        }
+        p_Os << "INFO: stream profile of instruction " << p_Instr << "\n"
+             << "  " << std::left << std::setw(48) << "stream" << std::right
+             << std::setw(8) << "count" << std::setw(8) << "depth" << std::setw(8) << "high"
+             << std::setw(14) << "traffic" << std::setw(14) << "read empty" << std::setw(14) << "write full" << "\n";
+        for (const std::pair<const std::string, Counts> &l_entry : m_Counts) {
+          const Counts &l_c = l_entry.second;
+          p_Os << "  " << std::left << std::setw(48) << l_entry.first << std::right
+               << std::setw(8) << l_c.m_Streams << std::setw(8) << l_c.m_Depth << std::setw(8) << l_c.m_HighWater
+               << std::setw(14) << l_c.m_Traffic << std::setw(14) << l_c.m_ReadEmpty << std::setw(14) << l_c.m_WriteFull << "\n";
+        }
+        m_Counts.clear();
+      }
+};
+
+inline
+DataflowFifoBase::DataflowFifoBase(const std::string &p_Name, bool p_Bounded)
+  : m_Name(p_Name), m_Depth(GEMX_streamDefaultDepth), m_Bounded(p_Bounded), m_WrCnt(0), m_RdCnt(0),
+    m_ReadEmpty(0), m_WriteFull(0), m_HighWater(0) {
+  if (m_Bounded) {
+    DataflowMonitor::instance().add(this);
+  }
+}
+
+inline
+DataflowFifoBase::~DataflowFifoBase() {
+  if (m_Bounded) {
+    DataflowMonitor::instance().remove(this);
+  }
+  #if GEMX_streamProfile
+  DataflowProfile::instance().add(m_Name, m_Depth, m_HighWater, m_WrCnt.load(), m_ReadEmpty, m_WriteFull);
+  #endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DataflowFifo
+//  the hls::stream interface over a bounded ring or, outside a threaded
+//  region, an unbounded queue
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+class DataflowFifo : public DataflowFifoBase
+{
+  private:
+    std::vector<T> m_Ring;
+    std::deque<T> m_Queue;
+
+  private:
+    static std::string
+    defaultName() {
+        static std::atomic<unsigned int> l_id(0);
+        std::ostringstream l_os;
+        l_os << "stream" << l_id++;
+        return(l_os.str());
+      }
+
+  public:
+    DataflowFifo()
+      : DataflowFifoBase(defaultName(), declaringRegion()) {
+        m_Ring.resize(m_Depth);
+      }
+    DataflowFifo(const char *p_Name)
+      : DataflowFifoBase(p_Name, declaringRegion()) {
+        m_Ring.resize(m_Depth);
+      }
+    // Must be called before the processes of the region start
+    void
+    setDepth(unsigned int p_Depth, const std::string &p_Name) {
+        m_Depth = (p_Depth == 0) ? 1 : p_Depth;
+        m_Name = p_Name;
+        m_Ring.resize(m_Depth);
+      }
+
+    void
+    write(const T &p_Val) {
+        unsigned long long l_wr = m_WrCnt.load(std::memory_order_relaxed);
+        unsigned int l_size;
+        if (m_Bounded) {
+          unsigned int l_spins = 0;
+          if (l_wr - m_RdCnt.load(std::memory_order_acquire) >= m_Depth) {
+            ++m_WriteFull;
+            while (l_wr - m_RdCnt.load(std::memory_order_acquire) >= m_Depth) {
+              wait(l_spins);
+            }
+          }
+          m_Ring[l_wr % m_Depth] = p_Val;
+          l_size = l_wr + 1 - m_RdCnt.load(std::memory_order_relaxed);
+        } else {
+          m_Queue.push_back(p_Val);
+          l_size = m_Queue.size();
+        }
+        m_HighWater = std::max(m_HighWater, l_size);
+        m_WrCnt.store(l_wr + 1, std::memory_order_release);
+      }
+    bool
+    write_nb(const T &p_Val) {
+        if (full()) {
+          ++m_WriteFull;
+          std::this_thread::yield();
+          return(false);
+        }
+        write(p_Val);
+        return(true);
+      }
+    void
+    read(T &p_Val) {
+        unsigned long long l_rd = m_RdCnt.load(std::memory_order_relaxed);
+        if (m_Bounded) {
+          unsigned int l_spins = 0;
+          if (m_WrCnt.load(std::memory_order_acquire) == l_rd) {
+            ++m_ReadEmpty;
+            while (m_WrCnt.load(std::memory_order_acquire) == l_rd) {
+              wait(l_spins);
+            }
+          }
+          p_Val = m_Ring[l_rd % m_Depth];
+        } else if (m_Queue.empty()) {
+          // Sequential code would read an undefined value, a kernel bug
+          std::cerr << "ERROR: gemx::Stream '" << m_Name << "' is read while empty\n";
+          std::abort();
+        } else {
+          p_Val = m_Queue.front();
+          m_Queue.pop_front();
+        }
+        m_RdCnt.store(l_rd + 1, std::memory_order_release);
+      }
+    T
+    read() {
+        T l_val;
+        read(l_val);
+        return(l_val);
+      }
+    // Polling processes yield so that the producer they wait for can run
+    bool
+    read_nb(T &p_Val) {
+        if (empty()) {
+          ++m_ReadEmpty;
+          std::this_thread::yield();
+          return(false);
+        }
+        read(p_Val);
+        return(true);
+      }
+    void operator>>(T &p_Val) {read(p_Val);}
+    void operator<<(const T &p_Val) {write(p_Val);}
+};
+
+template <typename T>
+void
+setStreamDepth(DataflowFifo<T> &p_Stream, unsigned int p_Depth, const std::string &p_Name) {
+  p_Stream.setDepth(p_Depth, p_Name);
+}
+
+template <typename T, std::size_t t_N>
+void
+setStreamDepth(T (&p_Streams)[t_N], unsigned int p_Depth, const std::string &p_Name) {
+  for (std::size_t i = 0; i < t_N; ++i) {
+    setStreamDepth(p_Streams[i], p_Depth, p_Name + "[" + std::to_string(i) + "]");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DataflowRegion
+//  runs each process on a thread, wait() joins them and watches for deadlock
+////////////////////////////////////////////////////////////////////////////////
+class DataflowRegion
+{
+  private:
+    std::string m_Name;
+    bool m_PrevDeclaring;
+    bool m_Declaring;
+    std::vector<std::thread> m_Threads;
+    std::vector<std::string> m_ProcNames;
+    std::vector<char> m_ProcDone;
+    unsigned int m_NumDone;
+    std::mutex m_Mutex;
+    std::condition_variable m_DoneCv;
+
+  private:
+    void
+    endDeclaring() {
+        if (m_Declaring) {
+          DataflowFifoBase::declaringRegion() = m_PrevDeclaring;
+          m_Declaring = false;
+        }
+      }
+
+  public:
+    DataflowRegion(const char *p_Name)
+      : m_Name(p_Name), m_PrevDeclaring(DataflowFifoBase::declaringRegion()), m_Declaring(true), m_NumDone(0) {
+        DataflowFifoBase::declaringRegion() = true;
+      }
+    ~DataflowRegion() {
+        wait();
+      }
+    DataflowRegion(const DataflowRegion&) = delete;
+    DataflowRegion &operator=(const DataflowRegion&) = delete;
+
+    template <typename t_Proc>
+    void
+    process(const char *p_ProcName, t_Proc p_Proc) {
+        endDeclaring();
+        unsigned int l_id = m_Threads.size();
+        {
+          std::lock_guard<std::mutex> l_lock(m_Mutex);
+          m_ProcNames.push_back(p_ProcName);
+          m_ProcDone.push_back(0);
+        }
+        m_Threads.push_back(std::thread([this, l_id, p_Proc]() {
+          p_Proc();
+          std::lock_guard<std::mutex> l_lock(m_Mutex);
+          m_ProcDone[l_id] = 1;
+          ++m_NumDone;
+          m_DoneCv.notify_all();
+        }));
+      }
+
+    void
+    wait() {
+        endDeclaring();
+        DataflowMonitor &l_monitor = DataflowMonitor::instance();
+        unsigned long long l_transfers = l_monitor.getTransfers();
+        std::chrono::steady_clock::time_point l_lastProgress = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> l_lock(m_Mutex);
+        while (m_NumDone < m_Threads.size()) {
+          if (m_DoneCv.wait_for(l_lock, std::chrono::milliseconds(100)) != std::cv_status::timeout) {
+            continue;
+          }
+          l_lock.unlock();
+          unsigned long long l_now = l_monitor.getTransfers();
+          std::chrono::steady_clock::time_point l_time = std::chrono::steady_clock::now();
+          if (l_now != l_transfers) {
+            l_transfers = l_now;
+            l_lastProgress = l_time;
+          } else if (l_time - l_lastProgress > std::chrono::seconds(GEMX_dataflowTimeoutSec)) {
+            l_lock.lock();
+            std::cerr << "ERROR: dataflow region " << m_Name << " deadlocked, no stream moved for "
+                      << GEMX_dataflowTimeoutSec << " s\n  running processes:\n";
+            for (unsigned int i = 0; i < m_ProcNames.size(); ++i) {
+              if (!m_ProcDone[i]) {
+                std::cerr << "    " << m_ProcNames[i] << "\n";
+              }
+            }
+            l_monitor.printBlocked(std::cerr);
+            std::abort();
+          }
+          l_lock.lock();
+        }
+        l_lock.unlock();
+        for (std::thread &l_thread : m_Threads) {
+          l_thread.join();
+        }
+        m_Threads.clear();
+        m_ProcNames.clear();
+        m_ProcDone.clear();
+        m_NumDone = 0;
+      }
+};
+
+template <typename T>
+using Stream = DataflowFifo<T>;
+
+} // namespace
+
+// Streams are named after the function declaring them, for the deadlock and profile reports
+#define GEMX_STREAM_DEPTH(p_Stream, p_Depth) gemx::setStreamDepth(p_Stream, p_Depth, std::string(__func__) + "." + #p_Stream)
+
+#else
+
+namespace gemx {
+template <typename T>
+using Stream = hls::stream<T>;
+}
+
+#define GEMX_STREAM_DEPTH(p_Stream, p_Depth)
+
+#endif
+
+#if GEMX_threadedCsim && !defined(__SYNTHESIS__)
+#define GEMX_DATAFLOW_REGION(p_Region) gemx::DataflowRegion p_Region(__func__)
+#define GEMX_DATAFLOW_PROCESS(p_Region, ...) p_Region.process(#__VA_ARGS__, [&]() {__VA_ARGS__;})
+#define GEMX_DATAFLOW_PROCESS_AT(p_Region, p_Idx, ...) p_Region.process(#__VA_ARGS__, [&, p_Idx]() {__VA_ARGS__;})
+#define GEMX_DATAFLOW_WAIT(p_Region) p_Region.wait()
+#else
+#define GEMX_DATAFLOW_REGION(p_Region)
+#define GEMX_DATAFLOW_PROCESS(p_Region, ...) __VA_ARGS__
+#define GEMX_DATAFLOW_PROCESS_AT(p_Region, p_Idx, ...) __VA_ARGS__
+#define GEMX_DATAFLOW_WAIT(p_Region)
+#endif
+
+#if GEMX_streamProfile && !defined(__SYNTHESIS__)
+#define GEMX_STREAM_REPORT(p_Instr) gemx::DataflowProfile::instance().report(std::cout, p_Instr)
+#else
+#define GEMX_STREAM_REPORT(p_Instr)
+#endif
+
+#endif
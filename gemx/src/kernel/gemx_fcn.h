@@ -53,6 +53,18 @@ class Fcn
 	typedef FcnArgs FcnArgsType;
 
 	public:
+	// PReLU of one C entry, plain ReLU for float types
+	t_FloatType
+	preluEntry(t_FloatType p_prePRelu, ap_int<10> p_scaleVal, ap_int<6> p_alpha) {
+		#pragma HLS inline self
+		#if GEMX_keepMacBits
+		t_FloatType l_postPRelu = (p_prePRelu < 0)? (p_prePRelu *p_scaleVal.to_int()) >> p_alpha.to_int(): p_prePRelu;
+		#else
+		t_FloatType l_postPRelu = (p_prePRelu < 0)? 0 : p_prePRelu;
+		#endif
+		return l_postPRelu;
+	}
+
 	void
 	FcnScalePRelu(
 		DdrStream &p_inS,
@@ -78,13 +90,7 @@ class Fcn
 							DdrWideType l_valOut;
 							#pragma HLS ARRAY_PARTITION variable=l_valOut complete
 							for (int w=0; w < t_DdrWidth; ++w){
-								t_FloatType l_prePRelu= l_val[w];
-								#if GEMX_keepMacBits
-								t_FloatType l_postPRelu = (l_prePRelu < 0)? (l_prePRelu *l_scaleVal.to_int()) >> l_alpha.to_int(): l_prePRelu;
-                                                                #else
-								t_FloatType l_postPRelu = (l_prePRelu < 0)? 0 : l_prePRelu;
-                                                                #endif
-								l_valOut[w] = l_postPRelu;
+								l_valOut[w] = preluEntry(l_val[w], l_scaleVal, l_alpha);
 							}
 							p_outS.write(l_valOut);
 						}
@@ -109,8 +115,12 @@ class Fcn
 		unsigned int p_xLd,
 		unsigned int p_transpBlocks,
 		int32_t p_postScale,
-		int16_t p_PReluVal
+		int16_t p_PReluVal,
+		bool p_TransA = false,
+		bool p_TransB = false,
+		bool p_TransC = false
 		) {
+		GEMX_DATAFLOW_REGION(l_dataflow);
 		#pragma HLS DATAFLOW
 
 		Gemm<t_FloatType, t_FloatEqIntType, t_XDataType, t_DdrWidth, t_XDdrWidth, t_aColMemWords, t_aRowMemWords, t_bColMemWords, t_MacBits> l_gemm;
@@ -121,11 +131,14 @@ class Fcn
 		#pragma HLS data_pack variable=p_C2ScalePRelu
 
 		#pragma HLS STREAM variable=p_C2ScalePRelu depth=4
+		GEMX_STREAM_DEPTH(p_C2ScalePRelu, 4);
 		#pragma HLS STREAM variable=p_Cs depth=4
+		GEMX_STREAM_DEPTH(p_Cs, 4);
 
-		l_gemm.GemmReadAndMult(p_aAddr, p_bAddr, p_xAddr, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_aLd, p_bLd, p_xLd, p_transpBlocks, p_postScale, p_C2ScalePRelu);
-		FcnScalePRelu(p_C2ScalePRelu, p_Cs, p_aRowBlocks, p_bColBlocks, p_PReluVal);
-		l_gemm.GemmWriteDdrStream(p_cAddr, p_Cs, p_aRowBlocks, p_bColBlocks, p_cLd);
+		GEMX_DATAFLOW_PROCESS(l_dataflow, l_gemm.GemmReadAndMult(p_aAddr, p_bAddr, p_xAddr, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_aLd, p_bLd, p_xLd, p_transpBlocks, p_postScale, p_C2ScalePRelu, p_TransA, p_TransB, p_TransC));
+		GEMX_DATAFLOW_PROCESS(l_dataflow, FcnScalePRelu(p_C2ScalePRelu, p_Cs, p_aRowBlocks, p_bColBlocks, p_PReluVal));
+		GEMX_DATAFLOW_PROCESS(l_dataflow, l_gemm.GemmWriteDdrStream(p_cAddr, p_Cs, p_aRowBlocks, p_bColBlocks, p_cLd, p_TransC));
+		GEMX_DATAFLOW_WAIT(l_dataflow);
 	}
 
 	void
@@ -151,9 +164,28 @@ class Fcn
 		int32_t l_postScale = p_Args.m_postScale;
 		int16_t l_PReluVal = p_Args.m_PReluVal;
 
+#if GEMX_fastCsim && !defined(__SYNTHESIS__)
+		Gemm<t_FloatType, t_FloatEqIntType, t_XDataType, t_DdrWidth, t_XDdrWidth, t_aColMemWords, t_aRowMemWords, t_bColMemWords, t_MacBits> l_gemm;
+		l_gemm.GemmFastCsim(l_aAddr, l_bAddr, l_cAddr, l_xAddr, p_Args.m_M, p_Args.m_K, p_Args.m_N,
+		                    p_Args.m_Lda, p_Args.m_Ldb, p_Args.m_Ldc, p_Args.m_Ldx, l_postScale,
+		                    p_Args.m_TransA, p_Args.m_TransB, p_Args.m_TransC);
+		ap_int<16> l_PRelu = l_PReluVal;
+		ap_int<10> l_scaleVal = l_PRelu.range(15,6);
+		ap_int<6> l_alpha = l_PRelu.range(5,0);
+		t_FloatType *l_c = l_cAddr[0].getValAddr();
+		const unsigned int l_cRows = p_Args.m_TransC ? p_Args.m_N : p_Args.m_M;
+		const unsigned int l_cCols = p_Args.m_TransC ? p_Args.m_M : p_Args.m_N;
+		for (unsigned int i = 0; i < l_cRows; ++i) {
+			t_FloatType *l_cRow = l_c + (size_t)i * p_Args.m_Ldc;
+			for (unsigned int j = 0; j < l_cCols; ++j) {
+				l_cRow[j] = preluEntry(l_cRow[j], l_scaleVal, l_alpha);
+			}
+		}
+#else
     unsigned int l_transpBlocks = l_aColBlocks * l_aRowBlocks * l_bColBlocks *t_aRowMemWords;
 		FcnBlocks(l_aAddr, l_bAddr, l_cAddr, l_xAddr, l_aColBlocks, l_aRowBlocks, l_bColBlocks, l_aLd, l_bLd, l_cLd, l_xLd, l_transpBlocks,
-							l_postScale, l_PReluVal);
+							l_postScale, l_PReluVal, p_Args.m_TransA, p_Args.m_TransB, p_Args.m_TransC);
+#endif
 
 	}
 };
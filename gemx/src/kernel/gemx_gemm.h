@@ -24,7 +24,13 @@
 
 #include <cassert>
 #include <iostream>
+#if GEMX_fastCsim && !defined(__SYNTHESIS__)
+#include <vector>
+#include <thread>
+#include <algorithm>
+#endif
 #include "gemx_types.h"
+#include "gemx_dataflow.h"
 #include "gemx_transp.h"
 
 namespace gemx {
@@ -47,12 +53,14 @@ class Gemm
   public:
 	static const unsigned int t_aMH = t_DdrWidth * t_aRowMemWords;
 	static const unsigned int t_bKD = t_DdrWidth * t_aColMemWords;
+	static const unsigned int t_bNW = t_DdrWidth * t_bColMemWords;
 	static const unsigned int t_uramParFactor = ((t_DdrWidth * sizeof(t_FloatType))/8);
 	static const unsigned int t_FloatBits = sizeof(t_FloatType)*8;
 	static const unsigned int t_FloatMultBits = t_FloatBits*2;
 	static const unsigned int t_XDataBits = sizeof(t_XDataType)*8;
 	static const unsigned int t_DdrOverXDdr = t_DdrWidth / t_XDdrWidth;
 	static const unsigned int t_xColMemWords = t_bColMemWords * t_DdrOverXDdr;
+	static const unsigned int t_xRowMemWords = t_aRowMemWords * t_DdrOverXDdr;
 
   typedef WideType<t_FloatType, t_DdrWidth> DdrWideType;
   typedef TaggedFloat<t_FloatType> TaggedFloatType;
@@ -60,9 +68,9 @@ class Gemm
 	typedef WideType<TaggedFloatType, t_DdrWidth> TaggedFloatArray;
 	typedef ExitTaggedWideType<TaggedFloatType, t_DdrWidth> ExitTaggedFloatArray;
  
-	typedef hls::stream<DdrWideType> DdrStream;
-	typedef hls::stream<TaggedWideFloat> EdgeStream;
-	typedef hls::stream<ExitTaggedFloatArray> ExitTaggedFloatStream;
+	typedef Stream<DdrWideType> DdrStream;
+	typedef Stream<TaggedWideFloat> EdgeStream;
+	typedef Stream<ExitTaggedFloatArray> ExitTaggedFloatStream;
 
 	typedef WideType<t_FloatType, t_DdrWidth/2> HalfDdrWideType;
 	typedef ExitTaggedWideType<t_FloatType, t_DdrWidth/2> HalfExitTaggedWideType;
@@ -70,12 +78,12 @@ class Gemm
 	typedef WideType<TaggedFloatType, t_DdrWidth/2> HalfTaggedFloatArray; 
 	typedef ExitTaggedWideType<TaggedFloatType, t_DdrWidth/2> HalfExitTaggedFloatArray;
 
-	typedef hls::stream<HalfExitTaggedWideType> HalfExitTaggedDdrStream;
-	typedef hls::stream<HalfTaggedWideFloat> HalfEdgeStream;
-	typedef hls::stream<HalfExitTaggedFloatArray> HalfExitTaggedFloatStream;
+	typedef Stream<HalfExitTaggedWideType> HalfExitTaggedDdrStream;
+	typedef Stream<HalfTaggedWideFloat> HalfEdgeStream;
+	typedef Stream<HalfExitTaggedFloatArray> HalfExitTaggedFloatStream;
 
 	typedef WideType<t_XDataType, t_XDdrWidth> XDdrWideType;
-	typedef hls::stream<XDdrWideType> XDdrStream;
+	typedef Stream<XDdrWideType> XDdrStream;
 	typedef WideType<t_XDataType, t_DdrWidth> DdrWideTypeForX;
 
 	//type definitions for enhanced MAC implementation, using 48-bits to store accumulation results.
@@ -84,12 +92,12 @@ class Gemm
 	#if GEMX_keepMacBits
 	typedef ap_int<t_MacBits> MacBitType;
 	typedef WideType<MacBitType, t_DdrWidth> WideMacBitType;
-	typedef hls::stream<WideMacBitType> WideMacBitStream;
+	typedef Stream<WideMacBitType> WideMacBitStream;
 
 	typedef WideType<MacBitType, t_DdrWidth/2> HalfWideMacBitType;
 	typedef ExitTaggedWideType<MacBitType, t_DdrWidth/2> HalfTaggedWideMacBitType;
-	typedef hls::stream<HalfTaggedWideMacBitType> HalfTaggedWideMacBitStream;
-	typedef hls::stream<HalfWideMacBitType> HalfWideMacBitStream;
+	typedef Stream<HalfTaggedWideMacBitType> HalfTaggedWideMacBitStream;
+	typedef Stream<HalfWideMacBitType> HalfWideMacBitStream;
 	#else
 	typedef t_FloatType MacBitType;
 	typedef DdrWideType WideMacBitType;
@@ -175,6 +183,29 @@ class Gemm
           #endif
         }
     
+    // One C entry from its A*B sum and X entry: add X, then post scale
+    t_FloatType
+    addXPostScale(
+          MacBitType p_ab,
+          t_XDataType p_x,
+          ap_uint<16> p_postScaleVal,
+          ap_uint<8> p_postScaleShift
+        ) {
+          #pragma HLS inline self
+          #if GEMX_keepMacBits
+          assert(t_MacBits >= t_XDataBits);
+          ap_int<t_XDataBits> l_xEntry = p_x;
+          MacBitType l_abxEntry = p_ab + l_xEntry;//add X
+          //post scale
+          MacBitType l_entryPS=(l_abxEntry * p_postScaleVal);
+          MacBitType l_entryPS1 = l_entryPS >> p_postScaleShift;
+          FloatBitType l_entryFl = l_entryPS1(t_FloatBits-1,0);
+          return(l_entryFl.to_int());
+          #else
+          return(macBitsToFloatType(p_ab + p_x));
+          #endif
+        }
+
 		///////////////////////////////////////////////////////////////////////////
 		//Gemm delay A B
     ///////////////////////////////////////////////////////////////////////////
@@ -933,6 +964,10 @@ class Gemm
 public:	
     ///////////////////////////////////////////////////////////////////////////
     // GEMM ABX loader
+    //  p_TransA, p_TransB, p_TransC : A is stored as K x M, B as N x K and X as
+    //  N x M; such blocks are read along their stored rows into a tile buffer
+    //  and streamed out in the same order as untransposed blocks. The tile
+    //  buffers are only built with GEMX_gemmTrans
     ///////////////////////////////////////////////////////////////////////////
     void
     GemmReadABX(
@@ -947,7 +982,10 @@ public:
 			unsigned int l_xWordLd,
       DdrStream &p_As,
       DdrStream &p_Bs,
-			XDdrStream &p_Xs
+			XDdrStream &p_Xs,
+			bool p_TransA = false,
+			bool p_TransB = false,
+			bool p_TransC = false
      ) {
 
     unsigned int l_aSrcOffset=0;
@@ -962,6 +1000,20 @@ public:
 		unsigned int l_xRowOffset=0;
 		unsigned int l_xColOffset=0;
 
+#if GEMX_gemmTrans
+		t_FloatType l_aTile[t_bKD][t_aMH];
+		#pragma HLS ARRAY_PARTITION variable=l_aTile cyclic factor=t_DdrWidth dim=1
+		#pragma HLS ARRAY_PARTITION variable=l_aTile cyclic factor=t_DdrWidth dim=2
+		t_FloatType l_bTile[t_bNW][t_bKD];
+		#pragma HLS ARRAY_PARTITION variable=l_bTile cyclic factor=t_DdrWidth dim=1
+		#pragma HLS ARRAY_PARTITION variable=l_bTile cyclic factor=t_DdrWidth dim=2
+		t_XDataType l_xTile[t_bNW][t_aMH];
+		#pragma HLS ARRAY_PARTITION variable=l_xTile cyclic factor=t_XDdrWidth dim=1
+		#pragma HLS ARRAY_PARTITION variable=l_xTile cyclic factor=t_XDdrWidth dim=2
+#else
+		assert(!p_TransA && !p_TransB && !p_TransC);
+#endif
+
 		assert(t_DdrOverXDdr != 0);
 		assert (t_DdrOverXDdr * t_XDdrWidth == t_DdrWidth);
 		
@@ -976,23 +1028,79 @@ public:
 					l_aSrcOffset = l_aRowOffset + l_aColOffset;
 					
 					l_bSrcOffset = l_bRowOffset + l_bColOffset;
-					//read A block, t_DdrWidth(height)*t_aRowMemWordS x t_aColBlocks * t_DdrWidth (width) into l_bufferA
-					for (int i=0; i<t_aMH; ++i) {
-						for (int j=0; j<t_aColMemWords; ++j) {
-						#pragma HLS PIPELINE
-							DdrWideType l_word = l_aAddr[l_aSrcOffset+j];
-							p_As.write(l_word);
+#if GEMX_gemmTrans
+					if (p_TransA) {
+						//read the t_bKD x t_aMH stored block of A, then stream out its transpose
+						l_aSrcOffset = l_aColBlock * t_bKD * l_aWordLd + l_aRowBlock * t_aRowMemWords;
+						for (int i=0; i<t_bKD; ++i) {
+							for (int j=0; j<t_aRowMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_word = l_aAddr[l_aSrcOffset+j];
+								for (int w=0; w<t_DdrWidth; ++w) {
+									l_aTile[i][j*t_DdrWidth+w] = l_word[w];
+								}
+							}
+							l_aSrcOffset += l_aWordLd;
+						}
+						for (int i=0; i<t_aMH; ++i) {
+							for (int j=0; j<t_aColMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_word;
+								for (int w=0; w<t_DdrWidth; ++w) {
+									l_word[w] = l_aTile[j*t_DdrWidth+w][i];
+								}
+								p_As.write(l_word);
+							}
+						}
+					} else
+#endif
+					{
+						//read A block, t_DdrWidth(height)*t_aRowMemWordS x t_aColBlocks * t_DdrWidth (width) into l_bufferA
+						for (int i=0; i<t_aMH; ++i) {
+							for (int j=0; j<t_aColMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_word = l_aAddr[l_aSrcOffset+j];
+								p_As.write(l_word);
+							}
+							l_aSrcOffset += l_aWordLd;
 						}
-						l_aSrcOffset += l_aWordLd;
 					}
-					//read B Block	
-					for (int i=0; i<t_bKD; ++i) {
-						for (int j=0; j<t_bColMemWords; ++j) {
-						#pragma HLS PIPELINE
-							DdrWideType l_word = l_bAddr[l_bSrcOffset+j];
-							p_Bs.write(l_word);
+#if GEMX_gemmTrans
+					if (p_TransB) {
+						//read the t_bNW x t_bKD stored block of B, then stream out its transpose
+						l_bSrcOffset = l_bColBlock * t_bNW * l_bWordLd + l_aColOffset;
+						for (int i=0; i<t_bNW; ++i) {
+							for (int j=0; j<t_aColMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_word = l_bAddr[l_bSrcOffset+j];
+								for (int w=0; w<t_DdrWidth; ++w) {
+									l_bTile[i][j*t_DdrWidth+w] = l_word[w];
+								}
+							}
+							l_bSrcOffset += l_bWordLd;
+						}
+						for (int i=0; i<t_bKD; ++i) {
+							for (int j=0; j<t_bColMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_word;
+								for (int w=0; w<t_DdrWidth; ++w) {
+									l_word[w] = l_bTile[j*t_DdrWidth+w][i];
+								}
+								p_Bs.write(l_word);
+							}
+						}
+					} else
+#endif
+					{
+						//read B Block	
+						for (int i=0; i<t_bKD; ++i) {
+							for (int j=0; j<t_bColMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_word = l_bAddr[l_bSrcOffset+j];
+								p_Bs.write(l_word);
+							}
+							l_bSrcOffset += l_bWordLd;
 						}
-						l_bSrcOffset += l_bWordLd;
 					}
 
 					l_bRowOffset += l_bWordLd *t_bKD;
@@ -1000,15 +1108,43 @@ public:
 		  
 				//read X block
 				WideConv<DdrWideType, XDdrWideType> l_conv;
-				l_xSrcOffset = l_xRowOffset + l_xColOffset;
-				for (int i=0; i<t_aMH; ++i) {
-					for (int j=0; j<t_xColMemWords; ++j) {
-					#pragma HLS PIPELINE
-						DdrWideType l_word = l_xAddr[l_xSrcOffset+j];
-						XDdrWideType l_wordx = l_conv.convert(l_word);
-						p_Xs.write(l_wordx);
+#if GEMX_gemmTrans
+				if (p_TransC) {
+					l_xSrcOffset = l_bColBlock * t_bNW * l_xWordLd + l_aRowBlock * t_xRowMemWords;
+					for (int i=0; i<t_bNW; ++i) {
+						for (int j=0; j<t_xRowMemWords; ++j) {
+						#pragma HLS PIPELINE
+							DdrWideType l_word = l_xAddr[l_xSrcOffset+j];
+							XDdrWideType l_wordx = l_conv.convert(l_word);
+							for (int w=0; w<t_XDdrWidth; ++w) {
+								l_xTile[i][j*t_XDdrWidth+w] = l_wordx[w];
+							}
+						}
+						l_xSrcOffset += l_xWordLd;
+					}
+					for (int i=0; i<t_aMH; ++i) {
+						for (int j=0; j<t_xColMemWords; ++j) {
+						#pragma HLS PIPELINE
+							XDdrWideType l_wordx;
+							for (int w=0; w<t_XDdrWidth; ++w) {
+								l_wordx[w] = l_xTile[j*t_XDdrWidth+w][i];
+							}
+							p_Xs.write(l_wordx);
+						}
+					}
+				} else
+#endif
+				{
+					l_xSrcOffset = l_xRowOffset + l_xColOffset;
+					for (int i=0; i<t_aMH; ++i) {
+						for (int j=0; j<t_xColMemWords; ++j) {
+						#pragma HLS PIPELINE
+							DdrWideType l_word = l_xAddr[l_xSrcOffset+j];
+							XDdrWideType l_wordx = l_conv.convert(l_word);
+							p_Xs.write(l_wordx);
+						}
+						l_xSrcOffset += l_xWordLd;
 					}
-					l_xSrcOffset += l_xWordLd;
 				}
 			}
 		  l_aRowOffset += l_aWordLd * t_aMH;
@@ -1336,11 +1472,14 @@ public:
 		EdgeStream &p_Bs,
 		WideMacBitStream &p_Cs
 	){
+		GEMX_DATAFLOW_REGION(l_dataflow);
 		ExitTaggedFloatStream l_taggedAs, l_taggedBs;
 		#pragma HLS DATA_PACK variable=l_taggedAs
 		#pragma HLS DATA_PACK variable=l_taggedBs
 		#pragma HLS STREAM variable=l_taggedAs DEPTH=4
+		GEMX_STREAM_DEPTH(l_taggedAs, 4);
 		#pragma HLS STREAM variable=l_taggedBs DEPTH=4
+		GEMX_STREAM_DEPTH(l_taggedBs, 4);
 		#pragma HLS RESOURCE variable=l_taggedAs core=FIFO_LUTRAM
 		#pragma HLS RESOURCE variable=l_taggedBs core=FIFO_LUTRAM
 
@@ -1357,31 +1496,41 @@ public:
 		#pragma HLS DATA_PACK variable=l_halfBs11
 
 		#pragma HLS STREAM variable=l_halfAs00 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfAs00, 4);
 		#pragma HLS STREAM variable=l_halfAs01 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfAs01, 4);
 		#pragma HLS STREAM variable=l_halfAs10 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfAs10, 4);
 		#pragma HLS STREAM variable=l_halfAs11 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfAs11, 4);
 
 		#pragma HLS STREAM variable=l_halfBs00 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfBs00, 4);
 		#pragma HLS STREAM variable=l_halfBs01 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfBs01, 4);
 		#pragma HLS STREAM variable=l_halfBs10 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfBs10, 4);
 		#pragma HLS STREAM variable=l_halfBs11 DEPTH=4
+		GEMX_STREAM_DEPTH(l_halfBs11, 4);
 
 		HalfTaggedWideMacBitStream l_dataS[2][2];
 		#pragma HLS DATA_PACK variable=l_dataS
 		#pragma HLS STREAM variable=l_dataS DEPTH=t_DdrWidth/2
+		GEMX_STREAM_DEPTH(l_dataS, t_DdrWidth/2);
 		
 		#pragma HLS DATAFLOW
 
-    GemmDelayAB(p_As, p_Bs, l_taggedAs, l_taggedBs);
-		GemmSplitDL(l_taggedAs, l_halfAs00, l_halfAs10);
-		GemmSplitDL(l_taggedBs, l_halfBs00, l_halfBs01);
+    GEMX_DATAFLOW_PROCESS(l_dataflow, GemmDelayAB(p_As, p_Bs, l_taggedAs, l_taggedBs));
+		GEMX_DATAFLOW_PROCESS(l_dataflow, GemmSplitDL(l_taggedAs, l_halfAs00, l_halfAs10));
+		GEMX_DATAFLOW_PROCESS(l_dataflow, GemmSplitDL(l_taggedBs, l_halfBs00, l_halfBs01));
 
-    GemmCalcHalf00(l_halfAs00, l_halfBs00, l_halfAs01, l_halfBs10, l_dataS[0][0]); 
-    GemmCalcHalf01(l_halfAs01, l_halfBs01, l_halfBs11, l_dataS[0][1]); 
-    GemmCalcHalf10(l_halfAs10, l_halfBs10, l_halfAs11, l_dataS[1][0]); 
-    GemmCalcHalf11(l_halfAs11, l_halfBs11, l_dataS[1][1]); 
+    GEMX_DATAFLOW_PROCESS(l_dataflow, GemmCalcHalf00(l_halfAs00, l_halfBs00, l_halfAs01, l_halfBs10, l_dataS[0][0]));
+    GEMX_DATAFLOW_PROCESS(l_dataflow, GemmCalcHalf01(l_halfAs01, l_halfBs01, l_halfBs11, l_dataS[0][1]));
+    GEMX_DATAFLOW_PROCESS(l_dataflow, GemmCalcHalf10(l_halfAs10, l_halfBs10, l_halfAs11, l_dataS[1][0]));
+    GEMX_DATAFLOW_PROCESS(l_dataflow, GemmCalcHalf11(l_halfAs11, l_halfBs11, l_dataS[1][1]));
 
-		GemmMergeDdrS(l_dataS, p_Cs);
+		GEMX_DATAFLOW_PROCESS(l_dataflow, GemmMergeDdrS(l_dataS, p_Cs));
+		GEMX_DATAFLOW_WAIT(l_dataflow);
 	}
 
     ///////////////////////////////////////////////////////////////////////////
@@ -1505,21 +1654,7 @@ public:
 							#pragma HLS ARRAY_PARTITION variable=l_cWord complete
 							#pragma HLS PIPELINE 
 							for (int w=0; w<t_DdrWidth; ++w) {
-							t_FloatType l_cEntry;
-							#if GEMX_keepMacBits
-									assert(t_MacBits >= t_XDataBits);
-									ap_int<t_XDataBits> l_xEntry = l_xVal[w];
-									MacBitType l_abEntry = l_val[w];
-									MacBitType l_abxEntry = l_abEntry + l_xEntry;//add X
-									//post scale
-									MacBitType l_entryPS=(l_abxEntry * l_postScaleVal);
-									MacBitType l_entryPS1 = l_entryPS >> l_postScaleShift;
-									FloatBitType l_entryFl = l_entryPS1(t_FloatBits-1,0);
-									l_cEntry = l_entryFl.to_int();			
-							#else
-								 	l_cEntry = macBitsToFloatType(l_val[w]+l_xVal[w]);
-							#endif
-								l_cWord[w] = l_cEntry;			
+								l_cWord[w] = addXPostScale(l_val[w], l_xVal[w], l_postScaleVal, l_postScaleShift);
 							}
 							p_Cout.write(l_cWord);
 						}
@@ -1591,6 +1726,7 @@ public:
     	) {
 			unsigned int l_cBlocks = p_aRowBlocks * p_bColBlocks;
 			unsigned int l_abBlocks = l_cBlocks * p_aColBlocks;
+			GEMX_DATAFLOW_REGION(l_dataflow);
       #pragma HLS DATAFLOW
 
 	  	DdrStream  p_As1, p_As1_1, p_As1_2, p_Bs0_0, p_Bs0_1, p_Bs1_0, p_Bs1_1, p_Bs1, p_As2, p_As2_1, p_As2_2, p_As3, p_CBufferS;
@@ -1616,44 +1752,61 @@ public:
       #pragma HLS data_pack variable=p_COutS
 
       #pragma HLS STREAM variable=p_Bs0_0 depth=2
+      GEMX_STREAM_DEPTH(p_Bs0_0, 2);
       #pragma HLS STREAM variable=p_Bs0_1 depth=2
+      GEMX_STREAM_DEPTH(p_Bs0_1, 2);
       #pragma HLS STREAM variable=p_Bs1_0 depth=2
+      GEMX_STREAM_DEPTH(p_Bs1_0, 2);
       #pragma HLS STREAM variable=p_Bs1_1 depth=2
+      GEMX_STREAM_DEPTH(p_Bs1_1, 2);
       #pragma HLS STREAM variable=p_Bs1 depth=2//4
+      GEMX_STREAM_DEPTH(p_Bs1, 2);
       #pragma HLS STREAM variable=p_As1 depth=2//4
+      GEMX_STREAM_DEPTH(p_As1, 2);
       #pragma HLS STREAM variable=p_As1_1 depth=t_aColMemWords*t_aMH//4
+      GEMX_STREAM_DEPTH(p_As1_1, t_aColMemWords*t_aMH);
       #pragma HLS STREAM variable=p_As1_2 depth=t_aColMemWords*t_aMH//4
+      GEMX_STREAM_DEPTH(p_As1_2, t_aColMemWords*t_aMH);
       #pragma HLS STREAM variable=p_As2_1 depth=2//t_aColMemWords*t_DdrWidth*t_bColMemWords/2//4
+      GEMX_STREAM_DEPTH(p_As2_1, 2);
       #pragma HLS STREAM variable=p_As2_2 depth=2//t_aColMemWords*t_DdrWidth*t_bColMemWords/2//4
+      GEMX_STREAM_DEPTH(p_As2_2, 2);
       #pragma HLS STREAM variable=p_As2 depth=4
+      GEMX_STREAM_DEPTH(p_As2, 4);
       #pragma HLS STREAM variable=p_As3 depth=4
+      GEMX_STREAM_DEPTH(p_As3, 4);
 
       #pragma HLS STREAM variable=p_AEdgeS0 depth=2//4
+      GEMX_STREAM_DEPTH(p_AEdgeS0, 2);
       #pragma HLS STREAM variable=p_BEdgeS0 depth=2//4
+      GEMX_STREAM_DEPTH(p_BEdgeS0, 2);
       #pragma HLS STREAM variable=p_CEdgeS depth=t_DdrWidth*2*t_bColMemWords
+      GEMX_STREAM_DEPTH(p_CEdgeS, t_DdrWidth*2*t_bColMemWords);
       #pragma HLS STREAM variable=p_COutS depth=2
+      GEMX_STREAM_DEPTH(p_COutS, 2);
 
 	  	Transp<t_FloatType, t_DdrWidth, t_aColMemWords, 1> l_transp;
 
-	  	GemmSplitB(l_abBlocks, p_Bs, p_Bs0_0, p_Bs0_1);
-			GemmBufferB((l_abBlocks/2)+(l_abBlocks%2), p_Bs0_0, p_Bs1_0);
-			GemmBufferB((l_abBlocks/2), p_Bs0_1, p_Bs1_1);
-	  	GemmMergeB(l_abBlocks, p_Bs1_0, p_Bs1_1, p_Bs1);
-
-      l_transp.shuffle_input(p_As, p_As1, p_transpBlocks);
-	  	l_transp.split(p_As1, p_As1_1, p_As1_2, p_transpBlocks);
-      l_transp.WR_bufferWithReuse(p_As1_1, p_As2_1, ((p_transpBlocks/2)+(p_transpBlocks %2)), t_bColMemWords-1);
-      l_transp.WR_bufferWithReuse(p_As1_2, p_As2_2, p_transpBlocks/2, t_bColMemWords-1);
-	  	l_transp.mergeWithReuse(p_As2_1, p_As2_2, p_As2, p_transpBlocks, t_bColMemWords-1);
-      l_transp.shuffle_output(p_As2, p_As3, p_transpBlocks*t_bColMemWords);
-      GemmTagAB(p_As3, p_Bs1, l_abBlocks, p_AEdgeS0, p_BEdgeS0);
+	  	GEMX_DATAFLOW_PROCESS(l_dataflow, GemmSplitB(l_abBlocks, p_Bs, p_Bs0_0, p_Bs0_1));
+			GEMX_DATAFLOW_PROCESS(l_dataflow, GemmBufferB((l_abBlocks/2)+(l_abBlocks%2), p_Bs0_0, p_Bs1_0));
+			GEMX_DATAFLOW_PROCESS(l_dataflow, GemmBufferB((l_abBlocks/2), p_Bs0_1, p_Bs1_1));
+	  	GEMX_DATAFLOW_PROCESS(l_dataflow, GemmMergeB(l_abBlocks, p_Bs1_0, p_Bs1_1, p_Bs1));
+
+      GEMX_DATAFLOW_PROCESS(l_dataflow, l_transp.shuffle_input(p_As, p_As1, p_transpBlocks));
+	  	GEMX_DATAFLOW_PROCESS(l_dataflow, l_transp.split(p_As1, p_As1_1, p_As1_2, p_transpBlocks));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, l_transp.WR_bufferWithReuse(p_As1_1, p_As2_1, ((p_transpBlocks/2)+(p_transpBlocks %2)), t_bColMemWords-1));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, l_transp.WR_bufferWithReuse(p_As1_2, p_As2_2, p_transpBlocks/2, t_bColMemWords-1));
+	  	GEMX_DATAFLOW_PROCESS(l_dataflow, l_transp.mergeWithReuse(p_As2_1, p_As2_2, p_As2, p_transpBlocks, t_bColMemWords-1));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, l_transp.shuffle_output(p_As2, p_As3, p_transpBlocks*t_bColMemWords));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, GemmTagAB(p_As3, p_Bs1, l_abBlocks, p_AEdgeS0, p_BEdgeS0));
       #if GEMX_splitMesh
-			GemmCalcComp(p_AEdgeS0, p_BEdgeS0, p_CEdgeS);
+			GEMX_DATAFLOW_PROCESS(l_dataflow, GemmCalcComp(p_AEdgeS0, p_BEdgeS0, p_CEdgeS));
 			#else
-      GemmCalc(p_AEdgeS0, p_BEdgeS0, p_CEdgeS);
+      GEMX_DATAFLOW_PROCESS(l_dataflow, GemmCalc(p_AEdgeS0, p_BEdgeS0, p_CEdgeS));
 			#endif
-      GemmCBuffer(p_CEdgeS, p_aColBlocks, l_cBlocks, p_COutS);
-      GemmAddX(p_COutS, p_Xs, l_cBlocks, p_postScale, p_Cs);
+      GEMX_DATAFLOW_PROCESS(l_dataflow, GemmCBuffer(p_CEdgeS, p_aColBlocks, l_cBlocks, p_COutS));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, GemmAddX(p_COutS, p_Xs, l_cBlocks, p_postScale, p_Cs));
+      GEMX_DATAFLOW_WAIT(l_dataflow);
     }
     void 
 		GemmReadAndMult(
@@ -1668,8 +1821,12 @@ public:
 			unsigned int p_xLd,
 	  	unsigned int p_transpBlocks,
 			int32_t p_postScale,
-			DdrStream &p_Cs
+			DdrStream &p_Cs,
+			bool p_TransA = false,
+			bool p_TransB = false,
+			bool p_TransC = false
     	) {
+    	GEMX_DATAFLOW_REGION(l_dataflow);
       #pragma HLS DATAFLOW
 
       DdrStream  l_As, l_Bs;
@@ -1679,11 +1836,15 @@ public:
       #pragma HLS data_pack variable=l_Bs
 
       #pragma HLS STREAM variable=l_As depth=32//t_aColMemWords*t_aMH
+      GEMX_STREAM_DEPTH(l_As, 32);
       #pragma HLS STREAM variable=l_Bs depth=32//t_bColMemWords*t_bKD
+      GEMX_STREAM_DEPTH(l_Bs, 32);
       #pragma HLS STREAM variable=l_Xs depth=32//t_xColMemWords*t_aMH
+      GEMX_STREAM_DEPTH(l_Xs, 32);
 
-      GemmReadABX(p_aAddr, p_bAddr, p_xAddr, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_aLd, p_bLd, p_xLd, l_As, l_Bs, l_Xs);
-			GemmBlockStream(l_As, l_Bs, l_Xs, p_Cs, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_transpBlocks, p_postScale);
+      GEMX_DATAFLOW_PROCESS(l_dataflow, GemmReadABX(p_aAddr, p_bAddr, p_xAddr, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_aLd, p_bLd, p_xLd, l_As, l_Bs, l_Xs, p_TransA, p_TransB, p_TransC));
+			GEMX_DATAFLOW_PROCESS(l_dataflow, GemmBlockStream(l_As, l_Bs, l_Xs, p_Cs, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_transpBlocks, p_postScale));
+			GEMX_DATAFLOW_WAIT(l_dataflow);
     }
     //load A and B in t_DdrWidth x t_DdrWidth size blocks, multiply blocks and write results back to memory
     void 
@@ -1700,8 +1861,12 @@ public:
 	  	unsigned int p_cLd,
 			unsigned int p_xLd,
 	  	unsigned int p_transpBlocks,
-			int32_t p_postScale
+			int32_t p_postScale,
+			bool p_TransA = false,
+			bool p_TransB = false,
+			bool p_TransC = false
     	) {
+    	GEMX_DATAFLOW_REGION(l_dataflow);
       #pragma HLS DATAFLOW
 
       DdrStream  l_As, l_Bs;
@@ -1714,15 +1879,109 @@ public:
       #pragma HLS data_pack variable=l_Cs
 
       #pragma HLS STREAM variable=l_As depth=32//t_aColMemWords*t_aMH
+      GEMX_STREAM_DEPTH(l_As, 32);
       #pragma HLS STREAM variable=l_Xs depth=32//t_xColMemWords*t_DdrWidth
+      GEMX_STREAM_DEPTH(l_Xs, 32);
       #pragma HLS STREAM variable=l_Bs depth=32//t_bColMemWords*t_bKD
+      GEMX_STREAM_DEPTH(l_Bs, 32);
       #pragma HLS STREAM variable=l_Cs depth=32
+      GEMX_STREAM_DEPTH(l_Cs, 32);
 
-      GemmReadABX(p_aAddr, p_bAddr, p_xAddr, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_aLd, p_bLd, p_xLd, l_As, l_Bs, l_Xs);
-			GemmBlockStream(l_As, l_Bs, l_Xs, l_Cs, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_transpBlocks, p_postScale);
-      GemmWriteDdrStream(p_cAddr, l_Cs, p_aRowBlocks, p_bColBlocks, p_cLd);
+      GEMX_DATAFLOW_PROCESS(l_dataflow, GemmReadABX(p_aAddr, p_bAddr, p_xAddr, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_aLd, p_bLd, p_xLd, l_As, l_Bs, l_Xs, p_TransA, p_TransB, p_TransC));
+			GEMX_DATAFLOW_PROCESS(l_dataflow, GemmBlockStream(l_As, l_Bs, l_Xs, l_Cs, p_aColBlocks, p_aRowBlocks, p_bColBlocks, p_transpBlocks, p_postScale));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, GemmWriteDdrStream(p_cAddr, l_Cs, p_aRowBlocks, p_bColBlocks, p_cLd, p_TransC));
+      GEMX_DATAFLOW_WAIT(l_dataflow);
     }
 
+#if GEMX_fastCsim && !defined(__SYNTHESIS__)
+    ///////////////////////////////////////////////////////////////////////////
+    // GemmFastCsim
+    //  C simulation only: computes the results of GemmBlocks directly on the
+    //  matrices in memory. Products are summed over each block of t_bKD rows of
+    //  B in order and the block sums are added in order, as GemmCalc and
+    //  GemmCBuffer do, so float results are the same. With GEMX_keepMacBits the
+    //  sums are kept in 64 bits, which wrap to the same t_MacBits value.
+    //  Transposed operands (GEMX_gemmTrans) are read through their element
+    //  strides.
+    ///////////////////////////////////////////////////////////////////////////
+    void
+    GemmFastCsim(
+      DdrWideType *p_aAddr,
+      DdrWideType *p_bAddr,
+      DdrWideType *p_cAddr,
+      DdrWideType *p_xAddr,
+      unsigned int p_M,
+      unsigned int p_K,
+      unsigned int p_N,
+      unsigned int p_aLd,   // leading dimensions in matrix entries
+      unsigned int p_bLd,
+      unsigned int p_cLd,
+      unsigned int p_xLd,
+      int32_t p_postScale,
+      bool p_TransA = false,
+      bool p_TransB = false,
+      bool p_TransC = false
+      ) {
+      #if !GEMX_gemmTrans
+      assert(!p_TransA && !p_TransB && !p_TransC);
+      #endif
+      #if GEMX_keepMacBits
+      typedef int64_t AccType;
+      #else
+      typedef MacBitType AccType;
+      #endif
+      const t_FloatType *l_a = p_aAddr[0].getValAddr();
+      const t_FloatType *l_b = p_bAddr[0].getValAddr();
+      t_FloatType *l_c = p_cAddr[0].getValAddr();
+      const t_XDataType *l_x = (const t_XDataType *)p_xAddr[0].getValAddr();
+      ap_uint<32> l_postScale = p_postScale;
+      ap_uint<16> l_postScaleVal = l_postScale.range(23,8);
+      ap_uint<8>  l_postScaleShift = l_postScale.range(7,0);
+      // Strides between rows and between columns of the M x K, K x N and M x N views
+      const size_t l_aRowStride = p_TransA ? 1 : p_aLd, l_aColStride = p_TransA ? p_aLd : 1;
+      const size_t l_bRowStride = p_TransB ? 1 : p_bLd, l_bColStride = p_TransB ? p_bLd : 1;
+      const size_t l_cRowStride = p_TransC ? 1 : p_cLd, l_cColStride = p_TransC ? p_cLd : 1;
+      const size_t l_xRowStride = p_TransC ? 1 : p_xLd, l_xColStride = p_TransC ? p_xLd : 1;
+
+      // Rows of C are independent, each thread computes a range of row blocks
+      auto l_rows = [&](unsigned int p_rowBegin, unsigned int p_rowEnd) {
+        std::vector<AccType> l_sum(p_N), l_blockSum(p_N);
+        for (unsigned int i = p_rowBegin; i < p_rowEnd; ++i) {
+          const t_FloatType *l_aRow = l_a + i * l_aRowStride;
+          for (unsigned int k0 = 0; k0 < p_K; k0 += t_bKD) {
+            std::fill(l_blockSum.begin(), l_blockSum.end(), AccType(0));
+            for (unsigned int k = k0; k < k0 + t_bKD; ++k) {
+              const AccType l_aVal = l_aRow[k * l_aColStride];
+              const t_FloatType *l_bRow = l_b + k * l_bRowStride;
+              for (unsigned int j = 0; j < p_N; ++j) {
+                l_blockSum[j] = l_aVal * (AccType)l_bRow[j * l_bColStride] + l_blockSum[j];
+              }
+            }
+            for (unsigned int j = 0; j < p_N; ++j) {
+              l_sum[j] = (k0 == 0) ? l_blockSum[j] : AccType(l_sum[j] + l_blockSum[j]);
+            }
+          }
+          t_FloatType *l_cRow = l_c + i * l_cRowStride;
+          const t_XDataType *l_xRow = l_x + i * l_xRowStride;
+          for (unsigned int j = 0; j < p_N; ++j) {
+            MacBitType l_ab = l_sum[j];
+            l_cRow[j * l_cColStride] = addXPostScale(l_ab, l_xRow[j * l_xColStride], l_postScaleVal, l_postScaleShift);
+          }
+        }
+      };
+      unsigned int l_rowBlocks = p_M / t_aMH;
+      unsigned int l_threads = std::max(1u, std::min(std::thread::hardware_concurrency(), l_rowBlocks));
+      std::vector<std::thread> l_workers;
+      for (unsigned int t = 1; t < l_threads; ++t) {
+        l_workers.push_back(std::thread(l_rows, l_rowBlocks * t / l_threads * t_aMH, l_rowBlocks * (t + 1) / l_threads * t_aMH));
+      }
+      l_rows(0, l_rowBlocks / l_threads * t_aMH);
+      for (std::thread &l_w : l_workers) {
+        l_w.join();
+      }
+    }
+#endif
+
     void runGemm(
         DdrWideType *p_DdrRd, // base DDR/memory address for matrix A and B
         DdrWideType *p_DdrWr, // base DDR/memory address for matrix C
@@ -1741,13 +2000,21 @@ public:
         	const unsigned int l_cLd  = p_Args.m_Ldc / t_DdrWidth;
 					const unsigned int l_xLd 	= p_Args.m_Ldx / t_XDdrWidth;
 					const int32_t l_postScale = p_Args.m_postScale;
+					#if GEMX_fastCsim && !defined(__SYNTHESIS__)
+					GemmFastCsim(l_aAddr, l_bAddr, l_cAddr, l_xAddr, p_Args.m_M, p_Args.m_K, p_Args.m_N,
+					             p_Args.m_Lda, p_Args.m_Ldb, p_Args.m_Ldc, p_Args.m_Ldx, l_postScale,
+					             p_Args.m_TransA, p_Args.m_TransB, p_Args.m_TransC);
+					#else
 					unsigned int l_transpBlocks = l_aColBlocks * l_aRowBlocks * l_bColBlocks *t_aRowMemWords;
-					GemmBlocks(l_aAddr, l_bAddr, l_cAddr, l_xAddr, l_aColBlocks, l_aRowBlocks, l_bColBlocks, l_aLd, l_bLd, l_cLd, l_xLd, l_transpBlocks, l_postScale);
+					GemmBlocks(l_aAddr, l_bAddr, l_cAddr, l_xAddr, l_aColBlocks, l_aRowBlocks, l_bColBlocks, l_aLd, l_bLd, l_cLd, l_xLd, l_transpBlocks, l_postScale,
+					           p_Args.m_TransA, p_Args.m_TransB, p_Args.m_TransC);
+					#endif
       }
       
     ///////////////////////////////////////////////////////////////////////////
     // GEMM writer ddr stream
-    // 
+    //  p_TransC : C is stored as N x M, each block is collected in a tile
+    //  buffer and written along the stored rows; needs GEMX_gemmTrans
     ///////////////////////////////////////////////////////////////////////////
     void
     GemmWriteDdrStream(
@@ -1755,13 +2022,22 @@ public:
       DdrStream &p_Cs,
 	  	unsigned int l_aRowBlocks,
       unsigned int l_bColBlocks,
-      unsigned int l_cWordLd
+      unsigned int l_cWordLd,
+      bool p_TransC = false
       ) {
         
 		unsigned int l_rowOffset = 0;
 		unsigned int l_colOffset = 0;
 		unsigned int l_dstOffset=0;
 
+#if GEMX_gemmTrans
+		t_FloatType l_cTile[t_bNW][t_aMH];
+		#pragma HLS ARRAY_PARTITION variable=l_cTile cyclic factor=t_DdrWidth dim=1
+		#pragma HLS ARRAY_PARTITION variable=l_cTile cyclic factor=t_DdrWidth dim=2
+#else
+		assert(!p_TransC);
+#endif
+
 			#ifndef __SYNTHESIS__
 				(t_debug >= 1) && std::cout << "    GemmWrite Recieved C\n" ;
       #endif
@@ -1775,16 +2051,44 @@ public:
 					#ifndef __SYNTHESIS__
 						(t_debug >= 1) && std::cout << "Store l_bufferC to DDR\n ";
           	  	  	#endif
-					//write l_bufferC back to DDR
-					for (int i=0; i<t_aRowMemWords*t_DdrWidth; ++i) {
-						unsigned int memAddr = l_dstOffset;
-						for (int j=0; j<t_bColMemWords; ++j) {
-						#pragma HLS PIPELINE
-							DdrWideType l_val = p_Cs.read();
-							l_cAddr[memAddr+j] = l_val;
+#if GEMX_gemmTrans
+					if (p_TransC) {
+						//collect the t_aMH x t_bNW block, then write its transpose
+						for (int i=0; i<t_aMH; ++i) {
+							for (int j=0; j<t_bColMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_val = p_Cs.read();
+								for (int w=0; w<t_DdrWidth; ++w) {
+									l_cTile[j*t_DdrWidth+w][i] = l_val[w];
+								}
+							}
 						}
-						l_dstOffset += l_cWordLd;	
-					}	
+						l_dstOffset = colBlock * t_bNW * l_cWordLd + rowBlock * t_aRowMemWords;
+						for (int i=0; i<t_bNW; ++i) {
+							for (int j=0; j<t_aRowMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_val;
+								for (int w=0; w<t_DdrWidth; ++w) {
+									l_val[w] = l_cTile[i][j*t_DdrWidth+w];
+								}
+								l_cAddr[l_dstOffset+j] = l_val;
+							}
+							l_dstOffset += l_cWordLd;
+						}
+					} else
+#endif
+					{
+						//write l_bufferC back to DDR
+						for (int i=0; i<t_aRowMemWords*t_DdrWidth; ++i) {
+							unsigned int memAddr = l_dstOffset;
+							for (int j=0; j<t_bColMemWords; ++j) {
+							#pragma HLS PIPELINE
+								DdrWideType l_val = p_Cs.read();
+								l_cAddr[memAddr+j] = l_val;
+							}
+							l_dstOffset += l_cWordLd;	
+						}	
+					}
 				}
 				l_rowOffset += l_cWordLd * t_DdrWidth*t_aRowMemWords;
 			} 
@@ -23,7 +23,7 @@
 #define GEMX_GEMV_H
 
 #include "assert.h"
-#include "hls_stream.h"
+#include "gemx_dataflow.h"
 #include "gemx_types.h"
 #include "gemx_kargs.h"
 #include "gemx_transp.h"
@@ -56,8 +56,8 @@ class Gemv
 {
 public:
 	typedef WideType<t_FloatType, t_DdrWidth> DdrWideType;
-	typedef hls::stream<DdrWideType> DdrStream;
-	typedef hls::stream<unsigned int> ParamStream;
+	typedef Stream<DdrWideType> DdrStream;
+	typedef Stream<unsigned int> ParamStream;
 	static const unsigned int t_colBlockLength = t_DdrWidth * t_colMemWords;
 	static const unsigned int t_rowBlockLength = t_DdrWidth * t_rowMemWords;
 	typedef GemvArgs GemvArgsType;
@@ -33,7 +33,9 @@ kernelOpLow(
     DdrType *p_DdrRd,
     DdrType *p_DdrWr,
 //    hls::stream<TimeStampType::OpType> &p_Control,
-    hls::stream<TimeStampType::TimeType> &p_Time
+    hls::stream<TimeStampType::TimeType> &p_Time,
+    unsigned int p_CodePage,
+    unsigned int &p_NextCodePage
   ) {
   #pragma HLS INLINE self off  
   
@@ -70,6 +72,8 @@ kernelOpLow(
   ///////////////////////////////////////////////////////////////////////////
   unsigned int l_pc = 0;
   bool l_isLastOp = false;
+  unsigned int l_nextCodePage = 0;
+  const unsigned int l_resPage = p_CodePage + GEMX_resPage - GEMX_codePage;
   static const unsigned int l_tsDepth = TimeStampType::t_FifoDepth;
   
   // Checks for code, result, and data segment sizes
@@ -81,7 +85,7 @@ kernelOpLow(
 
   // Prefetch all instructions for more accurate cycle measurements
   for (unsigned int l_pc = 0; l_pc < GEMX_numInstr; ++l_pc) {
-    l_code[l_pc].loadFromDdr(p_DdrRd, GEMX_codePage * DdrType::per4k() +
+    l_code[l_pc].loadFromDdr(p_DdrRd, p_CodePage * DdrType::per4k() +
                                       l_pc * KargsType::getInstrWidth());
   }
   
@@ -96,6 +100,10 @@ kernelOpLow(
         ControlArgsType l_controlArgs = l_kargs.getControlArgs();
         l_isLastOp = l_controlArgs.getIsLastOp();
         assert(!l_isLastOp || (l_pc == GEMX_numInstr - 1));
+        if (l_controlArgs.getNextCodePage() != 0) {
+          assert(l_pc == GEMX_numInstr - 1);
+          l_nextCodePage = l_controlArgs.getNextCodePage();
+        }
         break;
       }
       #if GEMX_runGemv==1
@@ -149,6 +157,7 @@ kernelOpLow(
         assert(false);
       }
     }
+    GEMX_STREAM_REPORT(l_pc);
     
     // Collect and store cycle count
     TimeStampType::TimeType l_ts = p_Time.read();
@@ -170,10 +179,31 @@ kernelOpLow(
   
   // Store instruction results in DDR result segment
   for (unsigned int l_pc = 0; l_pc < GEMX_numInstr; ++l_pc) {
-    l_res[l_pc].storeToDdr(p_DdrWr, GEMX_resPage * DdrType::per4k() +
+    l_res[l_pc].storeToDdr(p_DdrWr, l_resPage * DdrType::per4k() +
                                     l_pc * KargsType::getInstrWidth());
   }
+  p_NextCodePage = l_nextCodePage;
+}
+
+// Runs one page worth of instructions together with its timestamp process
+void
+kernelChunk(
+    DdrType *p_DdrRd,
+    DdrType *p_DdrWr,
+    unsigned int p_CodePage,
+    unsigned int &p_NextCodePage
+  ) {
+  #pragma HLS INLINE self off
+  TimeStampType l_tr;
+  //hls::stream<TimeStampType::OpType> l_controlStream;
+  hls::stream<TimeStampType::TimeType> l_timeStream;
+  //#pragma HLS STREAM   variable=l_controlStream  depth=1
+  #pragma HLS STREAM   variable=l_timeStream  depth=1
+
+  # pragma HLS DATAFLOW
   
+  l_tr.runTs(/*l_controlStream, */l_timeStream);
+  kernelOpLow(p_DdrRd, p_DdrWr, /*l_controlStream,*/ l_timeStream, p_CodePage, p_NextCodePage);
 }
 
 void
@@ -195,16 +225,14 @@ GEMX_EVALUATOR(gemxKernel_, GEMX_kernelId)
 	#if TEST_MEMCPY
 	p_DdrWr[0] = p_DdrRd[0];
 	#else
-  TimeStampType l_tr;
-  //hls::stream<TimeStampType::OpType> l_controlStream;
-  hls::stream<TimeStampType::TimeType> l_timeStream;
-  //#pragma HLS STREAM   variable=l_controlStream  depth=1
-  #pragma HLS STREAM   variable=l_timeStream  depth=1
-
-  # pragma HLS DATAFLOW
-  
-  l_tr.runTs(/*l_controlStream, */l_timeStream);
-  kernelOpLow(p_DdrRd, p_DdrWr, /*l_controlStream,*/ l_timeStream);
+  // Follow the chain of code pages until a chunk ends without a next page
+  unsigned int l_codePage = GEMX_codePage;
+  do {
+    unsigned int l_nextCodePage = 0;
+    kernelChunk(p_DdrRd, p_DdrWr, l_codePage, l_nextCodePage);
+    assert(l_nextCodePage == 0 || l_nextCodePage >= GEMX_dataPage);
+    l_codePage = l_nextCodePage;
+  } while (l_codePage != 0);
 	#endif
 }
 
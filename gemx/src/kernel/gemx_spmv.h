@@ -24,7 +24,7 @@
 #define GEMX_SPMV_H
 
 #include "assert.h"
-#include "hls_stream.h"
+#include "gemx_dataflow.h"
 #include "gemx_types.h"
 #include "gemx_kargs.h"
 
@@ -54,21 +54,21 @@ class Spmv
     
   public:
     typedef WideType<t_FloatType, t_DdrWidth> DdrWideType;
-    typedef hls::stream<DdrWideType> DdrWideStreamType;
+    typedef Stream<DdrWideType> DdrWideStreamType;
     typedef SpmvArgs SpmvArgsType;
     typedef SpmvAd<t_FloatType, t_NumIdxBits, t_ColAddIdxBits, t_SpmvWidth> SpmvAdType;  // DDR-side A-type
     typedef SpmvA<t_FloatType,  t_NumIdxBits, t_ColAddIdxBits, t_SpmvWidth> SpmvAType;
     typedef SpmvAB<t_FloatType, t_NumIdxBits, t_ColAddIdxBits, t_SpmvWidth, t_MacGroups> SpmvABType;
     typedef SpmvC<t_FloatType,  t_NumIdxBits, t_ColAddIdxBits, t_SpmvWidth, t_MacGroups> SpmvCType;
-    typedef hls::stream<SpmvAType> SpmvAStreamType;
-    typedef hls::stream<SpmvABType> SpmvABStreamType;
-    typedef hls::stream<SpmvCType> SpmvCStreamType;
+    typedef Stream<SpmvAType> SpmvAStreamType;
+    typedef Stream<SpmvABType> SpmvABStreamType;
+    typedef Stream<SpmvCType> SpmvCStreamType;
     typedef WideType<SpmvAType, t_SpmvWidth> SpmvWideAType;
     typedef WideType<SpmvAdType, t_SpmvWidth> SpmvWideAdType;
     typedef WideType<SpmvABType, t_SpmvWidth> SpmvWideABType;
-    typedef hls::stream<SpmvWideAType> SpmvWideAStreamType;
-    typedef hls::stream<SpmvWideABType> SpmvWideABStreamType;
-    typedef hls::stream<bool> ControlStreamType;
+    typedef Stream<SpmvWideAType> SpmvWideAStreamType;
+    typedef Stream<SpmvWideABType> SpmvWideABStreamType;
+    typedef Stream<bool> ControlStreamType;
     typedef WideType<SpmvAdesc, t_numDescPerDdr> SpmvWideDType;
     static const unsigned int t_RowsInCblock = t_SpmvWidth * t_MacGroups * t_mVectorBlocks * t_DdrWidth; // capacity of m_C; it should be less than the row idx range
     static const unsigned int getRowsInCblock() {return t_RowsInCblock;}
@@ -753,58 +753,74 @@ class Spmv
     multA(DdrWideType *p_aAddr, unsigned int p_numWordsA) {
       static const unsigned int t_FifoDepthDeep = 16;
       static const unsigned int t_FifoDepthShallow = 1;
+      GEMX_DATAFLOW_REGION(l_dataflow);
       
       SpmvWideAStreamType l_fifoCXinp;
       #pragma HLS data_pack variable=l_fifoCXinp
       #pragma HLS STREAM    variable=l_fifoCXinp depth=t_FifoDepthShallow
+      GEMX_STREAM_DEPTH(l_fifoCXinp, t_FifoDepthShallow);
       SpmvAStreamType l_fifoCXsplit[t_SpmvWidth][t_SpmvWidth];
       #pragma HLS data_pack variable=l_fifoCXsplit
       #pragma HLS STREAM    variable=l_fifoCXsplit depth=t_FifoDepthDeep
+      GEMX_STREAM_DEPTH(l_fifoCXsplit, t_FifoDepthDeep);
       SpmvAStreamType l_fifoCUinp[t_SpmvWidth];
       #pragma HLS data_pack variable=l_fifoCUinp
       #pragma HLS STREAM    variable=l_fifoCUinp depth=t_FifoDepthShallow
+      GEMX_STREAM_DEPTH(l_fifoCUinp, t_FifoDepthShallow);
       SpmvABStreamType l_fifoRXinp[t_SpmvWidth];
       #pragma HLS data_pack variable=l_fifoRXinp
       #pragma HLS STREAM    variable=l_fifoRXinp depth=t_FifoDepthShallow
+      GEMX_STREAM_DEPTH(l_fifoRXinp, t_FifoDepthShallow);
       SpmvABStreamType l_fifoRXsplit[t_SpmvWidth][t_SpmvWidth];
       #pragma HLS data_pack variable=l_fifoRXsplit
       #pragma HLS STREAM    variable=l_fifoRXsplit depth=t_FifoDepthDeep
+      GEMX_STREAM_DEPTH(l_fifoRXsplit, t_FifoDepthDeep);
       SpmvABStreamType l_fifoRXmerged[t_SpmvWidth];
       #pragma HLS data_pack variable=l_fifoRXmerged
       #pragma HLS STREAM    variable=l_fifoRXmerged depth=t_FifoDepthDeep
+      GEMX_STREAM_DEPTH(l_fifoRXmerged, t_FifoDepthDeep);
       SpmvABStreamType l_fifoRIout[t_SpmvWidth][t_MacGroups];
       #pragma HLS data_pack variable=l_fifoRIout
       #pragma HLS STREAM    variable=l_fifoRIout  depth=t_FifoDepthDeep
+      GEMX_STREAM_DEPTH(l_fifoRIout, t_FifoDepthDeep);
       SpmvCStreamType l_fifoRUout[t_SpmvWidth][t_MacGroups];
       #pragma HLS data_pack variable=l_fifoRUout
       #pragma HLS STREAM    variable=l_fifoRUout  depth=t_FifoDepthShallow
+      GEMX_STREAM_DEPTH(l_fifoRUout, t_FifoDepthShallow);
 
       ControlStreamType l_controlCXsplitDone;
       #pragma HLS data_pack variable=l_controlCXsplitDone
       #pragma HLS STREAM    variable=l_controlCXsplitDone
+      GEMX_STREAM_DEPTH(l_controlCXsplitDone, GEMX_streamDefaultDepth);
 
       ControlStreamType l_controlCUpre[t_SpmvWidth];
       #pragma HLS data_pack variable=l_controlCUpre
       #pragma HLS STREAM    variable=l_controlCUpre
+      GEMX_STREAM_DEPTH(l_controlCUpre, GEMX_streamDefaultDepth);
 
       ControlStreamType l_controlCUpost[t_SpmvWidth];
       #pragma HLS data_pack variable=l_controlCUpost
       #pragma HLS STREAM    variable=l_controlCUpost
+      GEMX_STREAM_DEPTH(l_controlCUpost, GEMX_streamDefaultDepth);
 
       ControlStreamType l_controlRXsplitDone;
       #pragma HLS data_pack variable=l_controlRXsplitDone
       #pragma HLS STREAM    variable=l_controlRXsplitDone
+      GEMX_STREAM_DEPTH(l_controlRXsplitDone, GEMX_streamDefaultDepth);
       ControlStreamType l_controlRXmergeDone[t_SpmvWidth];
       #pragma HLS data_pack variable=l_controlRXmergeDone
       #pragma HLS STREAM    variable=l_controlRXmergeDone
+      GEMX_STREAM_DEPTH(l_controlRXmergeDone, GEMX_streamDefaultDepth);
 
       ControlStreamType l_controlRiDone[t_SpmvWidth];
       #pragma HLS data_pack variable=l_controlRiDone
       #pragma HLS STREAM    variable=l_controlRiDone
+      GEMX_STREAM_DEPTH(l_controlRiDone, GEMX_streamDefaultDepth);
       
       ControlStreamType l_controlRUpost[t_SpmvWidth];
       #pragma HLS data_pack variable=l_controlRUpost
       #pragma HLS STREAM    variable=l_controlRUpost
+      GEMX_STREAM_DEPTH(l_controlRUpost, GEMX_streamDefaultDepth);
       
       #pragma HLS array_partition variable=m_B dim=1 COMPLETE
       #pragma HLS array_partition variable=m_C dim=1 COMPLETE
@@ -823,26 +839,27 @@ class Spmv
       
       #pragma HLS DATAFLOW
       
-      loaderA(p_aAddr, p_numWordsA, l_fifoCXinp);
+      GEMX_DATAFLOW_PROCESS(l_dataflow, loaderA(p_aAddr, p_numWordsA, l_fifoCXinp));
       
-      xBarColSplit(p_numWordsA, l_fifoCXinp, l_fifoCXsplit, l_controlCXsplitDone);
-      xBarColMerge(l_fifoCXsplit, l_fifoCUinp, l_controlCXsplitDone, l_controlCUpre);
+      GEMX_DATAFLOW_PROCESS(l_dataflow, xBarColSplit(p_numWordsA, l_fifoCXinp, l_fifoCXsplit, l_controlCXsplitDone));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, xBarColMerge(l_fifoCXsplit, l_fifoCUinp, l_controlCXsplitDone, l_controlCUpre));
       
       LOOP_W_CU:for(int w = 0; w < t_SpmvWidth; ++w) {
         #pragma HLS UNROLL
-        colUnit(l_fifoCUinp[w], l_fifoRXinp[w], l_controlCUpre[w], l_controlCUpost[w], w);
+        GEMX_DATAFLOW_PROCESS_AT(l_dataflow, w, colUnit(l_fifoCUinp[w], l_fifoRXinp[w], l_controlCUpre[w], l_controlCUpost[w], w));
       }
       
-      xBarRowSplit(l_fifoRXinp, l_fifoRXsplit, l_controlCUpost, l_controlRXsplitDone);
-      xBarRowMerge(l_fifoRXsplit, l_fifoRXmerged, l_controlRXsplitDone, l_controlRXmergeDone);
+      GEMX_DATAFLOW_PROCESS(l_dataflow, xBarRowSplit(l_fifoRXinp, l_fifoRXsplit, l_controlCUpost, l_controlRXsplitDone));
+      GEMX_DATAFLOW_PROCESS(l_dataflow, xBarRowMerge(l_fifoRXsplit, l_fifoRXmerged, l_controlRXsplitDone, l_controlRXmergeDone));
 
       LOOP_W_RU:for(int w = 0; w < t_SpmvWidth; ++w) {
         #pragma HLS UNROLL
-        rowInterleave(l_fifoRXmerged[w], l_fifoRIout[w], l_controlRXmergeDone[w],
-                      l_controlRiDone[w], w);
-        rowUnit(l_fifoRIout[w], l_fifoRUout[w], l_controlRiDone[w], l_controlRUpost[w], w);
-        aggUnit(l_fifoRUout[w], l_controlRUpost[w], w);
+        GEMX_DATAFLOW_PROCESS_AT(l_dataflow, w, rowInterleave(l_fifoRXmerged[w], l_fifoRIout[w], l_controlRXmergeDone[w],
+                      l_controlRiDone[w], w));
+        GEMX_DATAFLOW_PROCESS_AT(l_dataflow, w, rowUnit(l_fifoRIout[w], l_fifoRUout[w], l_controlRiDone[w], l_controlRUpost[w], w));
+        GEMX_DATAFLOW_PROCESS_AT(l_dataflow, w, aggUnit(l_fifoRUout[w], l_controlRUpost[w], w));
      }
+      GEMX_DATAFLOW_WAIT(l_dataflow);
     }
 
     void
@@ -25,7 +25,7 @@
 #define GEMX_SPMV_COO_H
 
 #include "assert.h"
-#include "hls_stream.h"
+#include "gemx_dataflow.h"
 #include "gemx_spmv_coo_types.h"
 #include "gemx_kargs.h"
 
@@ -75,19 +75,19 @@ class SpmvCoo
 
 		typedef SpmC<t_FloatType, t_IdxType, t_NumUramPerDdr, t_UramWidth> SpmCType;
 
-    typedef hls::stream<DdrWideType> DdrWideStreamType;
-		typedef hls::stream<IdxWideType> IdxWideStreamType;
-		typedef hls::stream<SpmCooWideType> SpmCooWideStreamType;
-		typedef hls::stream<SpmCooUramWideType> SpmCooUramWideStreamType;
-		typedef hls::stream<SpmColType> SpmColStreamType;
-		typedef hls::stream<SpmCooType> SpmCooStreamType;
-		typedef hls::stream<SpmABType> SpmABStreamType;
-		typedef hls::stream<SpmCType> SpmCStreamType;
-		typedef hls::stream<bool>ControlStreamType;
-		typedef hls::stream<t_FloatType> FloatStreamType;
-		typedef hls::stream<t_IdxType> IdxStreamType;
-		typedef hls::stream<uint8_t> ByteStreamType;
-   	typedef hls::stream<UramWideType> WordBStreamType; 
+    typedef Stream<DdrWideType> DdrWideStreamType;
+		typedef Stream<IdxWideType> IdxWideStreamType;
+		typedef Stream<SpmCooWideType> SpmCooWideStreamType;
+		typedef Stream<SpmCooUramWideType> SpmCooUramWideStreamType;
+		typedef Stream<SpmColType> SpmColStreamType;
+		typedef Stream<SpmCooType> SpmCooStreamType;
+		typedef Stream<SpmABType> SpmABStreamType;
+		typedef Stream<SpmCType> SpmCStreamType;
+		typedef Stream<bool>ControlStreamType;
+		typedef Stream<t_FloatType> FloatStreamType;
+		typedef Stream<t_IdxType> IdxStreamType;
+		typedef Stream<uint8_t> ByteStreamType;
+   	typedef Stream<UramWideType> WordBStreamType; 
   private:
 		//| -------------- DdrWord -----------------|
 		//|--URAM_0--| ... |--URAM_t_NumUramPerDdr--|
@@ -23,7 +23,7 @@
 #define GEMX_TRANSP_H
 
 #include "assert.h"
-#include "hls_stream.h"
+#include "gemx_dataflow.h"
 #include "gemx_types.h"
 #include "gemx_kargs.h"
 
@@ -58,7 +58,7 @@ class Transp
 {
 public:
 	typedef WideType<t_FloatType, t_DdrWidth> DdrWideType;
-	typedef hls::stream<DdrWideType> DdrStream;
+	typedef Stream<DdrWideType> DdrStream;
 	static const unsigned short t_colBlockLength = t_DdrWidth * t_colMemWords;
 	static const unsigned short t_rowBlockLength = t_DdrWidth * t_rowMemWords;
     typedef TranspArgs TranspArgsType;
@@ -575,6 +575,7 @@ void store_matrixGVA(DdrStream &toMemStream, DdrWideType *l_AddrWr, unsigned int
 void transp_matrix_blocks(DdrWideType *l_AddrRd, unsigned int l_srcWordLd, unsigned int l_rowBlocks, DdrWideType *l_AddrWr, unsigned int l_dstWordLd, unsigned int l_colBlocks, unsigned int numOfBlocks) {
 
 #pragma HLS DATAFLOW
+	GEMX_DATAFLOW_REGION(l_dataflow);
 
 	DdrStream fromMemStream("fromMemStream");
 	DdrStream wrStream("wrStream");
@@ -587,42 +588,52 @@ void transp_matrix_blocks(DdrWideType *l_AddrRd, unsigned int l_srcWordLd, unsig
 	
 	#pragma HLS DATA_PACK variable=fromMemStream
 	#pragma HLS STREAM variable=fromMemStream depth=4
+	GEMX_STREAM_DEPTH(fromMemStream, 4);
 	
 	#pragma HLS DATA_PACK variable=wrStream
 	#pragma HLS STREAM variable=wrStream depth=4
+	GEMX_STREAM_DEPTH(wrStream, 4);
 	
 	#pragma HLS DATA_PACK variable=wrStream1
 	#pragma HLS STREAM variable=wrStream1 depth=4
+	GEMX_STREAM_DEPTH(wrStream1, 4);
 
 	#pragma HLS DATA_PACK variable=wrStream2
 	#pragma HLS STREAM variable=wrStream2 depth=4
+	GEMX_STREAM_DEPTH(wrStream2, 4);
 
 	#pragma HLS DATA_PACK variable=shuffleStream1
 	#pragma HLS STREAM variable=shuffleStream1 depth=4
+	GEMX_STREAM_DEPTH(shuffleStream1, 4);
 
 	#pragma HLS DATA_PACK variable=shuffleStream2
 	#pragma HLS STREAM variable=shuffleStream2 depth=4
+	GEMX_STREAM_DEPTH(shuffleStream2, 4);
 
 	#pragma HLS DATA_PACK variable=shuffleStream
 	#pragma HLS STREAM variable=shuffleStream depth=4
+	GEMX_STREAM_DEPTH(shuffleStream, 4);
 	
 	#pragma HLS DATA_PACK variable=toMemStream
 	#pragma HLS STREAM variable=toMemStream depth=4
+	GEMX_STREAM_DEPTH(toMemStream, 4);
 
-	load_matrix(l_AddrRd, l_srcWordLd, l_rowBlocks, l_colBlocks, fromMemStream);
-	shuffle_input(fromMemStream, wrStream, numOfBlocks);
+	GEMX_DATAFLOW_PROCESS(l_dataflow, load_matrix(l_AddrRd, l_srcWordLd, l_rowBlocks, l_colBlocks, fromMemStream));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, shuffle_input(fromMemStream, wrStream, numOfBlocks));
 	//WR_buffer(wrStream, shuffleStream, numOfBlocks);
-	split(wrStream, wrStream1, wrStream2, numOfBlocks);
-	WR_buffer(wrStream1, shuffleStream1, ((numOfBlocks/2) + (numOfBlocks%2)));
-	WR_buffer(wrStream2, shuffleStream2, numOfBlocks/2);
-	merge(shuffleStream1, shuffleStream2, shuffleStream, numOfBlocks);
-	shuffle_output(shuffleStream, toMemStream, numOfBlocks);
-	store_matrix(toMemStream, l_AddrWr, l_dstWordLd, l_rowBlocks, l_colBlocks); 
+	GEMX_DATAFLOW_PROCESS(l_dataflow, split(wrStream, wrStream1, wrStream2, numOfBlocks));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, WR_buffer(wrStream1, shuffleStream1, ((numOfBlocks/2) + (numOfBlocks%2))));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, WR_buffer(wrStream2, shuffleStream2, numOfBlocks/2));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, merge(shuffleStream1, shuffleStream2, shuffleStream, numOfBlocks));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, shuffle_output(shuffleStream, toMemStream, numOfBlocks));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, store_matrix(toMemStream, l_AddrWr, l_dstWordLd, l_rowBlocks, l_colBlocks));
+	GEMX_DATAFLOW_WAIT(l_dataflow);
 }
 
 void transp_GemvA_blocks(DdrWideType *l_AddrRd, unsigned int l_srcWordLd, unsigned int l_rowBlocks, DdrWideType *l_AddrWr, unsigned int l_dstWordLd, unsigned int l_colBlocks, unsigned int numOfBlocks) {
 
 #pragma HLS DATAFLOW
+	GEMX_DATAFLOW_REGION(l_dataflow);
 
 	DdrStream fromMemStream("fromMemStream");
 	DdrStream wrStream("wrStream");
@@ -631,21 +642,26 @@ void transp_GemvA_blocks(DdrWideType *l_AddrRd, unsigned int l_srcWordLd, unsign
 	
 	#pragma HLS DATA_PACK variable=fromMemStream
 	#pragma HLS STREAM variable=fromMemStream depth=4
+	GEMX_STREAM_DEPTH(fromMemStream, 4);
 	
 	#pragma HLS DATA_PACK variable=wrStream
 	#pragma HLS STREAM variable=wrStream depth=4
+	GEMX_STREAM_DEPTH(wrStream, 4);
 	
 	#pragma HLS DATA_PACK variable=shuffleStream
 	#pragma HLS STREAM variable=shuffleStream depth=4
+	GEMX_STREAM_DEPTH(shuffleStream, 4);
 	
 	#pragma HLS DATA_PACK variable=toMemStream
 	#pragma HLS STREAM variable=toMemStream depth=4
-
-	load_matrix(l_AddrRd, l_srcWordLd, l_rowBlocks, l_colBlocks, fromMemStream);
-	shuffle_input(fromMemStream, wrStream, numOfBlocks);
-	WR_buffer(wrStream, shuffleStream, numOfBlocks);
-	shuffle_output(shuffleStream, toMemStream, numOfBlocks);
-	store_matrixGVA(toMemStream, l_AddrWr, l_dstWordLd, l_rowBlocks, l_colBlocks); 
+	GEMX_STREAM_DEPTH(toMemStream, 4);
+
+	GEMX_DATAFLOW_PROCESS(l_dataflow, load_matrix(l_AddrRd, l_srcWordLd, l_rowBlocks, l_colBlocks, fromMemStream));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, shuffle_input(fromMemStream, wrStream, numOfBlocks));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, WR_buffer(wrStream, shuffleStream, numOfBlocks));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, shuffle_output(shuffleStream, toMemStream, numOfBlocks));
+	GEMX_DATAFLOW_PROCESS(l_dataflow, store_matrixGVA(toMemStream, l_AddrWr, l_dstWordLd, l_rowBlocks, l_colBlocks));
+	GEMX_DATAFLOW_WAIT(l_dataflow);
 }
     void runTransp(
         DdrWideType *p_DdrRd,
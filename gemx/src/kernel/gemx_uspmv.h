@@ -25,7 +25,7 @@
 #define GEMX_USPMV_H
 
 #include "assert.h"
-#include "hls_stream.h"
+#include "gemx_dataflow.h"
 #include "gemx_types.h"
 #include "gemx_kargs.h"
 
@@ -171,18 +171,18 @@ class Uspmv
     typedef unsigned int ParamType;
 		typedef WideType<ParamType, t_ParamWidth> ParamWideType;
 
-		typedef hls::stream<t_FloatType> DataStreamType;
-    typedef hls::stream<DataDdrWideType> DataDdrWideStreamType;
-		typedef hls::stream<IdxDdrWideType> IdxDdrWideStreamType;
-		typedef hls::stream<UspmvCDdrWideType> UspmvCDdrWideStreamType;
-		typedef hls::stream<TaggedUspmvCDdrWideType> TaggedUspmvCDdrWideStreamType;
+		typedef Stream<t_FloatType> DataStreamType;
+    typedef Stream<DataDdrWideType> DataDdrWideStreamType;
+		typedef Stream<IdxDdrWideType> IdxDdrWideStreamType;
+		typedef Stream<UspmvCDdrWideType> UspmvCDdrWideStreamType;
+		typedef Stream<TaggedUspmvCDdrWideType> TaggedUspmvCDdrWideStreamType;
 
-		typedef hls::stream<UspmvCType> UspmvCStreamType;
-		typedef hls::stream<TaggedUspmvCType> TaggedUspmvCStreamType;
+		typedef Stream<UspmvCType> UspmvCStreamType;
+		typedef Stream<TaggedUspmvCType> TaggedUspmvCStreamType;
 
-		typedef hls::stream<bool> ControlStreamType;
-		typedef hls::stream<ControlWideType> ControlWideStreamType;
-    typedef hls::stream<ParamType> ParamStreamType;
+		typedef Stream<bool> ControlStreamType;
+		typedef Stream<ControlWideType> ControlWideStreamType;
+    typedef Stream<ParamType> ParamStreamType;
 
 		typedef UspmvArgs UspmvArgsType;
 
@@ -747,66 +747,83 @@ public:
 			unsigned int t_StageId) {
 			static const unsigned int t_FifoDeep=16;//16;
 			static const unsigned int t_FifoShallow = 2;
+			GEMX_DATAFLOW_REGION(l_dataflow);
 			
 			IdxDdrWideStreamType l_idx2pairB;
 			#pragma HLS data_pack variable=l_idx2pairB
 			#pragma HLS stream variable=l_idx2pairB depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_idx2pairB, t_FifoShallow);
 			DataDdrWideStreamType l_data2pairB;
 			#pragma HLS data_pack variable=l_data2pairB
 			#pragma HLS stream variable=l_data2pairB depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_data2pairB, t_FifoShallow);
 			DataDdrWideStreamType l_dataB2multAB;
 			#pragma HLS data_pack variable=l_dataB2multAB
 			#pragma HLS stream variable=l_dataB2multAB depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_dataB2multAB, t_FifoShallow);
 			DataDdrWideStreamType l_data2formC;
 			#pragma HLS data_pack variable=l_data2formC
 			#pragma HLS stream variable=l_data2formC depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_data2formC, t_FifoShallow);
 			TaggedUspmvCStreamType l_data2xBarRow[t_DdrWidth][t_DdrWidth];
 			#pragma HLS data_pack variable=l_data2xBarRow
 			#pragma HLS stream variable=l_data2xBarRow depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_data2xBarRow, t_FifoShallow);
 
 			TaggedUspmvCStreamType l_data2rowInterleave[t_DdrWidth];
 			#pragma HLS data_pack variable=l_data2rowInterleave
 			#pragma HLS stream variable=l_data2rowInterleave depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_data2rowInterleave, t_FifoShallow);
 			TaggedUspmvCStreamType l_data2accRowBank[t_DdrWidth][t_Interleaves];
 			#pragma HLS data_pack variable=l_data2accRowBank
 			#pragma HLS stream variable=l_data2accRowBank depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_data2accRowBank, t_FifoShallow);
 			DataStreamType l_data2mergeC[t_DdrWidth];
 			#pragma HLS data_pack variable=l_data2mergeC
 			#pragma HLS stream variable=l_data2mergeC depth=t_FifoShallow
+			GEMX_STREAM_DEPTH(l_data2mergeC, t_FifoShallow);
       ParamStreamType l_param2pairB;
       #pragma HLS data_pack variable=l_param2pairB
       #pragma HLS stream variable=l_param2pairB
+      GEMX_STREAM_DEPTH(l_param2pairB, GEMX_streamDefaultDepth);
       ParamStreamType l_param2multAB;
       #pragma HLS data_pack variable=l_param2multAB
       #pragma HLS stream variable=l_param2multAB
+      GEMX_STREAM_DEPTH(l_param2multAB, GEMX_streamDefaultDepth);
       ParamStreamType l_param2formC;
       #pragma HLS data_pack variable=l_param2formC
       #pragma HLS stream variable=l_param2formC
+      GEMX_STREAM_DEPTH(l_param2formC, GEMX_streamDefaultDepth);
       ParamStreamType l_param2xBarRow;
       #pragma HLS data_pack variable=l_param2xBarRow
       #pragma HLS stream variable=l_param2xBarRow
+      GEMX_STREAM_DEPTH(l_param2xBarRow, GEMX_streamDefaultDepth);
       ParamStreamType l_param2rowInterleave[t_DdrWidth];
       #pragma HLS data_pack variable=l_param2rowInterleave
       #pragma HLS stream variable=l_param2rowInterleave
+      GEMX_STREAM_DEPTH(l_param2rowInterleave, GEMX_streamDefaultDepth);
       ParamStreamType l_param2accRowBank[t_DdrWidth];
       #pragma HLS data_pack variable=l_param2accRowBank
       #pragma HLS stream variable=l_param2accRowBank
+      GEMX_STREAM_DEPTH(l_param2accRowBank, GEMX_streamDefaultDepth);
       ParamStreamType l_param2mergeC[t_DdrWidth];
       #pragma HLS data_pack variable=l_param2mergeC
       #pragma HLS stream variable=l_param2mergeC
+      GEMX_STREAM_DEPTH(l_param2mergeC, GEMX_streamDefaultDepth);
 		
 			#pragma HLS DATAFLOW
-      readCol(p_inParams, p_inBs, l_param2pairB, l_idx2pairB, l_data2pairB, t_StageId);
-			pairB(l_param2pairB, l_idx2pairB, l_data2pairB, l_param2multAB, l_dataB2multAB, t_StageId);
-			multAB(l_dataB2multAB, l_data2formC, l_param2multAB, l_param2formC, t_StageId); 
-			formC(l_data2formC, l_data2xBarRow, l_param2formC, l_param2xBarRow, t_StageId);
-			xBarRow(l_data2xBarRow, l_data2rowInterleave, l_param2xBarRow, l_param2rowInterleave, t_StageId); 
+      GEMX_DATAFLOW_PROCESS(l_dataflow, readCol(p_inParams, p_inBs, l_param2pairB, l_idx2pairB, l_data2pairB, t_StageId));
+			GEMX_DATAFLOW_PROCESS(l_dataflow, pairB(l_param2pairB, l_idx2pairB, l_data2pairB, l_param2multAB, l_dataB2multAB, t_StageId));
+			GEMX_DATAFLOW_PROCESS(l_dataflow, multAB(l_dataB2multAB, l_data2formC, l_param2multAB, l_param2formC, t_StageId)); 
+			GEMX_DATAFLOW_PROCESS(l_dataflow, formC(l_data2formC, l_data2xBarRow, l_param2formC, l_param2xBarRow, t_StageId));
+			GEMX_DATAFLOW_PROCESS(l_dataflow, xBarRow(l_data2xBarRow, l_data2rowInterleave, l_param2xBarRow, l_param2rowInterleave, t_StageId)); 
 			for (unsigned int w=0; w<t_DdrWidth; ++w) {
 			#pragma HLS unroll
-				rowInterleave(l_data2rowInterleave[w], l_data2accRowBank[w], l_param2rowInterleave[w], l_param2accRowBank[w], t_StageId);
-				accRowBank(l_data2accRowBank[w], l_data2mergeC[w], l_param2accRowBank[w], l_param2mergeC[w], t_StageId);
+				GEMX_DATAFLOW_PROCESS_AT(l_dataflow, w, rowInterleave(l_data2rowInterleave[w], l_data2accRowBank[w], l_param2rowInterleave[w], l_param2accRowBank[w], t_StageId));
+				GEMX_DATAFLOW_PROCESS_AT(l_dataflow, w, accRowBank(l_data2accRowBank[w], l_data2mergeC[w], l_param2accRowBank[w], l_param2mergeC[w], t_StageId));
 			}
-			mergeC(l_data2mergeC,p_outCs, l_param2mergeC, p_outParams, t_StageId);
+			GEMX_DATAFLOW_PROCESS(l_dataflow, mergeC(l_data2mergeC,p_outCs, l_param2mergeC, p_outParams, t_StageId));
+			GEMX_DATAFLOW_WAIT(l_dataflow);
 		}
 
 		//initiate sparse matrices with data from device memory
@@ -984,12 +1001,15 @@ public:
 			unsigned int p_numRuns
 		)
 		{
+			GEMX_DATAFLOW_REGION(l_dataflow);
 			DataDdrWideStreamType l_bS[t_StagesPlusOne];
 			#pragma HLS data_pack variable=l_bS
 			#pragma HLS stream variable=l_bS 
+			GEMX_STREAM_DEPTH(l_bS, GEMX_streamDefaultDepth);
       ParamStreamType l_paramS[t_StagesPlusOne];
       #pragma HLS data_pack variable=l_paramS
       #pragma HLS stream variable=l_paramS 
+      GEMX_STREAM_DEPTH(l_paramS, GEMX_streamDefaultDepth);
  
 			#pragma HLS resource variable=m_Acol core=XPM_MEMORY uram
 			#pragma HLS data_pack variable=m_Acol
@@ -1009,13 +1029,14 @@ public:
 			#pragma HLS ARRAY_PARTITION variable=m_Prelus complete
 			
 			#pragma HLS DATAFLOW
-			loadB (p_bAddr, l_bS[0], l_paramS[0], p_numRuns);
+			GEMX_DATAFLOW_PROCESS(l_dataflow, loadB (p_bAddr, l_bS[0], l_paramS[0], p_numRuns));
 			for (unsigned int i=0; i<t_Stages; ++i) {
 			#pragma HLS unroll
-			  spmvCompute(l_bS[i], l_bS[i+1], l_paramS[i], l_paramS[i+1], i);
+			  GEMX_DATAFLOW_PROCESS_AT(l_dataflow, i, spmvCompute(l_bS[i], l_bS[i+1], l_paramS[i], l_paramS[i+1], i));
 			}
 			//spmvCompute(l_bS[0], l_bS[1], l_paramS[0], l_paramS[1], 0);
-			storeC(l_bS[t_Stages],p_cAddr, l_paramS[t_Stages]);
+			GEMX_DATAFLOW_PROCESS(l_dataflow, storeC(l_bS[t_Stages],p_cAddr, l_paramS[t_Stages]));
+			GEMX_DATAFLOW_WAIT(l_dataflow);
 		}	
 		
 		void
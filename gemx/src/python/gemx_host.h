@@ -70,9 +70,10 @@ public:
     GemmArgs(unsigned int p_Aoffset, unsigned int p_Boffset,
             unsigned int p_Coffset, unsigned int p_Xoffset, unsigned int p_M, unsigned int p_K,
             unsigned int p_N, unsigned int p_Lda, unsigned int p_Ldb,
-            unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift) :
+            unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift,
+            bool p_TransA = false, bool p_TransB = false, bool p_TransC = false) :
                 m_gemm_args( { int(OpGemm),  p_Aoffset, p_Boffset, p_Coffset, p_Xoffset, p_M, p_K,
-        p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, 0, 0, 0 }) {	
+        p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, p_TransA, p_TransB, p_TransC, 0, {0, 0} }) {	
         m_gemm_args.m_postScaleVal = (post_scale << 8) | (post_shift & 0x000000ff);
     }
     size_t sizeInBytes() {
@@ -88,7 +89,9 @@ protected:
         unsigned int m_Aoffset, m_Boffset, m_Coffset, m_Xoffset, m_M, m_K, m_N,
         m_Lda, m_Ldb, m_Ldc, m_Ldx;
 	int m_postScaleVal;
-        int dummy[3];
+        bool m_TransA, m_TransB, m_TransC;
+        char c_dummy;
+        int dummy[2];
     } m_gemm_args;
 };
 
@@ -100,9 +103,10 @@ public:
     FcnArgs(unsigned int p_Aoffset, unsigned int p_Boffset,
             unsigned int p_Coffset, unsigned int p_Xoffset, unsigned int p_M, unsigned int p_K,
             unsigned int p_N, unsigned int p_Lda, unsigned int p_Ldb,
-            unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift, short prelu_scale, short prelu_alpha) :
+            unsigned int p_Ldc, unsigned int p_Ldx, int post_scale, int post_shift, short prelu_scale, short prelu_alpha,
+            bool p_TransA = false, bool p_TransB = false, bool p_TransC = false) :
                 m_fcn_args( { OpFcn, p_Aoffset, p_Boffset, p_Coffset, p_Xoffset, p_M, p_K,
-        p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, 0, 0, 0 }) {
+        p_N, p_Lda, p_Ldb, p_Ldc, p_Ldx, 0, 0, p_TransA, p_TransB, p_TransC, {0, 0, 0}, {0} }) {
 
         m_fcn_args.m_postScaleVal = (post_scale << 8) | (post_shift & 0x000000ff);
         m_fcn_args.m_PReLUVal = (prelu_scale << 6) | (prelu_alpha & 0x003f);
@@ -136,8 +140,9 @@ protected:
         m_Lda, m_Ldb, m_Ldc, m_Ldx;
         int m_postScaleVal;
         short m_PReLUVal;
-        short s_dummy;
-        int dummy[2];
+        bool m_TransA, m_TransB, m_TransC;
+        char c_dummy[3];
+        int dummy[1];
     } m_fcn_args;
 };
 
@@ -663,7 +668,7 @@ public:
         return AddGEMMOp (A, B, C, bias, m, k, n, k, n, n, n, postScale, postShift);
     }
 
-    bool AddGEMMOp(const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift) {
+    bool AddGEMMOp(const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, bool transA = false, bool transB = false, bool transC = false) {
         XTimer t;
         if (_hostMat.find(A) == _hostMat.end()
                 || _hostMat.find(B) == _hostMat.end()
@@ -711,7 +716,7 @@ public:
         X_off /= PAGE_SIZE;
 	
         GemmArgs gargs(A_off, B_off, C_off, X_off, m,
-                k, n, lda, ldb, ldc, ldx, postScale, postShift);
+                k, n, lda, ldb, ldc, ldx, postScale, postShift, transA, transB, transC);
 	AddInstr ( &gargs);
         return true;
     }
@@ -883,7 +888,7 @@ public:
         return AddFCNOp ( A, B, C, bias, m, k, n, k, n, n, n,postScale, postShift, PReLUScale, PReLUAlpha);
     }
 
-    bool AddFCNOp ( const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha)
+    bool AddFCNOp ( const HType & A, const HType & B, const HType &C, const HType & bias, unsigned int m, unsigned int k, unsigned int n, unsigned int lda, unsigned int ldb, unsigned int ldc, unsigned int ldx, int postScale, int postShift, short PReLUScale, short PReLUAlpha, bool transA = false, bool transB = false, bool transC = false)
     {
         XTimer t;
         if (this->_hostMat.find(A) == this->_hostMat.end()
@@ -989,7 +994,7 @@ public:
         X_off /= this->PAGE_SIZE;
 
         FcnArgs args(A_off, B_off, C_off, X_off, m,
-                k, n, lda, ldb, ldc, ldx, postScale, postShift,  PReLUScale, PReLUAlpha);
+                k, n, lda, ldb, ldc, ldx, postScale, postShift,  PReLUScale, PReLUAlpha, transA, transB, transC);
         this->AddInstr ( &args);
 #ifdef GEMX_PERF_DBG
         cout << "AddFCNOp: " << t.elapsed() << endl;